@@ -3,15 +3,14 @@
 #include <algorithm>
 #include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <optional>
 #include <vector>
 
 #include "date/date.h"
 #include "subtitler/cli/io/input.h"
 #include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_retime.h"
 #include "subtitler/util/duration_format.h"
-#include "subtitler/util/temp_file.h"
 #include "subtitler/util/unicode.h"
 #include "subtitler/video/metadata/ffprobe.h"
 #include "subtitler/video/player/ffplay.h"
@@ -34,6 +33,10 @@ const char* PRINT_SUBS_COMMAND = "printsubs";
 const char* ADD_SUB_COMMAND = "add";
 const char* DELETE_SUB_COMMAND = "delete";
 const char* EDIT_SUB_COMMAND = "edit";
+const char* RETIME_COMMAND = "retime";
+const char* FIND_COMMAND = "find";
+const char* UNDO_COMMAND = "undo";
+const char* REDO_COMMAND = "redo";
 const char* SAVE_COMMAND = "save";
 
 const char* QUIT_COMMAND = "quit";
@@ -82,7 +85,8 @@ Commands::Commands(const Paths& paths,
                    std::unique_ptr<video::player::FFPlay> ffplay,
                    std::unique_ptr<io::InputGetter> input_getter,
                    std::ostream& output,
-                   std::unique_ptr<video::metadata::Metadata> metadata)
+                   std::unique_ptr<video::metadata::Metadata> metadata,
+                   std::size_t journal_compact_threshold)
     : paths_{paths},
       ffplay_{std::move(ffplay)},
       input_getter_{std::move(input_getter)},
@@ -91,6 +95,8 @@ Commands::Commands(const Paths& paths,
       start_{0ms},
       duration_{5s},
       srt_file_{},
+      journal_{GetFileSystemUtf8Path(paths.output_subtitle_path),
+               journal_compact_threshold},
       srt_file_has_changed_{false} {
   if (!ffplay_) {
     throw std::invalid_argument("ffplay must not be null");
@@ -112,18 +118,32 @@ void Commands::MainLoop() {
   output_ << "Starting interactive mode. Type help for instructions."
           << std::endl;
 
-  // Load existing subtitles if any.
-  auto path = GetFileSystemUtf8Path(paths_.output_subtitle_path);
-  if (fs::exists(path)) {
-    try {
-      srt_file_.LoadState(path);
-      if (srt_file_.NumItems() > 0) {
-        output_ << "Loaded existing subtitles!" << std::endl;
-      }
-    } catch (const std::exception& e) {
-      output_ << e.what() << std::endl;
+  // Load existing subtitles if any, recovering any unsaved edits left in the
+  // journal by a previous session.
+  try {
+    srt::SubRipFile::Builder builder;
+    for (const auto& item : journal_.Open()) {
+      builder.Add(item);
+    }
+    srt_file_ = builder.Build();
+    if (journal_.recovered_changes()) {
+      // Still unsaved, so quitting asks whether to keep them.
+      srt_file_has_changed_ = true;
+      output_ << "Recovered unsaved changes!" << std::endl;
     }
+    if (srt_file_.NumItems() > 0) {
+      output_ << "Loaded existing subtitles!" << std::endl;
+    }
+  } catch (const std::exception& e) {
+    // Editing on top of an empty file would overwrite the subtitles on save,
+    // and pile new edits onto a journal which can't be replayed.
+    output_ << e.what() << std::endl;
+    output_ << "Could not load " << paths_.output_subtitle_path
+            << ", exiting." << std::endl;
+    return;
   }
+  history_.Reset(srt_file_);
+  search_index_ = srt::SubRipSearchIndex{srt_file_};
 
   std::string command;
   while (input_getter_->getline(command)) {
@@ -149,6 +169,16 @@ void Commands::MainLoop() {
     } else if (tokens.front() == EDIT_SUB_COMMAND) {
       tokens.erase(tokens.begin());
       EditSub(tokens);
+    } else if (tokens.front() == RETIME_COMMAND) {
+      tokens.erase(tokens.begin());
+      Retime(tokens);
+    } else if (tokens.front() == FIND_COMMAND) {
+      tokens.erase(tokens.begin());
+      Find(tokens);
+    } else if (tokens.front() == UNDO_COMMAND) {
+      Undo();
+    } else if (tokens.front() == REDO_COMMAND) {
+      Redo();
     } else if (tokens.front() == SAVE_COMMAND) {
       Save();
     } else if (tokens.front() == HELP_COMMAND) {
@@ -190,6 +220,17 @@ void Commands::Help() {
             << "               However delete --force {seq_num} enables deleting any subtitle." << std::endl;
     output_ << "edit      -- Edit an existing subtitle. Currently supports changing position." << std::endl
             << "               Use edit {seq_num} position or p {position} to set the new position." << std::endl;
+    output_ << "retime    -- Retimes all subtitles at once." << std::endl
+            << "               Use retime shift {time} or retime shift -{time} to move them later or earlier." << std::endl
+            << "               Use retime stretch {factor} to scale them around the current player position." << std::endl
+            << "               Use retime fps {from} {to} to convert them from one frame rate to another." << std::endl
+            << "               Add range {first_seq_num} {last_seq_num} to only retime some subtitles." << std::endl;
+    output_ << "find      -- Prints the subtitles containing some text. Use find {text}." << std::endl
+            << "               Case, line breaks and tags such as <i> are ignored." << std::endl
+            << "               Moves the player position to the next one after the current position," << std::endl
+            << "               so repeating find steps through them." << std::endl;
+    output_ << "undo      -- Undoes the last add, delete, edit or retime." << std::endl;
+    output_ << "redo      -- Redoes the last undone change." << std::endl;
     output_ << "save      -- Saves the current SRT to the output file." << std::endl;
 }
 
@@ -261,8 +302,8 @@ void Commands::Play(const std::vector<std::string>& tokens) {
 }
 
 void Commands::PrintSubs() {
-  auto collisions = srt_file_.GetCollisions(start_, duration_);
-  for (const auto& [seq_num, item] : collisions) {
+  for (const auto& [seq_num, item] :
+       srt_file_.OverlappingItems(start_, duration_)) {
     item->ToStream(seq_num, output_, /* flush= */ false);
     output_ << std::endl;
   }
@@ -322,14 +363,17 @@ void Commands::AddSub(const std::vector<std::string>& tokens) {
     }
   }
   if (item->num_lines() > 0) {
-    srt_file_.AddItem(std::move(item));
+    auto id = srt_file_.AddItem(item);
+    journal_.Added(item);
+    search_index_.Update(id, item->payload());
+    history_.Record(id, item.get());
+    history_.Commit();
     srt_file_has_changed_ = true;
   }
 }
 
 void Commands::DeleteSub(const std::vector<std::string>& tokens) {
   std::size_t i = 0;
-  const auto collisions = srt_file_.GetCollisions(start_, duration_);
   bool force = false;
   std::size_t sequence_num = 0;
   bool sequence_num_set = false;
@@ -356,8 +400,14 @@ void Commands::DeleteSub(const std::vector<std::string>& tokens) {
     output_ << "Missing sequence num. Check help for usage." << std::endl;
     return;
   }
-  if (auto it = collisions.find(sequence_num);
-      it == collisions.end() && !force) {
+  auto overlapping = srt_file_.OverlappingItems(start_, duration_);
+  auto is_at_position = std::any_of(
+      overlapping.begin(), overlapping.end(),
+      [&](const auto& found) {
+        const auto& [seq_num, item] = found;
+        return seq_num == sequence_num;
+      });
+  if (!is_at_position && !force) {
     output_ << "The subtitle you want to delete is not within the current "
                "player position."
             << std::endl;
@@ -368,7 +418,12 @@ void Commands::DeleteSub(const std::vector<std::string>& tokens) {
   }
 
   try {
+    auto id = srt_file_.GetId(sequence_num);
     auto deleted_item = srt_file_.RemoveItem(sequence_num);
+    journal_.Removed(deleted_item.get());
+    search_index_.Remove(id);
+    history_.Record(id, nullptr);
+    history_.Commit();
     output_ << "Deleted: ";
     deleted_item->ToStream(sequence_num, output_, /* flush= */ false);
     output_ << std::endl;
@@ -394,6 +449,9 @@ void Commands::EditSub(const std::vector<std::string>& tokens) {
     return;
   }
 
+  // Every token is checked before anything is edited, so a bad token never
+  // leaves part of the command applied.
+  std::vector<std::string> positions;
   std::size_t i = 1;
   while (i < tokens.size()) {
     if (tokens.at(i) == "position" || tokens.at(i) == "p") {
@@ -402,15 +460,14 @@ void Commands::EditSub(const std::vector<std::string>& tokens) {
         output_ << srt::SubRipItem::substation_alpha_positions << std::endl;
         return;
       }
-      try {
-        srt_file_.EditItemPosition(sequence_num, tokens.at(i + 1));
-      } catch (const std::out_of_range& e) {
+      if (sequence_num <= 0 || sequence_num > srt_file_.NumItems() ||
+          !srt::SubRipItem::pos_to_id.count(tokens.at(i + 1))) {
         output_ << "Unable to edit position of " << sequence_num
                 << ". Valid positions are:" << std::endl;
         output_ << srt::SubRipItem::substation_alpha_positions << std::endl;
         return;
       }
-
+      positions.push_back(tokens.at(i + 1));
       i += 2;
     } else {
       output_ << "Unrecognized token: " << tokens.at(i) << std::endl;
@@ -418,18 +475,186 @@ void Commands::EditSub(const std::vector<std::string>& tokens) {
     }
   }
 
+  for (const auto& position : positions) {
+    srt_file_.EditItemPosition(sequence_num, position);
+    journal_.PositionEdited(srt_file_.GetItem(sequence_num).get());
+    history_.Record(srt_file_.GetId(sequence_num),
+                    srt_file_.GetItem(sequence_num).get());
+  }
+  history_.Commit();
+  srt_file_has_changed_ = true;
+}
+
+void Commands::Retime(const std::vector<std::string>& tokens) {
+  if (tokens.empty()) {
+    output_ << "Missing retime operation. Check help for usage." << std::endl;
+    return;
+  }
+
+  auto parse_number = [](const std::string& token, double& number) {
+    std::istringstream stream{token};
+    return static_cast<bool>(stream >> number) && stream.eof();
+  };
+  std::optional<srt::TimeMap> map;
+  std::size_t i = 0;
+  try {
+    if (tokens.front() == "shift") {
+      if (tokens.size() < 2) {
+        output_ << "Missing shift time!" << std::endl;
+        return;
+      }
+      auto time = tokens.at(1);
+      bool earlier = !time.empty() && time.front() == '-';
+      const auto offset_opt = ParseDuration(earlier ? time.substr(1) : time);
+      if (!offset_opt) {
+        output_ << "Unable to parse shift time!" << std::endl;
+        return;
+      }
+      map = srt::TimeMap::Shift(earlier ? -*offset_opt : *offset_opt);
+      i = 2;
+    } else if (tokens.front() == "stretch") {
+      double factor = 0;
+      if (tokens.size() < 2 || !parse_number(tokens.at(1), factor)) {
+        output_ << "Missing or invalid stretch factor!" << std::endl;
+        return;
+      }
+      map = srt::TimeMap::Stretch(start_, factor);
+      i = 2;
+    } else if (tokens.front() == "fps") {
+      double from_fps = 0;
+      double to_fps = 0;
+      if (tokens.size() < 3 || !parse_number(tokens.at(1), from_fps) ||
+          !parse_number(tokens.at(2), to_fps)) {
+        output_ << "Missing or invalid frame rates!" << std::endl;
+        return;
+      }
+      map = srt::TimeMap::FrameRate(from_fps, to_fps);
+      i = 3;
+    } else {
+      output_ << "Unrecognized retime operation: " << tokens.front()
+              << std::endl;
+      return;
+    }
+  } catch (const std::invalid_argument& e) {
+    output_ << "Unable to retime: " << e.what() << std::endl;
+    return;
+  }
+
+  std::size_t first_sequence_num = 1;
+  std::size_t last_sequence_num = srt_file_.NumItems();
+  while (i < tokens.size()) {
+    if (tokens.at(i) == "range") {
+      if (i + 2 >= tokens.size()) {
+        output_ << "Missing range. Check help for usage." << std::endl;
+        return;
+      }
+      std::istringstream first_stream{tokens.at(i + 1)};
+      std::istringstream last_stream{tokens.at(i + 2)};
+      if (!(first_stream >> first_sequence_num) ||
+          !(last_stream >> last_sequence_num)) {
+        output_ << "Unable to parse range!" << std::endl;
+        return;
+      }
+      i += 3;
+    } else {
+      output_ << "Unrecognized token: " << tokens.at(i) << std::endl;
+      return;
+    }
+  }
+  if (srt_file_.NumItems() == 0) {
+    output_ << "There are no subtitles to retime." << std::endl;
+    return;
+  }
+
+  srt::RetimeEdit edit;
+  try {
+    edit = srt::Retime(srt_file_, *map, first_sequence_num, last_sequence_num);
+  } catch (const std::out_of_range& e) {
+    output_ << "Unable to retime " << first_sequence_num << " to "
+            << last_sequence_num << ". Valid sequence numbers are 1 to "
+            << srt_file_.NumItems() << "." << std::endl;
+    return;
+  }
+  std::vector<const srt::SubRipItem*> retimed;
+  retimed.reserve(edit.ids().size());
+  for (auto id : edit.ids()) {
+    retimed.push_back(srt_file_.GetItemById(id).get());
+  }
+  journal_.Retimed(retimed);
+  history_.Record(srt_file_, edit.ids());
+  history_.Commit();
   srt_file_has_changed_ = true;
+  output_ << "Retimed " << edit.NumItems() << " subtitles." << std::endl;
+}
+
+void Commands::Find(const std::vector<std::string>& tokens) {
+  if (tokens.empty()) {
+    output_ << "Missing text to find. Check help for usage." << std::endl;
+    return;
+  }
+  // Tokens are split on whitespace, which the search ignores anyway.
+  std::string text = tokens.front();
+  for (std::size_t i = 1; i < tokens.size(); ++i) {
+    text += ' ' + tokens.at(i);
+  }
+  std::vector<std::size_t> sequence_nums;
+  for (auto id : search_index_.Find(text)) {
+    sequence_nums.push_back(srt_file_.GetSequenceNumber(id));
+  }
+  if (sequence_nums.empty()) {
+    output_ << "No subtitles contain: " << text << std::endl;
+    return;
+  }
+  std::sort(sequence_nums.begin(), sequence_nums.end());
+
+  // Move to the first one starting after the current position, or wrap
+  // around to the first one.
+  std::size_t next = 0;
+  for (auto sequence_num : sequence_nums) {
+    const auto& item = srt_file_.GetItem(sequence_num);
+    item->ToStream(sequence_num, output_, /* flush= */ false);
+    output_ << std::endl;
+    if (next == 0 && item->start() > start_) {
+      next = sequence_num;
+    }
+  }
+  if (next == 0) {
+    next = sequence_nums.front();
+  }
+  const auto& item = srt_file_.GetItem(next);
+  start_ = item->start();
+  duration_ = item->duration();
+  output_ << "Found " << sequence_nums.size() << " subtitles. Moved to " << next
+          << " at start=" << FormatDuration(start_)
+          << " duration=" << FormatDuration(duration_) << std::endl;
+}
+
+void Commands::Undo() {
+  auto changes = history_.Undo();
+  if (changes.empty()) {
+    output_ << "Nothing to undo!" << std::endl;
+    return;
+  }
+  _ApplyHistoryChanges(changes);
+  output_ << "Undid changes to " << changes.size() << " subtitles."
+          << std::endl;
+}
+
+void Commands::Redo() {
+  auto changes = history_.Redo();
+  if (changes.empty()) {
+    output_ << "Nothing to redo!" << std::endl;
+    return;
+  }
+  _ApplyHistoryChanges(changes);
+  output_ << "Redid changes to " << changes.size() << " subtitles."
+          << std::endl;
 }
 
 void Commands::Save() {
-  namespace fs = std::filesystem;
-  auto path_wrapper = GetFileSystemUtf8Path(paths_.output_subtitle_path);
-  std::ofstream file{path_wrapper, std::ofstream::out | std::ofstream::trunc};
-  if (!file) {
-    throw std::runtime_error("Could not open file " +
-                             paths_.output_subtitle_path);
-  }
-  srt_file_.ToStream(file);
+  // The journal tracks the same items as srt_file_, so compacting it writes
+  // out the full file.
+  journal_.Compact();
   srt_file_has_changed_ = false;
   output_ << "Saved!" << std::endl;
 }
@@ -445,30 +670,55 @@ void Commands::Quit() {
     if (tokens.empty() || tokens.front() == "Y" || tokens.front() == "y") {
       // If nothing provided then still prefer to Save().
       Save();
+    } else {
+      // Edits were deliberately not saved, so don't recover them next time.
+      journal_.Discard();
     }
   }
 }
 
-// If there are subtitles at this player position, generate a temp file with
-// those subs. Then set the player to display them.
+// If there are subtitles at this player position, set the player to display
+// them. They are passed to the player through a pipe, not a file.
 void Commands::_GeneratePreviewSubs() {
-  std::ostringstream temp_subtitles_stream;
-  srt_file_.ToStream(temp_subtitles_stream, start_, duration_);
-  std::string temp_subtitles = temp_subtitles_stream.str();
-  if (!temp_subtitles.empty()) {
-    auto output_path = GetFileSystemUtf8Path(paths_.output_subtitle_path);
-    temp_file_ = std::make_unique<TempFile>(temp_subtitles,
-                                            output_path.parent_path(), ".srt");
-    if (!temp_file_) {
-      throw std::runtime_error("Could not make a temp file for the subs");
-    }
-    ffplay_->subtitles_path(temp_file_->FileName());
+  if (!srt_file_.OverlappingItems(start_, duration_).empty()) {
+    std::ostringstream subtitles_stream;
+    srt_file_.ToStream(subtitles_stream, start_, duration_);
+    ffplay_->subtitles(std::move(subtitles_stream).str());
   } else {
-    // Also deletes the temp file if it is not null.
-    temp_file_.reset();
-    ffplay_->subtitles_path("");
+    ffplay_->subtitles("");
   }
 }
 
+void Commands::_ApplyHistoryChanges(
+    const std::vector<srt::SubRipHistory::Change>& changes) {
+  auto items = srt::ApplyChanges(srt_file_, changes);
+  for (std::size_t i = 0; i < changes.size(); ++i) {
+    const auto& [id, before, after] = changes[i];
+    const auto* item = items[i].get();
+    if (after) {
+      search_index_.Update(id, after->payload());
+    } else {
+      search_index_.Remove(id);
+    }
+    if (!before) {
+      journal_.Added(items[i]);
+    } else if (!after) {
+      journal_.Removed(item);
+    } else {
+      if (before->start() != after->start() ||
+          before->duration() != after->duration()) {
+        journal_.Retimed(item);
+      }
+      if (!before->SamePayload(*after)) {
+        journal_.TextEdited(item);
+      }
+      if (!before->SamePosition(*after)) {
+        journal_.PositionEdited(item);
+      }
+    }
+  }
+  srt_file_has_changed_ = true;
+}
+
 }  // namespace cli
 }  // namespace subtitler
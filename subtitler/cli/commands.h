@@ -9,7 +9,9 @@
 
 #include "subtitler/cli/io/input.h"
 #include "subtitler/srt/subrip_file.h"
-#include "subtitler/util/temp_file.h"
+#include "subtitler/srt/subrip_history.h"
+#include "subtitler/srt/subrip_journal.h"
+#include "subtitler/srt/subrip_search.h"
 #include "subtitler/video/metadata/ffprobe.h"
 #include "subtitler/video/player/ffplay.h"
 
@@ -26,9 +28,12 @@ class Commands {
     std::string output_subtitle_path;
   };
 
+  // journal_compact_threshold is passed on to srt::SubRipJournal.
   Commands(const Paths& paths, std::unique_ptr<video::player::FFPlay> ffplay,
            std::unique_ptr<io::InputGetter> input_getter, std::ostream& output,
-           std::unique_ptr<video::metadata::Metadata> metadata);
+           std::unique_ptr<video::metadata::Metadata> metadata,
+           std::size_t journal_compact_threshold =
+               srt::SubRipJournal::kDefaultCompactThreshold);
 
   ~Commands();
 
@@ -49,8 +54,14 @@ class Commands {
   std::chrono::milliseconds start_;
   std::chrono::milliseconds duration_;
   srt::SubRipFile srt_file_;
+  // Records edits to srt_file_ as they happen, so they survive a crash.
+  // Save() compacts them into the output file.
+  srt::SubRipJournal journal_;
+  // One undo step per command which edits srt_file_.
+  srt::SubRipHistory history_;
+  // Text of srt_file_, for find. Updated with every edit.
+  srt::SubRipSearchIndex search_index_;
   bool srt_file_has_changed_;
-  std::unique_ptr<TempFile> temp_file_;
 
   void Help();
 
@@ -60,11 +71,18 @@ class Commands {
   void AddSub(const std::vector<std::string>& tokens);
   void DeleteSub(const std::vector<std::string>& tokens);
   void EditSub(const std::vector<std::string>& tokens);
+  void Retime(const std::vector<std::string>& tokens);
+  void Find(const std::vector<std::string>& tokens);
+  void Undo();
+  void Redo();
   void Save();
 
   void Quit();
 
   void _GeneratePreviewSubs();
+  // Applies changes from history_ to srt_file_ and records them in journal_.
+  void _ApplyHistoryChanges(
+      const std::vector<srt::SubRipHistory::Change>& changes);
 };
 
 }  // namespace cli
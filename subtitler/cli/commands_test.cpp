@@ -10,6 +10,7 @@
 #include <streambuf>
 
 #include "subtitler/cli/io/input.h"
+#include "subtitler/srt/subrip_journal.h"
 #include "subtitler/subprocess/mock_subprocess_executor.h"
 #include "subtitler/util/font_config.h"
 #include "subtitler/util/unicode.h"
@@ -22,6 +23,7 @@ using namespace std::chrono_literals;
 using subtitler::GetFileSystemUtf8Path;
 using subtitler::cli::Commands;
 using subtitler::cli::io::NarrowInputGetter;
+using subtitler::srt::SubRipJournal;
 using subtitler::subprocess::MockSubprocessExecutor;
 using subtitler::video::metadata::AudioStreamInfo;
 using subtitler::video::metadata::Metadata;
@@ -33,6 +35,7 @@ using ::testing::IsEmpty;
 using ::testing::NiceMock;
 using ::testing::Not;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::Throw;
 
 std::unique_ptr<NarrowInputGetter> CreateInputGetter(std::istream& stream) {
@@ -42,18 +45,24 @@ std::unique_ptr<NarrowInputGetter> CreateInputGetter(std::istream& stream) {
 class CommandsTest : public ::testing::Test {
  protected:
   void SetUp() override {
-    auto executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
-    mock_executor = executor.get();
     video_path = "path/to/test.mp4";
     ffplay_path = "path/to/ffplay";
     std::string temp_dir = std::getenv("TEST_TMPDIR");
     auto fs_srt_path = GetFileSystemUtf8Path(temp_dir) / fs::path("test.srt");
     srt_path = fs_srt_path.string();
-    // Clear the file beforehand.
+    // Clear the file and any journal left by other tests beforehand.
     std::ofstream file{fs_srt_path, std::ofstream::out | std::ofstream::trunc};
+    fs::remove(SubRipJournal::JournalPath(fs_srt_path));
+    fs::remove(SubRipJournal::CheckpointPath(fs_srt_path));
+    paths = Commands::Paths{video_path, srt_path};
+    SetUpPlayer();
+  }
 
+  // Creates the player and metadata, which are moved into Commands.
+  void SetUpPlayer() {
+    auto executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+    mock_executor = executor.get();
     ffplay = std::make_unique<FFPlay>(ffplay_path, std::move(executor));
-    paths = Commands::Paths{video_path, srt_path};
     metadata = std::make_unique<Metadata>();
 
     AudioStreamInfo audio{};
@@ -349,9 +358,6 @@ TEST_F(CommandsTest, AddedSubtitleCanReplayVideoDuringInput) {
   commands.MainLoop();
 
   // Use output log to check if play was called.
-  // Other way is to test SetCommand param, but this will contain the temp
-  // file path which is hard to predict. Either way this test might be a bit
-  // brittle, so just do the easier one for now.
   ASSERT_THAT(output.str(),
               HasSubstr("Playing start=00:00:00.000 duration=00:00:05.000\n"));
 
@@ -362,6 +368,28 @@ TEST_F(CommandsTest, AddedSubtitleCanReplayVideoDuringInput) {
                                       "\n"));
 }
 
+TEST_F(CommandsTest, PlayPassesSubtitlesThroughStdin) {
+  std::istringstream input{"add p middle-right \nline 1\n\n play"};
+  std::ostringstream output;
+  MockSubprocessExecutor::InputCallback subtitles_input;
+  EXPECT_CALL(*mock_executor, SetCommand(HasSubstr("subtitles='pipe\\:0'")))
+      .Times(1);
+  EXPECT_CALL(*mock_executor, SetInputCallback(_))
+      .WillOnce(SaveArg<0>(&subtitles_input));
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  std::string subtitles(1024, '\0');
+  subtitles.resize(subtitles_input(subtitles.data(), subtitles.size()));
+  ASSERT_EQ(subtitles,
+            "1\n"
+            "00:00:00,000 --> 00:00:05,000\n"
+            "{\\an6}line 1\n"
+            "\n");
+}
+
 TEST_F(CommandsTest, AddedSubtitleIsThenSaveable) {
   std::istringstream input{"add p middle-right \nsome subtitle\n\n save"};
   std::ostringstream output;
@@ -401,6 +429,102 @@ TEST_F(CommandsTest, AddedSubtitleCanBeSavedWhileQuitting) {
             "\n");
 }
 
+TEST_F(CommandsTest, UnsavedSubtitlesAreRecoveredFromJournal) {
+  {
+    // Input ends without quitting, like a crash.
+    std::istringstream input{"add p top-center \nsome subtitle\n\n"};
+    std::ostringstream output;
+    Commands commands{paths, std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata)};
+    commands.MainLoop();
+  }
+  {
+    std::ifstream ifs{srt_path};
+    std::string file((std::istreambuf_iterator<char>(ifs)),
+                     std::istreambuf_iterator<char>());
+    ASSERT_TRUE(file.empty());
+  }
+
+  SetUpPlayer();
+  std::istringstream input{"printsubs \n"};
+  std::ostringstream output;
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("Recovered unsaved changes!"));
+  ASSERT_THAT(output.str(), HasSubstr("{\\an8}some subtitle\n"));
+}
+
+TEST_F(CommandsTest, QuittingWithoutSavingDiscardsJournal) {
+  {
+    std::istringstream input{"add \nsome subtitle\n\n quit \n n"};
+    std::ostringstream output;
+    Commands commands{paths, std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata)};
+    commands.MainLoop();
+  }
+  ASSERT_FALSE(fs::exists(SubRipJournal::JournalPath(srt_path)));
+
+  SetUpPlayer();
+  std::istringstream input{"printsubs \n"};
+  std::ostringstream output;
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), Not(HasSubstr("some subtitle")));
+}
+
+TEST_F(CommandsTest, QuittingWithoutSavingPastJournalThresholdKeepsSrt) {
+  {
+    std::ofstream file{srt_path, std::ofstream::trunc};
+    file << "1\n00:00:01,000 --> 00:00:02,000\nsaved\n\n";
+  }
+  {
+    // Every edit is larger than the threshold, so each one is checkpointed.
+    std::istringstream input{
+        "add \nfirst edit\n\n add \nsecond edit\n\n quit \n n"};
+    std::ostringstream output;
+    Commands commands{paths,  std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata),
+                      /* journal_compact_threshold= */ 1};
+    commands.MainLoop();
+  }
+  std::ifstream ifs{srt_path};
+  std::string file((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ASSERT_EQ(file, "1\n00:00:01,000 --> 00:00:02,000\nsaved\n\n");
+  ASSERT_FALSE(fs::exists(SubRipJournal::JournalPath(srt_path)));
+  ASSERT_FALSE(fs::exists(SubRipJournal::CheckpointPath(srt_path)));
+}
+
+TEST_F(CommandsTest, RecoveredChangesAreDiscardedWhenNotSaved) {
+  {
+    // Input ends without quitting, like a crash.
+    std::istringstream input{"add \nsome subtitle\n\n"};
+    std::ostringstream output;
+    Commands commands{paths, std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata)};
+    commands.MainLoop();
+  }
+  SetUpPlayer();
+  {
+    std::istringstream input{"quit \n n"};
+    std::ostringstream output;
+    Commands commands{paths, std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata)};
+    commands.MainLoop();
+    ASSERT_THAT(output.str(), HasSubstr("Recovered unsaved changes!"));
+    ASSERT_THAT(output.str(), HasSubstr("Save before closing? Input: [Y/n]"));
+  }
+  std::ifstream ifs{srt_path};
+  std::string file((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ASSERT_TRUE(file.empty());
+  ASSERT_FALSE(fs::exists(SubRipJournal::CheckpointPath(srt_path)));
+}
+
 TEST_F(CommandsTest, AddSubInvalidCommandsPrintsErrorMessages) {
   std::istringstream input{
       "add position \n add position invalid \n add random stuff"};
@@ -522,6 +646,174 @@ TEST_F(CommandsTest, EditSubPositionInvalidCommandsPrintErrorMessages) {
       HasSubstr("Unable to edit position of 9999. Valid positions are:"));
 }
 
+TEST_F(CommandsTest, EditSubAppliesNothingIfAnyTokenIsInvalid) {
+  std::istringstream input{
+      "add p tc \nsubtitle\n\n edit 1 p bl p bogus \n edit 1 p tr junk \n "
+      "printsubs \n undo \n printsubs"};
+  std::ostringstream output;
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("{\\an8}subtitle\n"));
+  ASSERT_THAT(output.str(), Not(HasSubstr("{\\an1}")));
+  ASSERT_THAT(output.str(), Not(HasSubstr("{\\an9}")));
+  // Only the add is undone, no edit was recorded along with it.
+  ASSERT_THAT(output.str(), HasSubstr("Undid changes to 1 subtitles."));
+}
+
+TEST_F(CommandsTest, RetimeShiftsAndConvertsFrameRate) {
+  std::istringstream input{
+      "add\nfirst\n\n play start 10 \n add\nsecond\n\n"
+      "retime shift 2.5 \n retime shift -0.5 range 2 2 \n "
+      "retime fps 25 23.976 range 1 1 \n save"};
+  std::ostringstream output;
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("Retimed 2 subtitles."));
+  ASSERT_THAT(output.str(), HasSubstr("Retimed 1 subtitles."));
+  std::ifstream ifs{srt_path};
+  std::string file((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  // First: 2.5s to 7.5s, then slowed down by 25 / 23.976.
+  ASSERT_EQ(file,
+            "1\n"
+            "00:00:02,607 --> 00:00:07,820\n"
+            "first\n"
+            "\n"
+            "2\n"
+            "00:00:12,000 --> 00:00:17,000\n"
+            "second\n"
+            "\n");
+}
+
+TEST_F(CommandsTest, RetimeInvalidCommandsPrintErrorMessages) {
+  std::istringstream input{
+      "retime shift 1 \n add\nsubtitle\n\n retime \n retime jump 1 \n "
+      "retime shift \n retime shift abc \n retime stretch 0 \n "
+      "retime fps 25 \n retime shift 1 range 1 \n retime shift 1 range 1 5 "
+      "\n retime shift 1 extra"};
+  std::ostringstream output;
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("There are no subtitles to retime."));
+  ASSERT_THAT(output.str(),
+              HasSubstr("Missing retime operation. Check help for usage."));
+  ASSERT_THAT(output.str(), HasSubstr("Unrecognized retime operation: jump"));
+  ASSERT_THAT(output.str(), HasSubstr("Missing shift time!"));
+  ASSERT_THAT(output.str(), HasSubstr("Unable to parse shift time!"));
+  ASSERT_THAT(output.str(),
+              HasSubstr("Unable to retime: Stretch factor must be positive"));
+  ASSERT_THAT(output.str(), HasSubstr("Missing or invalid frame rates!"));
+  ASSERT_THAT(output.str(), HasSubstr("Missing range. Check help for usage."));
+  ASSERT_THAT(output.str(),
+              HasSubstr("Unable to retime 1 to 5. Valid sequence numbers are "
+                        "1 to 1."));
+  ASSERT_THAT(output.str(), HasSubstr("Unrecognized token: extra"));
+  ASSERT_THAT(output.str(), Not(HasSubstr("Retimed")));
+}
+
+TEST_F(CommandsTest, UndoAndRedoEdits) {
+  std::istringstream input{
+      "undo \n add\nfirst\n\n play start 10 \n add\nsecond\n\n "
+      "retime shift 1 \n delete --force 1 \n undo \n undo \n redo \n redo \n "
+      "redo \n undo \n save"};
+  std::ostringstream output;
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("Nothing to undo!"));
+  ASSERT_THAT(output.str(), HasSubstr("Undid changes to 1 subtitles."));
+  ASSERT_THAT(output.str(), HasSubstr("Undid changes to 2 subtitles."));
+  ASSERT_THAT(output.str(), HasSubstr("Redid changes to 2 subtitles."));
+  ASSERT_THAT(output.str(), HasSubstr("Redid changes to 1 subtitles."));
+  ASSERT_THAT(output.str(), HasSubstr("Nothing to redo!"));
+  std::ifstream ifs{srt_path};
+  std::string file((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  // The delete is undone, the retime is kept.
+  ASSERT_EQ(file,
+            "1\n"
+            "00:00:01,000 --> 00:00:06,000\n"
+            "first\n"
+            "\n"
+            "2\n"
+            "00:00:11,000 --> 00:00:16,000\n"
+            "second\n"
+            "\n");
+}
+
+TEST_F(CommandsTest, UndoAndRedoPositionEditsAreRecoveredFromJournal) {
+  {
+    // Undo back to no position, also from an explicit bottom-center which
+    // reads the same as no position. Input ends without quitting, like a
+    // crash.
+    std::istringstream input{
+        "add \nsome subtitle\n\n edit 1 position tl \n undo \n "
+        "edit 1 position bc \n undo \n redo \n undo \n"};
+    std::ostringstream output;
+    Commands commands{paths, std::move(ffplay), CreateInputGetter(input),
+                      output, std::move(metadata)};
+    commands.MainLoop();
+  }
+
+  SetUpPlayer();
+  std::istringstream input{"printsubs \n"};
+  std::ostringstream output;
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  ASSERT_THAT(output.str(), HasSubstr("Recovered unsaved changes!"));
+  ASSERT_THAT(output.str(), HasSubstr("1\n"
+                                      "00:00:00,000 --> 00:00:05,000\n"
+                                      "some subtitle\n"
+                                      "\n"));
+}
+
+TEST_F(CommandsTest, FindStepsThroughMatchingSubtitles) {
+  std::istringstream input{
+      "add\n<i>Where</i> are you?\n\n play start 10 \n add\nNowhere.\n\n "
+      "play start 20 \n add\nWHERE ARE\nyou going?\n\n find where are you \n "
+      "find where are you \n delete --force 1 \n find where \n undo \n "
+      "find are you? \n find \n find pear"};
+  std::ostringstream output;
+
+  Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
+                    std::move(metadata)};
+  commands.MainLoop();
+
+  // Wraps around from the end to the first match.
+  ASSERT_THAT(output.str(),
+              HasSubstr("1\n"
+                        "00:00:00,000 --> 00:00:05,000\n"
+                        "<i>Where</i> are you?\n\n"
+                        "3\n"
+                        "00:00:20,000 --> 00:00:25,000\n"
+                        "WHERE ARE\nyou going?\n\n"
+                        "Found 2 subtitles. Moved to 1 at start=00:00:00.000 "
+                        "duration=00:00:05.000"));
+  ASSERT_THAT(output.str(),
+              HasSubstr("Found 2 subtitles. Moved to 3 at start=00:00:20.000"));
+  // The deleted subtitle is no longer found.
+  ASSERT_THAT(output.str(),
+              HasSubstr("Found 2 subtitles. Moved to 1 at start=00:00:10.000"));
+  // Until the delete is undone.
+  ASSERT_THAT(output.str(),
+              HasSubstr("Found 1 subtitles. Moved to 1 at start=00:00:00.000"));
+  ASSERT_THAT(output.str(), HasSubstr("Missing text to find."));
+  ASSERT_THAT(output.str(), HasSubstr("No subtitles contain: pear"));
+}
+
 TEST_F(CommandsTest, LoadsExistingSubtitles) {
   std::string expected_subtitles =
       "1\n"
@@ -556,7 +848,7 @@ TEST_F(CommandsTest, LoadsExistingSubtitles) {
                                       "00:03:00,000 --> 00:04:00,000\n\n"));
 }
 
-TEST_F(CommandsTest, LoadingInvalidSubtitlesPrintsErrorButDoesNotCrash) {
+TEST_F(CommandsTest, LoadingInvalidSubtitlesPrintsErrorAndExits) {
   std::string existing_subtitles =
       "1\n"
       "00:00:00,abc --> 00:01:23,def\n"
@@ -567,7 +859,7 @@ TEST_F(CommandsTest, LoadingInvalidSubtitlesPrintsErrorButDoesNotCrash) {
     srt_file_stream << existing_subtitles;
   }
 
-  std::istringstream input{"printsubs \n"};
+  std::istringstream input{"add \nnew subtitle\n\n save \n"};
   std::ostringstream output;
 
   Commands commands{paths, std::move(ffplay), CreateInputGetter(input), output,
@@ -575,5 +867,14 @@ TEST_F(CommandsTest, LoadingInvalidSubtitlesPrintsErrorButDoesNotCrash) {
   commands.MainLoop();
 
   ASSERT_THAT(output.str(), HasSubstr("Could not parse timestamp values: "
-                                      "00:00:00,abc --> 00:01:23,def\n"));
+                                      "00:00:00,abc --> 00:01:23,def "
+                                      "(byte offset 2)\n"));
+  ASSERT_THAT(output.str(), HasSubstr(", exiting."));
+  // The edit and save never ran, so the invalid file is left as is.
+  ASSERT_THAT(output.str(), Not(HasSubstr("Enter next command:")));
+  std::ifstream ifs{srt_path};
+  std::string file((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  ASSERT_EQ(file, existing_subtitles);
+  ASSERT_FALSE(fs::exists(SubRipJournal::JournalPath(srt_path)));
 }
@@ -0,0 +1,46 @@
+#include "subtitler/cli/convert.h"
+
+namespace subtitler {
+namespace cli {
+
+void WriteConvertResults(const std::vector<srt::ConvertResult>& results,
+                         std::ostream& output) {
+  std::size_t num_failed = 0;
+  for (const auto& result : results) {
+    if (!result.error.empty()) {
+      output << "Unable to convert " << result.input.string() << ": "
+             << result.error << '\n';
+      ++num_failed;
+      continue;
+    }
+    output << result.input.string() << " -> " << result.output.string()
+           << " (" << result.num_cues << " cues)\n";
+  }
+  output << "Converted " << results.size() - num_failed << " files, "
+         << num_failed << " failed." << std::endl;
+}
+
+int RunConvert(const std::filesystem::path& input_directory,
+               const std::filesystem::path& output_directory,
+               srt::SubtitleFormat format, std::size_t num_threads,
+               std::ostream& output) {
+  std::vector<srt::ConvertResult> results;
+  try {
+    results = srt::ConvertSubtitleDirectory(input_directory, output_directory,
+                                            format, num_threads);
+  } catch (const std::filesystem::filesystem_error& e) {
+    output << "Unable to read " << input_directory.string() << ": "
+           << e.what() << std::endl;
+    return 2;
+  }
+  WriteConvertResults(results, output);
+  for (const auto& result : results) {
+    if (!result.error.empty()) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace cli
+}  // namespace subtitler
@@ -0,0 +1,34 @@
+#ifndef SUBTITLER_CLI_CONVERT_H
+#define SUBTITLER_CLI_CONVERT_H
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "subtitler/srt/subtitle_converter.h"
+
+namespace subtitler {
+namespace cli {
+
+// Writes one line per file to output, e.g.
+// a.srt -> out/a.vtt (12 cues)
+// or "Unable to convert broken.srt: ..." for a file which failed, followed
+// by a summary line with the number of files converted and failed.
+void WriteConvertResults(const std::vector<srt::ConvertResult>& results,
+                         std::ostream& output);
+
+// Converts every subtitle file under input_directory to format into
+// output_directory, see srt::ConvertSubtitleDirectory(), and writes the
+// results to output.
+// Returns the process exit code: 0 if every file converted, 1 otherwise, or
+// 2 if the directory could not be read.
+int RunConvert(const std::filesystem::path& input_directory,
+               const std::filesystem::path& output_directory,
+               srt::SubtitleFormat format, std::size_t num_threads,
+               std::ostream& output);
+
+}  // namespace cli
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,57 @@
+#include "subtitler/cli/convert.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+
+using subtitler::GetFileSystemUtf8Path;
+using subtitler::cli::RunConvert;
+using subtitler::srt::SubtitleFormat;
+using ::testing::HasSubstr;
+
+namespace {
+
+fs::path TestDir() {
+  return GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+         "convert_test_dir";
+}
+
+}  // namespace
+
+TEST(ConvertTest, ConvertsDirectory) {
+  auto dir = TestDir();
+  fs::create_directories(dir / "in");
+  std::ofstream{dir / "in" / "a.srt"}
+      << "1\n00:00:01,000 --> 00:00:03,000\n{\\an8}one\n\n"
+      << "2\n00:00:04,000 --> 00:00:06,000\ntwo\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(0, RunConvert(dir / "in", dir / "out",
+                          SubtitleFormat::kSubStationAlpha, 2, output));
+  ASSERT_THAT(output.str(), HasSubstr("a.ass (2 cues)\n"
+                                      "Converted 1 files, 0 failed.\n"));
+  ASSERT_TRUE(fs::exists(dir / "out" / "a.ass"));
+
+  std::ofstream{dir / "in" / "b.vtt"} << "not WebVTT\n";
+  std::ostringstream failed;
+  ASSERT_EQ(1, RunConvert(dir / "in", dir / "out", SubtitleFormat::kSubRip, 2,
+                          failed));
+  ASSERT_THAT(failed.str(), HasSubstr("Missing WEBVTT header"));
+  ASSERT_THAT(failed.str(), HasSubstr("Converted 0 files, 1 failed.\n"));
+
+  std::ostringstream missing;
+  ASSERT_EQ(2, RunConvert(dir / "missing", dir / "out",
+                          SubtitleFormat::kWebVtt, 2, missing));
+  ASSERT_THAT(missing.str(), HasSubstr("Unable to read"));
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,156 @@
+#include "subtitler/cli/diff.h"
+
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "subtitler/srt/subrip_loader.h"
+#include "subtitler/util/duration_format.h"
+
+namespace subtitler {
+namespace cli {
+
+namespace {
+
+void WriteCue(char prefix, const srt::SubRipItem& item, std::ostream& output) {
+  std::string timing{prefix};
+  AppendSubRipDuration(item.start(), timing);
+  timing += " --> ";
+  AppendSubRipDuration(item.start() + item.duration(), timing);
+  output << timing << '\n';
+  auto payload = item.payload();
+  while (!payload.empty()) {
+    auto end = payload.find('\n');
+    output << prefix << payload.substr(0, end) << '\n';
+    payload.remove_prefix(end == std::string_view::npos ? payload.size()
+                                                        : end + 1);
+  }
+}
+
+// Loads path, or writes the error to output and returns nullopt.
+std::optional<srt::SubRipFile> Load(const std::filesystem::path& path,
+                                    std::ostream& output) {
+  try {
+    return srt::LoadSubRipParallel(path);
+  } catch (const std::exception& e) {
+    output << "Unable to load " << path.string() << ": " << e.what()
+           << std::endl;
+    return std::nullopt;
+  }
+}
+
+}  // namespace
+
+void WriteDiff(const srt::SubRipFile& before, const srt::SubRipFile& after,
+               const std::vector<srt::CueDiff>& diffs, std::ostream& output) {
+  std::size_t counts[4] = {};
+  for (const auto& diff : diffs) {
+    ++counts[static_cast<int>(diff.type)];
+    switch (diff.type) {
+      case srt::CueDiffType::kUnchanged:
+        break;
+      case srt::CueDiffType::kChanged: {
+        output << "@@ " << diff.before_sequence << " -> "
+               << diff.after_sequence << " (";
+        std::string_view separator = "";
+        if (diff.timing_changed) {
+          output << separator << "timing";
+          separator = ", ";
+        }
+        if (diff.text_changed) {
+          output << separator << "text";
+          separator = ", ";
+        }
+        if (diff.position_changed) {
+          output << separator << "position";
+        }
+        output << ") @@\n";
+        WriteCue('-', *before.GetItem(diff.before_sequence), output);
+        WriteCue('+', *after.GetItem(diff.after_sequence), output);
+        break;
+      }
+      case srt::CueDiffType::kAdded:
+        output << "@@ (added) -> " << diff.after_sequence << " @@\n";
+        WriteCue('+', *after.GetItem(diff.after_sequence), output);
+        break;
+      case srt::CueDiffType::kRemoved:
+        output << "@@ " << diff.before_sequence << " -> (removed) @@\n";
+        WriteCue('-', *before.GetItem(diff.before_sequence), output);
+        break;
+    }
+  }
+  output << counts[static_cast<int>(srt::CueDiffType::kUnchanged)]
+         << " unchanged, "
+         << counts[static_cast<int>(srt::CueDiffType::kChanged)]
+         << " changed, " << counts[static_cast<int>(srt::CueDiffType::kAdded)]
+         << " added, "
+         << counts[static_cast<int>(srt::CueDiffType::kRemoved)]
+         << " removed." << std::endl;
+}
+
+int RunDiff(const std::filesystem::path& before,
+            const std::filesystem::path& after, std::ostream& output) {
+  auto before_file = Load(before, output);
+  auto after_file = Load(after, output);
+  if (!before_file || !after_file) {
+    return 2;
+  }
+  auto diffs = srt::DiffSubRip(*before_file, *after_file);
+  output << "--- " << before.string() << '\n';
+  output << "+++ " << after.string() << '\n';
+  WriteDiff(*before_file, *after_file, diffs, output);
+  for (const auto& diff : diffs) {
+    if (diff.type != srt::CueDiffType::kUnchanged) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int RunMerge(const std::filesystem::path& base,
+             const std::filesystem::path& ours,
+             const std::filesystem::path& theirs,
+             const std::filesystem::path& output_path, std::ostream& output) {
+  auto base_file = Load(base, output);
+  auto ours_file = Load(ours, output);
+  auto theirs_file = Load(theirs, output);
+  if (!base_file || !ours_file || !theirs_file) {
+    return 2;
+  }
+  auto result = srt::MergeSubRip(*base_file, *ours_file, *theirs_file);
+
+  std::ofstream ofs{output_path, std::ios_base::binary};
+  if (ofs) {
+    result.merged.ToStream(ofs);
+  }
+  if (!ofs) {
+    output << "Unable to write " << output_path.string() << std::endl;
+    return 2;
+  }
+
+  for (const auto& [base_sequence, ours_sequence, theirs_sequence] :
+       result.conflicts) {
+    output << "Conflict: base " << base_sequence << ", ours ";
+    if (ours_sequence) {
+      output << ours_sequence;
+    } else {
+      output << "(removed)";
+    }
+    output << ", theirs ";
+    if (theirs_sequence) {
+      output << theirs_sequence;
+    } else {
+      output << "(removed)";
+    }
+    output << '\n';
+  }
+  output << "Merged " << result.merged.NumItems() << " subtitles with "
+         << result.conflicts.size() << " conflicts." << std::endl;
+  return result.conflicts.empty() ? 0 : 1;
+}
+
+}  // namespace cli
+}  // namespace subtitler
@@ -0,0 +1,44 @@
+#ifndef SUBTITLER_CLI_DIFF_H
+#define SUBTITLER_CLI_DIFF_H
+
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "subtitler/srt/subrip_diff.h"
+#include "subtitler/srt/subrip_file.h"
+
+namespace subtitler {
+namespace cli {
+
+// Writes every cue of diffs which isn't unchanged to output, in a format
+// similar to a unified diff, e.g. for a retimed cue:
+// @@ 2 -> 2 (timing) @@
+// -00:00:04,000 --> 00:00:06,000
+// -two
+// +00:00:04,500 --> 00:00:06,000
+// +two
+// followed by a summary line with the number of cues of each type.
+void WriteDiff(const srt::SubRipFile& before, const srt::SubRipFile& after,
+               const std::vector<srt::CueDiff>& diffs, std::ostream& output);
+
+// Diffs two SRT files and writes the result to output.
+// Returns the process exit code, like diff: 0 if the cues are the same, 1 if
+// they differ, or 2 if either file could not be loaded.
+int RunDiff(const std::filesystem::path& before,
+            const std::filesystem::path& after, std::ostream& output);
+
+// Merges the edits ours and theirs made to base into output_path, and
+// writes a summary of the conflicts to output. Conflicting cues are written
+// with markers, see srt::MergeSubRip().
+// Returns the process exit code: 0 if the merge was clean, 1 if there were
+// conflicts, or 2 if a file could not be loaded or written.
+int RunMerge(const std::filesystem::path& base,
+             const std::filesystem::path& ours,
+             const std::filesystem::path& theirs,
+             const std::filesystem::path& output_path, std::ostream& output);
+
+}  // namespace cli
+}  // namespace subtitler
+
+#endif
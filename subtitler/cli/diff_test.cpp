@@ -0,0 +1,108 @@
+#include "subtitler/cli/diff.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+
+using subtitler::GetFileSystemUtf8Path;
+using subtitler::cli::RunDiff;
+using subtitler::cli::RunMerge;
+using ::testing::HasSubstr;
+
+namespace {
+
+fs::path TestDir() {
+  return GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) / "diff_test_dir";
+}
+
+std::string ReadFile(const fs::path& path) {
+  std::ifstream ifs{path};
+  return std::string{std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>()};
+}
+
+}  // namespace
+
+TEST(DiffTest, PrintsChanges) {
+  auto dir = TestDir();
+  fs::create_directories(dir);
+  std::ofstream{dir / "a.srt"} << "1\n00:00:01,000 --> 00:00:03,000\none\n\n"
+                               << "2\n00:00:04,000 --> 00:00:06,000\ntwo\n\n"
+                               << "3\n00:00:07,000 --> 00:00:09,000\nthree\n";
+  std::ofstream{dir / "b.srt"} << "1\n00:00:01,000 --> 00:00:03,000\none\n\n"
+                               << "2\n00:00:04,500 --> 00:00:06,000\nTwo\n\n"
+                               << "3\n00:00:10,000 --> 00:00:11,000\nfour\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(1, RunDiff(dir / "a.srt", dir / "b.srt", output));
+  ASSERT_THAT(output.str(), HasSubstr("@@ 2 -> 2 (timing, text) @@\n"
+                                      "-00:00:04,000 --> 00:00:06,000\n"
+                                      "-two\n"
+                                      "+00:00:04,500 --> 00:00:06,000\n"
+                                      "+Two\n"
+                                      "@@ 3 -> (removed) @@\n"
+                                      "-00:00:07,000 --> 00:00:09,000\n"
+                                      "-three\n"
+                                      "@@ (added) -> 3 @@\n"
+                                      "+00:00:10,000 --> 00:00:11,000\n"
+                                      "+four\n"
+                                      "1 unchanged, 1 changed, 1 added, "
+                                      "1 removed.\n"));
+
+  std::ostringstream same;
+  ASSERT_EQ(0, RunDiff(dir / "a.srt", dir / "a.srt", same));
+  ASSERT_THAT(same.str(), HasSubstr("3 unchanged, 0 changed"));
+
+  std::ostringstream missing;
+  ASSERT_EQ(2, RunDiff(dir / "a.srt", dir / "missing.srt", missing));
+  ASSERT_THAT(missing.str(), HasSubstr("Unable to load"));
+
+  fs::remove_all(dir);
+}
+
+TEST(DiffTest, MergesAndReportsConflicts) {
+  auto dir = TestDir();
+  fs::create_directories(dir);
+  std::ofstream{dir / "base.srt"}
+      << "1\n00:00:01,000 --> 00:00:03,000\none\n\n"
+      << "2\n00:00:04,000 --> 00:00:06,000\ntwo\n";
+  std::ofstream{dir / "ours.srt"}
+      << "1\n00:00:01,500 --> 00:00:03,000\none\n\n"
+      << "2\n00:00:04,000 --> 00:00:06,000\ntwo\n";
+  std::ofstream{dir / "theirs.srt"}
+      << "1\n00:00:01,000 --> 00:00:03,000\nONE\n\n"
+      << "2\n00:00:04,000 --> 00:00:06,000\ntwo\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(0, RunMerge(dir / "base.srt", dir / "ours.srt",
+                        dir / "theirs.srt", dir / "merged.srt", output));
+  ASSERT_THAT(output.str(), HasSubstr("Merged 2 subtitles with 0 conflicts."));
+  ASSERT_EQ(ReadFile(dir / "merged.srt"),
+            "1\n00:00:01,500 --> 00:00:03,000\nONE\n\n"
+            "2\n00:00:04,000 --> 00:00:06,000\ntwo\n\n");
+
+  std::ofstream{dir / "theirs.srt"}
+      << "1\n00:00:01,000 --> 00:00:03,000\nONE\n\n"
+      << "2\n00:00:04,000 --> 00:00:06,000\nTWO\n";
+  std::ofstream{dir / "ours.srt"}
+      << "1\n00:00:01,500 --> 00:00:03,000\none\n";
+  std::ostringstream conflict;
+  ASSERT_EQ(1, RunMerge(dir / "base.srt", dir / "ours.srt",
+                        dir / "theirs.srt", dir / "merged.srt", conflict));
+  ASSERT_THAT(conflict.str(),
+              HasSubstr("Conflict: base 2, ours (removed), theirs 2\n"
+                        "Merged 2 subtitles with 1 conflicts."));
+  ASSERT_THAT(ReadFile(dir / "merged.srt"),
+              HasSubstr("<<<<<<< ours (removed)\n=======\nTWO\n"));
+
+  fs::remove_all(dir);
+}
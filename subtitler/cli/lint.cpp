@@ -0,0 +1,87 @@
+#include "subtitler/cli/lint.h"
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+
+namespace subtitler {
+namespace cli {
+
+namespace {
+
+// JSON strings must be UTF-8, which path::string() isn't on Windows.
+// On Linux, u8string() returns the raw bytes, see Dump().
+std::string PathToUtf8(const std::filesystem::path& path) {
+  auto utf8 = path.u8string();
+  return std::string{utf8.begin(), utf8.end()};
+}
+
+// Paths aren't necessarily valid UTF-8 on Linux, nor are the errors that
+// include them. Replace invalid bytes rather than failing the whole report.
+std::string Dump(const nlohmann::json& document) {
+  return document.dump(/* indent= */ 2, /* indent_char= */ ' ',
+                       /* ensure_ascii= */ false,
+                       nlohmann::json::error_handler_t::replace);
+}
+
+}  // namespace
+
+void WriteLintReport(const std::vector<srt::LintReport>& reports,
+                     std::ostream& output) {
+  std::size_t num_failed = 0;
+  std::size_t num_issues = 0;
+  auto files = nlohmann::json::array();
+  for (const auto& report : reports) {
+    nlohmann::json file;
+    file["path"] = PathToUtf8(report.path);
+    if (!report.error.empty()) {
+      file["error"] = report.error;
+      ++num_failed;
+    }
+    auto issues = nlohmann::json::array();
+    for (const auto& issue : report.issues) {
+      nlohmann::json entry;
+      entry["type"] = std::string{srt::ToString(issue.type)};
+      entry["sequence"] = issue.sequence_number;
+      if (issue.other_sequence_number != 0) {
+        entry["other_sequence"] = issue.other_sequence_number;
+      }
+      entry["value"] = issue.value;
+      issues.push_back(std::move(entry));
+    }
+    num_issues += report.issues.size();
+    file["issues"] = std::move(issues);
+    files.push_back(std::move(file));
+  }
+
+  nlohmann::json document;
+  document["files"] = std::move(files);
+  document["num_files"] = reports.size();
+  document["num_failed"] = num_failed;
+  document["num_issues"] = num_issues;
+  output << Dump(document) << std::endl;
+}
+
+int RunLint(const std::filesystem::path& directory,
+            const srt::LintOptions& options, std::size_t num_threads,
+            std::ostream& output) {
+  std::vector<srt::LintReport> reports;
+  try {
+    reports = srt::LintSubRipDirectory(directory, options, num_threads);
+  } catch (const std::filesystem::filesystem_error& e) {
+    nlohmann::json document;
+    document["error"] = e.what();
+    output << Dump(document) << std::endl;
+    return 2;
+  }
+  WriteLintReport(reports, output);
+  for (const auto& report : reports) {
+    if (!report.error.empty() || !report.issues.empty()) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace cli
+}  // namespace subtitler
@@ -0,0 +1,33 @@
+#ifndef SUBTITLER_CLI_LINT_H
+#define SUBTITLER_CLI_LINT_H
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "subtitler/srt/subrip_linter.h"
+
+namespace subtitler {
+namespace cli {
+
+// Writes reports as a JSON document to output, of the form
+// {"files": [{"path": ..., "error": ..., "issues": [{"type": "overlap",
+//   "sequence": 2, "other_sequence": 1, "value": 9000}, ...]}, ...],
+//  "num_files": ..., "num_failed": ..., "num_issues": ...}
+// "error" is only present for files which failed to load, and
+// "other_sequence" only for issues involving two cues.
+void WriteLintReport(const std::vector<srt::LintReport>& reports,
+                     std::ostream& output);
+
+// Lints all SRT files under directory and writes the report to output.
+// Returns the process exit code: 0 if every file loaded without issues, 1
+// otherwise, or 2 if the directory could not be read.
+int RunLint(const std::filesystem::path& directory,
+            const srt::LintOptions& options, std::size_t num_threads,
+            std::ostream& output);
+
+}  // namespace cli
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,102 @@
+#include "subtitler/cli/lint.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+
+using subtitler::GetFileSystemUtf8Path;
+using subtitler::cli::RunLint;
+using subtitler::cli::WriteLintReport;
+using ::testing::HasSubstr;
+
+namespace {
+
+fs::path TestDir() {
+  return GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) / "lint_test_dir";
+}
+
+}  // namespace
+
+TEST(LintTest, CleanDirectory) {
+  auto dir = TestDir();
+  fs::create_directories(dir);
+  std::ofstream{dir / "a.srt"} << "1\n00:00:01,000 --> 00:00:03,000\nok\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(0, RunLint(dir, {}, 1, output));
+  auto report = nlohmann::json::parse(output.str());
+  ASSERT_EQ(1, report["num_files"]);
+  ASSERT_EQ(0, report["num_failed"]);
+  ASSERT_EQ(0, report["num_issues"]);
+  ASSERT_EQ((dir / "a.srt").string(), report["files"][0]["path"]);
+  ASSERT_TRUE(report["files"][0]["issues"].empty());
+  ASSERT_FALSE(report["files"][0].contains("error"));
+
+  fs::remove_all(dir);
+}
+
+TEST(LintTest, ReportsIssuesAndErrors) {
+  auto dir = TestDir();
+  fs::create_directories(dir);
+  std::ofstream{dir / "a.srt"} << "1\n00:00:01,000 --> 00:00:03,000\nok\n\n"
+                               << "2\n00:00:02,000 --> 00:00:04,000\nok\n";
+  std::ofstream{dir / "b.srt"} << "1\n00:00:01,000 -> 00:00:03,000\nok\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(1, RunLint(dir, {}, 2, output));
+  auto report = nlohmann::json::parse(output.str());
+  ASSERT_EQ(2, report["num_files"]);
+  ASSERT_EQ(1, report["num_failed"]);
+  ASSERT_EQ(1, report["num_issues"]);
+
+  const auto& issue = report["files"][0]["issues"][0];
+  ASSERT_EQ("overlap", issue["type"]);
+  ASSERT_EQ(2, issue["sequence"]);
+  ASSERT_EQ(1, issue["other_sequence"]);
+  ASSERT_EQ(1000, issue["value"]);
+  ASSERT_THAT(report["files"][1]["error"].get<std::string>(),
+              HasSubstr("-->"));
+
+  fs::remove_all(dir);
+}
+
+TEST(LintTest, MissingDirectory) {
+  std::ostringstream output;
+  ASSERT_EQ(2, RunLint(TestDir() / "missing", {}, 1, output));
+  ASSERT_TRUE(nlohmann::json::parse(output.str()).contains("error"));
+}
+
+TEST(LintTest, ReplacesInvalidUtf8) {
+  auto dir = TestDir();
+  fs::create_directories(dir);
+  // Not valid UTF-8 on Linux, where paths are raw bytes.
+  std::ofstream{dir / "caf\xe9.srt"} << "1\n00:00:01,000 -> 00:00:03,000\n";
+
+  std::ostringstream output;
+  ASSERT_EQ(1, RunLint(dir, {}, 1, output));
+  auto report = nlohmann::json::parse(output.str());
+  ASSERT_EQ(1, report["num_failed"]);
+  ASSERT_THAT(report["files"][0]["path"].get<std::string>(),
+              HasSubstr(".srt"));
+
+  subtitler::srt::LintReport invalid;
+  invalid.path = "caf\xe9.srt";
+  invalid.error = "Could not parse caf\xe9.srt\xff";
+  output.str("");
+  WriteLintReport({invalid}, output);
+  report = nlohmann::json::parse(output.str());
+  ASSERT_EQ("Could not parse caf\uFFFD.srt\uFFFD",
+            report["files"][0]["error"]);
+
+  fs::remove_all(dir);
+}
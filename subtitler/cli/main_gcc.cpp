@@ -1,6 +1,8 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -8,7 +10,11 @@
 #include <vector>
 
 #include "subtitler/cli/commands.h"
+#include "subtitler/cli/convert.h"
+#include "subtitler/cli/diff.h"
 #include "subtitler/cli/io/input.h"
+#include "subtitler/cli/lint.h"
+#include "subtitler/srt/subrip_text_pool.h"
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/video/metadata/ffprobe.h"
 #include "subtitler/video/player/ffplay.h"
@@ -22,6 +28,41 @@ DEFINE_string(video_path, "",
 DEFINE_string(output_subtitle_path, "",
               "Optional. Path to the output srt file. "
               "If not provided will be asked from stdin.");
+DEFINE_string(lint_directory, "",
+              "Optional. If provided, lints every .srt file under this "
+              "directory, prints a JSON report to stdout and exits.");
+DEFINE_int32(lint_threads, 0,
+             "Number of files linted concurrently. 0 uses all cores.");
+DEFINE_int32(lint_min_gap_ms, 84,
+             "Gaps between cues shorter than this are reported.");
+DEFINE_int32(lint_min_duration_ms, 833,
+             "Cues shorter than this are reported.");
+DEFINE_int32(lint_max_duration_ms, 7000,
+             "Cues longer than this are reported.");
+DEFINE_double(lint_max_chars_per_second, 20,
+              "Cues with a faster reading speed are reported.");
+DEFINE_int32(lint_max_lines, 2, "Cues with more lines are reported.");
+DEFINE_string(diff_before, "",
+              "Optional. If provided with diff_after, prints the changes "
+              "between the two .srt files and exits.");
+DEFINE_string(diff_after, "", "The changed .srt file to diff.");
+DEFINE_string(merge_base, "",
+              "Optional. If provided with merge_ours, merge_theirs and "
+              "merge_output, merges the edits both made to this .srt file "
+              "into merge_output and exits.");
+DEFINE_string(merge_ours, "", "The first edited copy of merge_base.");
+DEFINE_string(merge_theirs, "", "The second edited copy of merge_base.");
+DEFINE_string(merge_output, "", "Path to write the merged .srt file to.");
+DEFINE_string(convert_directory, "",
+              "Optional. If provided, converts every .srt, .vtt and .ass "
+              "file under this directory to convert_format and exits.");
+DEFINE_string(convert_output_directory, "",
+              "Where converted files are written, keeping their path "
+              "relative to convert_directory. Defaults to convert_directory.");
+DEFINE_string(convert_format, "vtt",
+              "Format to convert to, one of srt, vtt or ass.");
+DEFINE_int32(convert_threads, 0,
+             "Number of files converted concurrently. 0 uses all cores.");
 
 namespace {
 
@@ -82,6 +123,56 @@ void FixInputPath(std::string& path, bool should_have_quotes) {
   }
 }
 
+// Lints FLAGS_lint_directory, returning the exit code.
+int RunLintFromFlags() {
+  subtitler::srt::LintOptions options;
+  options.min_gap = std::chrono::milliseconds{FLAGS_lint_min_gap_ms};
+  options.min_duration = std::chrono::milliseconds{FLAGS_lint_min_duration_ms};
+  options.max_duration = std::chrono::milliseconds{FLAGS_lint_max_duration_ms};
+  options.max_chars_per_second = FLAGS_lint_max_chars_per_second;
+  options.max_lines = FLAGS_lint_max_lines;
+  return subtitler::cli::RunLint(
+      FLAGS_lint_directory, options,
+      static_cast<std::size_t>(std::max(FLAGS_lint_threads, 0)), std::cout);
+}
+
+// Diffs or merges the files given by the diff_ or merge_ flags, returning
+// the exit code.
+int RunDiffFromFlags() {
+  using subtitler::cli::RunDiff;
+  using subtitler::cli::RunMerge;
+  if (!FLAGS_diff_before.empty() && !FLAGS_diff_after.empty()) {
+    return RunDiff(FLAGS_diff_before, FLAGS_diff_after, std::cout);
+  }
+  return RunMerge(FLAGS_merge_base, FLAGS_merge_ours, FLAGS_merge_theirs,
+                  FLAGS_merge_output, std::cout);
+}
+
+// Logs how much cue text was shared between the loaded files, see
+// SubRipTextPool.
+void LogTextPoolStats() {
+  const auto stats = subtitler::srt::SubRipTextPool::Global().GetStats();
+  LOG(INFO) << "Shared " << stats.num_hits << " of " << stats.num_lookups
+            << " interned cue texts, saving " << stats.bytes_saved
+            << " bytes.";
+}
+
+// Converts the files under FLAGS_convert_directory, returning the exit code.
+int RunConvertFromFlags() {
+  auto format =
+      subtitler::srt::SubtitleFormatFromExtension(FLAGS_convert_format);
+  if (!format) {
+    LOG(ERROR) << "Unknown convert_format: " << FLAGS_convert_format;
+    return 2;
+  }
+  const std::string& output_directory = FLAGS_convert_output_directory.empty()
+                                            ? FLAGS_convert_directory
+                                            : FLAGS_convert_output_directory;
+  return subtitler::cli::RunConvert(
+      FLAGS_convert_directory, output_directory, *format,
+      static_cast<std::size_t>(std::max(FLAGS_convert_threads, 0)), std::cout);
+}
+
 }  // namespace
 
 DEFINE_validator(ffplay_path, &ValidateFlagNonEmpty);
@@ -94,6 +185,23 @@ int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags= */ true);
 
+  // Linting, diffing, merging and converting don't need the ff binaries.
+  if (!FLAGS_lint_directory.empty()) {
+    const int exit_code = RunLintFromFlags();
+    LogTextPoolStats();
+    return exit_code;
+  }
+  if (!FLAGS_convert_directory.empty()) {
+    return RunConvertFromFlags();
+  }
+  if ((!FLAGS_diff_before.empty() && !FLAGS_diff_after.empty()) ||
+      (!FLAGS_merge_base.empty() && !FLAGS_merge_ours.empty() &&
+       !FLAGS_merge_theirs.empty() && !FLAGS_merge_output.empty())) {
+    const int exit_code = RunDiffFromFlags();
+    LogTextPoolStats();
+    return exit_code;
+  }
+
   // If any binary path has spaces, let's make sure they are not
   // interpreted wrongly by wrapping them up with quotes.
   FixInputPath(FLAGS_ffplay_path, /* should_have_quotes= */ true);
@@ -3,6 +3,8 @@
 #include <glog/logging.h>
 #include <io.h>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -14,7 +16,11 @@
 #include <windows.h>
 
 #include "subtitler/cli/commands.h"
+#include "subtitler/cli/convert.h"
+#include "subtitler/cli/diff.h"
 #include "subtitler/cli/io/input.h"
+#include "subtitler/cli/lint.h"
+#include "subtitler/srt/subrip_text_pool.h"
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/util/unicode.h"
 #include "subtitler/video/metadata/ffprobe.h"
@@ -23,6 +29,41 @@
 DEFINE_string(ffplay_path, "ffplay", "Required. Path to ffplay binary.");
 DEFINE_string(ffmpeg_path, "ffmpeg", "Required. Path to ffmpeg binary.");
 DEFINE_string(ffprobe_path, "ffprobe", "Required. Path to ffprobe binary.");
+DEFINE_string(lint_directory, "",
+              "Optional. If provided, lints every .srt file under this "
+              "directory, prints a JSON report to stdout and exits.");
+DEFINE_int32(lint_threads, 0,
+             "Number of files linted concurrently. 0 uses all cores.");
+DEFINE_int32(lint_min_gap_ms, 84,
+             "Gaps between cues shorter than this are reported.");
+DEFINE_int32(lint_min_duration_ms, 833,
+             "Cues shorter than this are reported.");
+DEFINE_int32(lint_max_duration_ms, 7000,
+             "Cues longer than this are reported.");
+DEFINE_double(lint_max_chars_per_second, 20,
+              "Cues with a faster reading speed are reported.");
+DEFINE_int32(lint_max_lines, 2, "Cues with more lines are reported.");
+DEFINE_string(diff_before, "",
+              "Optional. If provided with diff_after, prints the changes "
+              "between the two .srt files and exits.");
+DEFINE_string(diff_after, "", "The changed .srt file to diff.");
+DEFINE_string(merge_base, "",
+              "Optional. If provided with merge_ours, merge_theirs and "
+              "merge_output, merges the edits both made to this .srt file "
+              "into merge_output and exits.");
+DEFINE_string(merge_ours, "", "The first edited copy of merge_base.");
+DEFINE_string(merge_theirs, "", "The second edited copy of merge_base.");
+DEFINE_string(merge_output, "", "Path to write the merged .srt file to.");
+DEFINE_string(convert_directory, "",
+              "Optional. If provided, converts every .srt, .vtt and .ass "
+              "file under this directory to convert_format and exits.");
+DEFINE_string(convert_output_directory, "",
+              "Where converted files are written, keeping their path "
+              "relative to convert_directory. Defaults to convert_directory.");
+DEFINE_string(convert_format, "vtt",
+              "Format to convert to, one of srt, vtt or ass.");
+DEFINE_int32(convert_threads, 0,
+             "Number of files converted concurrently. 0 uses all cores.");
 
 namespace {
 
@@ -157,6 +198,63 @@ std::wstring OpenFileDialog(bool save) {
   return result;
 }
 
+// Lints FLAGS_lint_directory, returning the exit code.
+int RunLintFromFlags() {
+  subtitler::srt::LintOptions options;
+  options.min_gap = std::chrono::milliseconds{FLAGS_lint_min_gap_ms};
+  options.min_duration = std::chrono::milliseconds{FLAGS_lint_min_duration_ms};
+  options.max_duration = std::chrono::milliseconds{FLAGS_lint_max_duration_ms};
+  options.max_chars_per_second = FLAGS_lint_max_chars_per_second;
+  options.max_lines = FLAGS_lint_max_lines;
+  return subtitler::cli::RunLint(
+      subtitler::GetFileSystemUtf8Path(FLAGS_lint_directory), options,
+      static_cast<std::size_t>(std::max(FLAGS_lint_threads, 0)), std::cout);
+}
+
+// Diffs or merges the files given by the diff_ or merge_ flags, returning
+// the exit code.
+int RunDiffFromFlags() {
+  using subtitler::GetFileSystemUtf8Path;
+  using subtitler::cli::RunDiff;
+  using subtitler::cli::RunMerge;
+  if (!FLAGS_diff_before.empty() && !FLAGS_diff_after.empty()) {
+    return RunDiff(GetFileSystemUtf8Path(FLAGS_diff_before),
+                   GetFileSystemUtf8Path(FLAGS_diff_after), std::cout);
+  }
+  return RunMerge(GetFileSystemUtf8Path(FLAGS_merge_base),
+                  GetFileSystemUtf8Path(FLAGS_merge_ours),
+                  GetFileSystemUtf8Path(FLAGS_merge_theirs),
+                  GetFileSystemUtf8Path(FLAGS_merge_output), std::cout);
+}
+
+// Logs how much cue text was shared between the loaded files, see
+// SubRipTextPool.
+void LogTextPoolStats() {
+  const auto stats = subtitler::srt::SubRipTextPool::Global().GetStats();
+  LOG(INFO) << "Shared " << stats.num_hits << " of " << stats.num_lookups
+            << " interned cue texts, saving " << stats.bytes_saved
+            << " bytes.";
+}
+
+// Converts the files under FLAGS_convert_directory, returning the exit code.
+int RunConvertFromFlags() {
+  using subtitler::GetFileSystemUtf8Path;
+  auto format =
+      subtitler::srt::SubtitleFormatFromExtension(FLAGS_convert_format);
+  if (!format) {
+    LOG(ERROR) << "Unknown convert_format: " << FLAGS_convert_format;
+    return 2;
+  }
+  auto input_directory = GetFileSystemUtf8Path(FLAGS_convert_directory);
+  auto output_directory =
+      FLAGS_convert_output_directory.empty()
+          ? input_directory
+          : GetFileSystemUtf8Path(FLAGS_convert_output_directory);
+  return subtitler::cli::RunConvert(
+      input_directory, output_directory, *format,
+      static_cast<std::size_t>(std::max(FLAGS_convert_threads, 0)), std::cout);
+}
+
 }  // namespace
 
 DEFINE_validator(ffplay_path, &ValidateFlagNonEmpty);
@@ -170,6 +268,23 @@ int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   gflags::ParseCommandLineFlags(&argc, &argv, /* remove_flags= */ true);
 
+  // Linting, diffing, merging and converting don't need the ff binaries.
+  if (!FLAGS_lint_directory.empty()) {
+    const int exit_code = RunLintFromFlags();
+    LogTextPoolStats();
+    return exit_code;
+  }
+  if (!FLAGS_convert_directory.empty()) {
+    return RunConvertFromFlags();
+  }
+  if ((!FLAGS_diff_before.empty() && !FLAGS_diff_after.empty()) ||
+      (!FLAGS_merge_base.empty() && !FLAGS_merge_ours.empty() &&
+       !FLAGS_merge_theirs.empty() && !FLAGS_merge_output.empty())) {
+    const int exit_code = RunDiffFromFlags();
+    LogTextPoolStats();
+    return exit_code;
+  }
+
 #ifdef _DEBUG
   LOG(INFO) << "debug mode";
   // Temporary workaround until Bill Gates fixes this deadlock with ASAN and
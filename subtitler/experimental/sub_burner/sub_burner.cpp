@@ -12,6 +12,9 @@ DEFINE_string(ffmpeg_path, "ffmpeg", "Required. Path to ffmpeg binary.");
 DEFINE_string(video_path, "", "Required. Path to the input video.");
 DEFINE_string(subtitle_path, "", "Required. Path to the input subtitles.");
 DEFINE_string(output_path, "", "Required. Path to the output video.");
+DEFINE_string(report_path, "",
+              "Optional. Path to write a JSON report of the run to, with the "
+              "resources used by ffmpeg and its progress over time.");
 
 namespace {
 
@@ -53,6 +56,10 @@ int main(int argc, char** argv) {
 
   LOG(INFO) << ffmpeg.GetVersionInfo();
 
+  if (!FLAGS_report_path.empty()) {
+    ffmpeg.SetRunReportPath(FLAGS_report_path);
+  }
+
   ffmpeg.BurnSubtitlesAsync(
       FLAGS_video_path, FLAGS_subtitle_path, FLAGS_output_path,
       [](const video::processing::Progress& progress) {
@@ -6,6 +6,7 @@
 #include <QMetaType>
 
 #include "subtitler/gui/exporting/export_dialog.h"
+#include "subtitler/gui/exporting/tasks/report_path.h"
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/video/processing/ffmpeg.h"
 
@@ -37,6 +38,11 @@ void BurnSubtitleTask::run() {
       ffmpeg_path, std::make_unique<subprocess::SubprocessExecutor>()};
 
   try {
+    // Keep a report of what each export cost in the app data directory.
+    const QString report_path = CreateReportFile("burn");
+    if (!report_path.isEmpty()) {
+      ffmpeg.SetRunReportPath(report_path.toStdString());
+    }
     ffmpeg.BurnSubtitlesAsync(
         video_.toStdString(), subtitle_.toStdString(), output_.toStdString(),
         [this](const video::processing::Progress& progress) {
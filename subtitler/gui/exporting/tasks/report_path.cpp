@@ -0,0 +1,43 @@
+#include "subtitler/gui/exporting/tasks/report_path.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+namespace subtitler {
+namespace gui {
+namespace exporting {
+namespace tasks {
+
+QString CreateReportFile(const QString& kind) {
+  QDir reports{QStandardPaths::writableLocation(
+                   QStandardPaths::AppLocalDataLocation) +
+               "/reports"};
+  if (!reports.mkpath(".")) {
+    return "";
+  }
+  const QString stem =
+      kind + "-" +
+      QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz");
+  // Bounded in case the directory can't be written to at all.
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    const QString name =
+        attempt == 0 ? stem + ".json"
+                     : stem + "-" + QString::number(attempt) + ".json";
+    QFile file{reports.filePath(name)};
+    // Fails if the file exists, so two tasks can't claim the same name.
+    if (file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+      return file.fileName();
+    }
+    if (!file.exists()) {
+      return "";
+    }
+  }
+  return "";
+}
+
+}  // namespace tasks
+}  // namespace exporting
+}  // namespace gui
+}  // namespace subtitler
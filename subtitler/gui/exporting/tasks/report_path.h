@@ -0,0 +1,23 @@
+#ifndef SUBTITLER_GUI_EXPORTING_TASKS_REPORT_PATH
+#define SUBTITLER_GUI_EXPORTING_TASKS_REPORT_PATH
+
+#include <QString>
+
+namespace subtitler {
+namespace gui {
+namespace exporting {
+namespace tasks {
+
+// Creates an empty report file named after kind and the current time, such
+// as "burn-20240101-120000-123.json", in the reports directory of the app
+// data. A counter is appended if the name is taken, so exports started at
+// the same time never share a report. Returns an empty string if the file
+// could not be created.
+QString CreateReportFile(const QString& kind);
+
+}  // namespace tasks
+}  // namespace exporting
+}  // namespace gui
+}  // namespace subtitler
+
+#endif
@@ -10,6 +10,9 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QHBoxLayout>
+#include <QKeySequence>
+#include <QLabel>
+#include <QLineEdit>
 #include <QMenuBar>
 #include <QVBoxLayout>
 #include <chrono>
@@ -62,6 +65,13 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
 
   QMenu* file_menu = menuBar()->addMenu(tr("&File"));
   QAction* export_video_action = file_menu->addAction(tr("Export Video"));
+  QMenu* edit_menu = menuBar()->addMenu(tr("&Edit"));
+  QAction* undo_action = edit_menu->addAction(tr("Undo"));
+  undo_action->setShortcut(QKeySequence::Undo);
+  QAction* redo_action = edit_menu->addAction(tr("Redo"));
+  redo_action->setShortcut(QKeySequence::Redo);
+  QAction* find_action = edit_menu->addAction(tr("Find Subtitle"));
+  find_action->setShortcut(QKeySequence::Find);
   QMenu* subtitle_menu = menuBar()->addMenu(tr("&Subtitle"));
   QAction* auto_transcribe_action =
       subtitle_menu->addAction(tr("Auto Transcribe"));
@@ -84,9 +94,19 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   auto* step_forwards =
       new player_controls::StepForwardsButton{player_controls_placeholder};
 
+  // Pressing enter again moves on to the next subtitle found.
+  auto* search_box = new QLineEdit{player_controls_placeholder};
+  search_box->setPlaceholderText(tr("Find subtitle text"));
+  search_box->setClearButtonEnabled(true);
+  search_box->setMaximumWidth(300);
+  auto* search_results = new QLabel{player_controls_placeholder};
+
   player_controls_layout->addWidget(step_backwards);
   player_controls_layout->addWidget(play_button);
   player_controls_layout->addWidget(step_forwards);
+  player_controls_layout->addStretch();
+  player_controls_layout->addWidget(search_box);
+  player_controls_layout->addWidget(search_results);
 
   timeline::Timer* timer =
       new timeline::Timer{interactive_elements_placeholder};
@@ -141,6 +161,24 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   connect(this, &MainWindow::playerChangedTime, timeline,
           &timeline::Timeline::onPlayerChangedTime);
 
+  // Search moves the ruler, and so the player, to the subtitles found.
+  connect(search_box, &QLineEdit::returnPressed, timeline,
+          [search_box, timeline]() {
+            timeline->onFindSubtitle(search_box->text());
+          });
+  connect(search_box, &QLineEdit::textChanged, search_results,
+          &QLabel::clear);
+  connect(timeline, &timeline::Timeline::subtitleFound, search_results,
+          [search_results](std::size_t hit, std::size_t num_hits) {
+            search_results->setText(
+                num_hits == 0 ? tr("No results")
+                              : tr("%1 of %2").arg(hit).arg(num_hits));
+          });
+  connect(find_action, &QAction::triggered, search_box, [search_box]() {
+    search_box->setFocus();
+    search_box->selectAll();
+  });
+
   audio_output_ = std::make_unique<QAVAudioOutput>();
   // Handle decoded frames.
   connect(player_.get(), &QAVPlayer::audioFrame, this,
@@ -179,6 +217,14 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   connect(auto_transcribe_action, &QAction::triggered, this,
           &MainWindow::onAutoTranscribe);
   connect(auto_transcribe_action, &QAction::triggered, this, pause_player);
+  // Undo replaces the intervals it changes, the editor follows the one it
+  // is showing.
+  connect(timeline, &timeline::Timeline::subtitleIntervalReplaced, editor_,
+          &subtitle_editor::SubtitleEditor::onSubtitleReplaced);
+  connect(undo_action, &QAction::triggered, timeline,
+          &timeline::Timeline::onUndo);
+  connect(redo_action, &QAction::triggered, timeline,
+          &timeline::Timeline::onRedo);
 
   if (!subtitle_file_.isEmpty()) {
     timeline->LoadSubtitles();
@@ -260,6 +306,8 @@ void MainWindow::onExport(bool checked) {
   if (export_dialog_) {
     return;
   }
+  // Export reads the SRT file, so it must include the journaled edits.
+  editor_->onCompact();
   exporting::Inputs inputs;
   inputs.video_file = video_file_->fileName();
   inputs.subtitle_file = subtitle_file_;
@@ -67,7 +67,7 @@ SubtitleEditor::SubtitleEditor(QWidget* parent)
   connect(text_edit_, &QPlainTextEdit::textChanged, this,
           &SubtitleEditor::onSubtitleTextChanged);
   connect(save_button, &QPushButton::clicked, this,
-          [this]() { this->onSave(); });
+          &SubtitleEditor::onCompact);
   connect(delete_button, &QPushButton::clicked, this,
           &SubtitleEditor::onDelete);
   connect(this, &SubtitleEditor::visibilityChanged, this,
@@ -115,6 +115,23 @@ void SubtitleEditor::onSubtitleChangeStartEndTime(
   begin_end_time_->setText(FormatSubtitleStartEndString(subtitle));
 }
 
+void SubtitleEditor::onSubtitleReplaced(
+    timeline::SubtitleInterval* subtitle,
+    timeline::SubtitleInterval* replacement) {
+  if (!currently_editing_ || subtitle != currently_editing_) {
+    // irrelevant event, skip.
+    return;
+  }
+  if (replacement) {
+    onOpenSubtitle(container_, replacement);
+    return;
+  }
+  // Without a container, closing doesn't compact, which would drop the
+  // redo steps.
+  onOpenSubtitle(Q_NULLPTR, Q_NULLPTR);
+  setVisible(false);
+}
+
 // Null container means to keep using the container member.
 // A valid container ptr means to use the new container for successive calls.
 void SubtitleEditor::onSave(timeline::SubtitleIntervalContainer* container) {
@@ -124,7 +141,15 @@ void SubtitleEditor::onSave(timeline::SubtitleIntervalContainer* container) {
   if (container) {
     container_ = container;
   }
+  // Only the journal is written, the SRT file is unchanged.
   container_->SaveSubripFile();
+}
+
+void SubtitleEditor::onCompact() {
+  if (!container_) {
+    return;
+  }
+  container_->CompactSubripFile();
   emit saved(container_->intervals().size());
 }
 
@@ -139,10 +164,10 @@ void SubtitleEditor::onDelete() {
   setVisible(false);
 }
 
-// Save when closing editor.
+// Write the SRT file when closing editor.
 void SubtitleEditor::onVisibilityChanged(bool visible) {
   if (prev_visibility_ != visible && !visible) {
-    onSave();
+    onCompact();
   }
   prev_visibility_ = visible;
 }
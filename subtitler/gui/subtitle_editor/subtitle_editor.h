@@ -47,10 +47,17 @@ class SubtitleEditor : public QDockWidget {
                       timeline::SubtitleInterval* subtitle);
   void onSubtitleTextChanged();
   void onSubtitleChangeStartEndTime(timeline::SubtitleInterval* subtitle);
+  // Follows the subtitle being edited when undo or redo replaces it, and
+  // closes if it was removed.
+  void onSubtitleReplaced(timeline::SubtitleInterval* subtitle,
+                          timeline::SubtitleInterval* replacement);
 
+  // Records edits in the journal of the container.
   // Pass a container pointer to use this new container for successive calls.
   // Pass null container to keep using the last container.
   void onSave(timeline::SubtitleIntervalContainer* container = Q_NULLPTR);
+  // Rewrites the SRT file with all edits so far.
+  void onCompact();
   void onDelete();
   void onVisibilityChanged(bool visible);
   void onPositionSelected(const std::string& position_id);
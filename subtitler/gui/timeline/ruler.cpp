@@ -7,8 +7,10 @@
 #include <QMenu>
 #include <QPainter>
 #include <QScrollBar>
+#include <algorithm>
 #include <stdexcept>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "subtitler/util/duration_format.h"
@@ -41,6 +43,14 @@ Ruler::Ruler(QWidget* parent, std::chrono::milliseconds duration,
   if (!subtitle_intervals_) {
     throw std::runtime_error{"Unable allocate subtitle container"};
   }
+  connect(subtitle_intervals_, &SubtitleIntervalContainer::intervalReplaced,
+          this, &Ruler::subtitleIntervalReplaced);
+  connect(subtitle_intervals_, &SubtitleIntervalContainer::searchIndexBuilt,
+          this, [this]() {
+            if (auto text = std::exchange(pending_find_text_, std::nullopt)) {
+              onFindSubtitle(*text);
+            }
+          });
 
   setAttribute(Qt::WA_OpaquePaintEvent);
 
@@ -100,6 +110,50 @@ void Ruler::ReloadSubtitles(const QString& new_subtitle_file) {
   updateChildren();
 }
 
+void Ruler::onUndo() {
+  if (subtitle_intervals_->Undo(interval_width_, msPerInterval(),
+                                BODY_HEIGHT / 2)) {
+    updateChildren();
+  }
+}
+
+void Ruler::onRedo() {
+  if (subtitle_intervals_->Redo(interval_width_, msPerInterval(),
+                                BODY_HEIGHT / 2)) {
+    updateChildren();
+  }
+}
+
+void Ruler::onFindSubtitle(const QString& text) {
+  if (subtitle_intervals_->IsSearchIndexBuilding()) {
+    pending_find_text_ = text;
+    return;
+  }
+  auto found = subtitle_intervals_->FindIntervals(text);
+  if (found.empty()) {
+    emit subtitleFound(0, 0);
+    return;
+  }
+  // Searching again steps through the hits.
+  auto next = std::upper_bound(
+      found.begin(), found.end(), indicator_time_,
+      [](auto time, const auto* interval) {
+        return time < interval->GetBeginTime();
+      });
+  if (next == found.end()) {
+    next = found.begin();
+  }
+  const auto begin_time = (*next)->GetBeginTime();
+  onMoveIndicator(begin_time);
+  emit userChangedIndicatorTime(indicator_time_);
+  if (scroll_bar_) {
+    // Center the start of the subtitle in the view.
+    scroll_bar_->setValue(millisecondsToPosition(begin_time) -
+                          scroll_bar_->pageStep() / 2);
+  }
+  emit subtitleFound(next - found.begin() + 1, found.size());
+}
+
 void Ruler::onMoveIndicator(std::chrono::milliseconds frame_time) {
   if (frame_time < 0ms || frame_time > duration_) {
     return;
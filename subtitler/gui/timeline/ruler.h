@@ -5,6 +5,7 @@
 #include <QTimer>
 #include <QWidget>
 #include <chrono>
+#include <optional>
 
 #include "subtitler/gui/timeline/indicator.h"
 #include "subtitler/gui/timeline/subtitle_interval.h"
@@ -58,6 +59,12 @@ class Ruler : public QWidget {
   void changeSubtitleIntervalTimeFinished(SubtitleIntervalContainer* container,
                                           SubtitleInterval* interval);
   void subtitleFileLoaded(std::size_t num_subtitles);
+  // Result of onFindSubtitle(): the hit moved to, counting from 1, out of
+  // num_hits. Both are 0 if nothing was found.
+  void subtitleFound(std::size_t hit, std::size_t num_hits);
+  // See SubtitleIntervalContainer::intervalReplaced().
+  void subtitleIntervalReplaced(SubtitleInterval* interval,
+                                SubtitleInterval* replacement);
 
  public slots:
   void onZoomIn(int level);
@@ -66,6 +73,12 @@ class Ruler : public QWidget {
   void onStepIndicator(std::chrono::milliseconds delta);
   void onAddSubtitleIntervalAfter();
   void onAddSubtitleIntervalBefore();
+  void onUndo();
+  void onRedo();
+  // Moves the indicator to the start of the next subtitle containing text,
+  // wrapping around to the first one, and scrolls it into view. While the
+  // subtitles are still being indexed, the search runs once they are.
+  void onFindSubtitle(const QString& text);
 
  protected:
   virtual void paintEvent(QPaintEvent* event) override;
@@ -95,6 +108,9 @@ class Ruler : public QWidget {
 
   std::chrono::milliseconds indicator_time_;
 
+  // Search made while the subtitles were being indexed.
+  std::optional<QString> pending_find_text_;
+
   // context menu
   QMenu* context_menu_;
   QAction* add_subtitle_after_;
@@ -1,12 +1,16 @@
 #include "subtitler/gui/timeline/subtitle_interval.h"
 
 #include <QDebug>
+#include <QEvent>
 #include <QFrame>
 #include <QLabel>
-#include <fstream>
+#include <QMetaObject>
+#include <QMetaType>
+#include <QRunnable>
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_map>
 
-#include "subtitler/srt/subrip_file.h"
 #include "subtitler/util/qstring_to_utf8_path.h"
 
 #define CUT_MARKER_WIDTH 10
@@ -16,23 +20,100 @@
 using namespace std::chrono_literals;
 namespace fs = std::filesystem;
 
+// Needed to pass the index through QMetaObject::invokeMethod, see
+// subtitler/gui/exporting/tasks/remux_subtitle_task.cpp.
+Q_DECLARE_METATYPE(std::shared_ptr<subtitler::srt::SubRipSearchIndex>)
+
 namespace subtitler {
 namespace gui {
 namespace timeline {
 
+namespace {
+
+// Indexes the text of a loaded file, which can take a while for long ones.
+class BuildSearchIndexTask : public QRunnable {
+ public:
+  BuildSearchIndexTask(
+      std::vector<std::pair<srt::SubRipFile::CueId, std::string>> cues,
+      quint64 generation, SubtitleIntervalContainer* container)
+      : QRunnable{},
+        cues_{std::move(cues)},
+        generation_{generation},
+        container_{container} {}
+
+  void run() override {
+    auto index = std::make_shared<srt::SubRipSearchIndex>(cues_);
+    QMetaObject::invokeMethod(
+        container_, "onSearchIndexBuilt", Qt::QueuedConnection,
+        // Q_ARG expects fully qualified name.
+        Q_ARG(std::shared_ptr<subtitler::srt::SubRipSearchIndex>, index),
+        Q_ARG(quint64, generation_));
+  }
+
+ private:
+  std::vector<std::pair<srt::SubRipFile::CueId, std::string>> cues_;
+  quint64 generation_;
+  SubtitleIntervalContainer* container_;
+};
+
+}  // namespace
+
 SubtitleIntervalContainer::SubtitleIntervalContainer(
     const QString& output_srt_file, QWidget* parent)
-    : QWidget{parent}, output_srt_file_{QStringToUtf8Path(output_srt_file)} {}
+    : QWidget{parent}, output_srt_file_{QStringToUtf8Path(output_srt_file)} {
+  qRegisterMetaType<std::shared_ptr<subtitler::srt::SubRipSearchIndex>>();
+  // One build at a time, a newer load makes the running one obsolete anyway.
+  search_index_pool_.setMaxThreadCount(1);
+  resetJournal();
+  resetHistory(srt::SubRipFile{});
+}
 
-SubtitleIntervalContainer::~SubtitleIntervalContainer() = default;
+SubtitleIntervalContainer::~SubtitleIntervalContainer() {
+  try {
+    CompactSubripFile();
+  } catch (const std::exception& e) {
+    qDebug() << "Failed to save subtitles: " << e.what();
+  }
+}
+
+void SubtitleIntervalContainer::resetJournal() {
+  journal_.reset();
+  if (!output_srt_file_.empty()) {
+    journal_ = std::make_unique<srt::SubRipJournal>(output_srt_file_);
+  }
+}
+
+void SubtitleIntervalContainer::resetHistory(const srt::SubRipFile& file) {
+  history_.Reset(file);
+  next_history_id_ = file.NumItems() + 1;
+}
 
 void SubtitleIntervalContainer::AddInterval(
     std::unique_ptr<SubtitleInterval> interval) {
+  if (interval && journal_) {
+    journal_->Added(interval->item_);
+  }
+  if (interval) {
+    interval->history_id_ = next_history_id_++;
+    history_.Record(interval->history_id_, interval->item_.get());
+    history_.Commit();
+  }
+  auto* added = interval.get();
+  insertInterval(std::move(interval));
+  updateSearchIndex(added->history_id_);
+}
+
+void SubtitleIntervalContainer::insertInterval(
+    std::unique_ptr<SubtitleInterval> interval) {
   if (!interval) {
     throw std::runtime_error{"Cannot add null interval to container"};
   }
   auto* interval_raw_ptr = interval.get();
+  interval_raw_ptr->container_index_ = intervals_.size();
+  interval_raw_ptr->container_ = this;
   intervals_.push_back(std::move(interval));
+  interval_raw_ptr->queueForSave();
+  id_to_interval_map_[interval_raw_ptr->history_id_] = interval_raw_ptr;
   auto [ignore, ok] = marker_to_interval_map_.insert(
       {interval_raw_ptr->GetBeginMarker(), interval_raw_ptr});
   if (!ok) {
@@ -54,25 +135,55 @@ void SubtitleIntervalContainer::RemoveInterval(SubtitleInterval* interval) {
   if (!interval || intervals_.size() == 0) {
     return;
   }
+  if (journal_) {
+    journal_->Removed(interval->item_.get());
+  }
+  const auto id = interval->history_id_;
+  history_.Record(id, nullptr);
+  history_.Commit();
+  eraseInterval(interval);
+  updateSearchIndex(id);
+}
+
+void SubtitleIntervalContainer::eraseInterval(SubtitleInterval* interval) {
   // Remove from maps first.
   marker_to_interval_map_.erase(interval->GetBeginMarker());
   marker_to_interval_map_.erase(interval->GetEndMarker());
   rect_to_interval_map_.erase(interval->GetRect());
+  if (auto it = id_to_interval_map_.find(interval->history_id_);
+      it != id_to_interval_map_.end() && it->second == interval) {
+    id_to_interval_map_.erase(it);
+  }
 
-  // Search for the interval in the vector and delete it.
-  for (auto it = intervals_.begin(); it != intervals_.end(); ++it) {
-    if (it->get() == interval) {
-      it->get()->CleanupWithoutParentAsking();
-      intervals_.erase(it);
-      interval = Q_NULLPTR;
-      return;
-    }
+  if (interval->queued_for_save_) {
+    std::erase(changed_intervals_, interval);
+    interval->queued_for_save_ = false;
   }
+
+  // Intervals are unordered, so move the last one into its slot instead of
+  // shifting everything after it.
+  auto index = interval->container_index_;
+  if (index >= intervals_.size() || intervals_[index].get() != interval) {
+    return;
+  }
+  interval->CleanupWithoutParentAsking();
+  if (index + 1 != intervals_.size()) {
+    intervals_[index] = std::move(intervals_.back());
+    intervals_[index]->container_index_ = index;
+  }
+  intervals_.pop_back();
 }
 
 void SubtitleIntervalContainer::DeleteAll() {
   marker_to_interval_map_.clear();
   rect_to_interval_map_.clear();
+  id_to_interval_map_.clear();
+  changed_intervals_.clear();
+  search_index_ = srt::SubRipSearchIndex{};
+  // Drops the index of any load still being built.
+  ++search_index_generation_;
+  search_index_pending_ = false;
+  search_index_edits_.clear();
 
   // In SubtitleInterval, each member (begin_marker, end_marker) etc has
   // the same parent as SubtitleIntervalContainer. Consequently, deleting the
@@ -104,61 +215,252 @@ SubtitleInterval* SubtitleIntervalContainer::GetIntervalFromRect(
 }
 
 void SubtitleIntervalContainer::SaveSubripFile() {
-  if (output_srt_file_.empty()) {
+  if (!journal_) {
     return;
   }
 
-  srt::SubRipFile srt_file;
-  for (const auto& interval : intervals_) {
-    srt_file.AddItem(interval->item_);
+  try {
+    for (auto* interval : changed_intervals_) {
+      if (interval->timing_changed_) {
+        journal_->Retimed(interval->item_.get());
+      }
+      if (interval->text_changed_) {
+        // Shares the text with any other cue with the same text.
+        interval->item_->InternPayload();
+        journal_->TextEdited(interval->item_.get());
+      }
+      if (interval->position_changed_) {
+        journal_->PositionEdited(interval->item_.get());
+      }
+      if (interval->timing_changed_ || interval->text_changed_ ||
+          interval->position_changed_) {
+        history_.Record(interval->history_id_, interval->item_.get());
+      }
+      interval->timing_changed_ = false;
+      interval->text_changed_ = false;
+      interval->position_changed_ = false;
+      interval->queued_for_save_ = false;
+    }
+  } catch (const std::exception& e) {
+    // TODO: maybe open dialog and warn user rather than using debug?
+    qDebug() << "Could not save subtitles: " << e.what();
+    // Keep the intervals which weren't recorded for the next save.
+    std::erase_if(changed_intervals_, [](const auto* interval) {
+      return !interval->queued_for_save_;
+    });
+    history_.Commit();
+    return;
   }
+  changed_intervals_.clear();
+  history_.Commit();
+}
 
-  std::ofstream file{output_srt_file_,
-                     std::ofstream::out | std::ofstream::trunc};
-  if (!file) {
-    // TODO: maybe open dialog and warn user rather than using debug?
-    qDebug() << "Could not open "
-             << QString::fromStdString(output_srt_file_.string());
+void SubtitleIntervalContainer::CompactSubripFile() {
+  if (!journal_) {
+    return;
+  }
+  SaveSubripFile();
+  // Never rewrite a file that wasn't edited, which would also re-encode it
+  // to UTF-8, or one that failed to load.
+  if (!journal_->HasPendingChanges()) {
+    return;
+  }
+  try {
+    journal_->Compact();
+  } catch (const std::exception& e) {
+    qDebug() << "Could not save subtitles: " << e.what();
     return;
   }
-  srt_file.ToStream(file);
   qDebug() << "Saved!";
 }
 
 std::pair<bool, std::size_t> SubtitleIntervalContainer::LoadSubripFile(
     qreal interval_width, quint32 ms_per_interval, int y_coord) {
-  srt::SubRipFile srt_file;
-  if (output_srt_file_.empty() || !fs::exists(output_srt_file_)) {
+  if (!journal_) {
     qDebug() << "No subtitle file to load";
     return std::make_pair(false, 0);
   }
+  std::size_t num_loaded = 0;
   try {
-    srt_file.LoadState(output_srt_file_);
-    if (srt_file.NumItems() == 0) {
+    // Open even if the SRT doesn't exist yet, so that edits recorded from
+    // now on apply to the empty file.
+    auto subrip_items = journal_->Open();
+    if (journal_->recovered_changes()) {
+      qDebug() << "Recovered unsaved changes!";
+    }
+    // The items are sorted, so they keep their order and get ids 1 to n.
+    srt::SubRipFile::Builder builder;
+    builder.Reserve(subrip_items.size());
+    for (const auto& subrip_item : subrip_items) {
+      builder.Add(subrip_item);
+    }
+    resetHistory(builder.Build());
+    if (subrip_items.empty()) {
       qDebug() << "No subtitle items found!";
       return std::make_pair(false, 0);
     }
     qDebug() << "Loaded subtitles!";
     DeleteAll();
 
-    const auto& subrip_items = srt_file.GetItems();
-    for (const auto& subrip_item : subrip_items) {
-      AddInterval(std::make_unique<SubtitleInterval>(
-          subrip_item, interval_width, ms_per_interval, y_coord,
-          parentWidget()));
+    // Copies the text, which may be edited while the index is built.
+    std::vector<std::pair<srt::SubRipFile::CueId, std::string>> cues;
+    cues.reserve(subrip_items.size());
+    for (std::size_t i = 0; i < subrip_items.size(); ++i) {
+      auto interval = std::make_unique<SubtitleInterval>(
+          subrip_items[i], interval_width, ms_per_interval, y_coord,
+          parentWidget());
+      interval->history_id_ = i + 1;
+      insertInterval(std::move(interval));
+      cues.emplace_back(i + 1, subrip_items[i]->payload());
     }
+    search_index_pending_ = true;
+    search_index_pool_.start(new BuildSearchIndexTask{
+        std::move(cues), search_index_generation_, this});
+    num_loaded = subrip_items.size();
   } catch (const std::exception& e) {
     qDebug() << "Failed to load subtitle: " << e.what();
     return std::make_pair(false, 0);
   }
-  return std::make_pair(true, srt_file.NumItems());
+  return std::make_pair(true, num_loaded);
 }
 
 void SubtitleIntervalContainer::ChangeSubripFile(
     const QString& new_subrip_file) {
+  CompactSubripFile();
   DeleteAll();
-  QByteArray new_subrip_file_u8 = new_subrip_file.toUtf8();
   output_srt_file_ = QStringToUtf8Path(new_subrip_file);
+  resetJournal();
+  resetHistory(srt::SubRipFile{});
+}
+
+bool SubtitleIntervalContainer::Undo(qreal interval_width,
+                                     quint32 ms_per_interval, int y_coord) {
+  SaveSubripFile();
+  return applyHistoryChanges(history_.Undo(), interval_width, ms_per_interval,
+                             y_coord);
+}
+
+bool SubtitleIntervalContainer::Redo(qreal interval_width,
+                                     quint32 ms_per_interval, int y_coord) {
+  SaveSubripFile();
+  return applyHistoryChanges(history_.Redo(), interval_width, ms_per_interval,
+                             y_coord);
+}
+
+bool SubtitleIntervalContainer::applyHistoryChanges(
+    const std::vector<srt::SubRipHistory::Change>& changes,
+    qreal interval_width, quint32 ms_per_interval, int y_coord) {
+  if (changes.empty()) {
+    return false;
+  }
+  std::unordered_map<srt::SubRipFile::CueId, SubtitleInterval*> intervals;
+  intervals.reserve(intervals_.size());
+  for (const auto& interval : intervals_) {
+    intervals[interval->history_id_] = interval.get();
+  }
+  // Intervals erased below, and what replaced them.
+  std::vector<std::pair<SubtitleInterval*, SubtitleInterval*>> replaced;
+
+  try {
+    for (const auto& [id, before, after] : changes) {
+      auto it = intervals.find(id);
+      std::shared_ptr<srt::SubRipItem> item;
+      if (it != intervals.end()) {
+        item = it->second->item_;
+        replaced.emplace_back(it->second, Q_NULLPTR);
+        eraseInterval(it->second);
+      }
+      if (!after) {
+        if (item && journal_) {
+          journal_->Removed(item.get());
+        }
+        continue;
+      }
+      if (!item) {
+        item = std::make_shared<srt::SubRipItem>(*after);
+        if (journal_) {
+          journal_->Added(item);
+        }
+      } else {
+        // The journal tracks the item, so it is modified in place.
+        *item = *after;
+        if (journal_) {
+          if (before->start() != after->start() ||
+              before->duration() != after->duration()) {
+            journal_->Retimed(item.get());
+          }
+          if (!before->SamePayload(*after)) {
+            journal_->TextEdited(item.get());
+          }
+          if (!before->SamePosition(*after)) {
+            journal_->PositionEdited(item.get());
+          }
+        }
+      }
+      auto interval = std::make_unique<SubtitleInterval>(
+          item, interval_width, ms_per_interval, y_coord, parentWidget());
+      interval->history_id_ = id;
+      if (it != intervals.end()) {
+        replaced.back().second = interval.get();
+      }
+      insertInterval(std::move(interval));
+    }
+  } catch (const std::exception& e) {
+    qDebug() << "Could not apply changes: " << e.what();
+  }
+  for (const auto& change : changes) {
+    updateSearchIndex(change.id);
+  }
+  for (const auto& [interval, replacement] : replaced) {
+    emit intervalReplaced(interval, replacement);
+  }
+  return true;
+}
+
+void SubtitleIntervalContainer::updateSearchIndex(srt::SubRipFile::CueId id) {
+  if (search_index_pending_) {
+    search_index_edits_.push_back(id);
+    return;
+  }
+  if (auto it = id_to_interval_map_.find(id); it != id_to_interval_map_.end()) {
+    search_index_.Update(id, it->second->item_->payload());
+  } else {
+    search_index_.Remove(id);
+  }
+}
+
+void SubtitleIntervalContainer::onSearchIndexBuilt(
+    std::shared_ptr<subtitler::srt::SubRipSearchIndex> index,
+    quint64 generation) {
+  if (!index || generation != search_index_generation_) {
+    return;
+  }
+  search_index_ = std::move(*index);
+  search_index_pending_ = false;
+  for (auto id : search_index_edits_) {
+    updateSearchIndex(id);
+  }
+  search_index_edits_.clear();
+  emit searchIndexBuilt();
+}
+
+std::vector<SubtitleInterval*> SubtitleIntervalContainer::FindIntervals(
+    const QString& text) {
+  std::vector<SubtitleInterval*> found;
+  if (search_index_pending_) {
+    // Never block the UI thread on the build.
+    return found;
+  }
+  for (auto id : search_index_.Find(text.toStdString())) {
+    if (auto it = id_to_interval_map_.find(id);
+        it != id_to_interval_map_.end()) {
+      found.push_back(it->second);
+    }
+  }
+  std::sort(found.begin(), found.end(), [](const auto* a, const auto* b) {
+    return a->GetBeginTime() < b->GetBeginTime();
+  });
+  return found;
 }
 
 void SubtitleInterval::initializeChildren(QWidget* parent) {
@@ -202,6 +504,7 @@ SubtitleInterval::SubtitleInterval(const SubtitleIntervalArgs& args,
   item_->duration(args.end_time - args.start_time);
 
   updateRect();
+  timing_changed_ = false;
 }
 
 SubtitleInterval::SubtitleInterval(const std::shared_ptr<srt::SubRipItem>& item,
@@ -225,37 +528,63 @@ SubtitleInterval::SubtitleInterval(const std::shared_ptr<srt::SubRipItem>& item,
   updateRect();
 
   // Make sure subtitle text state is set properly.
-  subtitle_text_ = QString::fromStdString(item->GetPayload());
+  auto payload = item->payload();
+  subtitle_text_ =
+      QString::fromUtf8(payload.data(), static_cast<int>(payload.size()));
   SetSubtitleText(subtitle_text_);
+  text_changed_ = false;
 }
 
 void SubtitleInterval::MoveBeginMarker(
     const std::chrono::milliseconds& start_time, int x_pos) {
+  // Zooming moves the markers without changing their times.
+  timing_changed_ = timing_changed_ || start_time != item_->start();
   const auto previous_end_time = item_->start() + item_->duration();
   item_->start(start_time);
   item_->duration(previous_end_time - item_->start());
 
   begin_marker_->move(x_pos, begin_marker_->y());
   updateRect();
+  queueForSave();
 }
 
 void SubtitleInterval::MoveEndMarker(const std::chrono::milliseconds& end_time,
                                      int x_pos) {
+  timing_changed_ = timing_changed_ || end_time != GetEndTime();
   item_->duration(end_time - item_->start());
 
   end_marker_->move(x_pos, end_marker_->y());
   updateRect();
+  queueForSave();
 }
 
 void SubtitleInterval::SetSubtitleText(const QString& subtitle) {
-  item_->ClearPayload();
-  item_->AppendLine(subtitle.toStdString());
+  text_changed_ = text_changed_ || subtitle != subtitle_text_;
+  // Interned once the edit is saved rather than on every keystroke.
+  item_->ClearPayload()->AppendLine(subtitle.toStdString());
   subtitle_text_ = subtitle;
   rect_box_->setText(subtitle_text_);
+  if (container_) {
+    container_->updateSearchIndex(history_id_);
+  }
+  queueForSave();
 }
 
 void SubtitleInterval::SetSubtitlePosition(const std::string& position_id) {
+  const int previous_position = item_->substation_alpha_position();
   item_->position(position_id);
+  position_changed_ = position_changed_ ||
+                      previous_position != item_->substation_alpha_position();
+  queueForSave();
+}
+
+void SubtitleInterval::queueForSave() {
+  if (!container_ || queued_for_save_ ||
+      !(timing_changed_ || text_changed_ || position_changed_)) {
+    return;
+  }
+  container_->changed_intervals_.push_back(this);
+  queued_for_save_ = true;
 }
 
 void SubtitleInterval::CleanupWithoutParentAsking() {
@@ -2,14 +2,22 @@
 #define SUBTITLER_GUI_TIMELINE_SUBTITLE_INTERVAL_H
 
 #include <QString>
+#include <QThreadPool>
 #include <QWidget>
 #include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_history.h"
 #include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_journal.h"
+#include "subtitler/srt/subrip_search.h"
 
 QT_FORWARD_DECLARE_CLASS(QLabel)
 QT_FORWARD_DECLARE_CLASS(QFrame)
@@ -30,6 +38,20 @@ namespace timeline {
  * auto* container = new SubtitleIntervalContainer(this);
  * SubtitleIntervalArgs args{ ... };
  * container->AddInterval(std::make_unique<SubtitleInverval>(args, this));
+ *
+ * Each interval edits its srt::SubRipItem in place. The journal tracks the
+ * same item, so every cue is stored once.
+ *
+ * Edits are recorded in a journal next to the SRT file, see
+ * srt::SubRipJournal. The SRT file itself is only rewritten on
+ * CompactSubripFile() and on destruction.
+ *
+ * Every add, remove and saved edit is also an undo step, see
+ * srt::SubRipHistory.
+ *
+ * The text of the intervals is indexed for FindIntervals(), see
+ * srt::SubRipSearchIndex. LoadSubripFile() builds the index on a background
+ * thread, and edits keep it current.
  */
 class SubtitleIntervalContainer : public QWidget {
   Q_OBJECT
@@ -40,15 +62,20 @@ class SubtitleIntervalContainer : public QWidget {
 
   // Unique_ptr required to memory manage SubtitleInterval since it is
   // not a widget. See documentation below on why that is.
+  // The new interval is recorded in the journal and the history.
   void AddInterval(std::unique_ptr<SubtitleInterval> interval);
 
+  // Removal is recorded in the journal and the history. O(1), but changes
+  // the order of intervals().
   void RemoveInterval(SubtitleInterval* interval);
 
+  // Removes the intervals from the timeline only, the SRT file is unchanged.
   void DeleteAll();
 
   SubtitleInterval* GetIntervalFromMarker(QObject* marker);
   SubtitleInterval* GetIntervalFromRect(QObject* rect);
 
+  // In no particular order.
   std::vector<std::unique_ptr<SubtitleInterval>>& intervals() {
     return intervals_;
   };
@@ -58,16 +85,85 @@ class SubtitleIntervalContainer : public QWidget {
   std::pair<bool, std::size_t> LoadSubripFile(qreal interval_width,
                                               quint32 ms_per_interval,
                                               int y_coord);
+  // Compacts pending edits into the current SRT file before switching.
   void ChangeSubripFile(const QString& new_subrip_file);
 
+  // Saves pending edits, then reverts or reapplies the last step. Intervals
+  // which change are replaced, so pointers to them must not be kept.
+  // Returns false if there was nothing to undo or redo.
+  // Params are the same as for LoadSubripFile().
+  bool Undo(qreal interval_width, quint32 ms_per_interval, int y_coord);
+  bool Redo(qreal interval_width, quint32 ms_per_interval, int y_coord);
+
+  // Intervals whose text contains text, sorted by begin time. Case, line
+  // breaks and formatting tags are ignored.
+  // Finds nothing while IsSearchIndexBuilding(), search again on
+  // searchIndexBuilt().
+  std::vector<SubtitleInterval*> FindIntervals(const QString& text);
+  // True from LoadSubripFile() until the index of the load is built.
+  bool IsSearchIndexBuilding() const { return search_index_pending_; }
+
+ signals:
+  // Emitted once the index of the last load is built.
+  void searchIndexBuilt();
+  // Emitted by Undo() and Redo() for every interval they replaced, once all
+  // of their changes are applied. replacement is null if the interval was
+  // removed. interval is already destroyed, so it may only be compared.
+  void intervalReplaced(SubtitleInterval* interval,
+                        SubtitleInterval* replacement);
+
  public slots:
+  // Records the edits made to intervals since the last call in the journal,
+  // as one undo step. The SRT file is left as is.
   void SaveSubripFile();
+  // Records pending edits, then rewrites the SRT file with all of them.
+  void CompactSubripFile();
+  // Called by the task started in LoadSubripFile(). The index is dropped if
+  // another file was loaded since.
+  void onSearchIndexBuilt(
+      std::shared_ptr<subtitler::srt::SubRipSearchIndex> index,
+      quint64 generation);
 
  private:
   std::vector<std::unique_ptr<SubtitleInterval>> intervals_;
   std::unordered_map<QObject*, SubtitleInterval*> marker_to_interval_map_;
   std::unordered_map<QObject*, SubtitleInterval*> rect_to_interval_map_;
   std::filesystem::path output_srt_file_;
+  // Null if there is no output SRT file.
+  std::unique_ptr<srt::SubRipJournal> journal_;
+  srt::SubRipHistory history_;
+  // Id of the next interval, in history_.
+  srt::SubRipFile::CueId next_history_id_ = 1;
+  std::unordered_map<srt::SubRipFile::CueId, SubtitleInterval*>
+      id_to_interval_map_;
+  // Intervals with edits not yet recorded by SaveSubripFile(), so that it
+  // only visits those.
+  std::vector<SubtitleInterval*> changed_intervals_;
+  // Text of the intervals, by history id.
+  srt::SubRipSearchIndex search_index_;
+  // Incremented by every load, to tell which one an index was built for.
+  quint64 search_index_generation_ = 0;
+  // While the index of a load is being built, edits are queued by id and
+  // applied once it arrives.
+  bool search_index_pending_ = false;
+  std::vector<srt::SubRipFile::CueId> search_index_edits_;
+  // Destroyed first, waiting for a running build before the rest goes.
+  QThreadPool search_index_pool_;
+
+  // Adds the interval without recording it in the journal.
+  void insertInterval(std::unique_ptr<SubtitleInterval> interval);
+  // Removes the interval without recording it in the journal.
+  void eraseInterval(SubtitleInterval* interval);
+  void resetJournal();
+  void resetHistory(const srt::SubRipFile& file);
+  // Indexes the current text of the interval with this id, or removes it if
+  // there is none.
+  void updateSearchIndex(srt::SubRipFile::CueId id);
+  bool applyHistoryChanges(
+      const std::vector<srt::SubRipHistory::Change>& changes,
+      qreal interval_width, quint32 ms_per_interval, int y_coord);
+
+  friend class SubtitleInterval;
 };
 
 /**
@@ -133,13 +229,32 @@ class SubtitleInterval {
   QLabel* end_marker_;
   QLabel* rect_box_;
 
+  // Shared with the journal, which tracks it.
   std::shared_ptr<srt::SubRipItem> item_;
   // Payload of SubRipItem may contain  additional formatting, so we also
   // separately store the subtitle_text before any formatting.
   QString subtitle_text_;
 
+  // Edits not yet recorded in the journal by the container.
+  bool timing_changed_ = false;
+  bool text_changed_ = false;
+  bool position_changed_ = false;
+  // Whether the interval is in the container's changed_intervals_.
+  bool queued_for_save_ = false;
+
+  // Position in SubtitleIntervalContainer::intervals_.
+  std::size_t container_index_ = 0;
+  // Identifies the interval across undo steps.
+  srt::SubRipFile::CueId history_id_ = 0;
+  // Set once the interval is in a container, whose search index is updated
+  // on text edits.
+  SubtitleIntervalContainer* container_ = Q_NULLPTR;
+
   void updateRect();
   void initializeChildren(QWidget* parent);
+  // Queues the interval for the next save of its container if it has any
+  // unrecorded edits.
+  void queueForSave();
 
   friend class SubtitleIntervalContainer;
 };
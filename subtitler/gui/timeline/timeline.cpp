@@ -43,6 +43,9 @@ Timeline::Timeline(std::chrono::milliseconds duration,
           &Timeline::onChangeSubtitleStartEndTimeFinished);
   connect(ruler_, &Ruler::subtitleFileLoaded, this,
           &Timeline::onSubtitleFileLoaded);
+  connect(ruler_, &Ruler::subtitleFound, this, &Timeline::subtitleFound);
+  connect(ruler_, &Ruler::subtitleIntervalReplaced, this,
+          &Timeline::subtitleIntervalReplaced);
 }
 
 void Timeline::LoadSubtitles() { ruler_->LoadSubtitles(); }
@@ -89,6 +92,14 @@ void Timeline::onSubtitleFileReload(const QString& new_subtitle_file) {
   ruler_->ReloadSubtitles(new_subtitle_file);
 }
 
+void Timeline::onUndo() { ruler_->onUndo(); }
+
+void Timeline::onRedo() { ruler_->onRedo(); }
+
+void Timeline::onFindSubtitle(const QString& text) {
+  ruler_->onFindSubtitle(text);
+}
+
 }  // namespace timeline
 }  // namespace gui
 }  // namespace subtitler
@@ -39,6 +39,9 @@ class Timeline : public QScrollArea {
   void changeSubtitleStartEndTimeFinished(SubtitleIntervalContainer* container,
                                           SubtitleInterval* subtitle);
   void subtitleFileLoaded(std::size_t num_loaded);
+  void subtitleFound(std::size_t hit, std::size_t num_hits);
+  void subtitleIntervalReplaced(SubtitleInterval* subtitle,
+                                SubtitleInterval* replacement);
 
  public slots:
   // Handles outgoing time changes from the ruler.
@@ -61,6 +64,11 @@ class Timeline : public QScrollArea {
       SubtitleIntervalContainer* container, SubtitleInterval* subtitle);
   void onSubtitleFileLoaded(std::size_t num_loaded);
   void onSubtitleFileReload(const QString& new_subtitle_file);
+  // Undoes or redoes the last edit of the subtitles.
+  void onUndo();
+  void onRedo();
+  // Moves the ruler to the next subtitle containing text.
+  void onFindSubtitle(const QString& text);
 
  private:
   Ruler* ruler_;
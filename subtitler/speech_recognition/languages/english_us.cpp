@@ -12,7 +12,7 @@ namespace speech_recognition {
 namespace languages {
 namespace {
 
-void groupSentences(srt::SubRipFile& srt_file,
+void groupSentences(srt::SubRipFile::Builder& builder,
                     const cloud_service::TranscriptionResult& transcription) {
   std::istringstream tokenizer{transcription.display_text};
 
@@ -45,7 +45,7 @@ void groupSentences(srt::SubRipFile& srt_file,
       const auto end = timing.offset + timing.duration;
       srt::SubRipItem item{};
       item.start(start)->duration(end - start)->AppendLine(sentence_so_far);
-      srt_file.AddItem(std::move(item));
+      builder.Add(item);
       sentence_so_far.clear();
 
       if (no_more_word_timings) {
@@ -60,13 +60,14 @@ void groupSentences(srt::SubRipFile& srt_file,
 
 srt::SubRipFile EnglishUS::ConvertToSRT(
     const std::vector<cloud_service::TranscriptionResult>& transcriptions) {
-  srt::SubRipFile srt_file;
+  // Sentences arrive mostly in order, so sort once at the end.
+  srt::SubRipFile::Builder builder;
 
   for (const auto& transcription : transcriptions) {
-    groupSentences(srt_file, transcription);
+    groupSentences(builder, transcription);
   }
 
-  return srt_file;
+  return builder.Build();
 }
 
 }  // namespace languages
@@ -0,0 +1,490 @@
+#include "subtitler/srt/cue_tree.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+using Node = CueTree::Node;
+
+std::size_t Size(const Node* node) { return node ? node->size : 0; }
+
+std::chrono::milliseconds MaxEnd(const Node* node) {
+  return node ? node->max_end : std::chrono::milliseconds::min();
+}
+
+// Recomputes the augmented fields of node from its children.
+void Update(Node* node) {
+  node->size = 1 + Size(node->left) + Size(node->right);
+  node->max_end =
+      std::max({node->end, MaxEnd(node->left), MaxEnd(node->right)});
+  if (node->left) {
+    node->left->parent = node;
+  }
+  if (node->right) {
+    node->right->parent = node;
+  }
+}
+
+// Same order as SubRipItem::operator<.
+bool Less(const Node* a, const Node* b) {
+  return a->start < b->start || (a->start == b->start && a->end < b->end);
+}
+
+// Splits the tree into the nodes with rank < k, and the rest.
+void SplitAt(Node* node, std::size_t k, Node*& left, Node*& right) {
+  if (!node) {
+    left = right = nullptr;
+    return;
+  }
+  if (Size(node->left) < k) {
+    SplitAt(node->right, k - Size(node->left) - 1, node->right, right);
+    left = node;
+  } else {
+    SplitAt(node->left, k, left, node->left);
+    right = node;
+  }
+  Update(node);
+}
+
+// All nodes of left must come before the nodes of right.
+Node* Merge(Node* left, Node* right) {
+  if (!left || !right) {
+    return left ? left : right;
+  }
+  if (left->priority > right->priority) {
+    left->right = Merge(left->right, right);
+    Update(left);
+    return left;
+  }
+  right->left = Merge(left, right->left);
+  Update(right);
+  return right;
+}
+
+// In order successor, through parent links.
+const Node* Next(const Node* node) {
+  if (node->right) {
+    node = node->right;
+    while (node->left) {
+      node = node->left;
+    }
+    return node;
+  }
+  while (node->parent && node == node->parent->right) {
+    node = node->parent;
+  }
+  return node->parent;
+}
+
+const Node* First(const Node* node) {
+  while (node && node->left) {
+    node = node->left;
+  }
+  return node;
+}
+
+const Node* Last(const Node* node) {
+  while (node && node->right) {
+    node = node->right;
+  }
+  return node;
+}
+
+// Sets the timings of the subtree in order, starting at starts[i]. Clears
+// sorted if two consecutive nodes end up out of order.
+void SetTimings(Node* node,
+                const std::vector<std::chrono::milliseconds>& starts,
+                const std::vector<std::chrono::milliseconds>& durations,
+                std::size_t& i, const Node*& previous, bool& sorted) {
+  if (!node) {
+    return;
+  }
+  SetTimings(node->left, starts, durations, i, previous, sorted);
+  node->item->start(starts[i])->duration(durations[i]);
+  node->start = starts[i];
+  node->end = starts[i] + durations[i];
+  ++i;
+  if (previous && Less(node, previous)) {
+    sorted = false;
+  }
+  previous = node;
+  SetTimings(node->right, starts, durations, i, previous, sorted);
+  Update(node);
+}
+
+void CollectNodes(Node* node, std::vector<Node*>& nodes) {
+  if (!node) {
+    return;
+  }
+  CollectNodes(node->left, nodes);
+  nodes.push_back(node);
+  CollectNodes(node->right, nodes);
+}
+
+void VisitAll(const Node* node, std::size_t& rank,
+              const CueTree::Visitor& visit) {
+  if (!node) {
+    return;
+  }
+  VisitAll(node->left, rank, visit);
+  visit(rank++, node->item);
+  VisitAll(node->right, rank, visit);
+}
+
+}  // namespace
+
+CueTree::CueTree() = default;
+
+CueTree::~CueTree() = default;
+
+CueTree::CueTree(const CueTree& other)
+    : size_{other.size_}, next_id_{other.next_id_}, random_{other.random_} {
+  // Copies the allocated blocks as they are, then points the links of every
+  // node at the node with the same id in the copy.
+  blocks_.resize(other.blocks_.size());
+  for (std::size_t i = 0; i < blocks_.size(); ++i) {
+    const auto& block = other.blocks_[i];
+    if (!block.nodes) {
+      continue;
+    }
+    blocks_[i].nodes = std::make_unique<Node[]>(kNodesPerBlock);
+    blocks_[i].size = block.size;
+    std::copy(block.nodes.get(), block.nodes.get() + kNodesPerBlock,
+              blocks_[i].nodes.get());
+  }
+  auto relink = [this](Node*& node) {
+    if (node) {
+      node = Slot(node->id);
+    }
+  };
+  for (const auto& block : blocks_) {
+    if (!block.nodes) {
+      continue;
+    }
+    for (auto* node = block.nodes.get();
+         node != block.nodes.get() + kNodesPerBlock; ++node) {
+      relink(node->left);
+      relink(node->right);
+      relink(node->parent);
+    }
+  }
+  root_ = other.root_ ? Slot(other.root_->id) : nullptr;
+}
+
+CueTree& CueTree::operator=(const CueTree& other) {
+  if (this != &other) {
+    CueTree copy{other};
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+CueTree::CueTree(CueTree&& other) noexcept
+    : blocks_{std::move(other.blocks_)},
+      size_{std::exchange(other.size_, 0)},
+      root_{std::exchange(other.root_, nullptr)},
+      next_id_{other.next_id_},
+      random_{other.random_} {
+  other.blocks_.clear();
+}
+
+CueTree& CueTree::operator=(CueTree&& other) noexcept {
+  blocks_ = std::move(other.blocks_);
+  other.blocks_.clear();
+  size_ = std::exchange(other.size_, 0);
+  root_ = std::exchange(other.root_, nullptr);
+  next_id_ = other.next_id_;
+  random_ = other.random_;
+  return *this;
+}
+
+CueTree::CueId CueTree::Insert(const std::shared_ptr<SubRipItem>& item) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  auto* node = NewNode(item, next_id_++);
+  Link(node);
+  return node->id;
+}
+
+void CueTree::Insert(const std::shared_ptr<SubRipItem>& item, CueId id) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  if (id == 0 || id >= next_id_ || Contains(id)) {
+    throw std::invalid_argument{"Cue id " + std::to_string(id) +
+                                " is in use or was never handed out"};
+  }
+  Link(NewNode(item, id));
+}
+
+void CueTree::Assign(std::vector<std::shared_ptr<SubRipItem>> items) {
+  if (std::find(items.begin(), items.end(), nullptr) != items.end()) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  Clear();
+  blocks_.reserve(items.size() / kNodesPerBlock + 1);
+  // Builds the treap from sorted input in O(n). The stack holds the right
+  // spine of the tree built so far. A node popped off it won't change any
+  // more, and neither will its subtree, so that is when it is updated.
+  std::vector<Node*> spine;
+  for (auto& item : items) {
+    auto* node = NewNode(std::move(item), next_id_++);
+    Node* last_popped = nullptr;
+    while (!spine.empty() && spine.back()->priority < node->priority) {
+      last_popped = spine.back();
+      spine.pop_back();
+      Update(last_popped);
+    }
+    node->left = last_popped;
+    if (!spine.empty()) {
+      spine.back()->right = node;
+    }
+    spine.push_back(node);
+  }
+  for (auto it = spine.rbegin(); it != spine.rend(); ++it) {
+    Update(*it);
+  }
+  if (!spine.empty()) {
+    root_ = spine.front();
+    root_->parent = nullptr;
+  }
+}
+
+void CueTree::Clear() {
+  root_ = nullptr;
+  blocks_.clear();
+  size_ = 0;
+  next_id_ = 1;
+}
+
+const std::shared_ptr<SubRipItem>& CueTree::At(std::size_t rank) const {
+  return NodeAt(rank)->item;
+}
+
+CueTree::CueId CueTree::IdAt(std::size_t rank) const {
+  return NodeAt(rank)->id;
+}
+
+std::size_t CueTree::RankOf(CueId id) const {
+  const Node* node = FindNode(id);
+  auto rank = Size(node->left);
+  for (; node->parent; node = node->parent) {
+    if (node == node->parent->right) {
+      rank += Size(node->parent->left) + 1;
+    }
+  }
+  return rank;
+}
+
+const std::shared_ptr<SubRipItem>& CueTree::Get(CueId id) const {
+  return FindNode(id)->item;
+}
+
+std::shared_ptr<SubRipItem> CueTree::Erase(CueId id) {
+  auto* node = FindNode(id);
+  Unlink(node);
+  --size_;
+  // Leaves a null item, which marks the node as unused.
+  auto item = std::move(node->item);
+  auto& block = blocks_[(id - 1) / kNodesPerBlock];
+  if (--block.size == 0) {
+    block.nodes.reset();
+  }
+  return item;
+}
+
+std::size_t CueTree::Retime(CueId id, std::chrono::milliseconds start,
+                            std::chrono::milliseconds duration) {
+  auto* node = FindNode(id);
+  Unlink(node);
+  node->item->start(start)->duration(duration);
+  node->start = start;
+  node->end = start + duration;
+  Link(node);
+  return RankOf(id);
+}
+
+void CueTree::GetTimings(
+    std::size_t first_rank, std::size_t count, std::vector<CueId>& ids,
+    std::vector<std::chrono::milliseconds>& starts,
+    std::vector<std::chrono::milliseconds>& durations) const {
+  CheckRange(first_rank, count);
+  if (count == 0) {
+    return;
+  }
+  ids.reserve(ids.size() + count);
+  starts.reserve(starts.size() + count);
+  durations.reserve(durations.size() + count);
+  const Node* node = NodeAt(first_rank);
+  for (std::size_t i = 0; i < count; ++i, node = Next(node)) {
+    ids.push_back(node->id);
+    starts.push_back(node->start);
+    durations.push_back(node->end - node->start);
+  }
+}
+
+bool CueTree::RetimeRange(
+    std::size_t first_rank, const std::vector<std::chrono::milliseconds>& starts,
+    const std::vector<std::chrono::milliseconds>& durations) {
+  if (starts.size() != durations.size()) {
+    throw std::invalid_argument{"Mismatched number of starts and durations"};
+  }
+  CheckRange(first_rank, starts.size());
+
+  Node* left = nullptr;
+  Node* middle = nullptr;
+  Node* right = nullptr;
+  SplitAt(root_, first_rank, left, right);
+  SplitAt(right, starts.size(), middle, right);
+  if (middle) {
+    middle->parent = nullptr;
+  }
+
+  std::size_t i = 0;
+  const Node* previous = nullptr;
+  bool sorted = true;
+  SetTimings(middle, starts, durations, i, previous, sorted);
+  if (sorted && middle) {
+    // Only the cues next to the range can end up out of order with it.
+    auto* before = Last(left);
+    auto* after = First(right);
+    sorted = (!before || !Less(First(middle), before)) &&
+             (!after || !Less(after, Last(middle)));
+  }
+
+  if (sorted) {
+    root_ = Merge(Merge(left, middle), right);
+    if (root_) {
+      root_->parent = nullptr;
+    }
+    return true;
+  }
+  root_ = Merge(left, right);
+  if (root_) {
+    root_->parent = nullptr;
+  }
+  std::vector<Node*> nodes;
+  nodes.reserve(starts.size());
+  CollectNodes(middle, nodes);
+  for (auto* node : nodes) {
+    Link(node);
+  }
+  return false;
+}
+
+void CueTree::ForEach(const Visitor& visit) const {
+  std::size_t rank = 0;
+  VisitAll(root_, rank, visit);
+}
+
+CueTree::Node* CueTree::Slot(CueId id) const {
+  if (id == 0 || id > blocks_.size() * kNodesPerBlock) {
+    return nullptr;
+  }
+  const auto& block = blocks_[(id - 1) / kNodesPerBlock];
+  if (!block.nodes) {
+    return nullptr;
+  }
+  return &block.nodes[(id - 1) % kNodesPerBlock];
+}
+
+CueTree::Node* CueTree::NewNode(std::shared_ptr<SubRipItem> item, CueId id) {
+  if (blocks_.size() * kNodesPerBlock < id) {
+    blocks_.resize((id - 1) / kNodesPerBlock + 1);
+  }
+  auto& block = blocks_[(id - 1) / kNodesPerBlock];
+  if (!block.nodes) {
+    block.nodes = std::make_unique<Node[]>(kNodesPerBlock);
+  }
+  ++block.size;
+  auto* node = Slot(id);
+  node->start = item->start();
+  node->end = item->start() + item->duration();
+  node->item = std::move(item);
+  node->id = id;
+  node->max_end = node->end;
+  node->size = 1;
+  node->priority = static_cast<std::uint32_t>(random_());
+  node->left = node->right = node->parent = nullptr;
+  ++size_;
+  return node;
+}
+
+const CueTree::Node* CueTree::NodeAt(std::size_t rank) const {
+  if (rank >= size()) {
+    throw std::out_of_range{"Rank " + std::to_string(rank) +
+                            " is out of range"};
+  }
+  const Node* node = root_;
+  for (;;) {
+    auto left_size = Size(node->left);
+    if (rank < left_size) {
+      node = node->left;
+    } else if (rank == left_size) {
+      return node;
+    } else {
+      rank -= left_size + 1;
+      node = node->right;
+    }
+  }
+}
+
+void CueTree::CheckRange(std::size_t first_rank, std::size_t count) const {
+  if (first_rank > size() || count > size() - first_rank) {
+    throw std::out_of_range{"Ranks " + std::to_string(first_rank) + " to " +
+                            std::to_string(first_rank + count) +
+                            " are out of range"};
+  }
+}
+
+CueTree::Node* CueTree::FindNode(CueId id) const {
+  auto* node = Slot(id);
+  if (!node || !node->item) {
+    throw std::out_of_range{"No cue with id " + std::to_string(id)};
+  }
+  return node;
+}
+
+void CueTree::Link(Node* node) {
+  node->left = node->right = node->parent = nullptr;
+  Update(node);
+  // Number of nodes which compare less than or equal to node.
+  std::size_t rank = 0;
+  for (const Node* current = root_; current;) {
+    if (Less(node, current)) {
+      current = current->left;
+    } else {
+      rank += Size(current->left) + 1;
+      current = current->right;
+    }
+  }
+  Node* left = nullptr;
+  Node* right = nullptr;
+  SplitAt(root_, rank, left, right);
+  root_ = Merge(Merge(left, node), right);
+  root_->parent = nullptr;
+}
+
+void CueTree::Unlink(Node* node) {
+  auto rank = RankOf(node->id);
+  Node* left = nullptr;
+  Node* middle = nullptr;
+  Node* right = nullptr;
+  SplitAt(root_, rank, left, right);
+  SplitAt(right, 1, middle, right);
+  root_ = Merge(left, right);
+  if (root_) {
+    root_->parent = nullptr;
+  }
+  node->left = node->right = node->parent = nullptr;
+}
+
+}  // namespace srt
+}  // namespace subtitler
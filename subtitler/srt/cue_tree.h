@@ -0,0 +1,318 @@
+#ifndef SUBTITLER_SRT_CUE_TREE_H
+#define SUBTITLER_SRT_CUE_TREE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Order statistic tree over the cues of a SubRipFile, sorted by start time
+ * and then duration. Every cue gets an id when it is inserted, which stays
+ * the same while other cues are added or removed, or while the cue itself
+ * is retimed, even though its rank (0's based position in sorted order)
+ * changes.
+ *
+ * Implemented as a treap where each node records the size of its subtree,
+ * to find the cue at a rank and the rank of a cue, and the maximum end time
+ * of its subtree, to answer overlap queries the same way as IntervalIndex.
+ * Insert, erase, retime and all lookups take O(log n) expected time, and an
+ * overlap query O(log n) per cue found.
+ *
+ * Nodes are allocated in blocks and found by id without hashing, so
+ * building the tree from n sorted cues takes O(n) time and O(n / block size)
+ * allocations. Ids are not reused until Clear() or Assign(), which start
+ * over from 1. In between, a block is freed once every cue in it was
+ * erased, so memory is bounded by the blocks holding at least one cue, plus
+ * a pointer per block of ids handed out.
+ *
+ * Overlap queries are available as a lazy range, which walks the tree
+ * through parent links and so never allocates:
+ * for (const auto& [rank, item] : tree.Overlapping(10s, 15s)) { ... }
+ */
+class CueTree {
+ public:
+  using CueId = std::uint64_t;
+  using Visitor =
+      std::function<void(std::size_t, const std::shared_ptr<SubRipItem>&)>;
+
+  struct Node {
+    std::shared_ptr<SubRipItem> item;
+    CueId id = 0;
+    std::chrono::milliseconds start;
+    std::chrono::milliseconds end;
+    // Max end time of the subtree rooted here.
+    std::chrono::milliseconds max_end;
+    std::size_t size = 1;
+    std::uint32_t priority = 0;
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Node* parent = nullptr;
+  };
+
+  // A cue found by an overlap query. rank is numbered from the first_rank
+  // passed to Overlapping(), so SubRipFile can report sequence numbers.
+  struct Entry {
+    std::size_t rank;
+    const std::shared_ptr<SubRipItem>& item;
+  };
+
+  // Iterates over the cues which intersect [start, end], in order. An
+  // iterator is invalidated by any change to the tree.
+  class OverlapIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Entry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Entry;
+
+    // The end iterator.
+    OverlapIterator() = default;
+
+    Entry operator*() const { return {rank_, node_->item}; }
+
+    OverlapIterator& operator++() {
+      Advance();
+      return *this;
+    }
+    OverlapIterator operator++(int) {
+      auto copy = *this;
+      Advance();
+      return copy;
+    }
+
+    friend bool operator==(const OverlapIterator& a, const OverlapIterator& b) {
+      return a.node_ == b.node_;
+    }
+    friend bool operator!=(const OverlapIterator& a, const OverlapIterator& b) {
+      return !(a == b);
+    }
+
+   private:
+    const Node* node_ = nullptr;
+    std::size_t rank_ = 0;
+    std::chrono::milliseconds start_;
+    std::chrono::milliseconds end_;
+
+    OverlapIterator(const Node* root, std::size_t first_rank,
+                    std::chrono::milliseconds start,
+                    std::chrono::milliseconds end)
+        : start_{start}, end_{end} {
+      if (start <= end && Reaches(root)) {
+        Descend(root, first_rank);
+      }
+    }
+
+    static std::size_t Size(const Node* node) { return node ? node->size : 0; }
+
+    bool Reaches(const Node* subtree) const {
+      return subtree && subtree->max_end >= start_;
+    }
+
+    // Moves to the first cue of the subtree which overlaps, given the rank
+    // of its leftmost cue. The subtree must reach start_, so the first cue
+    // ending at or after start_ is in it; if that one begins after end_, so
+    // do all that follow and the query is done.
+    void Descend(const Node* node, std::size_t first_rank) {
+      for (;;) {
+        if (Reaches(node->left)) {
+          node = node->left;
+          continue;
+        }
+        auto rank = first_rank + Size(node->left);
+        if (node->start > end_) {
+          node_ = nullptr;
+          return;
+        }
+        if (node->end >= start_) {
+          node_ = node;
+          rank_ = rank;
+          return;
+        }
+        first_rank = rank + 1;
+        node = node->right;
+      }
+    }
+
+    void Advance() {
+      const Node* node = node_;
+      if (Reaches(node->right)) {
+        Descend(node->right, rank_ + 1);
+        return;
+      }
+      // Rank of the last cue visited or skipped so far.
+      auto last_rank = rank_ + Size(node->right);
+      for (;;) {
+        while (node->parent && node == node->parent->right) {
+          node = node->parent;
+        }
+        if (!node->parent) {
+          node_ = nullptr;
+          return;
+        }
+        node = node->parent;
+        auto rank = last_rank + 1;
+        if (node->start > end_) {
+          node_ = nullptr;
+          return;
+        }
+        if (node->end >= start_) {
+          node_ = node;
+          rank_ = rank;
+          return;
+        }
+        if (Reaches(node->right)) {
+          Descend(node->right, rank + 1);
+          return;
+        }
+        last_rank = rank + Size(node->right);
+      }
+    }
+
+    friend class CueTree;
+  };
+
+  class OverlapRange {
+   public:
+    OverlapIterator begin() const { return begin_; }
+    OverlapIterator end() const { return {}; }
+    bool empty() const { return begin_ == end(); }
+
+   private:
+    explicit OverlapRange(OverlapIterator begin) : begin_{begin} {}
+
+    OverlapIterator begin_;
+
+    friend class CueTree;
+  };
+
+  CueTree();
+  ~CueTree();
+  CueTree(const CueTree& other);
+  CueTree& operator=(const CueTree& other);
+  CueTree(CueTree&& other) noexcept;
+  CueTree& operator=(CueTree&& other) noexcept;
+
+  std::size_t size() const { return size_; }
+
+  // Inserts after any cues which compare equal. Returns the id of the cue.
+  // Throws std::invalid_argument if item is null.
+  CueId Insert(const std::shared_ptr<SubRipItem>& item);
+
+  // Same as above, but the cue takes an id handed out earlier which is no
+  // longer in use, e.g. to undo an Erase().
+  // Throws std::invalid_argument if item is null, or if the id is in use or
+  // was never handed out.
+  void Insert(const std::shared_ptr<SubRipItem>& item, CueId id);
+
+  // Replaces the contents with items, which must be sorted. O(n).
+  // Ids start over from 1, like after Clear().
+  void Assign(std::vector<std::shared_ptr<SubRipItem>> items);
+
+  // Removes every cue and frees all nodes. Ids handed out before are reused,
+  // so they must not be passed to this tree anymore.
+  void Clear();
+
+  // Throw std::out_of_range if rank >= size().
+  const std::shared_ptr<SubRipItem>& At(std::size_t rank) const;
+  CueId IdAt(std::size_t rank) const;
+
+  // Throw std::out_of_range if there is no cue with this id.
+  std::size_t RankOf(CueId id) const;
+  const std::shared_ptr<SubRipItem>& Get(CueId id) const;
+  std::shared_ptr<SubRipItem> Erase(CueId id);
+  // Sets the timing of the cue and moves it to its new rank, which is
+  // returned. The cue is placed after any cues which compare equal.
+  std::size_t Retime(CueId id, std::chrono::milliseconds start,
+                     std::chrono::milliseconds duration);
+
+  bool Contains(CueId id) const {
+    const Node* node = Slot(id);
+    return node && node->item;
+  }
+
+  // Appends the ids and timings of count cues starting at first_rank, in
+  // order. O(count + log n).
+  // Throws std::out_of_range if the cues are not all in the tree.
+  void GetTimings(std::size_t first_rank, std::size_t count,
+                  std::vector<CueId>& ids,
+                  std::vector<std::chrono::milliseconds>& starts,
+                  std::vector<std::chrono::milliseconds>& durations) const;
+
+  // Sets the timings of the cues starting at first_rank, in order, keeping
+  // their ids. If the cues stay in sorted order, which is the case for any
+  // order preserving retime, this is O(count + log n) and returns true.
+  // Otherwise the retimed cues are moved to their new ranks one at a time,
+  // in O(count log n), and false is returned.
+  // Throws std::invalid_argument if starts and durations differ in size, and
+  // std::out_of_range if the cues are not all in the tree.
+  bool RetimeRange(std::size_t first_rank,
+                   const std::vector<std::chrono::milliseconds>& starts,
+                   const std::vector<std::chrono::milliseconds>& durations);
+
+  // Calls visit(rank, item) for every cue, in order.
+  void ForEach(const Visitor& visit) const;
+
+  // The cues which have a non-empty intersection with [start, end], in
+  // order. Ranks are reported starting from first_rank.
+  OverlapRange Overlapping(std::chrono::milliseconds start,
+                           std::chrono::milliseconds end,
+                           std::size_t first_rank = 0) const {
+    return OverlapRange{OverlapIterator{root_, first_rank, start, end}};
+  }
+
+  // Calls on_find(rank, item) for every cue in Overlapping(start, end).
+  // Takes any callable, so there is no type erasure or allocation.
+  template <typename OnFind>
+  void ForEachOverlapping(std::chrono::milliseconds start,
+                          std::chrono::milliseconds end,
+                          OnFind&& on_find) const {
+    for (const auto& [rank, item] : Overlapping(start, end)) {
+      on_find(rank, item);
+    }
+  }
+
+ private:
+  static constexpr std::size_t kNodesPerBlock = 1024;
+
+  struct Block {
+    // Null once every cue of the block was erased.
+    std::unique_ptr<Node[]> nodes;
+    // Number of nodes with an item.
+    std::size_t size = 0;
+  };
+
+  // Owns the nodes, the tree only links them. The node of the cue with id i
+  // is at index i - 1, and never moves. Nodes of erased cues, and of ids not
+  // handed out yet, have a null item.
+  std::vector<Block> blocks_;
+  std::size_t size_ = 0;
+  Node* root_ = nullptr;
+  CueId next_id_ = 1;
+  std::minstd_rand random_;
+
+  // The node for id, or null if its block isn't allocated.
+  Node* Slot(CueId id) const;
+  Node* NewNode(std::shared_ptr<SubRipItem> item, CueId id);
+  Node* FindNode(CueId id) const;
+  const Node* NodeAt(std::size_t rank) const;
+  void CheckRange(std::size_t first_rank, std::size_t count) const;
+  // Links node into / out of the tree, it stays in its block.
+  void Link(Node* node);
+  void Unlink(Node* node);
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,312 @@
+#include "subtitler/srt/cue_tree.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+namespace {
+
+std::shared_ptr<SubRipItem> MakeItem(std::chrono::milliseconds start,
+                                     std::chrono::milliseconds duration) {
+  auto item = std::make_shared<SubRipItem>();
+  item->start(start)->duration(duration);
+  return item;
+}
+
+std::vector<std::shared_ptr<SubRipItem>> Items(const CueTree& tree) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  tree.ForEach([&](std::size_t rank, const std::shared_ptr<SubRipItem>& item) {
+    EXPECT_EQ(rank, items.size());
+    items.push_back(item);
+  });
+  return items;
+}
+
+std::vector<std::size_t> Overlapping(const CueTree& tree,
+                                     std::chrono::milliseconds start,
+                                     std::chrono::milliseconds end) {
+  std::vector<std::size_t> ranks;
+  tree.ForEachOverlapping(
+      start, end,
+      [&](std::size_t rank, const std::shared_ptr<SubRipItem>& item) {
+        EXPECT_EQ(item, tree.At(rank));
+        ranks.push_back(rank);
+      });
+  return ranks;
+}
+
+}  // namespace
+
+TEST(CueTreeTest, InsertKeepsOrderAndIds) {
+  CueTree tree;
+  auto late = MakeItem(5s, 1s);
+  auto early = MakeItem(1s, 1s);
+  auto tie = MakeItem(5s, 1s);
+  auto late_id = tree.Insert(late);
+  auto early_id = tree.Insert(early);
+  auto tie_id = tree.Insert(tie);
+
+  // Ties keep insertion order.
+  EXPECT_THAT(Items(tree), ElementsAre(early, late, tie));
+  EXPECT_EQ(tree.RankOf(early_id), 0);
+  EXPECT_EQ(tree.RankOf(late_id), 1);
+  EXPECT_EQ(tree.RankOf(tie_id), 2);
+  EXPECT_EQ(tree.IdAt(1), late_id);
+  EXPECT_EQ(tree.Get(tie_id), tie);
+  EXPECT_THROW(tree.Insert(nullptr), std::invalid_argument);
+}
+
+TEST(CueTreeTest, IdsSurviveEraseAndRetime) {
+  CueTree tree;
+  std::vector<CueTree::CueId> ids;
+  for (int i = 0; i < 5; ++i) {
+    ids.push_back(tree.Insert(MakeItem(std::chrono::seconds{i}, 1s)));
+  }
+  auto removed = tree.Erase(ids[1]);
+  EXPECT_EQ(removed->start(), 1s);
+  EXPECT_FALSE(tree.Contains(ids[1]));
+  EXPECT_EQ(tree.RankOf(ids[4]), 3);
+
+  // Move the first cue to the end.
+  EXPECT_EQ(tree.Retime(ids[0], 10s, 2s), 3);
+  EXPECT_EQ(tree.Get(ids[0])->start(), 10s);
+  EXPECT_EQ(tree.Get(ids[0])->duration(), 2s);
+  EXPECT_EQ(tree.RankOf(ids[2]), 0);
+  EXPECT_THAT(Overlapping(tree, 11s, 11s), ElementsAre(3));
+
+  EXPECT_THROW(tree.Erase(ids[1]), std::out_of_range);
+  EXPECT_THROW(tree.RankOf(ids[1]), std::out_of_range);
+  EXPECT_THROW(tree.At(4), std::out_of_range);
+
+  // Restores the erased cue under its old id.
+  tree.Insert(removed, ids[1]);
+  EXPECT_EQ(tree.RankOf(ids[1]), 0);
+  EXPECT_EQ(tree.Get(ids[1]), removed);
+  EXPECT_THROW(tree.Insert(removed, ids[1]), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(removed, 100), std::invalid_argument);
+  EXPECT_THROW(tree.Insert(nullptr, ids[1]), std::invalid_argument);
+}
+
+TEST(CueTreeTest, AssignAndCopy) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  for (int i = 0; i < 100; ++i) {
+    items.push_back(MakeItem(std::chrono::seconds{i}, 1s));
+  }
+  CueTree tree;
+  tree.Assign(items);
+  EXPECT_EQ(Items(tree), items);
+
+  CueTree copy{tree};
+  auto id = tree.IdAt(50);
+  tree.Erase(id);
+  EXPECT_EQ(copy.size(), 100);
+  EXPECT_EQ(copy.RankOf(id), 50);
+  EXPECT_EQ(Items(copy), items);
+
+  CueTree moved{std::move(copy)};
+  EXPECT_EQ(moved.RankOf(id), 50);
+  tree = moved;
+  EXPECT_EQ(tree.size(), 100);
+
+  std::vector<std::shared_ptr<SubRipItem>> with_null{nullptr};
+  EXPECT_THROW(tree.Assign(with_null), std::invalid_argument);
+  EXPECT_EQ(tree.size(), 100);
+}
+
+TEST(CueTreeTest, IdsSpanManyNodeBlocks) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  for (int i = 0; i < 5000; ++i) {
+    items.push_back(MakeItem(std::chrono::seconds{i}, 1s));
+  }
+  CueTree tree;
+  tree.Assign(items);
+  auto first_id = tree.IdAt(0);
+  auto last_id = tree.IdAt(4999);
+  auto erased = tree.Erase(tree.IdAt(2500));
+  EXPECT_EQ(tree.size(), 4999);
+  EXPECT_EQ(tree.RankOf(last_id), 4998);
+  EXPECT_THAT(Overlapping(tree, 4000500ms, 4001s), ElementsAre(3999, 4000));
+
+  CueTree copy{tree};
+  tree.Clear();
+  EXPECT_EQ(tree.size(), 0);
+  EXPECT_FALSE(tree.Contains(first_id));
+  EXPECT_EQ(copy.Get(last_id), items.back());
+  EXPECT_THAT(Overlapping(copy, 4000500ms, 4001s), ElementsAre(3999, 4000));
+
+  // Ids start over after Clear(), so older ones can't be restored.
+  EXPECT_THROW(tree.Insert(erased, last_id), std::invalid_argument);
+  EXPECT_EQ(tree.Insert(items.front()), 1);
+  tree.Assign(items);
+  EXPECT_EQ(tree.IdAt(0), 1);
+  EXPECT_EQ(tree.IdAt(4999), 5000);
+}
+
+TEST(CueTreeTest, BlocksOfErasedCuesAreFreed) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  for (int i = 0; i < 3000; ++i) {
+    items.push_back(MakeItem(std::chrono::seconds{i}, 1s));
+  }
+  CueTree tree;
+  tree.Assign(items);
+  // Empties the first block of nodes.
+  std::vector<CueTree::CueId> erased_ids;
+  while (tree.IdAt(0) <= 1024) {
+    erased_ids.push_back(tree.IdAt(0));
+    tree.Erase(tree.IdAt(0));
+  }
+  ASSERT_EQ(erased_ids.size(), 1024);
+  EXPECT_EQ(tree.size(), 3000 - 1024);
+  EXPECT_FALSE(tree.Contains(erased_ids.front()));
+  EXPECT_THROW(tree.Get(erased_ids.back()), std::out_of_range);
+
+  // Copies skip the freed block.
+  CueTree copy{tree};
+  EXPECT_EQ(Items(copy), std::vector(items.begin() + 1024, items.end()));
+  EXPECT_THAT(Overlapping(copy, 1500s, 1500s),
+              ElementsAre(1499 - 1024, 1500 - 1024));
+
+  // Restoring an erased cue allocates its block again.
+  tree.Insert(items[5], erased_ids[5]);
+  EXPECT_EQ(tree.RankOf(erased_ids[5]), 0);
+  EXPECT_FALSE(copy.Contains(erased_ids[5]));
+  EXPECT_EQ(tree.Insert(MakeItem(0s, 1s)), 3001);
+}
+
+TEST(CueTreeTest, OverlappingRange) {
+  CueTree tree;
+  for (int i = 0; i < 10; ++i) {
+    tree.Insert(MakeItem(std::chrono::seconds{i}, 1s));
+  }
+  auto range = tree.Overlapping(3s + 500ms, 5s, 1);
+  std::vector<std::size_t> numbers;
+  for (const auto& [number, item] : range) {
+    EXPECT_EQ(item, tree.At(number - 1));
+    numbers.push_back(number);
+  }
+  EXPECT_THAT(numbers, ElementsAre(4, 5, 6));
+
+  EXPECT_TRUE(tree.Overlapping(20s, 30s).empty());
+  EXPECT_TRUE(tree.Overlapping(5s, 4s).empty());
+  EXPECT_TRUE(CueTree{}.Overlapping(0s, 1s).empty());
+}
+
+TEST(CueTreeTest, MatchesSortedVector) {
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<int> time_dist{0, 1000};
+  std::uniform_int_distribution<int> length_dist{0, 50};
+  CueTree tree;
+  std::vector<std::pair<std::shared_ptr<SubRipItem>, CueTree::CueId>> expected;
+  auto sort_expected = [&] {
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto& a, const auto& b) {
+                       return *a.first < *b.first;
+                     });
+  };
+
+  for (int step = 0; step < 2000; ++step) {
+    auto op = rng() % 3;
+    if (op == 0 || expected.empty()) {
+      auto item = MakeItem(std::chrono::milliseconds{time_dist(rng)},
+                           std::chrono::milliseconds{length_dist(rng)});
+      expected.emplace_back(item, tree.Insert(item));
+      sort_expected();
+    } else if (op == 1) {
+      auto rank = rng() % expected.size();
+      tree.Erase(expected[rank].second);
+      expected.erase(expected.begin() + rank);
+    } else {
+      auto rank = rng() % expected.size();
+      auto entry = expected[rank];
+      expected.erase(expected.begin() + rank);
+      tree.Retime(entry.second, std::chrono::milliseconds{time_dist(rng)},
+                  std::chrono::milliseconds{length_dist(rng)});
+      // Retimed cues go after any ties, same as a new insertion.
+      expected.push_back(entry);
+      sort_expected();
+    }
+
+    ASSERT_EQ(tree.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(tree.At(i), expected[i].first);
+      ASSERT_EQ(tree.RankOf(expected[i].second), i);
+    }
+    auto start = std::chrono::milliseconds{time_dist(rng)};
+    auto end = start + std::chrono::milliseconds{length_dist(rng)};
+    std::vector<std::size_t> brute_force;
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      const auto& item = *expected[i].first;
+      if (item.start() <= end && item.start() + item.duration() >= start) {
+        brute_force.push_back(i);
+      }
+    }
+    ASSERT_EQ(Overlapping(tree, start, end), brute_force);
+  }
+}
+
+TEST(CueTreeTest, RetimeRangeKeepsIdsAndOrder) {
+  std::mt19937 rng{11};
+  std::uniform_int_distribution<int> time_dist{0, 1000};
+  CueTree tree;
+  std::unordered_map<CueTree::CueId, std::chrono::milliseconds> expected_starts;
+  for (int i = 0; i < 200; ++i) {
+    auto start = std::chrono::milliseconds{time_dist(rng)};
+    expected_starts[tree.Insert(MakeItem(start, 10ms))] = start;
+  }
+
+  for (int step = 0; step < 200; ++step) {
+    auto first = rng() % tree.size();
+    auto count = rng() % (tree.size() - first + 1);
+    std::vector<CueTree::CueId> ids;
+    std::vector<std::chrono::milliseconds> starts, durations;
+    tree.GetTimings(first, count, ids, starts, durations);
+    ASSERT_EQ(ids.size(), count);
+    // Mostly small shifts which keep the order, sometimes large ones.
+    auto offset = std::chrono::milliseconds{
+        step % 4 == 0 ? time_dist(rng) - 500 : time_dist(rng) % 3};
+    for (std::size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(tree.RankOf(ids[i]), first + i);
+      starts[i] = std::max(starts[i] + offset, 0ms);
+      expected_starts[ids[i]] = starts[i];
+    }
+    tree.RetimeRange(first, starts, durations);
+
+    ASSERT_EQ(tree.size(), expected_starts.size());
+    std::chrono::milliseconds previous = 0ms;
+    for (std::size_t rank = 0; rank < tree.size(); ++rank) {
+      auto id = tree.IdAt(rank);
+      ASSERT_EQ(tree.RankOf(id), rank);
+      ASSERT_EQ(tree.At(rank)->start(), expected_starts[id]);
+      ASSERT_GE(tree.At(rank)->start(), previous);
+      previous = tree.At(rank)->start();
+    }
+    auto query_start = std::chrono::milliseconds{time_dist(rng)};
+    std::vector<std::size_t> brute_force;
+    for (std::size_t rank = 0; rank < tree.size(); ++rank) {
+      const auto& item = *tree.At(rank);
+      if (item.start() <= query_start + 5ms &&
+          item.start() + item.duration() >= query_start) {
+        brute_force.push_back(rank);
+      }
+    }
+    ASSERT_EQ(Overlapping(tree, query_start, query_start + 5ms), brute_force);
+  }
+
+  std::vector<std::chrono::milliseconds> one{1s};
+  EXPECT_THROW(tree.RetimeRange(tree.size(), one, one), std::out_of_range);
+  EXPECT_THROW(tree.RetimeRange(0, one, {}), std::invalid_argument);
+}
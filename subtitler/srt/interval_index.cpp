@@ -0,0 +1,135 @@
+#include "subtitler/srt/interval_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+constexpr std::chrono::milliseconds kEmptyLeaf =
+    std::chrono::milliseconds::min();
+
+std::size_t NextPowerOfTwo(std::size_t n) {
+  std::size_t result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+void IntervalIndex::Assign(std::vector<Interval> intervals) {
+  starts_.clear();
+  ends_.clear();
+  starts_.reserve(intervals.size());
+  ends_.reserve(intervals.size());
+  for (const auto& interval : intervals) {
+    starts_.push_back(interval.start);
+    ends_.push_back(interval.end);
+  }
+  Rebuild();
+}
+
+void IntervalIndex::Insert(std::size_t position,
+                           std::chrono::milliseconds start,
+                           std::chrono::milliseconds end) {
+  if (position > starts_.size()) {
+    throw std::out_of_range{"invalid position passed to Insert()"};
+  }
+  starts_.insert(starts_.begin() + position, start);
+  ends_.insert(ends_.begin() + position, end);
+  if (starts_.size() > capacity_) {
+    Rebuild();
+    return;
+  }
+  // Every leaf at or after position has shifted right by one.
+  Refresh(position, starts_.size());
+}
+
+void IntervalIndex::Erase(std::size_t position) {
+  if (position >= starts_.size()) {
+    throw std::out_of_range{"invalid position passed to Erase()"};
+  }
+  starts_.erase(starts_.begin() + position);
+  ends_.erase(ends_.begin() + position);
+  // Every leaf after position has shifted left by one, and the old last
+  // leaf must be cleared.
+  Refresh(position, starts_.size() + 1);
+}
+
+void IntervalIndex::Clear() {
+  starts_.clear();
+  ends_.clear();
+  max_end_.clear();
+  capacity_ = 0;
+}
+
+void IntervalIndex::ForEachOverlapping(
+    std::chrono::milliseconds start, std::chrono::milliseconds end,
+    const std::function<void(std::size_t)>& on_find) const {
+  if (starts_.empty() || start > end) {
+    return;
+  }
+  // Since intervals are sorted by start, only [0, limit) can start before the
+  // query window ends.
+  auto limit = static_cast<std::size_t>(
+      std::upper_bound(starts_.begin(), starts_.end(), end) - starts_.begin());
+  if (limit == 0) {
+    return;
+  }
+  Visit(/* node= */ 1, /* node_begin= */ 0, /* node_size= */ capacity_, limit,
+        start, on_find);
+}
+
+void IntervalIndex::Refresh(std::size_t from, std::size_t to) {
+  if (from >= to) {
+    return;
+  }
+  to = std::min(to, capacity_);
+  for (std::size_t i = from; i < to; ++i) {
+    max_end_[capacity_ + i] = i < ends_.size() ? ends_[i] : kEmptyLeaf;
+  }
+  // Walk up level by level, recomputing only the parents of changed nodes.
+  std::size_t lo = (capacity_ + from) / 2;
+  std::size_t hi = (capacity_ + to - 1) / 2;
+  while (lo >= 1) {
+    for (std::size_t node = lo; node <= hi; ++node) {
+      max_end_[node] = std::max(max_end_[2 * node], max_end_[2 * node + 1]);
+    }
+    lo /= 2;
+    hi /= 2;
+  }
+}
+
+void IntervalIndex::Rebuild() {
+  // Grow geometrically so that appends are amortized O(log n).
+  capacity_ = NextPowerOfTwo(std::max<std::size_t>(starts_.size(), 1));
+  max_end_.assign(2 * capacity_, kEmptyLeaf);
+  std::copy(ends_.begin(), ends_.end(), max_end_.begin() + capacity_);
+  for (std::size_t node = capacity_ - 1; node >= 1; --node) {
+    max_end_[node] = std::max(max_end_[2 * node], max_end_[2 * node + 1]);
+  }
+}
+
+void IntervalIndex::Visit(
+    std::size_t node, std::size_t node_begin, std::size_t node_size,
+    std::size_t limit, std::chrono::milliseconds start,
+    const std::function<void(std::size_t)>& on_find) const {
+  // Prune subtrees that start after the window, or end before it.
+  if (node_begin >= limit || max_end_[node] < start) {
+    return;
+  }
+  if (node_size == 1) {
+    on_find(node_begin);
+    return;
+  }
+  auto half = node_size / 2;
+  Visit(2 * node, node_begin, half, limit, start, on_find);
+  Visit(2 * node + 1, node_begin + half, half, limit, start, on_find);
+}
+
+}  // namespace srt
+}  // namespace subtitler
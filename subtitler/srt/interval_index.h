@@ -0,0 +1,89 @@
+#ifndef SUBTITLER_SRT_INTERVAL_INDEX_H
+#define SUBTITLER_SRT_INTERVAL_INDEX_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Augmented interval index over a sequence of closed intervals that is kept
+ * sorted by start time by its owner (see LazySubRipFile). SubRipFile uses
+ * CueTree instead, which answers the same queries and can also be edited in
+ * O(log n).
+ *
+ * The intervals are stored in owner order and an implicit balanced tree is
+ * laid over them, where every node records the maximum end time in its
+ * subtree. A window query first binary searches for the last interval that
+ * starts before the window ends, then descends the tree, skipping any subtree
+ * whose maximum end is before the window starts. Only subtrees containing a
+ * hit are visited, so a query costs O(log n + k) for k hits (with a log
+ * factor only along the paths to the hits) instead of a linear scan.
+ *
+ * Positions passed to Insert() and Erase() are 0's based and must match the
+ * owner's container, which is what keeps the index in sync.
+ *
+ * The index is built for files which are queried far more than edited.
+ * Insert() and Erase() shift every interval after position and refresh its
+ * leaf, so they cost O(n) in the worst case, the same as the vector insert
+ * or erase the owner makes alongside. Prefer CueTree when edits are frequent.
+ */
+class IntervalIndex {
+ public:
+  struct Interval {
+    std::chrono::milliseconds start;
+    std::chrono::milliseconds end;
+  };
+
+  IntervalIndex() = default;
+
+  // Replaces the contents of the index. Intervals must be sorted by start.
+  void Assign(std::vector<Interval> intervals);
+
+  // Inserts an interval at position. The caller is responsible for choosing
+  // a position which keeps the intervals sorted by start time. O(n).
+  // Throws std::out_of_range if position > size().
+  void Insert(std::size_t position, std::chrono::milliseconds start,
+              std::chrono::milliseconds end);
+
+  // Removes the interval at position. O(n).
+  // Throws std::out_of_range if position >= size().
+  void Erase(std::size_t position);
+
+  void Clear();
+
+  std::size_t size() const { return starts_.size(); }
+
+  // Calls on_find(position) for every interval which has a non-empty
+  // intersection with [start, end], in increasing order of position.
+  void ForEachOverlapping(std::chrono::milliseconds start,
+                          std::chrono::milliseconds end,
+                          const std::function<void(std::size_t)>& on_find) const;
+
+ private:
+  // starts_ and ends_ are parallel arrays in owner order.
+  std::vector<std::chrono::milliseconds> starts_;
+  std::vector<std::chrono::milliseconds> ends_;
+  // Implicit tree with 2 * capacity_ nodes. Node 1 is the root, node i has
+  // children 2i and 2i + 1, and leaf j lives at capacity_ + j. Each node holds
+  // the max end time of its subtree. Unused leaves hold min().
+  std::vector<std::chrono::milliseconds> max_end_;
+  std::size_t capacity_ = 0;
+
+  // Recomputes leaves [from, to) and all of their ancestors.
+  void Refresh(std::size_t from, std::size_t to);
+  // Rebuilds the whole tree, growing capacity if needed.
+  void Rebuild();
+
+  void Visit(std::size_t node, std::size_t node_begin, std::size_t node_size,
+             std::size_t limit, std::chrono::milliseconds start,
+             const std::function<void(std::size_t)>& on_find) const;
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,105 @@
+#include "subtitler/srt/interval_index.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std::chrono_literals;
+using subtitler::srt::IntervalIndex;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+
+std::vector<std::size_t> Query(const IntervalIndex& index,
+                               std::chrono::milliseconds start,
+                               std::chrono::milliseconds end) {
+  std::vector<std::size_t> found;
+  index.ForEachOverlapping(start, end,
+                           [&](std::size_t i) { found.push_back(i); });
+  return found;
+}
+
+}  // namespace
+
+TEST(IntervalIndexTest, EmptyIndexFindsNothing) {
+  IntervalIndex index;
+  ASSERT_THAT(Query(index, 0ms, 10s), IsEmpty());
+}
+
+TEST(IntervalIndexTest, FindsOverlapsInSortedOrder) {
+  IntervalIndex index;
+  index.Assign({{0s, 20s}, {1s, 5s}, {1s, 6s}, {2s, 7s}});
+
+  ASSERT_THAT(Query(index, 500ms, 1500ms), ElementsAre(0, 1, 2));
+  ASSERT_THAT(Query(index, 6100ms, 9100ms), ElementsAre(0, 3));
+  // Touching end points count as overlapping.
+  ASSERT_THAT(Query(index, 20s, 25s), ElementsAre(0));
+  ASSERT_THAT(Query(index, 21s, 25s), IsEmpty());
+}
+
+TEST(IntervalIndexTest, InsertAndEraseKeepIndexInSync) {
+  IntervalIndex index;
+  index.Insert(0, 10s, 11s);
+  index.Insert(0, 0s, 1s);
+  index.Insert(1, 5s, 30s);
+
+  ASSERT_EQ(3, index.size());
+  ASSERT_THAT(Query(index, 12s, 13s), ElementsAre(1));
+
+  index.Erase(1);
+  ASSERT_EQ(2, index.size());
+  ASSERT_THAT(Query(index, 12s, 13s), IsEmpty());
+  ASSERT_THAT(Query(index, 0s, 10s), ElementsAre(0, 1));
+}
+
+TEST(IntervalIndexTest, InvalidPositionsThrow) {
+  IntervalIndex index;
+  ASSERT_THROW(index.Insert(1, 0s, 1s), std::out_of_range);
+  ASSERT_THROW(index.Erase(0), std::out_of_range);
+}
+
+TEST(IntervalIndexTest, MatchesLinearScanOnRandomEdits) {
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> start_dist{0, 100000};
+  std::uniform_int_distribution<int> length_dist{0, 8000};
+
+  IntervalIndex index;
+  std::vector<IntervalIndex::Interval> reference;
+  auto insert_sorted = [&](std::chrono::milliseconds start,
+                           std::chrono::milliseconds end) {
+    auto it = std::upper_bound(
+        reference.begin(), reference.end(), start,
+        [](auto value, const auto& interval) { return value < interval.start; });
+    auto position = it - reference.begin();
+    reference.insert(it, {start, end});
+    index.Insert(position, start, end);
+  };
+
+  for (int round = 0; round < 2000; ++round) {
+    if (!reference.empty() && round % 3 == 0) {
+      std::uniform_int_distribution<std::size_t> pick{0, reference.size() - 1};
+      auto position = pick(rng);
+      reference.erase(reference.begin() + position);
+      index.Erase(position);
+    } else {
+      std::chrono::milliseconds start{start_dist(rng)};
+      insert_sorted(start, start + std::chrono::milliseconds{length_dist(rng)});
+    }
+
+    std::chrono::milliseconds query_start{start_dist(rng)};
+    auto query_end = query_start + std::chrono::milliseconds{length_dist(rng)};
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < reference.size(); ++i) {
+      if (query_start <= reference[i].end && reference[i].start <= query_end) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(expected, Query(index, query_start, query_end));
+  }
+}
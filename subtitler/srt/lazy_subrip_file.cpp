@@ -0,0 +1,256 @@
+#include "subtitler/srt/lazy_subrip_file.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "subtitler/srt/subrip_encoding.h"
+#include "subtitler/srt/subrip_parser.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+bool EndsWith(const std::string& text, std::string_view suffix) {
+  return text.size() >= suffix.size() &&
+         std::string_view{text}.substr(text.size() - suffix.size()) == suffix;
+}
+
+}  // namespace
+
+LazySubRipFile::LazySubRipFile(const fs::path& file_name,
+                               std::size_t max_cached)
+    : file_{std::make_unique<MemoryMappedFile>(file_name)},
+      max_cached_{std::max<std::size_t>(max_cached, 1)} {
+  contents_ = DecodeSubRip(file_->contents(), decoded_contents_);
+  auto spans = IndexSubRip(contents_);
+  prefix_ = contents_.substr(0, spans.empty() ? contents_.size()
+                                              : spans.front().offset);
+
+  cues_.reserve(spans.size());
+  for (const auto& span : spans) {
+    if (span.size > std::numeric_limits<std::uint32_t>::max()) {
+      throw SubRipParseError{"Cue is too large", span.offset};
+    }
+    cues_.push_back({span.start.count(), span.duration.count(), span.offset,
+                     static_cast<std::uint32_t>(span.size), kNotDecoded});
+  }
+  // Ties keep their order in the file.
+  if (!std::is_sorted(cues_.begin(), cues_.end(), ByTime)) {
+    std::stable_sort(cues_.begin(), cues_.end(), ByTime);
+  }
+
+  std::vector<IntervalIndex::Interval> intervals;
+  intervals.reserve(cues_.size());
+  for (const auto& cue : cues_) {
+    intervals.push_back({std::chrono::milliseconds{cue.start},
+                         std::chrono::milliseconds{cue.start + cue.duration}});
+  }
+  index_.Assign(std::move(intervals));
+}
+
+std::chrono::milliseconds LazySubRipFile::start(std::size_t index) const {
+  CheckIndex(index);
+  return std::chrono::milliseconds{cues_[index].start};
+}
+
+std::chrono::milliseconds LazySubRipFile::duration(std::size_t index) const {
+  CheckIndex(index);
+  return std::chrono::milliseconds{cues_[index].duration};
+}
+
+std::shared_ptr<const SubRipItem> LazySubRipFile::GetItem(std::size_t index) {
+  return DecodedCue(index).item;
+}
+
+std::shared_ptr<SubRipItem> LazySubRipFile::EditItem(std::size_t index) {
+  auto& decoded = DecodedCue(index);
+  if (!decoded.edited) {
+    lru_.erase(decoded.lru);
+    decoded.edited = true;
+  }
+  return decoded.item;
+}
+
+bool LazySubRipFile::IsDecoded(std::size_t index) const {
+  CheckIndex(index);
+  return cues_[index].decoded != kNotDecoded;
+}
+
+std::size_t LazySubRipFile::NumDecoded() const {
+  return std::count_if(cues_.begin(), cues_.end(), [](const Cue& cue) {
+    return cue.decoded != kNotDecoded;
+  });
+}
+
+void LazySubRipFile::ForEachOverlapping(
+    std::chrono::milliseconds start, std::chrono::milliseconds duration,
+    const std::function<void(std::size_t)>& on_find) const {
+  index_.ForEachOverlapping(start, start + duration, on_find);
+}
+
+void LazySubRipFile::AddItem(const std::shared_ptr<SubRipItem>& item) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  Cue cue{item->start().count(), item->duration().count(), 0, 0,
+          StoreDecoded(item, /* edited= */ true)};
+  // Inserts in sorted order, after any cues which compare equal.
+  auto insert_here = std::upper_bound(cues_.begin(), cues_.end(), cue, ByTime);
+  auto position = static_cast<std::size_t>(insert_here - cues_.begin());
+  cues_.insert(insert_here, cue);
+  index_.Insert(position, item->start(), item->start() + item->duration());
+}
+
+std::shared_ptr<SubRipItem> LazySubRipFile::RemoveItem(
+    std::size_t sequence_number) {
+  if (sequence_number <= 0 || sequence_number > NumItems()) {
+    throw std::out_of_range("invalid index passed to RemoveItem()");
+  }
+  auto position = sequence_number - 1;
+  auto backup = DecodedCue(position).item;
+  // Release the decoded item, its slot is reused by the next decoded cue.
+  ReleaseDecoded(cues_[position].decoded);
+  cues_.erase(cues_.begin() + position);
+  index_.Erase(position);
+  return backup;
+}
+
+void LazySubRipFile::ToStream(std::ostream& output) const {
+  // Serialize everything into one buffer, like SubRipFile::ToStream.
+  std::string buffer;
+  std::size_t estimated_size = prefix_.size();
+  for (const auto& cue : cues_) {
+    estimated_size += cue.size;
+  }
+  buffer.reserve(estimated_size);
+  buffer += prefix_;
+  for (std::size_t i = 0; i < cues_.size(); ++i) {
+    AppendCue(cues_[i], i + 1, i + 1 == cues_.size(), buffer);
+  }
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  output << std::flush;
+}
+
+bool LazySubRipFile::ByTime(const Cue& a, const Cue& b) {
+  return a.start < b.start || (a.start == b.start && a.duration < b.duration);
+}
+
+void LazySubRipFile::CheckIndex(std::size_t index) const {
+  if (index >= cues_.size()) {
+    throw std::out_of_range{"Index " + std::to_string(index) +
+                            " is out of range"};
+  }
+}
+
+std::string_view LazySubRipFile::Source(const Cue& cue) const {
+  return contents_.substr(cue.offset, cue.size);
+}
+
+std::shared_ptr<SubRipItem> LazySubRipFile::Decode(const Cue& cue) const {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  try {
+    items = ParseSubRip(Source(cue));
+  } catch (const SubRipParseError& e) {
+    throw SubRipParseError{e.message(), cue.offset + e.offset()};
+  }
+  if (items.size() != 1) {
+    throw SubRipParseError{"Expected a single cue", cue.offset};
+  }
+  return items.front();
+}
+
+LazySubRipFile::Decoded& LazySubRipFile::DecodedCue(std::size_t index) {
+  CheckIndex(index);
+  auto& cue = cues_[index];
+  if (cue.decoded == kNotDecoded) {
+    auto item = Decode(cue);
+    if (lru_.size() >= max_cached_) {
+      EvictDecoded();
+    }
+    cue.decoded = StoreDecoded(std::move(item), /* edited= */ false);
+  } else if (auto& decoded = decoded_[cue.decoded]; !decoded.edited) {
+    lru_.splice(lru_.begin(), lru_, decoded.lru);
+  }
+  return decoded_[cue.decoded];
+}
+
+std::uint32_t LazySubRipFile::StoreDecoded(std::shared_ptr<SubRipItem> item,
+                                           bool edited) {
+  std::uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<std::uint32_t>(decoded_.size());
+    decoded_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  auto& decoded = decoded_[slot];
+  decoded.item = std::move(item);
+  decoded.edited = edited;
+  if (!edited) {
+    decoded.lru = lru_.insert(lru_.begin(), slot);
+  }
+  return slot;
+}
+
+void LazySubRipFile::ReleaseDecoded(std::uint32_t slot) {
+  auto& decoded = decoded_[slot];
+  if (!decoded.edited) {
+    lru_.erase(decoded.lru);
+  }
+  decoded = {};
+  free_slots_.push_back(slot);
+}
+
+void LazySubRipFile::EvictDecoded() {
+  auto slot = lru_.back();
+  // The item was not edited, so it still has the timings of its cue, which
+  // is among the cues that compare equal to it.
+  const auto& item = *decoded_[slot].item;
+  Cue key{item.start().count(), item.duration().count(), 0, 0, kNotDecoded};
+  auto [first, last] =
+      std::equal_range(cues_.begin(), cues_.end(), key, ByTime);
+  auto owner = std::find_if(first, last, [slot](const Cue& cue) {
+    return cue.decoded == slot;
+  });
+  owner->decoded = kNotDecoded;
+  ReleaseDecoded(slot);
+}
+
+void LazySubRipFile::AppendCue(const Cue& cue, std::size_t sequence_number,
+                               bool is_last, std::string& output) const {
+  if (cue.decoded != kNotDecoded && decoded_[cue.decoded].edited) {
+    decoded_[cue.decoded].item->AppendTo(sequence_number, output);
+    output += '\n';
+    return;
+  }
+
+  auto text = Source(cue);
+  // The sequence number changes if cues were added, removed or reordered.
+  auto number = std::to_string(sequence_number);
+  auto number_end = text.find_first_of("\r\n");
+  if (text.substr(0, number_end) == number) {
+    output += text;
+  } else {
+    output += number;
+    output += text.substr(number_end);
+  }
+  if (is_last) {
+    return;
+  }
+  // The last cue of the file may not be followed by a blank line.
+  if (!EndsWith(output, "\n")) {
+    output += '\n';
+  }
+  if (!EndsWith(output, "\n\n") && !EndsWith(output, "\n\r\n")) {
+    output += '\n';
+  }
+}
+
+}  // namespace srt
+}  // namespace subtitler
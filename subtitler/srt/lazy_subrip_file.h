@@ -0,0 +1,158 @@
+#ifndef SUBTITLER_SRT_LAZY_SUBRIP_FILE_H
+#define SUBTITLER_SRT_LAZY_SUBRIP_FILE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/interval_index.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/memory_mapped_file.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * SRT file for which only the cue timings are decoded up front. Opening the
+ * file indexes the timing and byte range of every cue in a single pass over
+ * the mapped file, and a cue's SubRipItem is decoded on first access. Memory
+ * for a file of many cues is then mostly the timing arrays and the interval
+ * index, not the payloads.
+ *
+ * At most max_cached cues which were not edited are kept decoded. Past that,
+ * the least recently accessed one is dropped and decoded again if needed.
+ * Edited and added cues are kept until they are removed, since the file no
+ * longer holds their contents.
+ *
+ * Cues are ordered by start time and addressed by index, like
+ * SubRipFile::GetItems(). ToStream() writes cues which were not modified
+ * exactly as they appear in the file, so an untouched file round trips byte
+ * for byte (as long as it was sorted and numbered from 1).
+ *
+ * The cues are kept in a sorted vector under an IntervalIndex, which suits
+ * viewing a file. AddItem() and RemoveItem() cost O(n), so prefer SubRipFile
+ * for making many edits to a large file.
+ *
+ * Sample Usage:
+ * LazySubRipFile file{"movie.srt"};
+ * file.ForEachOverlapping(10s, 5s, [&](std::size_t i) {
+ *   Show(file.GetItem(i)->payload());
+ * });
+ */
+class LazySubRipFile {
+ public:
+  static constexpr std::size_t kDefaultMaxCached = 1024;
+
+  // Maps and indexes the file. Throws like SubRipFile::LoadState, since
+  // every cue is validated up front, even though payloads are not decoded.
+  // At least one unedited cue is cached, even if max_cached is 0.
+  explicit LazySubRipFile(const std::filesystem::path& file_name,
+                          std::size_t max_cached = kDefaultMaxCached);
+
+  LazySubRipFile(const LazySubRipFile&) = delete;
+  LazySubRipFile& operator=(const LazySubRipFile&) = delete;
+
+  std::size_t NumItems() const { return cues_.size(); }
+
+  // Timings, available without decoding the cue.
+  // Throws std::out_of_range if index >= NumItems().
+  std::chrono::milliseconds start(std::size_t index) const;
+  std::chrono::milliseconds duration(std::size_t index) const;
+
+  // Returns the cue, decoding it if it isn't cached. Later calls return the
+  // same item until it is evicted from the cache.
+  // Throws std::out_of_range if index >= NumItems().
+  std::shared_ptr<const SubRipItem> GetItem(std::size_t index);
+
+  // Same as GetItem(), for modifying the payload or position of the cue,
+  // which ToStream() then writes from the item instead of the file.
+  // Same as with SubRipFile, the timings of the item must not be modified,
+  // remove and add it again instead. The item is never evicted.
+  std::shared_ptr<SubRipItem> EditItem(std::size_t index);
+
+  bool IsDecoded(std::size_t index) const;
+  std::size_t NumDecoded() const;
+
+  // Calls on_find(index) for every cue with a non-empty intersection with
+  // [start, start + duration], in increasing order. Does not decode cues.
+  void ForEachOverlapping(
+      std::chrono::milliseconds start, std::chrono::milliseconds duration,
+      const std::function<void(std::size_t)>& on_find) const;
+
+  // Same semantics as SubRipFile::AddItem. O(n).
+  void AddItem(const std::shared_ptr<SubRipItem>& item);
+
+  // Same semantics as SubRipFile::RemoveItem, decodes the removed cue. O(n).
+  std::shared_ptr<SubRipItem> RemoveItem(std::size_t sequence_number);
+
+  // Prints the entire file to the stream. Cues which were not passed to
+  // EditItem() are copied from the file verbatim.
+  void ToStream(std::ostream& output) const;
+
+ private:
+  static constexpr std::uint32_t kNotDecoded = 0xffffffff;
+
+  struct Decoded {
+    std::shared_ptr<SubRipItem> item;
+    // Set by EditItem(), and for added cues.
+    bool edited = false;
+    // Position in lru_, for cues which are not edited.
+    std::list<std::uint32_t>::iterator lru;
+  };
+
+  struct Cue {
+    std::int64_t start;
+    std::int64_t duration;
+    // Byte range in contents_, size 0 for cues which were added.
+    std::uint64_t offset;
+    std::uint32_t size;
+    // Index into decoded_, or kNotDecoded.
+    std::uint32_t decoded;
+  };
+
+  std::unique_ptr<MemoryMappedFile> file_;
+  // Holds the file transcoded to UTF-8 if it isn't UTF-8 already.
+  std::string decoded_contents_;
+  // The file as UTF-8, without a byte order mark.
+  std::string_view contents_;
+  // Any blank lines before the first cue of the file.
+  std::string_view prefix_;
+  std::vector<Cue> cues_;
+  std::vector<Decoded> decoded_;
+  // Slots of decoded_ released by RemoveItem() or evicted, reused before
+  // growing it.
+  std::vector<std::uint32_t> free_slots_;
+  // Slots of the cues which are not edited, most recently accessed first.
+  std::list<std::uint32_t> lru_;
+  std::size_t max_cached_;
+  IntervalIndex index_;
+
+  // Same order as SubRipFile::Builder.
+  static bool ByTime(const Cue& a, const Cue& b);
+  void CheckIndex(std::size_t index) const;
+  std::string_view Source(const Cue& cue) const;
+  std::shared_ptr<SubRipItem> Decode(const Cue& cue) const;
+  // The decoded slot of the cue at index, decoding it if needed.
+  Decoded& DecodedCue(std::size_t index);
+  // Stores item in a free slot of decoded_ and returns its index.
+  std::uint32_t StoreDecoded(std::shared_ptr<SubRipItem> item, bool edited);
+  // Frees the slot, which must not be referenced by a cue anymore.
+  void ReleaseDecoded(std::uint32_t slot);
+  // Drops the least recently accessed cue which is not edited.
+  void EvictDecoded();
+  void AppendCue(const Cue& cue, std::size_t sequence_number, bool is_last,
+                 std::string& output) const;
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
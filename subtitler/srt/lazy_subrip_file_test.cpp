@@ -0,0 +1,254 @@
+#include "subtitler/srt/lazy_subrip_file.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/temp_file.h"
+#include "subtitler/util/unicode.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+namespace {
+
+// Irregular formatting which SubRipFile would normalize: "\r\n" endings,
+// '.' separators, short timestamps, extra blank lines and no final newline.
+constexpr char kIrregularSrt[] =
+    "\n"
+    "1\r\n"
+    "00:00:01.000 --> 00:00:05,000\r\n"
+    "{\\an8}first\r\n"
+    "line\r\n"
+    "\r\n"
+    "2\n"
+    "0:2 --> 0:3\n"
+    "second\n"
+    "\n"
+    "\n"
+    "3\n"
+    "00:00:10,000 --> 00:00:11,000\n"
+    "third";
+
+std::string ToString(const LazySubRipFile& file) {
+  std::ostringstream output;
+  file.ToStream(output);
+  return output.str();
+}
+
+class LazySubRipFileTest : public ::testing::Test {
+ protected:
+  LazySubRipFile Open(
+      const std::string& contents,
+      std::size_t max_cached = LazySubRipFile::kDefaultMaxCached) {
+    temp_file_ = std::make_unique<TempFile>(
+        contents, GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")), ".srt");
+    return LazySubRipFile{GetFileSystemUtf8Path(temp_file_->FileName()),
+                          max_cached};
+  }
+
+ private:
+  std::unique_ptr<TempFile> temp_file_;
+};
+
+}  // namespace
+
+TEST_F(LazySubRipFileTest, IndexesTimingsWithoutDecoding) {
+  auto file = Open(kIrregularSrt);
+  ASSERT_EQ(file.NumItems(), 3);
+  EXPECT_EQ(file.start(0), 1s);
+  EXPECT_EQ(file.duration(0), 4s);
+  EXPECT_EQ(file.start(1), 2s);
+  EXPECT_EQ(file.duration(2), 1s);
+
+  std::vector<std::size_t> found;
+  file.ForEachOverlapping(4s, 1s, [&](std::size_t i) { found.push_back(i); });
+  EXPECT_THAT(found, ElementsAre(0));
+  EXPECT_EQ(file.NumDecoded(), 0);
+  EXPECT_THROW(file.start(3), std::out_of_range);
+}
+
+TEST_F(LazySubRipFileTest, DecodesOnFirstAccess) {
+  auto file = Open(kIrregularSrt);
+  const auto& first = file.GetItem(0);
+  EXPECT_TRUE(file.IsDecoded(0));
+  EXPECT_FALSE(file.IsDecoded(1));
+  EXPECT_EQ(first->payload(), "first\nline\n");
+  EXPECT_EQ(first->substation_alpha_position(), 8);
+  // Decoded once, later calls return the same item.
+  EXPECT_EQ(file.GetItem(0).get(), first.get());
+  EXPECT_EQ(file.GetItem(2)->payload(), "third\n");
+  EXPECT_EQ(file.NumDecoded(), 2);
+}
+
+TEST_F(LazySubRipFileTest, UntouchedFileIsWrittenByteForByte) {
+  auto file = Open(kIrregularSrt);
+  EXPECT_EQ(ToString(file), kIrregularSrt);
+
+  // Decoding alone doesn't change anything either.
+  file.GetItem(0);
+  file.GetItem(1);
+  EXPECT_EQ(ToString(file), kIrregularSrt);
+}
+
+TEST_F(LazySubRipFileTest, OnlyEditedCuesAreRewritten) {
+  auto file = Open(kIrregularSrt);
+  // Editing without changes still rewrites the cue.
+  file.EditItem(0);
+  file.EditItem(1)->ClearPayload()->AppendLine("edited");
+  EXPECT_EQ(ToString(file),
+            "\n"
+            "1\n"
+            "00:00:01,000 --> 00:00:05,000\n"
+            "{\\an8}first\n"
+            "line\n"
+            "\n"
+            "2\n"
+            "00:00:02,000 --> 00:00:03,000\n"
+            "edited\n"
+            "\n"
+            "3\n"
+            "00:00:10,000 --> 00:00:11,000\n"
+            "third");
+}
+
+TEST_F(LazySubRipFileTest, ItemsOutliveLaterDecodesAndRemovals) {
+  auto file = Open(kIrregularSrt);
+  auto first = file.GetItem(0);
+  auto second = file.GetItem(1);
+  file.RemoveItem(1);
+  // Decoded into the slot the removed cue released.
+  auto third = file.GetItem(1);
+  for (int i = 0; i < 100; ++i) {
+    auto added = std::make_shared<SubRipItem>();
+    added->start(std::chrono::seconds{20 + i})->duration(1s);
+    file.AddItem(added);
+  }
+  EXPECT_EQ(first->payload(), "first\nline\n");
+  EXPECT_EQ(second->payload(), "second\n");
+  EXPECT_EQ(third->payload(), "third\n");
+  EXPECT_EQ(file.GetItem(1).get(), third.get());
+}
+
+TEST_F(LazySubRipFileTest, EvictsLeastRecentlyUsedCues) {
+  auto file = Open(kIrregularSrt, /* max_cached= */ 2);
+  auto first = file.GetItem(0);
+  file.GetItem(1);
+  file.GetItem(0);
+  file.GetItem(2);
+  EXPECT_TRUE(file.IsDecoded(0));
+  EXPECT_FALSE(file.IsDecoded(1));
+  EXPECT_TRUE(file.IsDecoded(2));
+  EXPECT_EQ(file.NumDecoded(), 2);
+
+  // Decoded again on access, evicting the first cue this time.
+  EXPECT_EQ(file.GetItem(1)->payload(), "second\n");
+  EXPECT_FALSE(file.IsDecoded(0));
+  EXPECT_EQ(first->payload(), "first\nline\n");
+  EXPECT_EQ(ToString(file), kIrregularSrt);
+}
+
+TEST_F(LazySubRipFileTest, NeverEvictsEditedCues) {
+  auto file = Open(kIrregularSrt, /* max_cached= */ 1);
+  file.EditItem(1)->ClearPayload()->AppendLine("edited");
+  auto added = std::make_shared<SubRipItem>();
+  added->start(20s)->duration(1s)->AppendLine("fourth");
+  file.AddItem(added);
+  file.GetItem(0);
+  file.GetItem(2);
+  EXPECT_FALSE(file.IsDecoded(0));
+  EXPECT_TRUE(file.IsDecoded(1));
+  EXPECT_TRUE(file.IsDecoded(2));
+  EXPECT_TRUE(file.IsDecoded(3));
+  EXPECT_EQ(file.GetItem(1)->payload(), "edited\n");
+  EXPECT_EQ(file.GetItem(3).get(), added.get());
+}
+
+TEST_F(LazySubRipFileTest, EvictsAmongCuesWithTheSameTimings) {
+  auto file = Open(
+      "1\n00:00:01,000 --> 00:00:02,000\na\n\n"
+      "2\n00:00:01,000 --> 00:00:02,000\nb\n\n"
+      "3\n00:00:01,000 --> 00:00:02,000\nc\n",
+      /* max_cached= */ 1);
+  for (int round = 0; round < 2; ++round) {
+    EXPECT_EQ(file.GetItem(1)->payload(), "b\n");
+    EXPECT_EQ(file.GetItem(0)->payload(), "a\n");
+    EXPECT_EQ(file.GetItem(2)->payload(), "c\n");
+    EXPECT_EQ(file.NumDecoded(), 1);
+    EXPECT_TRUE(file.IsDecoded(2));
+  }
+  file.RemoveItem(2);
+  EXPECT_EQ(file.GetItem(1)->payload(), "c\n");
+  EXPECT_EQ(file.NumDecoded(), 1);
+}
+
+TEST_F(LazySubRipFileTest, AddAndRemoveRenumber) {
+  auto file = Open(kIrregularSrt);
+  auto removed = file.RemoveItem(1);
+  EXPECT_EQ(removed->payload(), "first\nline\n");
+
+  auto added = std::make_shared<SubRipItem>();
+  added->start(20s)->duration(1s)->AppendLine("fourth");
+  file.AddItem(added);
+  ASSERT_EQ(file.NumItems(), 3);
+  EXPECT_EQ(file.GetItem(2).get(), added.get());
+
+  EXPECT_EQ(ToString(file),
+            "\n"
+            "1\n"
+            "0:2 --> 0:3\n"
+            "second\n"
+            "\n"
+            "\n"
+            "2\n"
+            "00:00:10,000 --> 00:00:11,000\n"
+            "third\n"
+            "\n"
+            "3\n"
+            "00:00:20,000 --> 00:00:21,000\n"
+            "fourth\n"
+            "\n");
+  EXPECT_THROW(file.RemoveItem(0), std::out_of_range);
+  EXPECT_THROW(file.RemoveItem(4), std::out_of_range);
+  EXPECT_THROW(file.AddItem(nullptr), std::invalid_argument);
+}
+
+TEST_F(LazySubRipFileTest, SortsLikeSubRipFile) {
+  const std::string unsorted =
+      "1\n00:00:05,000 --> 00:00:06,000\nlate\n\n"
+      "2\n00:00:01,000 --> 00:00:02,000\nearly\n\n";
+  auto file = Open(unsorted);
+  EXPECT_EQ(file.GetItem(0)->payload(), "early\n");
+
+  SubRipFile::Builder builder;
+  for (auto& item : ParseSubRip(unsorted)) {
+    builder.Add(item);
+  }
+  std::ostringstream expected;
+  builder.Build().ToStream(expected);
+  EXPECT_EQ(ToString(file), expected.str());
+}
+
+TEST_F(LazySubRipFileTest, ValidatesEveryCueUpFront) {
+  EXPECT_THROW(Open("1\nabc --> efg\nhello\n\n"), SubRipParseError);
+  EXPECT_THROW(Open("1\n00:00:01,000 --> 00:00:02,000\n{\\an0}bad\n\n"),
+               SubRipParseError);
+}
+
+TEST_F(LazySubRipFileTest, EmptyFile) {
+  auto file = Open("\n\n");
+  EXPECT_EQ(file.NumItems(), 0);
+  EXPECT_EQ(ToString(file), "\n\n");
+}
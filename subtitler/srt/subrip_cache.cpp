@@ -0,0 +1,459 @@
+#include "subtitler/srt/subrip_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "subtitler/srt/subrip_encoding.h"
+#include "subtitler/srt/subrip_parser.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'R', 'T', 'C', 'A', 'C', 'H', 'E'};
+constexpr std::uint32_t kVersion = 1;
+// Reads differently on a machine of the other endianness.
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order_mark;
+  std::uint64_t num_items;
+  std::uint64_t source_size;
+  std::int64_t source_mtime;
+  std::uint64_t source_hash;
+  std::uint64_t text_size;
+};
+static_assert(sizeof(Header) % 8 == 0, "arrays after the header must align");
+
+std::size_t AlignTo8(std::size_t size) { return (size + 7) & ~std::size_t{7}; }
+
+// Byte offsets of each array, relative to the start of the file.
+struct Layout {
+  std::size_t starts;
+  std::size_t durations;
+  std::size_t max_ends;
+  std::size_t text_offsets;
+  std::size_t num_lines;
+  std::size_t pos_ids;
+  std::size_t text;
+  std::size_t total;
+
+  Layout(std::uint64_t num_items, std::uint64_t text_size) {
+    starts = sizeof(Header);
+    durations = starts + num_items * sizeof(std::int64_t);
+    max_ends = durations + num_items * sizeof(std::int64_t);
+    text_offsets = max_ends + num_items * sizeof(std::int64_t);
+    num_lines = text_offsets + (num_items + 1) * sizeof(std::uint64_t);
+    pos_ids = AlignTo8(num_lines + num_items * sizeof(std::uint32_t));
+    text = AlignTo8(pos_ids + num_items * sizeof(std::int8_t));
+    total = text + text_size;
+  }
+};
+
+std::int64_t LastWriteTime(const fs::path& path) {
+  return static_cast<std::int64_t>(
+      fs::last_write_time(path).time_since_epoch().count());
+}
+
+template <typename T>
+void Put(std::string& buffer, std::size_t offset, const T& value) {
+  std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+// Writes the cache files of this process one at a time on a single thread,
+// so that they never block the caller. Pending writes are finished when the
+// program exits.
+class BackgroundWriter {
+ public:
+  static BackgroundWriter& Get() {
+    static BackgroundWriter writer;
+    return writer;
+  }
+
+  void Schedule(std::function<void()> write) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      queue_.push_back(std::move(write));
+      if (!thread_.joinable()) {
+        thread_ = std::thread{[this]() { Run(); }};
+      }
+    }
+    changed_.notify_all();
+  }
+
+  std::vector<std::string> WaitAll() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+    std::vector<std::string> errors;
+    errors.swap(errors_);
+    return errors;
+  }
+
+  ~BackgroundWriter() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+      changed_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      auto write = std::move(queue_.front());
+      queue_.pop_front();
+      busy_ = true;
+      lock.unlock();
+      std::string error;
+      try {
+        write();
+      } catch (const std::exception& e) {
+        error = e.what();
+      }
+      // Destroy the captured items before reporting the write as done.
+      write = nullptr;
+      lock.lock();
+      busy_ = false;
+      if (!error.empty()) {
+        errors_.push_back(std::move(error));
+      }
+      changed_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::function<void()>> queue_;
+  // True while a write taken off the queue is running.
+  bool busy_ = false;
+  bool stopping_ = false;
+  std::vector<std::string> errors_;
+  std::thread thread_;
+};
+
+void WriteBufferAtomically(const fs::path& path, const std::string& buffer) {
+  // Concurrent writers of the same cache each use their own temp file.
+  static std::atomic<std::uint64_t> counter{0};
+  auto temp_path = path;
+  temp_path += ".tmp" + std::to_string(counter++);
+  {
+    std::ofstream output{temp_path, std::ofstream::out |
+                                        std::ofstream::trunc |
+                                        std::ofstream::binary};
+    if (!output) {
+      throw std::runtime_error{"Could not open file " + temp_path.string()};
+    }
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (!output) {
+      std::error_code ignored;
+      fs::remove(temp_path, ignored);
+      throw std::runtime_error{"Could not write file " + temp_path.string()};
+    }
+  }
+  fs::rename(temp_path, path);
+}
+
+}  // namespace
+
+SubRipSource SubRipSource::Of(const fs::path& path, std::string_view contents) {
+  SubRipSource source;
+  source.size = contents.size();
+  source.mtime = LastWriteTime(path);
+  source.hash = HashSubRipSource(contents);
+  return source;
+}
+
+std::uint64_t HashSubRipSource(std::string_view contents) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : contents) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+fs::path SubRipCache::CachePath(const fs::path& srt_path) {
+  auto cache_path = srt_path;
+  cache_path += ".cache";
+  return cache_path;
+}
+
+std::optional<SubRipCache> SubRipCache::Open(const fs::path& srt_path) {
+  std::error_code error;
+  auto srt_size = fs::file_size(srt_path, error);
+  if (error) {
+    return std::nullopt;
+  }
+  auto cache_path = CachePath(srt_path);
+  if (!fs::exists(cache_path, error)) {
+    return std::nullopt;
+  }
+
+  SubRipCache cache{nullptr};
+  try {
+    cache = SubRipCache{std::make_unique<MemoryMappedFile>(cache_path)};
+  } catch (const std::runtime_error&) {
+    return std::nullopt;
+  }
+  if (!cache.Assign() || cache.source_.size != srt_size) {
+    return std::nullopt;
+  }
+
+  auto srt_mtime = fs::last_write_time(srt_path, error);
+  if (error) {
+    return std::nullopt;
+  }
+  if (cache.source_.mtime ==
+      static_cast<std::int64_t>(srt_mtime.time_since_epoch().count())) {
+    return cache;
+  }
+  // Same size but a different mtime, compare the contents.
+  try {
+    MemoryMappedFile srt{srt_path};
+    if (HashSubRipSource(srt.contents()) != cache.source_.hash) {
+      return std::nullopt;
+    }
+  } catch (const std::runtime_error&) {
+    return std::nullopt;
+  }
+  return cache;
+}
+
+SubRipCache::SubRipCache(std::unique_ptr<MemoryMappedFile> file)
+    : file_{std::move(file)} {}
+
+bool SubRipCache::Assign() {
+  auto contents = file_->contents();
+  if (contents.size() < sizeof(Header)) {
+    return false;
+  }
+  Header header;
+  std::memcpy(&header, contents.data(), sizeof(Header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.byte_order_mark != kByteOrderMark) {
+    return false;
+  }
+  // Guard the layout computation below against overflow.
+  if (header.num_items > contents.size() ||
+      header.text_size > contents.size()) {
+    return false;
+  }
+  Layout layout{header.num_items, header.text_size};
+  if (layout.total != contents.size()) {
+    return false;
+  }
+
+  // Mappings are page aligned, and so is every array in the layout.
+  const char* base = contents.data();
+  num_items_ = header.num_items;
+  starts_ = reinterpret_cast<const std::int64_t*>(base + layout.starts);
+  durations_ = reinterpret_cast<const std::int64_t*>(base + layout.durations);
+  max_ends_ = reinterpret_cast<const std::int64_t*>(base + layout.max_ends);
+  text_offsets_ =
+      reinterpret_cast<const std::uint64_t*>(base + layout.text_offsets);
+  num_lines_ = reinterpret_cast<const std::uint32_t*>(base + layout.num_lines);
+  pos_ids_ = reinterpret_cast<const std::int8_t*>(base + layout.pos_ids);
+  text_ = base + layout.text;
+  // payload(i) trusts the offsets, so a corrupt cache must not get past
+  // here. This is a single pass over the offsets, still without parsing.
+  if (text_offsets_[0] != 0 || text_offsets_[num_items_] != header.text_size) {
+    return false;
+  }
+  for (std::size_t i = 0; i < num_items_; ++i) {
+    if (text_offsets_[i] > text_offsets_[i + 1] || pos_ids_[i] < 0 ||
+        pos_ids_[i] > 9) {
+      return false;
+    }
+  }
+
+  source_.size = header.source_size;
+  source_.mtime = header.source_mtime;
+  source_.hash = header.source_hash;
+  return true;
+}
+
+void SubRipCache::ForEachOverlapping(
+    std::chrono::milliseconds start, std::chrono::milliseconds end,
+    const std::function<void(std::size_t)>& on_find) const {
+  if (num_items_ == 0 || start > end) {
+    return;
+  }
+  // Cues at or after limit start after the window.
+  auto limit = static_cast<std::size_t>(
+      std::upper_bound(starts_, starts_ + num_items_, end.count()) - starts_);
+  // max_ends_ is non decreasing, so every cue before first ends before the
+  // window starts.
+  auto first = static_cast<std::size_t>(
+      std::lower_bound(max_ends_, max_ends_ + limit, start.count()) -
+      max_ends_);
+  for (auto i = first; i < limit; ++i) {
+    if (starts_[i] + durations_[i] >= start.count()) {
+      on_find(i);
+    }
+  }
+}
+
+std::vector<std::shared_ptr<SubRipItem>> SubRipCache::ToItems() const {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  items.reserve(num_items_);
+  for (std::size_t i = 0; i < num_items_; ++i) {
+    auto item = std::make_shared<SubRipItem>();
+    item->start(start(i))->duration(duration(i));
+    item->payload_ = payload(i);
+    item->num_lines_ = static_cast<int>(num_lines_[i]);
+    item->ass_pos_id_ = pos_ids_[i];
+    items.push_back(std::move(item));
+  }
+  InternRepeatedSubRipPayloads(items);
+  return items;
+}
+
+template <typename GetItem>
+std::string SubRipCache::Serialize(const SubRipSource& source,
+                                   std::size_t num_items, GetItem get_item) {
+  std::uint64_t text_size = 0;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    text_size += get_item(i).payload().size();
+  }
+  Layout layout{num_items, text_size};
+  std::string buffer(layout.total, '\0');
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.num_items = num_items;
+  header.source_size = source.size;
+  header.source_mtime = source.mtime;
+  header.source_hash = source.hash;
+  header.text_size = text_size;
+  Put(buffer, 0, header);
+
+  std::int64_t max_end = std::numeric_limits<std::int64_t>::min();
+  std::uint64_t text_offset = 0;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    const auto& item = get_item(i);
+    const std::int64_t start = item.start().count();
+    const std::int64_t duration = item.duration().count();
+    max_end = std::max(max_end, start + duration);
+    Put(buffer, layout.starts + i * sizeof(std::int64_t), start);
+    Put(buffer, layout.durations + i * sizeof(std::int64_t), duration);
+    Put(buffer, layout.max_ends + i * sizeof(std::int64_t), max_end);
+    Put(buffer, layout.text_offsets + i * sizeof(std::uint64_t), text_offset);
+    Put(buffer, layout.num_lines + i * sizeof(std::uint32_t),
+        static_cast<std::uint32_t>(item.num_lines()));
+    Put(buffer, layout.pos_ids + i, item.ass_pos_id_);
+
+    auto payload = item.payload();
+    std::memcpy(buffer.data() + layout.text + text_offset, payload.data(),
+                payload.size());
+    text_offset += payload.size();
+  }
+  Put(buffer, layout.text_offsets + num_items * sizeof(std::uint64_t),
+      text_offset);
+  return buffer;
+}
+
+std::string SubRipCache::Serialize(
+    const SubRipSource& source,
+    const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  return Serialize(source, items.size(),
+                   [&items](std::size_t i) -> const SubRipItem& {
+                     return *items[i];
+                   });
+}
+
+std::string SubRipCache::Serialize(const SubRipSource& source,
+                                   const std::vector<SubRipItem>& items) {
+  return Serialize(source, items.size(),
+                   [&items](std::size_t i) -> const SubRipItem& {
+                     return items[i];
+                   });
+}
+
+void WriteSubRipCache(const fs::path& srt_path, const SubRipSource& source,
+                      const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  WriteBufferAtomically(SubRipCache::CachePath(srt_path),
+                        SubRipCache::Serialize(source, items));
+}
+
+void RebuildSubRipCacheInBackground(
+    const fs::path& srt_path, const SubRipSource& source,
+    const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  // Copies, so they can be serialized on the writer thread while the caller
+  // keeps editing. Interned payloads are shared rather than copied. The
+  // others are copied as is, which is cheaper than interning them here.
+  std::vector<SubRipItem> snapshot;
+  snapshot.reserve(items.size());
+  for (const auto& item : items) {
+    snapshot.push_back(*item);
+  }
+  BackgroundWriter::Get().Schedule(
+      [cache_path = SubRipCache::CachePath(srt_path), source,
+       snapshot = std::move(snapshot)]() {
+        // Without a cache, the next load parses the SRT instead.
+        WriteBufferAtomically(cache_path,
+                              SubRipCache::Serialize(source, snapshot));
+      });
+}
+
+std::vector<std::string> WaitForSubRipCacheWrites() {
+  return BackgroundWriter::Get().WaitAll();
+}
+
+std::vector<std::shared_ptr<SubRipItem>> LoadSubRipCached(
+    const fs::path& srt_path, SubRipSource* source) {
+  if (auto cache = SubRipCache::Open(srt_path)) {
+    if (source) {
+      *source = cache->source();
+    }
+    return cache->ToItems();
+  }
+
+  // Stat before reading, so that a concurrent write makes the cache stale
+  // rather than describing contents it doesn't hold.
+  SubRipSource loaded_source;
+  loaded_source.mtime = LastWriteTime(srt_path);
+  MemoryMappedFile file{srt_path};
+  loaded_source.size = file.contents().size();
+  loaded_source.hash = HashSubRipSource(file.contents());
+  std::string decoded;
+  auto items = ParseSubRip(DecodeSubRip(file.contents(), decoded));
+  // Same order as SubRipFile::Builder, ties keep their order in the file.
+  if (!std::is_sorted(items.begin(), items.end(),
+                      [](const auto& a, const auto& b) { return *a < *b; })) {
+    std::stable_sort(items.begin(), items.end(),
+                     [](const auto& a, const auto& b) { return *a < *b; });
+  }
+  RebuildSubRipCacheInBackground(srt_path, loaded_source, items);
+  if (source) {
+    *source = loaded_source;
+  }
+  return items;
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,166 @@
+#ifndef SUBTITLER_SRT_SUBRIP_CACHE_H
+#define SUBTITLER_SRT_SUBRIP_CACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/memory_mapped_file.h"
+
+namespace subtitler {
+namespace srt {
+
+// Identifies the contents of an SRT file, to tell whether data derived from
+// it (a cache or a journal) still applies.
+struct SubRipSource {
+  std::uint64_t size = 0;
+  // Last write time, in the units of std::filesystem::file_time_type.
+  std::int64_t mtime = 0;
+  // FNV-1a hash of the contents.
+  std::uint64_t hash = 0;
+
+  // Describes the file at path, whose current contents are given.
+  // Throws std::filesystem::filesystem_error if path can't be stat'ed.
+  static SubRipSource Of(const std::filesystem::path& path,
+                         std::string_view contents);
+};
+
+std::uint64_t HashSubRipSource(std::string_view contents);
+
+/**
+ * Binary sidecar of an SRT file, kept next to it as "<file>.cache", which
+ * can be used in place of the SRT without parsing it. The file is mapped
+ * and read in place, opening it only checks that the text offsets are in
+ * bounds, a single pass which is much cheaper than parsing the SRT.
+ *
+ * Layout, in native byte order, with every array 8 byte aligned:
+ * header: magic, version, byte order mark, number of cues n, size, mtime
+ *         and hash of the SRT, size of the text blob
+ * int64 starts[n], int64 durations[n] (milliseconds, sorted by start)
+ * int64 max_ends[n]: max end time of cues [0, i], the interval index
+ * uint64 text_offsets[n + 1]: payload i is text[offsets[i], offsets[i + 1])
+ * uint32 num_lines[n]
+ * int8 pos_ids[n]: 0 if the cue has no position
+ * char text[]
+ *
+ * A cache is fresh if the size and mtime of the SRT match the header. If
+ * only the mtime differs, e.g. the file was copied or touched, the contents
+ * are hashed to decide.
+ *
+ * Example:
+ * if (auto cache = SubRipCache::Open("subs.srt")) {
+ *   cache->payload(0);
+ * }
+ */
+class SubRipCache {
+ public:
+  // Path of the cache belonging to srt_path.
+  static std::filesystem::path CachePath(const std::filesystem::path& srt_path);
+
+  // Maps the cache of srt_path. Returns nullopt if there is no cache, or it
+  // is stale or corrupt, in which case the SRT should be parsed instead.
+  static std::optional<SubRipCache> Open(
+      const std::filesystem::path& srt_path);
+
+  std::size_t NumItems() const { return num_items_; }
+
+  // The SRT this cache was built from.
+  const SubRipSource& source() const { return source_; }
+
+  // Accessors for cue i, which must be < NumItems().
+  std::chrono::milliseconds start(std::size_t i) const {
+    return std::chrono::milliseconds{starts_[i]};
+  }
+  std::chrono::milliseconds duration(std::size_t i) const {
+    return std::chrono::milliseconds{durations_[i]};
+  }
+  // 0 if the cue has no position.
+  int position(std::size_t i) const { return pos_ids_[i]; }
+  // Valid for the lifetime of the cache.
+  std::string_view payload(std::size_t i) const {
+    return {text_ + text_offsets_[i], text_offsets_[i + 1] - text_offsets_[i]};
+  }
+
+  // Calls on_find(i) for every cue with a non-empty intersection with
+  // [start, end], in increasing order. O(log n) to locate the cues which may
+  // intersect.
+  void ForEachOverlapping(
+      std::chrono::milliseconds start, std::chrono::milliseconds end,
+      const std::function<void(std::size_t)>& on_find) const;
+
+  // Materializes the cues, sorted by start time. Payloads which occur more
+  // than once are interned, like ParseSubRip().
+  std::vector<std::shared_ptr<SubRipItem>> ToItems() const;
+
+  // Serializes items, which must be sorted by start time, into the cache
+  // format.
+  static std::string Serialize(
+      const SubRipSource& source,
+      const std::vector<std::shared_ptr<SubRipItem>>& items);
+  static std::string Serialize(const SubRipSource& source,
+                               const std::vector<SubRipItem>& items);
+
+ private:
+  explicit SubRipCache(std::unique_ptr<MemoryMappedFile> file);
+
+  // Serialize() for items[i] given by item(i).
+  template <typename GetItem>
+  static std::string Serialize(const SubRipSource& source,
+                               std::size_t num_items, GetItem item);
+
+  std::unique_ptr<MemoryMappedFile> file_;
+  SubRipSource source_;
+  std::size_t num_items_ = 0;
+  const std::int64_t* starts_ = nullptr;
+  const std::int64_t* durations_ = nullptr;
+  const std::int64_t* max_ends_ = nullptr;
+  const std::uint64_t* text_offsets_ = nullptr;
+  const std::uint32_t* num_lines_ = nullptr;
+  const std::int8_t* pos_ids_ = nullptr;
+  const char* text_ = nullptr;
+
+  // Returns false if the mapped file is not a valid cache.
+  bool Assign();
+};
+
+// Writes the cache of srt_path. The cache is replaced atomically, so readers
+// never see a partially written one.
+// Throws std::runtime_error on failure.
+void WriteSubRipCache(const std::filesystem::path& srt_path,
+                      const SubRipSource& source,
+                      const std::vector<std::shared_ptr<SubRipItem>>& items);
+
+// Like WriteSubRipCache, but serializes and writes the file on a background
+// thread. The calling thread only copies items, sharing interned payloads,
+// so items may be modified once this returns. Failures don't throw, since
+// the cache is only an optimization, they are returned by
+// WaitForSubRipCacheWrites instead.
+void RebuildSubRipCacheInBackground(
+    const std::filesystem::path& srt_path, const SubRipSource& source,
+    const std::vector<std::shared_ptr<SubRipItem>>& items);
+
+// Blocks until all background writes have finished. Returns the error
+// messages of the writes which failed since the last call.
+std::vector<std::string> WaitForSubRipCacheWrites();
+
+// Loads the cues of srt_path, sorted by start time. Uses the cache if it is
+// fresh. Otherwise parses the SRT and rebuilds the cache in the background.
+// If source is not null, it is set to describe the loaded SRT.
+// Only meant for the editors, which reopen the same files. Batch and read
+// only loaders use SubRipFile::LoadState, which never writes a cache.
+// Throws like SubRipFile::LoadState.
+std::vector<std::shared_ptr<SubRipItem>> LoadSubRipCached(
+    const std::filesystem::path& srt_path, SubRipSource* source = nullptr);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
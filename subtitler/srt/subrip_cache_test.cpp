@@ -0,0 +1,285 @@
+#include "subtitler/srt/subrip_cache.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/memory_mapped_file.h"
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+namespace {
+
+constexpr char kSrt[] =
+    "1\n"
+    "00:00:01,000 --> 00:00:05,000\n"
+    "{\\an8}first\n"
+    "line\n"
+    "\n"
+    "2\n"
+    "00:00:02,000 --> 00:00:03,000\n"
+    "second\n"
+    "\n"
+    "3\n"
+    "00:00:10,000 --> 00:00:11,000\n"
+    "third\n"
+    "\n";
+
+void WriteFile(const fs::path& path, const std::string& contents) {
+  std::ofstream output{path, std::ofstream::trunc | std::ofstream::binary};
+  output << contents;
+}
+
+std::vector<std::shared_ptr<SubRipItem>> MakeItems() {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  auto first = std::make_shared<SubRipItem>();
+  first->start(1s)->duration(4s)->AppendLine("first")->AppendLine("line");
+  first->position("top-center");
+  items.push_back(first);
+  auto second = std::make_shared<SubRipItem>();
+  second->start(2s)->duration(1s)->AppendLine("second");
+  items.push_back(second);
+  auto third = std::make_shared<SubRipItem>();
+  third->start(10s)->duration(1s)->AppendLine("third");
+  items.push_back(third);
+  return items;
+}
+
+SubRipSource SourceOf(const fs::path& path) {
+  MemoryMappedFile file{path};
+  return SubRipSource::Of(path, file.contents());
+}
+
+}  // namespace
+
+class SubRipCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    srt_path = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+               "subrip_cache_test.srt";
+    cache_path = SubRipCache::CachePath(srt_path);
+    fs::remove(cache_path);
+    WriteFile(srt_path, kSrt);
+  }
+
+  void TearDown() override {
+    WaitForSubRipCacheWrites();
+    fs::remove(srt_path);
+    fs::remove(cache_path);
+  }
+
+  fs::path srt_path;
+  fs::path cache_path;
+};
+
+TEST_F(SubRipCacheTest, RoundTrip) {
+  auto items = MakeItems();
+  WriteSubRipCache(srt_path, SourceOf(srt_path), items);
+
+  auto cache = SubRipCache::Open(srt_path);
+  ASSERT_TRUE(cache.has_value());
+  ASSERT_EQ(cache->NumItems(), 3);
+  EXPECT_EQ(cache->start(0), 1s);
+  EXPECT_EQ(cache->duration(0), 4s);
+  EXPECT_EQ(cache->position(0), 8);
+  EXPECT_EQ(cache->payload(0), "first\nline\n");
+  EXPECT_EQ(cache->position(1), 0);
+  EXPECT_EQ(cache->payload(2), "third\n");
+
+  auto loaded = cache->ToItems();
+  ASSERT_EQ(loaded.size(), items.size());
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ(loaded[i]->start(), items[i]->start());
+    EXPECT_EQ(loaded[i]->duration(), items[i]->duration());
+    EXPECT_EQ(loaded[i]->payload(), items[i]->payload());
+    EXPECT_EQ(loaded[i]->num_lines(), items[i]->num_lines());
+    EXPECT_EQ(loaded[i]->substation_alpha_position(),
+              items[i]->substation_alpha_position());
+  }
+}
+
+TEST_F(SubRipCacheTest, EmptyCache) {
+  WriteSubRipCache(srt_path, SourceOf(srt_path), {});
+  auto cache = SubRipCache::Open(srt_path);
+  ASSERT_TRUE(cache.has_value());
+  EXPECT_EQ(cache->NumItems(), 0);
+  EXPECT_TRUE(cache->ToItems().empty());
+}
+
+TEST_F(SubRipCacheTest, MissingCacheIsNotUsed) {
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+  fs::remove(srt_path);
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+}
+
+TEST_F(SubRipCacheTest, StaleWhenSrtChanges) {
+  WriteSubRipCache(srt_path, SourceOf(srt_path), MakeItems());
+  ASSERT_TRUE(SubRipCache::Open(srt_path).has_value());
+
+  WriteFile(srt_path, std::string{kSrt} + "\n");
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+}
+
+TEST_F(SubRipCacheTest, HashDecidesWhenOnlyMtimeChanges) {
+  WriteSubRipCache(srt_path, SourceOf(srt_path), MakeItems());
+  auto mtime = fs::last_write_time(srt_path);
+
+  // Touched, but the same contents.
+  fs::last_write_time(srt_path, mtime + 1h);
+  EXPECT_TRUE(SubRipCache::Open(srt_path).has_value());
+
+  // Same size, different contents.
+  std::string changed = kSrt;
+  changed.replace(changed.find("first"), 5, "FIRST");
+  WriteFile(srt_path, changed);
+  fs::last_write_time(srt_path, mtime + 2h);
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+}
+
+TEST_F(SubRipCacheTest, CorruptCacheIsNotUsed) {
+  WriteSubRipCache(srt_path, SourceOf(srt_path), MakeItems());
+  auto contents = SubRipCache::Serialize(SourceOf(srt_path), MakeItems());
+
+  WriteFile(cache_path, contents.substr(0, contents.size() - 1));
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+
+  contents[0] = 'X';
+  WriteFile(cache_path, contents);
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+
+  WriteFile(cache_path, "");
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+}
+
+TEST_F(SubRipCacheTest, CorruptMiddleOffsetIsNotUsed) {
+  auto contents = SubRipCache::Serialize(SourceOf(srt_path), MakeItems());
+  // text_offsets[1] follows the 56 byte header and the starts, durations
+  // and max_ends of the 3 cues. The first and last offsets stay valid.
+  constexpr std::size_t kSecondOffset = 56 + 3 * 3 * 8 + 8;
+  std::uint64_t offset = 0;
+  std::memcpy(&offset, contents.data() + kSecondOffset, sizeof(offset));
+  ASSERT_EQ(offset, std::string_view{"first\nline\n"}.size());
+  offset = 1 << 20;
+  std::memcpy(contents.data() + kSecondOffset, &offset, sizeof(offset));
+  WriteFile(cache_path, contents);
+  EXPECT_FALSE(SubRipCache::Open(srt_path).has_value());
+
+  // Loading falls back to parsing the SRT.
+  auto items = LoadSubRipCached(srt_path);
+  ASSERT_EQ(items.size(), 3);
+  EXPECT_EQ(items[1]->payload(), "second\n");
+}
+
+TEST_F(SubRipCacheTest, ToItemsInternsOnlyRepeats) {
+  auto items = MakeItems();
+  const std::string repeated = "a payload too long for the buffer";
+  items[0]->ClearPayload()->AppendLine(repeated);
+  items[2]->ClearPayload()->AppendLine(repeated);
+  items[1]->ClearPayload()->AppendLine("another payload too long for it");
+  WriteSubRipCache(srt_path, SourceOf(srt_path), items);
+
+  auto loaded = SubRipCache::Open(srt_path)->ToItems();
+  ASSERT_EQ(loaded.size(), 3);
+  EXPECT_TRUE(loaded[0]->payload_interned());
+  EXPECT_FALSE(loaded[1]->payload_interned());
+  EXPECT_TRUE(loaded[2]->payload_interned());
+  EXPECT_EQ(loaded[0]->payload().data(), loaded[2]->payload().data());
+}
+
+TEST_F(SubRipCacheTest, ForEachOverlapping) {
+  WriteSubRipCache(srt_path, SourceOf(srt_path), MakeItems());
+  auto cache = SubRipCache::Open(srt_path);
+  ASSERT_TRUE(cache.has_value());
+
+  auto overlapping = [&](std::chrono::milliseconds start,
+                         std::chrono::milliseconds end) {
+    std::vector<std::size_t> found;
+    cache->ForEachOverlapping(start, end,
+                              [&](std::size_t i) { found.push_back(i); });
+    return found;
+  };
+  // The first cue ends after the second, so it must still be found.
+  EXPECT_THAT(overlapping(4s, 4s), ElementsAre(0));
+  EXPECT_THAT(overlapping(2500ms, 2600ms), ElementsAre(0, 1));
+  EXPECT_THAT(overlapping(5s, 10s), ElementsAre(0, 2));
+  EXPECT_THAT(overlapping(6s, 9s), ElementsAre());
+  EXPECT_THAT(overlapping(0s, 1h), ElementsAre(0, 1, 2));
+  EXPECT_THAT(overlapping(12s, 13s), ElementsAre());
+}
+
+TEST_F(SubRipCacheTest, LoadRebuildsStaleCache) {
+  SubRipSource source;
+  auto parsed = LoadSubRipCached(srt_path, &source);
+  ASSERT_EQ(parsed.size(), 3);
+  EXPECT_EQ(parsed[1]->payload(), "second\n");
+  EXPECT_EQ(source.size, std::string{kSrt}.size());
+
+  WaitForSubRipCacheWrites();
+  auto cache = SubRipCache::Open(srt_path);
+  ASSERT_TRUE(cache.has_value());
+  EXPECT_EQ(cache->source().hash, source.hash);
+
+  auto cached = LoadSubRipCached(srt_path);
+  ASSERT_EQ(cached.size(), parsed.size());
+  for (std::size_t i = 0; i < parsed.size(); ++i) {
+    EXPECT_EQ(cached[i]->start(), parsed[i]->start());
+    EXPECT_EQ(cached[i]->payload(), parsed[i]->payload());
+    EXPECT_EQ(cached[i]->substation_alpha_position(),
+              parsed[i]->substation_alpha_position());
+  }
+}
+
+TEST_F(SubRipCacheTest, LoadUsesFreshCacheWithoutParsing) {
+  // A cache that doesn't match the SRT contents, but claims to be fresh,
+  // proves that the SRT wasn't parsed.
+  auto items = MakeItems();
+  items.pop_back();
+  WriteSubRipCache(srt_path, SourceOf(srt_path), items);
+
+  EXPECT_EQ(LoadSubRipCached(srt_path).size(), 2);
+}
+
+TEST_F(SubRipCacheTest, BackgroundWriteFailuresAreReported) {
+  auto missing_dir = srt_path.parent_path() / "missing" / "subs.srt";
+  RebuildSubRipCacheInBackground(missing_dir, SourceOf(srt_path), MakeItems());
+  RebuildSubRipCacheInBackground(srt_path, SourceOf(srt_path), MakeItems());
+
+  auto errors = WaitForSubRipCacheWrites();
+  ASSERT_EQ(errors.size(), 1);
+  EXPECT_THAT(errors[0], ::testing::HasSubstr("missing"));
+  EXPECT_TRUE(SubRipCache::Open(srt_path).has_value());
+  EXPECT_TRUE(WaitForSubRipCacheWrites().empty());
+}
+
+TEST_F(SubRipCacheTest, BackgroundRebuildSnapshotsItems) {
+  auto items = MakeItems();
+  items[0]->ClearPayload()->AppendLine("a payload too long for the buffer");
+  RebuildSubRipCacheInBackground(srt_path, SourceOf(srt_path), items);
+  // Edits made after scheduling the write don't reach the cache.
+  items[0]->AppendLine("edited")->start(7s);
+  items[1]->ClearPayload();
+  ASSERT_TRUE(WaitForSubRipCacheWrites().empty());
+
+  auto cache = SubRipCache::Open(srt_path);
+  ASSERT_TRUE(cache.has_value());
+  ASSERT_EQ(cache->NumItems(), 3);
+  EXPECT_EQ(cache->start(0), 1s);
+  EXPECT_EQ(cache->payload(0), "a payload too long for the buffer\n");
+  EXPECT_EQ(cache->payload(1), "second\n");
+}
@@ -0,0 +1,445 @@
+#include "subtitler/srt/subrip_diff.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "subtitler/util/duration_format.h"
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+using Items = std::vector<std::shared_ptr<SubRipItem>>;
+
+constexpr std::size_t kUnmatched = std::numeric_limits<std::size_t>::max();
+
+// Appends the byte bigrams of text to bigrams, sorted.
+void AppendBigrams(std::string_view text, std::vector<std::uint16_t>& bigrams) {
+  const auto first = bigrams.size();
+  for (std::size_t i = 0; i + 1 < text.size(); ++i) {
+    bigrams.push_back(static_cast<std::uint16_t>(
+        (static_cast<unsigned char>(text[i]) << 8) |
+        static_cast<unsigned char>(text[i + 1])));
+  }
+  std::sort(bigrams.begin() + first, bigrams.end());
+}
+
+double Dice(std::span<const std::uint16_t> a,
+            std::span<const std::uint16_t> b) {
+  if (a.empty() || b.empty()) {
+    return 0;
+  }
+  std::size_t common = 0;
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (b[j] < a[i]) {
+      ++j;
+    } else {
+      ++common;
+      ++i;
+      ++j;
+    }
+  }
+  return 2.0 * static_cast<double>(common) /
+         static_cast<double>(a.size() + b.size());
+}
+
+// Sorted bigrams of the payload of every item, stored contiguously so that
+// each payload is only split once however many cues it is compared with.
+class PayloadBigrams {
+ public:
+  explicit PayloadBigrams(const Items& items) {
+    offsets_.reserve(items.size() + 1);
+    offsets_.push_back(0);
+    for (const auto& item : items) {
+      AppendBigrams(item->payload(), bigrams_);
+      offsets_.push_back(bigrams_.size());
+    }
+  }
+
+  std::span<const std::uint16_t> operator[](std::size_t i) const {
+    return {bigrams_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+  }
+
+ private:
+  std::vector<std::uint16_t> bigrams_;
+  std::vector<std::size_t> offsets_;
+};
+
+// Intersection over union of the intervals of a and b. Identical intervals
+// are 1, even if empty.
+double Overlap(const SubRipItem& a, const SubRipItem& b) {
+  const auto a_end = a.start() + a.duration();
+  const auto b_end = b.start() + b.duration();
+  const auto intersection = std::min(a_end, b_end) - std::max(a.start(), b.start());
+  if (intersection <= std::chrono::milliseconds{0}) {
+    return a.start() == b.start() && a.duration() == b.duration() ? 1 : 0;
+  }
+  const auto union_ = std::max(a_end, b_end) - std::min(a.start(), b.start());
+  return static_cast<double>(intersection.count()) /
+         static_cast<double>(union_.count());
+}
+
+struct Candidate {
+  double score;
+  std::size_t before;
+  std::size_t after;
+};
+
+// Pairs the best scoring candidates first, skipping cues already paired.
+void MatchGreedily(std::vector<Candidate>& candidates,
+                   std::vector<std::size_t>& after_of_before,
+                   std::vector<std::size_t>& before_of_after) {
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              if (a.score != b.score) {
+                return a.score > b.score;
+              }
+              return std::pair{a.before, a.after} < std::pair{b.before, b.after};
+            });
+  for (const auto& [score, before, after] : candidates) {
+    if (after_of_before[before] == kUnmatched &&
+        before_of_after[after] == kUnmatched) {
+      after_of_before[before] = after;
+      before_of_after[after] = before;
+    }
+  }
+}
+
+// after holds the items of after_file, in order.
+std::vector<CueDiff> Diff(const Items& before, const SubRipFile& after_file,
+                          const Items& after, const DiffOptions& options) {
+  std::vector<std::size_t> after_of_before(before.size(), kUnmatched);
+  std::vector<std::size_t> before_of_after(after.size(), kUnmatched);
+
+  // Overlapping cues, found through the interval index of after, so a long
+  // cue only costs the cues it overlaps rather than widening the search for
+  // every other cue.
+  std::vector<Candidate> candidates;
+  {
+    const PayloadBigrams before_bigrams{before};
+    const PayloadBigrams after_bigrams{after};
+    for (std::size_t i = 0; i < before.size(); ++i) {
+      const auto& item = *before[i];
+      for (const auto& [sequence_number, after_item] :
+           after_file.OverlappingItems(item.start(), item.duration())) {
+        const auto j = sequence_number - 1;
+        const auto overlap = Overlap(item, *after_item);
+        if (overlap <= 0) {
+          continue;
+        }
+        const auto similarity =
+            item.SamePayload(*after_item)
+                ? 1.0
+                : Dice(before_bigrams[i], after_bigrams[j]);
+        const auto score = (overlap + similarity) / 2;
+        if (score >= options.min_score) {
+          candidates.push_back({score, i, j});
+        }
+      }
+    }
+  }
+  MatchGreedily(candidates, after_of_before, before_of_after);
+
+  // Cues left over with identical text, e.g. shifted by more than their
+  // duration.
+  candidates.clear();
+  std::unordered_map<std::string_view, std::vector<std::size_t>> unmatched;
+  for (std::size_t j = 0; j < after.size(); ++j) {
+    if (before_of_after[j] == kUnmatched) {
+      unmatched[after[j]->payload()].push_back(j);
+    }
+  }
+  if (!unmatched.empty()) {
+    for (std::size_t i = 0; i < before.size(); ++i) {
+      if (after_of_before[i] != kUnmatched) {
+        continue;
+      }
+      auto it = unmatched.find(before[i]->payload());
+      if (it == unmatched.end()) {
+        continue;
+      }
+      const auto start = before[i]->start();
+      // Sorted by start, since the cues of after are.
+      const auto& same_text = it->second;
+      auto j = std::lower_bound(same_text.begin(), same_text.end(),
+                                start - options.max_shift,
+                                [&](std::size_t index,
+                                    std::chrono::milliseconds time) {
+                                  return after[index]->start() < time;
+                                });
+      for (; j != same_text.end() &&
+             after[*j]->start() <= start + options.max_shift;
+           ++j) {
+        const auto distance = std::chrono::abs(after[*j]->start() - start);
+        // Closer cues score higher, all above any overlapping pair with
+        // different text.
+        const auto score =
+            0.5 + 0.5 / (1 + static_cast<double>(distance.count()));
+        candidates.push_back({score, i, *j});
+      }
+    }
+    MatchGreedily(candidates, after_of_before, before_of_after);
+  }
+
+  // Merge walk over both files, placing removed cues by their start time.
+  std::vector<CueDiff> diffs;
+  diffs.reserve(std::max(before.size(), after.size()));
+  std::size_t i = 0;
+  auto emit_removed_until = [&](std::chrono::milliseconds time, bool all) {
+    for (; i < before.size() && (all || before[i]->start() <= time); ++i) {
+      if (after_of_before[i] == kUnmatched) {
+        diffs.push_back({CueDiffType::kRemoved, i + 1, 0});
+      }
+    }
+  };
+  for (std::size_t j = 0; j < after.size(); ++j) {
+    emit_removed_until(after[j]->start(), /* all= */ false);
+    const auto match = before_of_after[j];
+    if (match == kUnmatched) {
+      diffs.push_back({CueDiffType::kAdded, 0, j + 1});
+      continue;
+    }
+    const auto& old_item = *before[match];
+    const auto& new_item = *after[j];
+    CueDiff diff{CueDiffType::kUnchanged, match + 1, j + 1};
+    diff.timing_changed = old_item.start() != new_item.start() ||
+                          old_item.duration() != new_item.duration();
+    diff.text_changed = !old_item.SamePayload(new_item);
+    diff.position_changed = !old_item.SamePosition(new_item);
+    if (diff.timing_changed || diff.text_changed || diff.position_changed) {
+      diff.type = CueDiffType::kChanged;
+    }
+    diffs.push_back(diff);
+  }
+  emit_removed_until({}, /* all= */ true);
+  return diffs;
+}
+
+bool SameCue(const SubRipItem& a, const SubRipItem& b) {
+  return a.start() == b.start() && a.duration() == b.duration() &&
+         a.SamePayload(b) && a.SamePosition(b);
+}
+
+// Sets merged to whichever of ours and theirs changed base, or to either if
+// both made the same change. Returns false if they made different changes.
+template <typename T>
+bool MergeField(const T& base, const T& ours, const T& theirs, T& merged) {
+  if (ours == base) {
+    merged = theirs;
+    return true;
+  }
+  if (theirs == base || theirs == ours) {
+    merged = ours;
+    return true;
+  }
+  return false;
+}
+
+// MergeField for the payloads, returns whichever of ours and theirs to take
+// the payload from, or null if both changed it differently.
+const SubRipItem* MergePayload(const SubRipItem& base, const SubRipItem& ours,
+                               const SubRipItem& theirs) {
+  if (ours.SamePayload(base)) {
+    return &theirs;
+  }
+  if (theirs.SamePayload(base) || theirs.SamePayload(ours)) {
+    return &ours;
+  }
+  return nullptr;
+}
+
+// Same for the positions as set, so that an explicit bottom-center differs
+// from no position.
+const SubRipItem* MergePosition(const SubRipItem& base,
+                                const SubRipItem& ours,
+                                const SubRipItem& theirs) {
+  if (ours.SamePosition(base)) {
+    return &theirs;
+  }
+  if (theirs.SamePosition(base) || theirs.SamePosition(ours)) {
+    return &ours;
+  }
+  return nullptr;
+}
+
+std::string ConflictMarker(std::string_view label, const SubRipItem* item) {
+  std::string marker{label};
+  if (!item) {
+    return marker + " (removed)";
+  }
+  marker += ' ';
+  AppendSubRipDuration(item->start(), marker);
+  marker += " --> ";
+  AppendSubRipDuration(item->start() + item->duration(), marker);
+  return marker;
+}
+
+void AppendPayloadLines(const SubRipItem* item, SubRipItem& output) {
+  if (!item) {
+    return;
+  }
+  auto payload = item->payload();
+  while (!payload.empty()) {
+    auto end = payload.find('\n');
+    output.AppendLine(payload.substr(0, end));
+    payload.remove_prefix(end == std::string_view::npos ? payload.size()
+                                                        : end + 1);
+  }
+}
+
+SubRipItem ConflictItem(const SubRipItem* ours, const SubRipItem* theirs) {
+  const auto& timing = ours ? *ours : *theirs;
+  SubRipItem item;
+  item.start(timing.start())->duration(timing.duration());
+  item.AppendLine(ConflictMarker("<<<<<<< ours", ours));
+  AppendPayloadLines(ours, item);
+  item.AppendLine("=======");
+  AppendPayloadLines(theirs, item);
+  item.AppendLine(ConflictMarker(">>>>>>> theirs", theirs));
+  return item;
+}
+
+}  // namespace
+
+std::string_view ToString(CueDiffType type) {
+  switch (type) {
+    case CueDiffType::kUnchanged:
+      return "unchanged";
+    case CueDiffType::kChanged:
+      return "changed";
+    case CueDiffType::kAdded:
+      return "added";
+    case CueDiffType::kRemoved:
+      return "removed";
+  }
+  return "unknown";
+}
+
+double TextSimilarity(std::string_view a, std::string_view b) {
+  if (a == b) {
+    return 1;
+  }
+  std::vector<std::uint16_t> a_bigrams;
+  std::vector<std::uint16_t> b_bigrams;
+  AppendBigrams(a, a_bigrams);
+  AppendBigrams(b, b_bigrams);
+  return Dice(a_bigrams, b_bigrams);
+}
+
+std::vector<CueDiff> DiffSubRip(const SubRipFile& before,
+                                const SubRipFile& after,
+                                const DiffOptions& options) {
+  return Diff(before.GetItems(), after, after.GetItems(), options);
+}
+
+MergeResult MergeSubRip(const SubRipFile& base, const SubRipFile& ours,
+                        const SubRipFile& theirs, const DiffOptions& options) {
+  const auto base_items = base.GetItems();
+  const auto ours_items = ours.GetItems();
+  const auto theirs_items = theirs.GetItems();
+
+  // Sequence number of each cue of base in ours and theirs, 0 if removed.
+  std::vector<std::size_t> in_ours(base_items.size(), 0);
+  std::vector<std::size_t> in_theirs(base_items.size(), 0);
+  std::vector<const SubRipItem*> ours_added;
+  std::vector<const SubRipItem*> theirs_added;
+  for (const auto& diff : Diff(base_items, ours, ours_items, options)) {
+    if (diff.type == CueDiffType::kAdded) {
+      ours_added.push_back(ours_items[diff.after_sequence - 1].get());
+    } else if (diff.before_sequence != 0) {
+      in_ours[diff.before_sequence - 1] = diff.after_sequence;
+    }
+  }
+  for (const auto& diff : Diff(base_items, theirs, theirs_items, options)) {
+    if (diff.type == CueDiffType::kAdded) {
+      theirs_added.push_back(theirs_items[diff.after_sequence - 1].get());
+    } else if (diff.before_sequence != 0) {
+      in_theirs[diff.before_sequence - 1] = diff.after_sequence;
+    }
+  }
+
+  MergeResult result;
+  SubRipFile::Builder builder;
+  builder.Reserve(base_items.size() + ours_added.size() + theirs_added.size());
+  for (std::size_t b = 0; b < base_items.size(); ++b) {
+    const auto& base_item = *base_items[b];
+    const SubRipItem* ours_item =
+        in_ours[b] ? ours_items[in_ours[b] - 1].get() : nullptr;
+    const SubRipItem* theirs_item =
+        in_theirs[b] ? theirs_items[in_theirs[b] - 1].get() : nullptr;
+    if (!ours_item && !theirs_item) {
+      continue;
+    }
+    if (!ours_item || !theirs_item) {
+      // Removed by one side, which is only clean if the other kept it as is.
+      const auto* kept = ours_item ? ours_item : theirs_item;
+      if (!SameCue(*kept, base_item)) {
+        builder.Add(ConflictItem(ours_item, theirs_item));
+        result.conflicts.push_back({b + 1, in_ours[b], in_theirs[b]});
+      }
+      continue;
+    }
+
+    std::pair<std::chrono::milliseconds, std::chrono::milliseconds> timing;
+    const SubRipItem* payload_source = nullptr;
+    const SubRipItem* position_source = nullptr;
+    bool merged =
+        MergeField(std::pair{base_item.start(), base_item.duration()},
+                   std::pair{ours_item->start(), ours_item->duration()},
+                   std::pair{theirs_item->start(), theirs_item->duration()},
+                   timing) &&
+        (payload_source = MergePayload(base_item, *ours_item, *theirs_item)) &&
+        (position_source =
+             MergePosition(base_item, *ours_item, *theirs_item));
+    if (!merged) {
+      builder.Add(ConflictItem(ours_item, theirs_item));
+      result.conflicts.push_back({b + 1, in_ours[b], in_theirs[b]});
+      continue;
+    }
+    // Copies the side the text came from, which also keeps its line count
+    // and shares its interned payload.
+    SubRipItem item = *payload_source;
+    item.start(timing.first)->duration(timing.second);
+    item.CopyPosition(*position_source);
+    builder.Add(item);
+  }
+
+  // Both lists are sorted by start time, so cues added by both sides are
+  // found with a binary search.
+  for (const auto* item : ours_added) {
+    builder.Add(*item);
+  }
+  for (const auto* item : theirs_added) {
+    auto it = std::lower_bound(
+        ours_added.begin(), ours_added.end(), item->start(),
+        [](const SubRipItem* added, std::chrono::milliseconds start) {
+          return added->start() < start;
+        });
+    bool added_by_both = false;
+    for (; it != ours_added.end() && (*it)->start() == item->start(); ++it) {
+      if (SameCue(**it, *item)) {
+        added_by_both = true;
+        break;
+      }
+    }
+    if (!added_by_both) {
+      builder.Add(*item);
+    }
+  }
+  result.merged = builder.Build();
+  return result;
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,101 @@
+#ifndef SUBTITLER_SRT_SUBRIP_DIFF_H
+#define SUBTITLER_SRT_SUBRIP_DIFF_H
+
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+
+namespace subtitler {
+namespace srt {
+
+struct DiffOptions {
+  // Cues are paired when the mean of their timing overlap (intersection over
+  // union) and text similarity is at least this.
+  double min_score = 0.5;
+  // Cues with identical text are also paired without overlapping, as long as
+  // they start within this of each other, e.g. after a shift.
+  std::chrono::milliseconds max_shift{2000};
+};
+
+enum class CueDiffType {
+  kUnchanged,
+  kChanged,
+  kAdded,
+  kRemoved,
+};
+
+// Name of the type, e.g. "changed".
+std::string_view ToString(CueDiffType type);
+
+struct CueDiff {
+  CueDiffType type;
+  // Sequence number of the cue in the before file, 0 if added.
+  std::size_t before_sequence;
+  // Sequence number of the cue in the after file, 0 if removed.
+  std::size_t after_sequence;
+  // For kChanged, what differs.
+  bool timing_changed = false;
+  bool text_changed = false;
+  bool position_changed = false;
+};
+
+/**
+ * Pairs up the cues of two versions of a file, and reports every cue as
+ * unchanged, changed, added or removed. The result is ordered by time, with
+ * a removed cue before the cues of after starting at the same time or later.
+ *
+ * Each cue of before is only compared with the cues of after which overlap
+ * it, found through the interval index of after in O(log n + k), plus those
+ * with identical text within options.max_shift. Candidates are then matched
+ * greedily by score, best first. So this is O(n log n + k) for k overlapping
+ * pairs: a long cue, e.g. music over the whole file, only adds the cues it
+ * overlaps.
+ */
+std::vector<CueDiff> DiffSubRip(const SubRipFile& before,
+                                const SubRipFile& after,
+                                const DiffOptions& options = {});
+
+// Dice coefficient of the byte bigrams of a and b: 1 if equal, 0 if they
+// have nothing in common.
+double TextSimilarity(std::string_view a, std::string_view b);
+
+struct MergeConflict {
+  // Sequence numbers of the cue in each version, 0 if it isn't in one.
+  std::size_t base_sequence;
+  std::size_t ours_sequence;
+  std::size_t theirs_sequence;
+};
+
+struct MergeResult {
+  SubRipFile merged;
+  // In order of base_sequence.
+  std::vector<MergeConflict> conflicts;
+};
+
+/**
+ * Three-way merge of the edits made by ours and theirs to base. Both are
+ * diffed against base. Edits to different parts of a cue (timing, text,
+ * position) are combined, and cues added by either side are kept, once if
+ * both added the same cue.
+ *
+ * A cue which both sides changed differently, or which one side removed and
+ * the other changed, is a conflict. It is kept with the timing of ours (of
+ * theirs if ours removed it) and a payload with conflict markers:
+ * <<<<<<< ours 00:00:01,000 --> 00:00:03,000
+ * text of ours
+ * =======
+ * text of theirs
+ * >>>>>>> theirs 00:00:01,500 --> 00:00:03,000
+ * where a removed side has "(removed)" instead of its timing and no text.
+ */
+MergeResult MergeSubRip(const SubRipFile& base, const SubRipFile& ours,
+                        const SubRipFile& theirs,
+                        const DiffOptions& options = {});
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
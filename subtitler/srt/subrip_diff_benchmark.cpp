@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "subtitler/srt/subrip_diff.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::DiffSubRip;
+using subtitler::srt::MergeSubRip;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+
+namespace {
+
+// Back to back cues of 1-5s. With edit_seed != 0, about one cue in ten is
+// retimed, rewritten, dropped or followed by a new one.
+SubRipFile MakeFile(std::size_t num_items, unsigned edit_seed) {
+  std::mt19937 rng{42};
+  std::mt19937 edit_rng{edit_seed};
+  std::uniform_int_distribution<int> length_dist{1000, 5000};
+  std::uniform_int_distribution<int> edit_dist{0, 39};
+  SubRipFile::Builder builder;
+  builder.Reserve(num_items);
+  std::chrono::milliseconds start = 0ms;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    std::chrono::milliseconds length{length_dist(rng)};
+    auto item = std::make_shared<SubRipItem>();
+    item->start(start)->duration(length);
+    auto text = "Line number " + std::to_string(i) + " of the subtitles";
+    switch (edit_seed ? edit_dist(edit_rng) : -1) {
+      case 0:
+        item->start(start + 300ms);
+        break;
+      case 1:
+        text += " (edited)";
+        break;
+      case 2:
+        start += length;
+        continue;
+      case 3: {
+        SubRipItem added;
+        added.start(start)->duration(length / 2)->AppendLine("New line");
+        builder.Add(added);
+        break;
+      }
+    }
+    item->AppendLine(text);
+    builder.Add(item);
+    start += length;
+  }
+  return builder.Build();
+}
+
+void BM_DiffSubRip(benchmark::State& state) {
+  auto before = MakeFile(state.range(0), 0);
+  auto after = MakeFile(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DiffSubRip(before, after));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DiffSubRip)->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond);
+
+// Same, with a cue over the whole file in both versions, e.g. music.
+void BM_DiffSubRipWithLongCue(benchmark::State& state) {
+  auto before = MakeFile(state.range(0), 0);
+  auto after = MakeFile(state.range(0), 1);
+  for (auto* file : {&before, &after}) {
+    SubRipItem music;
+    music.start(0ms)
+        ->duration(state.range(0) * 5000ms)
+        ->AppendLine("[Music]");
+    file->AddItem(music);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DiffSubRip(before, after));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DiffSubRipWithLongCue)
+    ->Arg(1000)
+    ->Arg(50000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_MergeSubRip(benchmark::State& state) {
+  auto base = MakeFile(state.range(0), 0);
+  auto ours = MakeFile(state.range(0), 1);
+  auto theirs = MakeFile(state.range(0), 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MergeSubRip(base, ours, theirs));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MergeSubRip)->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
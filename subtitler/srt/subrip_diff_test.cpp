@@ -0,0 +1,253 @@
+#include "subtitler/srt/subrip_diff.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+namespace {
+
+struct Cue {
+  std::chrono::milliseconds start;
+  std::chrono::milliseconds end;
+  std::string text;
+};
+
+SubRipFile MakeFile(const std::vector<Cue>& cues) {
+  SubRipFile::Builder builder;
+  for (const auto& [start, end, text] : cues) {
+    auto item = std::make_shared<SubRipItem>();
+    item->start(start)->duration(end - start)->AppendLine(text);
+    builder.Add(item);
+  }
+  return builder.Build();
+}
+
+// Diff as "type before after" strings, which are easy to compare.
+std::vector<std::string> Diff(const SubRipFile& before,
+                              const SubRipFile& after,
+                              const DiffOptions& options = {}) {
+  std::vector<std::string> result;
+  for (const auto& diff : DiffSubRip(before, after, options)) {
+    std::ostringstream entry;
+    entry << ToString(diff.type) << ' ' << diff.before_sequence << ' '
+          << diff.after_sequence;
+    if (diff.timing_changed) {
+      entry << " timing";
+    }
+    if (diff.text_changed) {
+      entry << " text";
+    }
+    if (diff.position_changed) {
+      entry << " position";
+    }
+    result.push_back(entry.str());
+  }
+  return result;
+}
+
+std::string ToString(const SubRipFile& file) {
+  std::ostringstream output;
+  file.ToStream(output);
+  return output.str();
+}
+
+}  // namespace
+
+TEST(SubRipDiffTest, TextSimilarity) {
+  ASSERT_EQ(1, TextSimilarity("hello", "hello"));
+  ASSERT_EQ(1, TextSimilarity("", ""));
+  ASSERT_EQ(0, TextSimilarity("hello", "xyz"));
+  ASSERT_EQ(0, TextSimilarity("a", "b"));
+  // he el ll lo vs he el ll lp: 3 of 4 in common.
+  ASSERT_DOUBLE_EQ(0.75, TextSimilarity("hello", "hellp"));
+}
+
+TEST(SubRipDiffTest, IdenticalFiles) {
+  auto file = MakeFile({{1s, 3s, "one"}, {4s, 6s, "two"}});
+  ASSERT_THAT(Diff(file, file),
+              ElementsAre("unchanged 1 1", "unchanged 2 2"));
+  ASSERT_TRUE(Diff(SubRipFile{}, SubRipFile{}).empty());
+}
+
+TEST(SubRipDiffTest, ReportsEachKindOfChange) {
+  auto before = MakeFile({{1s, 3s, "one"},
+                          {4s, 6s, "two"},
+                          {7s, 9s, "three"},
+                          {10s, 12s, "four"}});
+  auto after = MakeFile({{1s, 3s, "one"},
+                         {4500ms, 6s, "two"},
+                         {7s, 9s, "three!"},
+                         {13s, 14s, "five"}});
+  ASSERT_THAT(Diff(before, after),
+              ElementsAre("unchanged 1 1", "changed 2 2 timing",
+                          "changed 3 3 text", "removed 4 0", "added 0 4"));
+
+  after.EditItemPosition(1, "top-center");
+  ASSERT_THAT(Diff(before, after)[0], "changed 1 1 position");
+}
+
+TEST(SubRipDiffTest, ExplicitBottomCenterIsAPositionChange) {
+  auto before = MakeFile({{1s, 3s, "one"}});
+  auto after = MakeFile({{1s, 3s, "one"}});
+  // Bottom-center is where cues without a position are shown, but {\an2}
+  // is still written to the file.
+  after.EditItemPosition(1, "bottom-center");
+  ASSERT_THAT(Diff(before, after), ElementsAre("changed 1 1 position"));
+  ASSERT_THAT(Diff(after, before), ElementsAre("changed 1 1 position"));
+  ASSERT_THAT(Diff(after, after), ElementsAre("unchanged 1 1"));
+}
+
+TEST(SubRipDiffTest, PrefersTheBestPairing) {
+  // Two cues overlapping the same cue, the one with the same text wins even
+  // though it overlaps less.
+  auto before = MakeFile({{1s, 5s, "hello there"}});
+  auto after = MakeFile({{1s, 4s, "something else"}, {2s, 5s, "hello there"}});
+  ASSERT_THAT(Diff(before, after),
+              ElementsAre("added 0 1", "changed 1 2 timing"));
+}
+
+TEST(SubRipDiffTest, RewrittenTextIsAChangeWhenTimingMatches) {
+  auto before = MakeFile({{1s, 3s, "completely"}});
+  auto after = MakeFile({{1s, 3s, "different"}});
+  ASSERT_THAT(Diff(before, after), ElementsAre("changed 1 1 text"));
+
+  // Without overlap or similar text, they are unrelated.
+  after = MakeFile({{3s, 5s, "different"}});
+  ASSERT_THAT(Diff(before, after), ElementsAre("removed 1 0", "added 0 1"));
+}
+
+TEST(SubRipDiffTest, MatchesShiftedCuesWithIdenticalText) {
+  auto before = MakeFile({{1s, 2s, "one"}, {3s, 4s, "two"}});
+  auto after = MakeFile({{2500ms, 3500ms, "one"}, {4500ms, 5500ms, "two"}});
+  ASSERT_THAT(Diff(before, after),
+              ElementsAre("changed 1 1 timing", "changed 2 2 timing"));
+
+  DiffOptions options;
+  options.max_shift = 1s;
+  ASSERT_THAT(Diff(before, after, options),
+              ElementsAre("removed 1 0", "added 0 1", "removed 2 0",
+                          "added 0 2"));
+}
+
+TEST(SubRipDiffTest, RepeatedCuesPairInOrder) {
+  auto before = MakeFile({{1s, 2s, "la"}, {2s, 3s, "la"}, {3s, 4s, "la"}});
+  auto after = MakeFile({{1s, 2s, "la"}, {3s, 4s, "la"}});
+  ASSERT_THAT(Diff(before, after),
+              ElementsAre("unchanged 1 1", "removed 2 0", "unchanged 3 2"));
+}
+
+TEST(SubRipDiffTest, LongCueDoesNotDisturbPairing) {
+  std::vector<Cue> cues{{0s, 1h, "[Music]"}};
+  for (int i = 0; i < 100; ++i) {
+    cues.push_back({i * 10s, i * 10s + 5s, "line " + std::to_string(i)});
+  }
+  auto before = MakeFile(cues);
+  cues[50].text = "line 49, edited";
+  auto after = MakeFile(cues);
+
+  auto diffs = DiffSubRip(before, after);
+  ASSERT_EQ(101, diffs.size());
+  for (const auto& diff : diffs) {
+    ASSERT_EQ(diff.before_sequence, diff.after_sequence);
+    ASSERT_EQ(diff.before_sequence == 51 ? CueDiffType::kChanged
+                                         : CueDiffType::kUnchanged,
+              diff.type);
+  }
+}
+
+TEST(SubRipMergeTest, CombinesEditsOfBothSides) {
+  auto base = MakeFile(
+      {{1s, 3s, "one"}, {4s, 6s, "two"}, {7s, 9s, "three"}, {10s, 12s, "four"}});
+  // Ours retimes two and removes four, theirs edits the text of two and
+  // three, and both add a cue.
+  auto ours = MakeFile({{1s, 3s, "one"},
+                        {4500ms, 6s, "two"},
+                        {7s, 9s, "three"},
+                        {13s, 14s, "added"}});
+  auto theirs = MakeFile({{1s, 3s, "one"},
+                          {4s, 6s, "TWO"},
+                          {7s, 9s, "THREE"},
+                          {10s, 12s, "four"},
+                          {13s, 14s, "added"},
+                          {15s, 16s, "theirs"}});
+
+  auto result = MergeSubRip(base, ours, theirs);
+  ASSERT_TRUE(result.conflicts.empty());
+  ASSERT_EQ(ToString(result.merged),
+            "1\n00:00:01,000 --> 00:00:03,000\none\n\n"
+            "2\n00:00:04,500 --> 00:00:06,000\nTWO\n\n"
+            "3\n00:00:07,000 --> 00:00:09,000\nTHREE\n\n"
+            "4\n00:00:13,000 --> 00:00:14,000\nadded\n\n"
+            "5\n00:00:15,000 --> 00:00:16,000\ntheirs\n\n");
+}
+
+TEST(SubRipMergeTest, ConflictingEditsGetMarkers) {
+  auto base = MakeFile({{1s, 3s, "one"}, {4s, 6s, "two"}});
+  auto ours = MakeFile({{1s, 3s, "ours"}});
+  auto theirs = MakeFile({{1s, 3s, "theirs"}, {4500ms, 6s, "two"}});
+
+  auto result = MergeSubRip(base, ours, theirs);
+  ASSERT_EQ(2, result.conflicts.size());
+  ASSERT_EQ(1, result.conflicts[0].base_sequence);
+  ASSERT_EQ(1, result.conflicts[0].ours_sequence);
+  ASSERT_EQ(1, result.conflicts[0].theirs_sequence);
+  ASSERT_EQ(2, result.conflicts[1].base_sequence);
+  ASSERT_EQ(0, result.conflicts[1].ours_sequence);
+  ASSERT_EQ(2, result.conflicts[1].theirs_sequence);
+  ASSERT_EQ(ToString(result.merged),
+            "1\n00:00:01,000 --> 00:00:03,000\n"
+            "<<<<<<< ours 00:00:01,000 --> 00:00:03,000\n"
+            "ours\n"
+            "=======\n"
+            "theirs\n"
+            ">>>>>>> theirs 00:00:01,000 --> 00:00:03,000\n\n"
+            "2\n00:00:04,500 --> 00:00:06,000\n"
+            "<<<<<<< ours (removed)\n"
+            "=======\n"
+            "two\n"
+            ">>>>>>> theirs 00:00:04,500 --> 00:00:06,000\n\n");
+}
+
+TEST(SubRipMergeTest, SameEditOnBothSidesIsClean) {
+  auto base = MakeFile({{1s, 3s, "one"}, {4s, 6s, "two"}});
+  auto edited = MakeFile({{1s, 3s, "uno"}});
+  auto result = MergeSubRip(base, edited, edited);
+  ASSERT_TRUE(result.conflicts.empty());
+  ASSERT_EQ(ToString(result.merged), ToString(edited));
+}
+
+TEST(SubRipMergeTest, KeepsExplicitBottomCenter) {
+  auto base = MakeFile({{1s, 3s, "one"}, {4s, 6s, "two"}});
+  auto ours = MakeFile({{1s, 3s, "one"}, {4s, 6s, "two"}});
+  ours.EditItemPosition(1, "bottom-center");
+  ours.EditItemPosition(2, "bottom-center");
+  auto theirs = MakeFile({{1s, 3s, "uno"}, {4s, 6s, "two"}});
+  theirs.EditItemPosition(2, "top-center");
+
+  auto result = MergeSubRip(base, ours, theirs);
+  ASSERT_EQ(1, result.conflicts.size());
+  ASSERT_EQ(2, result.conflicts[0].base_sequence);
+  ASSERT_THAT(ToString(result.merged),
+              HasSubstr("1\n00:00:01,000 --> 00:00:03,000\n{\\an2}uno\n\n"));
+
+  // Theirs removing the position ours kept is a change too.
+  auto positioned = MakeFile({{1s, 3s, "one"}});
+  positioned.EditItemPosition(1, "bottom-center");
+  auto unpositioned = MakeFile({{1s, 3s, "one"}});
+  result = MergeSubRip(positioned, positioned, unpositioned);
+  ASSERT_TRUE(result.conflicts.empty());
+  ASSERT_EQ(ToString(result.merged), ToString(unpositioned));
+}
@@ -0,0 +1,400 @@
+#include "subtitler/srt/subrip_encoding.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SUBTITLER_SRT_HAS_SSE2 1
+#endif
+
+#include "subtitler/srt/subrip_parser.h"
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+constexpr std::string_view kUtf8Bom = "\xEF\xBB\xBF";
+constexpr std::string_view kUtf16LEBom = "\xFF\xFE";
+constexpr std::string_view kUtf16BEBom = "\xFE\xFF";
+
+// Bytes looked at to tell UTF-16 without a byte order mark, about the first
+// cue, whose sequence number and timestamps are ASCII.
+constexpr std::size_t kUtf16SampleSize = 64;
+
+// Code points of bytes 0x80 to 0x9F in Windows-1252. The 5 undefined bytes
+// map to the C1 controls, like in Latin-1. Bytes from 0xA0 are Latin-1.
+constexpr char16_t kWindows1252[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178};
+
+constexpr char32_t kReplacementCharacter = 0xFFFD;
+
+// Index of the first byte at or after i which isn't ASCII, or size.
+std::size_t SkipAscii(const unsigned char* data, std::size_t i,
+                      std::size_t size) {
+#ifdef SUBTITLER_SRT_HAS_SSE2
+  for (; i + 64 <= size; i += 64) {
+    auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+    auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 32));
+    auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 48));
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b),
+                                       _mm_or_si128(c, d))) != 0) {
+      break;
+    }
+  }
+  for (; i + 16 <= size; i += 16) {
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+    if (mask != 0) {
+      return i + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+  }
+#else
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    if ((word & 0x8080808080808080ull) != 0) {
+      break;
+    }
+  }
+#endif
+  while (i < size && data[i] < 0x80) {
+    ++i;
+  }
+  return i;
+}
+
+// Length of the well formed sequence starting with the non ASCII byte
+// data[i], or 0 if it isn't one. See table 3-7 of the Unicode standard.
+std::size_t SequenceLength(const unsigned char* data, std::size_t i,
+                           std::size_t size) {
+  const auto lead = data[i];
+  // Range of the second byte, which rules out overlong forms, surrogates
+  // and code points above U+10FFFF.
+  unsigned char min = 0x80;
+  unsigned char max = 0xBF;
+  std::size_t length = 0;
+  if (lead < 0xC2) {
+    return 0;
+  } else if (lead < 0xE0) {
+    length = 2;
+  } else if (lead < 0xF0) {
+    length = 3;
+    if (lead == 0xE0) {
+      min = 0xA0;
+    } else if (lead == 0xED) {
+      max = 0x9F;
+    }
+  } else if (lead < 0xF5) {
+    length = 4;
+    if (lead == 0xF0) {
+      min = 0x90;
+    } else if (lead == 0xF4) {
+      max = 0x8F;
+    }
+  } else {
+    return 0;
+  }
+  if (size - i < length || data[i + 1] < min || data[i + 1] > max) {
+    return 0;
+  }
+  for (std::size_t k = 2; k < length; ++k) {
+    if ((data[i + k] & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+char* AppendUtf8(char32_t code_point, char* output) {
+  if (code_point < 0x80) {
+    *output++ = static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *output++ = static_cast<char>(0xC0 | (code_point >> 6));
+    *output++ = static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    *output++ = static_cast<char>(0xE0 | (code_point >> 12));
+    *output++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *output++ = static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    *output++ = static_cast<char>(0xF0 | (code_point >> 18));
+    *output++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    *output++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *output++ = static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+  return output;
+}
+
+// True if the sample looks like UTF-16 in the given byte order: the high
+// byte of most code units is 0, and the low byte never is.
+bool LooksLikeUtf16(std::string_view contents, bool little_endian) {
+  const auto sample = std::min(contents.size(), kUtf16SampleSize) & ~1;
+  if (sample == 0) {
+    return false;
+  }
+  std::size_t high_zeros = 0;
+  for (std::size_t i = 0; i < sample; i += 2) {
+    const char high = contents[little_endian ? i + 1 : i];
+    const char low = contents[little_endian ? i : i + 1];
+    if (low == 0) {
+      return false;
+    }
+    high_zeros += high == 0;
+  }
+  return high_zeros * 4 >= sample;
+}
+
+// Appends the UTF-8 of contents to storage.
+void TranscodeUtf16(std::string_view contents, bool little_endian,
+                    std::string& storage) {
+  const auto* data = reinterpret_cast<const unsigned char*>(contents.data());
+  const auto num_units = contents.size() / 2;
+  auto unit = [&](std::size_t k) -> char32_t {
+    return little_endian ? data[2 * k] | (data[2 * k + 1] << 8)
+                         : (data[2 * k] << 8) | data[2 * k + 1];
+  };
+  // A code unit takes at most 3 bytes, a surrogate pair 4.
+  const auto start = storage.size();
+  storage.resize(start + num_units * 3 + 3);
+  char* output = storage.data() + start;
+  for (std::size_t k = 0; k < num_units; ++k) {
+    char32_t code_point = unit(k);
+    if (code_point < 0x80) {
+      *output++ = static_cast<char>(code_point);
+      continue;
+    }
+    if (code_point >= 0xD800 && code_point < 0xE000) {
+      char32_t next = k + 1 < num_units ? unit(k + 1) : 0;
+      if (code_point < 0xDC00 && next >= 0xDC00 && next < 0xE000) {
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (next - 0xDC00);
+        ++k;
+      } else {
+        code_point = kReplacementCharacter;
+      }
+    }
+    output = AppendUtf8(code_point, output);
+  }
+  if (contents.size() % 2 != 0) {
+    output = AppendUtf8(kReplacementCharacter, output);
+  }
+  storage.resize(static_cast<std::size_t>(output - storage.data()));
+}
+
+// Appends the UTF-8 of contents to storage.
+void TranscodeWindows1252(std::string_view contents, std::string& storage) {
+  const auto* data = reinterpret_cast<const unsigned char*>(contents.data());
+  const auto size = contents.size();
+  storage.reserve(storage.size() + size + size / 8);
+  std::size_t i = 0;
+  while (i < size) {
+    // Copies runs of ASCII as is.
+    auto end = SkipAscii(data, i, size);
+    storage.append(contents.data() + i, end - i);
+    i = end;
+    for (; i < size && data[i] >= 0x80; ++i) {
+      char32_t code_point = data[i] < 0xA0 ? kWindows1252[data[i] - 0x80]
+                                           : data[i];
+      char buffer[4];
+      storage.append(buffer, AppendUtf8(code_point, buffer));
+    }
+  }
+}
+
+}  // namespace
+
+std::string_view ToString(TextEncoding encoding) {
+  switch (encoding) {
+    case TextEncoding::kUtf8:
+      return "utf-8";
+    case TextEncoding::kUtf8Bom:
+      return "utf-8-bom";
+    case TextEncoding::kUtf16LE:
+      return "utf-16le";
+    case TextEncoding::kUtf16BE:
+      return "utf-16be";
+    case TextEncoding::kWindows1252:
+      return "windows-1252";
+  }
+  return "unknown";
+}
+
+TextEncoding DetectTextEncoding(std::string_view contents) {
+  if (contents.starts_with(kUtf8Bom)) {
+    return TextEncoding::kUtf8Bom;
+  }
+  if (contents.starts_with(kUtf16LEBom)) {
+    return TextEncoding::kUtf16LE;
+  }
+  if (contents.starts_with(kUtf16BEBom)) {
+    return TextEncoding::kUtf16BE;
+  }
+  if (LooksLikeUtf16(contents, /* little_endian= */ true)) {
+    return TextEncoding::kUtf16LE;
+  }
+  if (LooksLikeUtf16(contents, /* little_endian= */ false)) {
+    return TextEncoding::kUtf16BE;
+  }
+  return FindInvalidUtf8(contents) == contents.size()
+             ? TextEncoding::kUtf8
+             : TextEncoding::kWindows1252;
+}
+
+std::string_view DecodeSubRip(std::string_view contents, std::string& storage,
+                              TextEncoding* encoding) {
+  const auto detected = DetectTextEncoding(contents);
+  if (encoding) {
+    *encoding = detected;
+  }
+  switch (detected) {
+    case TextEncoding::kUtf8:
+      // Already validated by DetectTextEncoding.
+      return contents;
+    case TextEncoding::kUtf8Bom: {
+      contents.remove_prefix(kUtf8Bom.size());
+      if (auto invalid = FindInvalidUtf8(contents);
+          invalid != contents.size()) {
+        throw SubRipParseError{"Invalid UTF-8", invalid + kUtf8Bom.size()};
+      }
+      return contents;
+    }
+    case TextEncoding::kUtf16LE:
+    case TextEncoding::kUtf16BE: {
+      const bool little_endian = detected == TextEncoding::kUtf16LE;
+      if (contents.starts_with(little_endian ? kUtf16LEBom : kUtf16BEBom)) {
+        contents.remove_prefix(kUtf16LEBom.size());
+      }
+      storage.clear();
+      TranscodeUtf16(contents, little_endian, storage);
+      return storage;
+    }
+    case TextEncoding::kWindows1252:
+      storage.clear();
+      TranscodeWindows1252(contents, storage);
+      return storage;
+  }
+  return contents;
+}
+
+void TextDecoder::Decode(std::string_view block, bool last,
+                         std::string& output) {
+  pending_.append(block);
+  std::string_view text = pending_;
+  if (!detected_) {
+    if (text.size() < kUtf16SampleSize && !last) {
+      return;
+    }
+    detected_ = true;
+    if (text.starts_with(kUtf8Bom)) {
+      encoding_ = TextEncoding::kUtf8Bom;
+      decided_ = true;
+      text.remove_prefix(kUtf8Bom.size());
+    } else if (text.starts_with(kUtf16LEBom)) {
+      encoding_ = TextEncoding::kUtf16LE;
+      text.remove_prefix(kUtf16LEBom.size());
+    } else if (text.starts_with(kUtf16BEBom)) {
+      encoding_ = TextEncoding::kUtf16BE;
+      text.remove_prefix(kUtf16BEBom.size());
+    } else if (LooksLikeUtf16(text, /* little_endian= */ true)) {
+      encoding_ = TextEncoding::kUtf16LE;
+    } else if (LooksLikeUtf16(text, /* little_endian= */ false)) {
+      encoding_ = TextEncoding::kUtf16BE;
+    }
+  }
+  const auto skipped = static_cast<std::size_t>(text.data() - pending_.data());
+  std::size_t consumed = text.size();
+  switch (encoding_) {
+    case TextEncoding::kUtf8:
+    case TextEncoding::kUtf8Bom:
+      consumed = DecodeUtf8(text, offset_ + skipped, last, output);
+      break;
+    case TextEncoding::kUtf16LE:
+    case TextEncoding::kUtf16BE: {
+      const bool little_endian = encoding_ == TextEncoding::kUtf16LE;
+      if (!last) {
+        consumed &= ~std::size_t{1};
+        // Keeps a high surrogate for the low one in the next block.
+        if (consumed >= 2) {
+          const auto* data =
+              reinterpret_cast<const unsigned char*>(text.data());
+          const unsigned char high =
+              little_endian ? data[consumed - 1] : data[consumed - 2];
+          if (high >= 0xD8 && high < 0xDC) {
+            consumed -= 2;
+          }
+        }
+      }
+      TranscodeUtf16(text.substr(0, consumed), little_endian, output);
+      break;
+    }
+    case TextEncoding::kWindows1252:
+      TranscodeWindows1252(text, output);
+      break;
+  }
+  offset_ += skipped + consumed;
+  pending_.erase(0, skipped + consumed);
+}
+
+std::size_t TextDecoder::DecodeUtf8(std::string_view text, std::size_t offset,
+                                    bool last, std::string& output) {
+  const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+  auto size = text.size();
+  if (!last) {
+    // Leaves a sequence cut by the end of the block for the next one.
+    for (std::size_t k = 1; k <= std::min<std::size_t>(size, 3); ++k) {
+      const auto byte = data[size - k];
+      if ((byte & 0xC0) == 0x80) {
+        continue;
+      }
+      if (byte >= 0xC0 && (byte < 0xE0 ? 2u : byte < 0xF0 ? 3u : 4u) > k) {
+        size -= k;
+      }
+      break;
+    }
+  }
+  text = text.substr(0, size);
+  const auto invalid = FindInvalidUtf8(text);
+  if (!decided_) {
+    if (const auto first = SkipAscii(data, 0, size); first != size) {
+      decided_ = true;
+      if (invalid == first) {
+        // Everything before was ASCII, which Windows-1252 leaves as is.
+        encoding_ = TextEncoding::kWindows1252;
+        TranscodeWindows1252(text, output);
+        return size;
+      }
+    }
+  }
+  if (invalid != size) {
+    throw SubRipParseError{"Invalid UTF-8", offset + invalid};
+  }
+  output.append(text);
+  return size;
+}
+
+std::size_t FindInvalidUtf8(std::string_view text) {
+  const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+  const auto size = text.size();
+  std::size_t i = 0;
+  while (i < size) {
+    i = SkipAscii(data, i, size);
+    // Multibyte sequences up to the next ASCII byte.
+    while (i < size && data[i] >= 0x80) {
+      auto length = SequenceLength(data, i, size);
+      if (length == 0) {
+        return i;
+      }
+      i += length;
+    }
+  }
+  return size;
+}
+
+}  // namespace srt
+}  // namespace subtitler
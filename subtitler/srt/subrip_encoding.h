@@ -0,0 +1,108 @@
+#ifndef SUBTITLER_SRT_SUBRIP_ENCODING_H
+#define SUBTITLER_SRT_SUBRIP_ENCODING_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Input stage of the SRT loaders, which turns the bytes of a file into the
+ * UTF-8 that ParseSubRip() expects. Files from other tools often start
+ * with a byte order mark, or are UTF-16 or in a legacy codepage.
+ *
+ * Sample Usage:
+ * MemoryMappedFile file{path};
+ * std::string storage;
+ * auto items = ParseSubRip(DecodeSubRip(file.contents(), storage));
+ */
+
+enum class TextEncoding {
+  kUtf8,
+  // UTF-8 starting with a byte order mark.
+  kUtf8Bom,
+  kUtf16LE,
+  kUtf16BE,
+  // The usual legacy codepage of SRT files, a superset of Latin-1.
+  kWindows1252,
+};
+
+// Name of the encoding, e.g. "utf-16le".
+std::string_view ToString(TextEncoding encoding);
+
+// Guesses the encoding of contents: from its byte order mark if there is
+// one, otherwise UTF-16 if every other byte of the first cue is 0, UTF-8 if
+// it is valid UTF-8, and Windows-1252 if it isn't.
+TextEncoding DetectTextEncoding(std::string_view contents);
+
+// Returns contents as UTF-8 without a byte order mark. UTF-8 input is
+// returned as a view into contents, anything else is transcoded into
+// storage, which must outlive the result. Sets encoding to the detected
+// encoding if not null.
+// Unpaired UTF-16 surrogates are replaced by U+FFFD. Throws
+// SubRipParseError if contents start with a UTF-8 byte order mark but
+// aren't valid UTF-8, with the offset of the first invalid byte.
+std::string_view DecodeSubRip(std::string_view contents, std::string& storage,
+                              TextEncoding* encoding = nullptr);
+
+/**
+ * DecodeSubRip() for input read a block at a time, so that memory is
+ * bounded by the block size rather than the size of the input. Sequences
+ * split between blocks are carried over to the next one.
+ *
+ * The encoding is detected like DecodeSubRip() does, from the first bytes,
+ * except that the choice between UTF-8 and Windows-1252 is made at the
+ * first non ASCII byte, as later blocks aren't known yet: UTF-8 if it
+ * starts a valid sequence, Windows-1252 if it doesn't. Invalid UTF-8 after
+ * that throws SubRipParseError with its offset in the input.
+ *
+ * Sample Usage:
+ * TextDecoder decoder;
+ * std::string utf8;
+ * do {
+ *   input.read(block.data(), block.size());
+ *   utf8.clear();
+ *   decoder.Decode({block.data(), std::size_t(input.gcount())}, !input, utf8);
+ *   ...
+ * } while (input);
+ */
+class TextDecoder {
+ public:
+  // Appends the UTF-8 of block to output. last must be true for the final
+  // block, possibly empty, so that whatever is carried over is decoded.
+  void Decode(std::string_view block, bool last, std::string& output);
+
+  // The encoding detected so far. kUtf8 may still turn into kWindows1252
+  // until a non ASCII byte is seen.
+  TextEncoding encoding() const { return encoding_; }
+
+ private:
+  // Decodes text, at offset in the input, while it may still be UTF-8.
+  // Returns the number of bytes consumed, the rest is carried over.
+  std::size_t DecodeUtf8(std::string_view text, std::size_t offset, bool last,
+                         std::string& output);
+
+  TextEncoding encoding_ = TextEncoding::kUtf8;
+  // True once the first bytes were looked at for a byte order mark and
+  // UTF-16.
+  bool detected_ = false;
+  // True once a non ASCII byte decided between UTF-8 and Windows-1252.
+  bool decided_ = false;
+  // Bytes carried over to the next block.
+  std::string pending_;
+  // Offset in the input of the first byte of pending_.
+  std::size_t offset_ = 0;
+};
+
+// Offset of the first byte of text which doesn't start a well formed UTF-8
+// sequence (overlong forms, surrogates and code points above U+10FFFF
+// included), or text.size() if all of it is valid. ASCII is checked 64
+// bytes at a time with SSE2 where available, 8 at a time otherwise.
+std::size_t FindInvalidUtf8(std::string_view text);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
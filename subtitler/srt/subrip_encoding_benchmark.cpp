@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "subtitler/srt/subrip_encoding.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::DecodeSubRip;
+using subtitler::srt::FindInvalidUtf8;
+using subtitler::srt::ParseSubRip;
+using subtitler::srt::SubRipItem;
+
+namespace {
+
+// Contents of an SRT file with num_items two line cues of the given text.
+std::string MakeContents(std::size_t num_items, const std::string& text) {
+  std::ostringstream output;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})
+        ->duration(2s)
+        ->AppendLine(text + " " + std::to_string(i))
+        ->AppendLine(text);
+    item.ToStream(i + 1, output, /* flush= */ false);
+  }
+  return output.str();
+}
+
+// About 8 MB of English.
+const std::string& AsciiContents() {
+  static const std::string contents = MakeContents(
+      80'000, "This is the subtitle of a cue, and some more dialogue.");
+  return contents;
+}
+
+// About 8 MB, mostly three byte sequences.
+const std::string& CjkContents() {
+  static const std::string contents = MakeContents(
+      80'000,
+      "\xE8\xBF\x99\xE6\x98\xAF\xE4\xB8\x80\xE4\xB8\xAA\xE5\xAD\x97\xE5\xB9\x95"
+      "\xE7\x9A\x84\xE4\xBE\x8B\xE5\xAD\x90\xEF\xBC\x8C\xE8\xBF\x98\xE6\x9C\x89"
+      "\xE6\x9B\xB4\xE5\xA4\x9A\xE7\x9A\x84\xE5\xAF\xB9\xE8\xAF\x9D\xE3\x80\x82");
+  return contents;
+}
+
+void Validate(benchmark::State& state, const std::string& contents) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(FindInvalidUtf8(contents));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+// What validation adds to a load, compared with BM_Parse*.
+void Parse(benchmark::State& state, const std::string& contents) {
+  for (auto _ : state) {
+    std::string storage;
+    benchmark::DoNotOptimize(ParseSubRip(DecodeSubRip(contents, storage)));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+void BM_ValidateAscii(benchmark::State& state) {
+  Validate(state, AsciiContents());
+}
+
+void BM_ValidateCjk(benchmark::State& state) { Validate(state, CjkContents()); }
+
+void BM_ParseAscii(benchmark::State& state) { Parse(state, AsciiContents()); }
+
+void BM_ParseCjk(benchmark::State& state) { Parse(state, CjkContents()); }
+
+// Transcoding a legacy file, against parsing it once it is UTF-8.
+void BM_DecodeWindows1252(benchmark::State& state) {
+  std::string contents = AsciiContents();
+  for (std::size_t i = 0; i < contents.size(); i += 97) {
+    if (contents[i] == 'e') {
+      contents[i] = '\xE9';
+    }
+  }
+  for (auto _ : state) {
+    std::string storage;
+    benchmark::DoNotOptimize(DecodeSubRip(contents, storage));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ValidateAscii)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ValidateCjk)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseAscii)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseCjk)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeWindows1252)->Unit(benchmark::kMillisecond);
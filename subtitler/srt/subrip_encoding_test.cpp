@@ -0,0 +1,198 @@
+#include "subtitler/srt/subrip_encoding.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "subtitler/srt/subrip_parser.h"
+
+using namespace subtitler::srt;
+
+namespace {
+
+constexpr std::string_view kContents =
+    "1\r\n"
+    "00:00:01,000 --> 00:00:02,000\r\n"
+    "caf\xC3\xA9 \xE2\x80\x9Cquoted\xE2\x80\x9D \xF0\x9F\x98\x80\r\n";
+
+std::string ToUtf16(std::u16string_view text, bool little_endian) {
+  std::string result;
+  for (char16_t unit : text) {
+    char low = static_cast<char>(unit & 0xFF);
+    char high = static_cast<char>(unit >> 8);
+    result += little_endian ? low : high;
+    result += little_endian ? high : low;
+  }
+  return result;
+}
+
+constexpr std::u16string_view kContentsUtf16 =
+    u"1\r\n"
+    u"00:00:01,000 --> 00:00:02,000\r\n"
+    u"café “quoted” \U0001F600\r\n";
+
+std::string Decode(std::string_view contents, TextEncoding expected) {
+  std::string storage;
+  TextEncoding encoding;
+  auto decoded = DecodeSubRip(contents, storage, &encoding);
+  EXPECT_EQ(expected, encoding);
+  return std::string{decoded};
+}
+
+// Decodes contents with TextDecoder in blocks of block_size.
+std::string DecodeInBlocks(std::string_view contents, std::size_t block_size,
+                           TextEncoding expected) {
+  TextDecoder decoder;
+  std::string decoded;
+  do {
+    auto block = contents.substr(0, block_size);
+    contents.remove_prefix(block.size());
+    decoder.Decode(block, contents.empty(), decoded);
+  } while (!contents.empty());
+  EXPECT_EQ(expected, decoder.encoding());
+  return decoded;
+}
+
+}  // namespace
+
+TEST(SubRipEncodingTest, ReturnsUtf8AsView) {
+  std::string contents{kContents};
+  std::string storage;
+  TextEncoding encoding;
+  auto decoded = DecodeSubRip(contents, storage, &encoding);
+  EXPECT_EQ(TextEncoding::kUtf8, encoding);
+  EXPECT_EQ(contents.data(), decoded.data());
+  EXPECT_EQ(contents.size(), decoded.size());
+  EXPECT_EQ(TextEncoding::kUtf8, DetectTextEncoding(""));
+}
+
+TEST(SubRipEncodingTest, StripsUtf8ByteOrderMark) {
+  EXPECT_EQ(kContents, Decode("\xEF\xBB\xBF" + std::string{kContents},
+                              TextEncoding::kUtf8Bom));
+  auto items = ParseSubRip(Decode("\xEF\xBB\xBF" + std::string{kContents},
+                                  TextEncoding::kUtf8Bom));
+  ASSERT_EQ(1, items.size());
+}
+
+TEST(SubRipEncodingTest, ThrowsOnInvalidUtf8AfterByteOrderMark) {
+  std::string storage;
+  try {
+    DecodeSubRip("\xEF\xBB\xBF" "1\nab\xC3(", storage);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    EXPECT_EQ(7, e.offset());
+  }
+}
+
+TEST(SubRipEncodingTest, TranscodesUtf16) {
+  EXPECT_EQ(kContents,
+            Decode("\xFF\xFE" + ToUtf16(kContentsUtf16, true),
+                   TextEncoding::kUtf16LE));
+  EXPECT_EQ(kContents,
+            Decode("\xFE\xFF" + ToUtf16(kContentsUtf16, false),
+                   TextEncoding::kUtf16BE));
+  // Without a byte order mark.
+  EXPECT_EQ(kContents, Decode(ToUtf16(kContentsUtf16, true),
+                              TextEncoding::kUtf16LE));
+  EXPECT_EQ(kContents, Decode(ToUtf16(kContentsUtf16, false),
+                              TextEncoding::kUtf16BE));
+}
+
+TEST(SubRipEncodingTest, ReplacesUnpairedSurrogates) {
+  // Lone high surrogate, lone low surrogate, high surrogate at the end, and
+  // an odd trailing byte.
+  std::u16string text = u"a";
+  text += static_cast<char16_t>(0xD83D);
+  text += u"b";
+  text += static_cast<char16_t>(0xDE00);
+  text += static_cast<char16_t>(0xD83D);
+  EXPECT_EQ("a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD",
+            Decode("\xFF\xFE" + ToUtf16(text, true), TextEncoding::kUtf16LE));
+  EXPECT_EQ("a\xEF\xBF\xBD",
+            Decode("\xFE\xFF" + ToUtf16(u"a", false) + "\x20",
+                   TextEncoding::kUtf16BE));
+}
+
+TEST(SubRipEncodingTest, TranscodesWindows1252) {
+  // "café “quoted” €", plus an undefined byte mapped to a C1 control.
+  EXPECT_EQ(
+      "1\nabc caf\xC3\xA9 \xE2\x80\x9Cquoted\xE2\x80\x9D \xE2\x82\xAC\xC2\x81",
+      Decode("1\nabc caf\xE9 \x93quoted\x94 \x80\x81",
+             TextEncoding::kWindows1252));
+  // Long enough for the ASCII runs to be copied in blocks.
+  std::string ascii(100, 'x');
+  EXPECT_EQ(ascii + "\xC3\xBF" + ascii,
+            Decode(ascii + "\xFF" + ascii, TextEncoding::kWindows1252));
+}
+
+TEST(SubRipEncodingTest, DecodesInBlocksOfAnySize) {
+  std::string padding(70, 'x');
+  std::string windows_1252 = padding + "caf\xE9 \x93quoted\x94 \x80";
+  std::string utf16 = ToUtf16(kContentsUtf16, true);
+  for (std::size_t block_size = 1; block_size < 80; ++block_size) {
+    SCOPED_TRACE(block_size);
+    EXPECT_EQ(kContents,
+              DecodeInBlocks(kContents, block_size, TextEncoding::kUtf8));
+    EXPECT_EQ(kContents,
+              DecodeInBlocks("\xEF\xBB\xBF" + std::string{kContents},
+                             block_size, TextEncoding::kUtf8Bom));
+    EXPECT_EQ(kContents,
+              DecodeInBlocks(utf16, block_size, TextEncoding::kUtf16LE));
+    EXPECT_EQ(kContents,
+              DecodeInBlocks("\xFE\xFF" + ToUtf16(kContentsUtf16, false),
+                             block_size, TextEncoding::kUtf16BE));
+    EXPECT_EQ(Decode(windows_1252, TextEncoding::kWindows1252),
+              DecodeInBlocks(windows_1252, block_size,
+                             TextEncoding::kWindows1252));
+  }
+  EXPECT_EQ("", DecodeInBlocks("", 10, TextEncoding::kUtf8));
+  // A sequence cut by the end of the input.
+  EXPECT_EQ("ab\xC3\x83", DecodeInBlocks("ab\xC3", 1,
+                                          TextEncoding::kWindows1252));
+}
+
+TEST(SubRipEncodingTest, DecoderThrowsOnInvalidUtf8AfterValidUtf8) {
+  TextDecoder decoder;
+  std::string decoded;
+  decoder.Decode("1\ncaf\xC3\xA9\n", false, decoded);
+  try {
+    decoder.Decode("caf\xE9\n", true, decoded);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    EXPECT_EQ(11, e.offset());
+  }
+}
+
+TEST(SubRipEncodingTest, FindsInvalidUtf8) {
+  EXPECT_EQ(0, FindInvalidUtf8(""));
+  EXPECT_EQ(kContents.size(), FindInvalidUtf8(kContents));
+  // Stray continuation byte.
+  EXPECT_EQ(1, FindInvalidUtf8("a\x80"));
+  // Truncated sequences.
+  EXPECT_EQ(1, FindInvalidUtf8("a\xE2\x80"));
+  EXPECT_EQ(0, FindInvalidUtf8("\xE2\x80x"));
+  // Overlong forms.
+  EXPECT_EQ(0, FindInvalidUtf8("\xC0\xAF"));
+  EXPECT_EQ(0, FindInvalidUtf8("\xE0\x80\xAF"));
+  EXPECT_EQ(0, FindInvalidUtf8("\xF0\x80\x80\xAF"));
+  // Surrogates and code points above U+10FFFF.
+  EXPECT_EQ(0, FindInvalidUtf8("\xED\xA0\x80"));
+  EXPECT_EQ(0, FindInvalidUtf8("\xF4\x90\x80\x80"));
+  EXPECT_EQ(0, FindInvalidUtf8("\xF5\x80\x80\x80"));
+  // Largest valid code points of each length.
+  EXPECT_EQ(12, FindInvalidUtf8("\xDF\xBF\xEF\xBF\xBF\xF4\x8F\xBF\xBF\xED\x9F"
+                                "\xBF"));
+}
+
+TEST(SubRipEncodingTest, FindsInvalidUtf8AtEveryOffset) {
+  // Exercises the block skipping over ASCII at every alignment.
+  for (std::size_t offset = 0; offset < 200; ++offset) {
+    std::string text(offset, 'a');
+    text += "\xFF";
+    text += std::string(100, 'b');
+    EXPECT_EQ(offset, FindInvalidUtf8(text)) << offset;
+    text[offset] = 'c';
+    EXPECT_EQ(text.size(), FindInvalidUtf8(text)) << offset;
+  }
+}
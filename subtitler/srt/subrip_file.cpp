@@ -2,10 +2,13 @@
 
 #include <algorithm>
 #include <filesystem>
-#include <fstream>
 #include <stdexcept>
+#include <string>
 
+#include "subtitler/srt/subrip_encoding.h"
 #include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/memory_mapped_file.h"
 
 namespace fs = std::filesystem;
 
@@ -14,95 +17,133 @@ namespace srt {
 
 namespace {
 
-void InsertSortedItem(std::vector<std::shared_ptr<SubRipItem>>& container,
-                      const std::shared_ptr<SubRipItem>& item) {
-  if (!item) {
-    throw std::invalid_argument{"Cannot add null SubRipItem"};
-  }
-  // Inserts in sorted order.
-  auto insert_here = std::lower_bound(
-      container.begin(), container.end(), item.get(),
-      [](const std::shared_ptr<SubRipItem>& sri, const SubRipItem* to_compare) {
-        return *sri < *to_compare;
-      });
-  container.insert(insert_here, item);
+// Upper bound for typical cues: sequence number, timestamp line, position tag
+// and separating blank line, plus the payload.
+std::size_t EstimatedSerializedSize(const SubRipItem& item) {
+  constexpr std::size_t kPerItemOverhead = 64;
+  return item.payload().size() + kPerItemOverhead;
+}
+
+void WriteBuffer(const std::string& buffer, std::ostream& output) {
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  output << std::flush;
 }
 
 }  // namespace
 
 void SubRipFile::ToStream(std::ostream& output) const {
-  for (std::size_t i = 0; i < items_.size(); ++i) {
-    items_.at(i)->ToStream(i + 1, output, /* flush= */ false);
-    output << '\n';
-  }
-  output << std::flush;
+  // Serialize everything into one buffer, then write it out at once.
+  std::string buffer;
+  std::size_t estimated_size = 0;
+  items_.ForEach([&](std::size_t, const std::shared_ptr<SubRipItem>& item) {
+    estimated_size += EstimatedSerializedSize(*item);
+  });
+  buffer.reserve(estimated_size);
+  items_.ForEach(
+      [&](std::size_t index, const std::shared_ptr<SubRipItem>& item) {
+        item->AppendTo(index + 1, buffer);
+        buffer += '\n';
+      });
+  WriteBuffer(buffer, output);
 }
 
 void SubRipFile::LoadState(const fs::path& file_name) {
-  auto path = file_name;
-  std::ifstream stream{path};
-
-  std::vector<std::shared_ptr<SubRipItem>> new_items;
-  std::string line;
-  while (std::getline(stream, line)) {
-    if (line.empty()) {
-      continue;
-    }
-    // Encountered first non-empty line
-    std::ostringstream item_stream;
-    item_stream << line << std::endl;
-    while (std::getline(stream, line) && !line.empty()) {
-      item_stream << line << std::endl;
-    }
-    InsertSortedItem(new_items,
-                     std::make_shared<SubRipItem>(item_stream.str()));
+  // Parse straight out of the mapped file, instead of copying every cue
+  // through a stream. Only files which aren't UTF-8 are copied, to decode
+  // them.
+  MemoryMappedFile file{file_name};
+  std::string decoded;
+  auto items = ParseSubRip(DecodeSubRip(file.contents(), decoded));
+  Builder builder;
+  builder.Reserve(items.size());
+  for (auto& item : items) {
+    builder.Add(std::move(item));
   }
 
   // Overwrite previous state.
-  items_ = std::move(new_items);
+  *this = builder.Build();
+}
+
+void SubRipFile::AssignSorted(
+    std::vector<std::shared_ptr<SubRipItem>> new_items) {
+  items_.Assign(std::move(new_items));
 }
 
 void SubRipFile::ToStream(std::ostream& output, std::chrono::milliseconds start,
                           std::chrono::milliseconds duration) const {
   std::size_t sequence_number = 1;
-
-  auto print_item = [&](std::size_t ignored,
-                        const std::shared_ptr<SubRipItem>& item) {
-    // To produce a valid SRT file, the first subtitle must begin with
-    // sequence one. Hence we provide our own sequential counter while
-    // ignoring the index.
-    item->ToStream(sequence_number, output, /* flush= */ false);
-    output << '\n';
+  auto overlapping = OverlappingItems(start, duration);
+  std::string buffer;
+  std::size_t estimated_size = 0;
+  for (const auto& [ignored, item] : overlapping) {
+    estimated_size += EstimatedSerializedSize(*item);
+  }
+  buffer.reserve(estimated_size);
+
+  // To produce a valid SRT file, the first subtitle must begin with
+  // sequence one. Hence we provide our own sequential counter while
+  // ignoring the sequence number in the file.
+  for (const auto& [ignored, item] : overlapping) {
+    item->AppendTo(sequence_number, buffer);
+    buffer += '\n';
     ++sequence_number;
-  };
-  this->ForEachOverlappingItem(start, duration, print_item);
-  output << std::flush;
+  }
+  WriteBuffer(buffer, output);
 }
 
 std::size_t SubRipFile::NumItems() const { return items_.size(); }
 
+std::vector<std::shared_ptr<SubRipItem>> SubRipFile::GetItems() const {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  items.reserve(items_.size());
+  items_.ForEach(
+      [&](std::size_t, const std::shared_ptr<SubRipItem>& item) {
+        items.push_back(item);
+      });
+  return items;
+}
+
+const std::shared_ptr<SubRipItem>& SubRipFile::GetItem(
+    std::size_t sequence_number) const {
+  if (sequence_number <= 0 || sequence_number > NumItems()) {
+    throw std::out_of_range("invalid index passed to GetItem()");
+  }
+  return items_.At(sequence_number - 1);
+}
+
+SubRipFile::CueId SubRipFile::GetId(std::size_t sequence_number) const {
+  if (sequence_number <= 0 || sequence_number > NumItems()) {
+    throw std::out_of_range("invalid index passed to GetId()");
+  }
+  return items_.IdAt(sequence_number - 1);
+}
+
+std::size_t SubRipFile::GetSequenceNumber(CueId id) const {
+  return items_.RankOf(id) + 1;
+}
+
+const std::shared_ptr<SubRipItem>& SubRipFile::GetItemById(CueId id) const {
+  return items_.Get(id);
+}
+
 std::unordered_map<std::size_t, const SubRipItem*> SubRipFile::GetCollisions(
     std::chrono::milliseconds start, std::chrono::milliseconds duration) const {
   std::unordered_map<std::size_t, const SubRipItem*> intersections;
-
-  auto add_to_intersections = [&](std::size_t index,
-                                  const std::shared_ptr<SubRipItem>& item) {
-    // Recall that sequence number is 1's based, while vector index is 0's
-    // based.
-    intersections[index + 1] = item.get();
-  };
-  this->ForEachOverlappingItem(start, duration, add_to_intersections);
-
+  for (const auto& [sequence_number, item] :
+       OverlappingItems(start, duration)) {
+    intersections[sequence_number] = item.get();
+  }
   return intersections;
 }
 
-void SubRipFile::AddItem(const std::shared_ptr<SubRipItem>& item) {
-  InsertSortedItem(items_, item);
+SubRipFile::CueId SubRipFile::AddItem(
+    const std::shared_ptr<SubRipItem>& item) {
+  return items_.Insert(item);
 }
 
-void SubRipFile::AddItem(const SubRipItem& item) {
+SubRipFile::CueId SubRipFile::AddItem(const SubRipItem& item) {
   auto item_copy = std::make_shared<SubRipItem>(item);
-  AddItem(item_copy);
+  return AddItem(item_copy);
 }
 
 std::shared_ptr<SubRipItem> SubRipFile::RemoveItem(
@@ -110,10 +151,41 @@ std::shared_ptr<SubRipItem> SubRipFile::RemoveItem(
   if (sequence_number <= 0 || sequence_number > NumItems()) {
     throw std::out_of_range("invalid index passed to RemoveItem()");
   }
-  auto vector_position = sequence_number - 1;
-  auto backup = items_.at(vector_position);
-  items_.erase(items_.begin() + vector_position);
-  return backup;
+  return items_.Erase(items_.IdAt(sequence_number - 1));
+}
+
+std::shared_ptr<SubRipItem> SubRipFile::RemoveItemById(CueId id) {
+  return items_.Erase(id);
+}
+
+void SubRipFile::RestoreItem(CueId id,
+                             const std::shared_ptr<SubRipItem>& item) {
+  items_.Insert(item, id);
+}
+
+std::size_t SubRipFile::RetimeItem(CueId id, std::chrono::milliseconds start,
+                                   std::chrono::milliseconds duration) {
+  return items_.Retime(id, start, duration) + 1;
+}
+
+void SubRipFile::GetTimings(
+    std::size_t first_sequence, std::size_t count, std::vector<CueId>& ids,
+    std::vector<std::chrono::milliseconds>& starts,
+    std::vector<std::chrono::milliseconds>& durations) const {
+  if (first_sequence <= 0) {
+    throw std::out_of_range("invalid index passed to GetTimings()");
+  }
+  items_.GetTimings(first_sequence - 1, count, ids, starts, durations);
+}
+
+bool SubRipFile::RetimeItems(
+    std::size_t first_sequence,
+    const std::vector<std::chrono::milliseconds>& starts,
+    const std::vector<std::chrono::milliseconds>& durations) {
+  if (first_sequence <= 0) {
+    throw std::out_of_range("invalid index passed to RetimeItems()");
+  }
+  return items_.RetimeRange(first_sequence - 1, starts, durations);
 }
 
 void SubRipFile::EditItemPosition(std::size_t sequence_number,
@@ -121,34 +193,41 @@ void SubRipFile::EditItemPosition(std::size_t sequence_number,
   if (sequence_number <= 0 || sequence_number > NumItems()) {
     throw std::out_of_range("invalid index passed to EditItemPosition()");
   }
-  auto vector_position = sequence_number - 1;
-  auto& item = items_.at(vector_position);
-  item->position(position);
-}
-
-void SubRipFile::ForEachOverlappingItem(
-    std::chrono::milliseconds start, std::chrono::milliseconds duration,
-    std::function<void(std::size_t, const std::shared_ptr<SubRipItem>&)>
-        on_find) const {
-  // Run linear search to collect intersections. Since we allow overlaps in
-  // existing intervals, there is not a trivial binary search that we can do.
-  // A better way would be to use interval tree, but until we see an actual
-  // need to use one let's Keep it Simple!
-  auto end = start + duration;
-  for (std::size_t i = 0; i < items_.size(); ++i) {
-    auto& item = items_.at(i);
-    // Assume items are sorted by start time. If the next interval starts
-    // after I end then none of the remaining items can overlap with me.
-    if (item->start_ > end) {
-      break;
-    }
-    auto item_end = item->start_ + item->duration_;
-    // Reference https://stackoverflow.com/questions/3269434
-    auto does_overlap = start <= item_end && item->start_ <= end;
-    if (does_overlap) {
-      on_find(i, item);
-    }
+  items_.At(sequence_number - 1)->position(position);
+}
+
+SubRipFile::Builder& SubRipFile::Builder::Add(
+    const std::shared_ptr<SubRipItem>& item) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  items_.push_back(item);
+  return *this;
+}
+
+SubRipFile::Builder& SubRipFile::Builder::Add(
+    std::shared_ptr<SubRipItem>&& item) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  items_.push_back(std::move(item));
+  return *this;
+}
+
+SubRipFile::Builder& SubRipFile::Builder::Add(const SubRipItem& item) {
+  return Add(std::make_shared<SubRipItem>(item));
+}
+
+SubRipFile SubRipFile::Builder::Build() {
+  auto compare = [](const std::shared_ptr<SubRipItem>& a,
+                    const std::shared_ptr<SubRipItem>& b) { return *a < *b; };
+  if (!std::is_sorted(items_.begin(), items_.end(), compare)) {
+    std::stable_sort(items_.begin(), items_.end(), compare);
   }
+  SubRipFile file;
+  file.AssignSorted(std::move(items_));
+  items_ = {};
+  return file;
 }
 
 }  // namespace srt
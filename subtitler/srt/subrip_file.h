@@ -2,7 +2,6 @@
 #define SUBTITLER_SRT_SUBRIP_FILE_H
 
 #include <chrono>
-#include <functional>
 #include <memory>
 #include <sstream>
 #include <string_view>
@@ -10,6 +9,7 @@
 #include <vector>
 #include <filesystem>
 
+#include "subtitler/srt/cue_tree.h"
 #include "subtitler/srt/subrip_item.h"
 
 namespace subtitler {
@@ -18,10 +18,18 @@ namespace srt {
 // Internal representation of an SRT subtitle file.
 class SubRipFile {
  public:
+  class Builder;
+  // Identifies a SubRipItem for as long as it is in the file, unlike its
+  // sequence number, which changes as items are added and removed.
+  using CueId = CueTree::CueId;
+
   SubRipFile() = default;
 
-  // Loads internal state from a file.
-  // May throw exception on failure.
+  // Loads internal state from a file, decoding it to UTF-8 if needed.
+  // Neither reads nor writes the binary cache of the file, the editors load
+  // through LoadSubRipCached instead.
+  // May throw exception on failure. Malformed cues throw SubRipParseError,
+  // which reports the byte offset of the offending line.
   // If success, then all previous state is overwritten.
   // If fail, then prevous state is left untouched.
   void LoadState(const std::filesystem::path& file_name);
@@ -37,29 +45,102 @@ class SubRipFile {
   // Return the number of SubRipItems.
   std::size_t NumItems() const;
 
-  const std::vector<std::shared_ptr<SubRipItem>>& GetItems() const {
-    return items_;
+  // Returns a copy of all items in order. This is O(n), prefer GetItem()
+  // to access a single item.
+  std::vector<std::shared_ptr<SubRipItem>> GetItems() const;
+
+  // Calls visit(sequence_number, item) for every item, in order. O(n),
+  // without copying the items like GetItems().
+  template <typename Visit>
+  void ForEachItem(Visit&& visit) const {
+    items_.ForEach(
+        [&](std::size_t index, const std::shared_ptr<SubRipItem>& item) {
+          visit(index + 1, item);
+        });
+  }
+
+  // O(log n) lookups between sequence numbers, ids and items.
+  // Throw std::out_of_range if invalid sequence or id is provided.
+  const std::shared_ptr<SubRipItem>& GetItem(std::size_t sequence_number) const;
+  CueId GetId(std::size_t sequence_number) const;
+  std::size_t GetSequenceNumber(CueId id) const;
+  const std::shared_ptr<SubRipItem>& GetItemById(CueId id) const;
+
+  // True if an item with this id is in the file. O(1).
+  bool Contains(CueId id) const { return items_.Contains(id); }
+
+  // The SubRipItems which have a non-empty intersection with
+  // [start, start + duration], as a lazy range of (sequence number, item) in
+  // sorted order. O(log n) per item found and does not allocate. The range
+  // is invalidated by any change to the file.
+  //
+  // Sample Usage:
+  // for (const auto& [sequence_number, item] :
+  //      file.OverlappingItems(10s, 5s)) { ... }
+  CueTree::OverlapRange OverlappingItems(
+      std::chrono::milliseconds start,
+      std::chrono::milliseconds duration) const {
+    return items_.Overlapping(start, start + duration, 1);
+  }
+
+  // Calls on_find(sequence_number, item) for every item in
+  // OverlappingItems(start, duration), without type erasing on_find.
+  template <typename OnFind>
+  void ForEachOverlappingItem(std::chrono::milliseconds start,
+                              std::chrono::milliseconds duration,
+                              OnFind&& on_find) const {
+    for (const auto& [sequence_number, item] :
+         OverlappingItems(start, duration)) {
+      on_find(sequence_number, item);
+    }
   }
 
-  // Returns the SubRipItems which have start and ends intersecting with the
-  // given interval. SubRipItems are keyed by sequence number. Worst case this
-  // is a linear search.
+  // Same as OverlappingItems(), but collected into a map keyed by sequence
+  // number. Prefer OverlappingItems(), which does not allocate.
   std::unordered_map<std::size_t, const SubRipItem*> GetCollisions(
       std::chrono::milliseconds start,
       std::chrono::milliseconds duration) const;
 
   // Add a SubRipItem. Maintains sorted order by start time.
-  // Overlapping intervals are allowed.
-  void AddItem(const std::shared_ptr<SubRipItem>& item);
+  // Overlapping intervals are allowed. Items comparing equal keep the order
+  // in which they were added. This is O(log n), but prefer Builder when
+  // adding many items at once. Returns the id of the item.
+  CueId AddItem(const std::shared_ptr<SubRipItem>& item);
 
   // Makes a copy of the subripitem and adds it.
-  void AddItem(const SubRipItem& item);
+  CueId AddItem(const SubRipItem& item);
 
   // Remove the SubRipItem with sequence number and returns the removed one.
   // Throws std::out_of_range if invalid sequence is provided.
   // Note that indices start at 1, as per SRT file format spec.
   std::shared_ptr<SubRipItem> RemoveItem(std::size_t sequence_number);
 
+  // Same as above, by id.
+  std::shared_ptr<SubRipItem> RemoveItemById(CueId id);
+
+  // Adds back an item which was removed, under the id it had, e.g. to undo
+  // the removal. Throws std::invalid_argument if item is null, or if the id
+  // is in use or was never handed out by this file.
+  void RestoreItem(CueId id, const std::shared_ptr<SubRipItem>& item);
+
+  // Sets the timing of an item, moving it to keep the items sorted. Its id
+  // stays the same. Returns the new sequence number of the item.
+  // Throws std::out_of_range if invalid id is provided.
+  std::size_t RetimeItem(CueId id, std::chrono::milliseconds start,
+                         std::chrono::milliseconds duration);
+
+  // Bulk versions of GetId() and RetimeItem() for the count items starting
+  // at first_sequence, see CueTree::GetTimings() and CueTree::RetimeRange().
+  // RetimeItems() returns false if the items had to be reordered.
+  // Throws std::out_of_range if invalid sequence is provided.
+  void GetTimings(std::size_t first_sequence, std::size_t count,
+                  std::vector<CueId>& ids,
+                  std::vector<std::chrono::milliseconds>& starts,
+                  std::vector<std::chrono::milliseconds>& durations) const;
+  bool RetimeItems(std::size_t first_sequence,
+                   const std::vector<std::chrono::milliseconds>& starts,
+                   const std::vector<std::chrono::milliseconds>& durations);
+
   // Edits the positioning of an existing SubRipItem.
   // Reference SubRipItem::pos_to_id for valid positions.
   // Throws std::out_of_range if invalid sequence or position is provided.
@@ -73,14 +154,49 @@ class SubRipFile {
   // SubRipFile to be deleted when the subtitle still has a reference in an
   // open editor. Thus, we use reference counting to ensure that subtitles
   // always have valid lifetimes.
-  std::vector<std::shared_ptr<SubRipItem>> items_;
+  //
+  // The timings of items must not be modified while they are owned by this
+  // file, except through RetimeItem(), since the tree would then be out of
+  // order.
+  CueTree items_;
+
+  // Replaces all items with new_items, which must already be sorted.
+  void AssignSorted(std::vector<std::shared_ptr<SubRipItem>> new_items);
+};
+
+/**
+ * Builds a SubRipFile from many items at once. Items may be added in any
+ * order, and are sorted once in Build() rather than on every insertion.
+ * Already sorted input (e.g. a well formed SRT file) skips the sort.
+ *
+ * Sample Usage:
+ * SubRipFile::Builder builder;
+ * builder.Reserve(n);
+ * for (...) builder.Add(item);
+ * SubRipFile file = builder.Build();
+ */
+class SubRipFile::Builder {
+ public:
+  Builder() = default;
+
+  void Reserve(std::size_t num_items) { items_.reserve(num_items); }
+
+  // Throws std::invalid_argument if item is null.
+  Builder& Add(const std::shared_ptr<SubRipItem>& item);
+  // Same, but takes over item instead of sharing it, which saves updating
+  // the reference count when loading many items.
+  Builder& Add(std::shared_ptr<SubRipItem>&& item);
 
-  // Find all intervals with non-empty intersection with [start, start +
-  // duration] For each item found, call on_find(index_of_item, item).
-  void ForEachOverlappingItem(
-      std::chrono::milliseconds start, std::chrono::milliseconds duration,
-      std::function<void(std::size_t, const std::shared_ptr<SubRipItem>&)>
-          on_find) const;
+  // Makes a copy of the subripitem and adds it.
+  Builder& Add(const SubRipItem& item);
+
+  // Sorts the items with a stable sort, so items comparing equal keep the
+  // order in which they were added, same as SubRipFile::AddItem.
+  // The builder is left empty and may be reused.
+  SubRipFile Build();
+
+ private:
+  std::vector<std::shared_ptr<SubRipItem>> items_;
 };
 
 }  // namespace srt
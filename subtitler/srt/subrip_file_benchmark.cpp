@@ -0,0 +1,265 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/allocation_counter.h"
+#include "subtitler/util/duration_format.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+
+namespace {
+
+// Reports the heap allocations per iteration made since allocations_before.
+void SetAllocationsPerQuery(benchmark::State& state,
+                            std::size_t allocations_before) {
+  state.counters["allocs_per_query"] = benchmark::Counter(
+      static_cast<double>(subtitler::NumAllocations() - allocations_before),
+      benchmark::Counter::kAvgIterations);
+}
+
+// Builds a file resembling a transcription: back to back cues of 1-6s with
+// occasional overlaps, plus a few long cues (e.g. signs on screen) which
+// overlap many others.
+SubRipFile MakeFile(std::size_t num_items) {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<int> length_dist{1000, 6000};
+  std::uniform_int_distribution<int> gap_dist{-500, 1500};
+  SubRipFile file;
+  std::chrono::milliseconds start = 0ms;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    auto item = std::make_shared<SubRipItem>();
+    auto length = std::chrono::milliseconds{length_dist(rng)};
+    if (i % 1000 == 0) {
+      length = 10min;
+    }
+    item->start(start)->duration(length)->AppendLine("Hello world!");
+    file.AddItem(item);
+    start = std::max(0ms, start + std::chrono::milliseconds{length_dist(rng)} +
+                              std::chrono::milliseconds{gap_dist(rng)});
+  }
+  return file;
+}
+
+// The previous implementation of SubRipFile::ForEachOverlappingItem.
+std::size_t LinearScan(const std::vector<std::shared_ptr<SubRipItem>>& items,
+                       std::chrono::milliseconds start,
+                       std::chrono::milliseconds duration) {
+  std::size_t found = 0;
+  auto end = start + duration;
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    const auto& item = items[i];
+    if (item->start() > end) {
+      break;
+    }
+    if (start <= item->start() + item->duration() && item->start() <= end) {
+      ++found;
+    }
+  }
+  return found;
+}
+
+std::chrono::milliseconds EndTime(const SubRipFile& file) {
+  const auto& last = file.GetItem(file.NumItems());
+  return last->start() + last->duration();
+}
+
+void BM_LinearScan(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  auto items = file.GetItems();
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<long long> start_dist{0,
+                                                      EndTime(file).count()};
+  for (auto _ : state) {
+    std::chrono::milliseconds start{start_dist(rng)};
+    benchmark::DoNotOptimize(LinearScan(items, start, 5s));
+  }
+}
+
+void BM_IntervalIndex(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<long long> start_dist{0,
+                                                      EndTime(file).count()};
+  auto allocations_before = subtitler::NumAllocations();
+  for (auto _ : state) {
+    std::chrono::milliseconds start{start_dist(rng)};
+    benchmark::DoNotOptimize(file.GetCollisions(start, 5s));
+  }
+  SetAllocationsPerQuery(state, allocations_before);
+}
+
+void BM_OverlappingItems(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<long long> start_dist{0,
+                                                      EndTime(file).count()};
+  auto allocations_before = subtitler::NumAllocations();
+  for (auto _ : state) {
+    std::chrono::milliseconds start{start_dist(rng)};
+    std::size_t found = 0;
+    for (const auto& [sequence_number, item] :
+         file.OverlappingItems(start, 5s)) {
+      found += sequence_number;
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  SetAllocationsPerQuery(state, allocations_before);
+}
+
+void BM_ForEachOverlappingItem(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<long long> start_dist{0,
+                                                      EndTime(file).count()};
+  auto allocations_before = subtitler::NumAllocations();
+  for (auto _ : state) {
+    std::chrono::milliseconds start{start_dist(rng)};
+    std::size_t found = 0;
+    file.ForEachOverlappingItem(
+        start, 5s,
+        [&](std::size_t sequence_number, const std::shared_ptr<SubRipItem>&) {
+          found += sequence_number;
+        });
+    benchmark::DoNotOptimize(found);
+  }
+  SetAllocationsPerQuery(state, allocations_before);
+}
+
+// Cues in random order, e.g. intervals_ of the timeline editor.
+std::vector<std::shared_ptr<SubRipItem>> ShuffledItems(std::size_t num_items) {
+  auto items = MakeFile(num_items).GetItems();
+  std::shuffle(items.begin(), items.end(), std::mt19937{13});
+  return items;
+}
+
+void BM_AddItemShuffled(benchmark::State& state) {
+  auto items = ShuffledItems(state.range(0));
+  for (auto _ : state) {
+    SubRipFile file;
+    for (const auto& item : items) {
+      file.AddItem(item);
+    }
+    benchmark::DoNotOptimize(file.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_BuilderShuffled(benchmark::State& state) {
+  auto items = ShuffledItems(state.range(0));
+  for (auto _ : state) {
+    SubRipFile::Builder builder;
+    builder.Reserve(items.size());
+    for (const auto& item : items) {
+      builder.Add(item);
+    }
+    benchmark::DoNotOptimize(builder.Build().NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The previous implementation of SubRipFile::RemoveItem followed by AddItem,
+// on a sorted vector.
+void BM_LegacyRemoveReadd(benchmark::State& state) {
+  auto items = MakeFile(state.range(0)).GetItems();
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<std::size_t> index_dist{0, items.size() - 1};
+  for (auto _ : state) {
+    auto position = index_dist(rng);
+    auto item = items[position];
+    items.erase(items.begin() + position);
+    auto insert_here = std::upper_bound(
+        items.begin(), items.end(), item,
+        [](const auto& a, const auto& b) { return *a < *b; });
+    items.insert(insert_here, item);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_RemoveReadd(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<std::size_t> sequence_dist{1, file.NumItems()};
+  for (auto _ : state) {
+    file.AddItem(file.RemoveItem(sequence_dist(rng)));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_EditItemPosition(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<std::size_t> sequence_dist{1, file.NumItems()};
+  for (auto _ : state) {
+    file.EditItemPosition(sequence_dist(rng), "top-center");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The previous implementation of SubRipFile::ToStream: every item streamed
+// separately, with timestamps formatted through date::to_stream.
+void LegacyToStream(const SubRipFile& file, std::ostream& output) {
+  const auto& items = file.GetItems();
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    const auto& item = items[i];
+    output << i + 1 << '\n';
+    auto start = subtitler::FormatDuration(item->start());
+    auto end = subtitler::FormatDuration(item->start() + item->duration());
+    std::replace(start.begin(), start.end(), '.', ',');
+    std::replace(end.begin(), end.end(), '.', ',');
+    output << start << " --> " << end << '\n';
+    auto payload = item->GetPayload();
+    if (!payload.empty()) {
+      output << payload;
+    }
+    output << '\n';
+  }
+  output << std::flush;
+}
+
+void BM_LegacyToStream(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    std::ostringstream output;
+    LegacyToStream(file, output);
+    benchmark::DoNotOptimize(output.tellp());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ToStream(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    std::ostringstream output;
+    file.ToStream(output);
+    benchmark::DoNotOptimize(output.tellp());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_LegacyToStream)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_ToStream)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_AddItemShuffled)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+BENCHMARK(BM_BuilderShuffled)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+BENCHMARK(BM_LegacyRemoveReadd)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_RemoveReadd)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_EditItemPosition)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_LinearScan)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_IntervalIndex)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_OverlappingItems)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_ForEachOverlappingItem)
+    ->Arg(1'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
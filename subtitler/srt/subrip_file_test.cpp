@@ -6,7 +6,11 @@
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "subtitler/srt/subrip_item.h"
 #include "subtitler/util/temp_file.h"
@@ -16,6 +20,7 @@ namespace fs = std::filesystem;
 using namespace std::chrono_literals;
 using namespace subtitler;
 using namespace subtitler::srt;
+using ::testing::ElementsAre;
 using ::testing::UnorderedElementsAre;
 
 class SubRipFileTest : public ::testing::Test {
@@ -214,7 +219,9 @@ TEST_F(SubRipFileTest, FailureToLoadRetainsPreviousState) {
     file.LoadState(path_wrapper);
     FAIL() << "Expected std::runtime_error";
   } catch (const std::runtime_error& e) {
-    ASSERT_STREQ("Could not parse timestamp values: abc --> efg", e.what());
+    ASSERT_STREQ(
+        "Could not parse timestamp values: abc --> efg (byte offset 3)",
+        e.what());
   }
 
   std::ostringstream output;
@@ -240,3 +247,127 @@ TEST_F(SubRipFileTest, FailureToLoadRetainsPreviousState) {
       "\n",
       output.str());
 }
+
+TEST_F(SubRipFileTest, FindCollisionsAfterRemove) {
+  file.RemoveItem(1);
+  auto collisions = file.GetCollisions(7s + 500ms, 1s);
+  ASSERT_TRUE(collisions.empty());
+
+  collisions = file.GetCollisions(6s + 500ms, 1s);
+  ASSERT_EQ(1, collisions.size());
+  ASSERT_EQ("fourth\n", collisions.at(3)->GetPayload());
+}
+
+TEST_F(SubRipFileTest, OverlappingItemsInOrder) {
+  std::vector<std::size_t> sequence_numbers;
+  std::vector<std::string> payloads;
+  for (const auto& [sequence_number, item] :
+       file.OverlappingItems(5s + 500ms, 1s)) {
+    sequence_numbers.push_back(sequence_number);
+    payloads.push_back(item->GetPayload());
+  }
+  ASSERT_THAT(sequence_numbers, ElementsAre(1, 3, 4));
+  ASSERT_THAT(payloads, ElementsAre("first\n", "third\n", "fourth\n"));
+  ASSERT_TRUE(file.OverlappingItems(21s, 1s).empty());
+}
+
+TEST_F(SubRipFileTest, BuilderMatchesAddItem) {
+  SubRipFile::Builder builder;
+  // Add in reverse order so the builder has to sort.
+  const auto& items = file.GetItems();
+  for (auto it = items.rbegin(); it != items.rend(); ++it) {
+    builder.Add(**it);
+  }
+  auto built = builder.Build();
+
+  std::ostringstream expected, actual;
+  file.ToStream(expected);
+  built.ToStream(actual);
+  ASSERT_EQ(expected.str(), actual.str());
+
+  auto collisions = built.GetCollisions(6s + 500ms, 1s);
+  ASSERT_EQ(2, collisions.size());
+  ASSERT_EQ("fourth\n", collisions.at(4)->GetPayload());
+}
+
+TEST_F(SubRipFileTest, IdsSurviveRemoveAndRetime) {
+  auto first = file.GetId(1);
+  auto third = file.GetId(3);
+  auto fourth = file.GetId(4);
+  ASSERT_EQ("third\n", file.GetItem(3)->GetPayload());
+
+  auto removed = file.RemoveItemById(first);
+  ASSERT_EQ("first\n", removed->GetPayload());
+  ASSERT_EQ(2, file.GetSequenceNumber(third));
+  ASSERT_EQ(3, file.GetSequenceNumber(fourth));
+
+  // Moves "third" after "fourth".
+  ASSERT_EQ(3, file.RetimeItem(third, 10s, 1s));
+  ASSERT_EQ(2, file.GetSequenceNumber(fourth));
+  ASSERT_EQ(third, file.GetId(3));
+  ASSERT_EQ(10s, file.GetItem(3)->start());
+
+  auto collisions = file.GetCollisions(10s, 0s);
+  ASSERT_EQ(1, collisions.size());
+  ASSERT_EQ("third\n", collisions.at(3)->GetPayload());
+
+  ASSERT_THROW(file.GetSequenceNumber(first), std::out_of_range);
+  ASSERT_THROW(file.RemoveItemById(first), std::out_of_range);
+  ASSERT_THROW(file.GetItem(0), std::out_of_range);
+  ASSERT_THROW(file.GetId(4), std::out_of_range);
+}
+
+TEST(SubRipFileBuilderTest, EqualItemsKeepInsertionOrder) {
+  SubRipItem item;
+  SubRipFile::Builder builder;
+  SubRipFile added;
+  for (const auto* payload : {"c", "a", "b"}) {
+    item.start(1s)->duration(1s)->ClearPayload()->AppendLine(payload);
+    builder.Add(item);
+    added.AddItem(item);
+  }
+  item.start(0s)->duration(1s)->ClearPayload()->AppendLine("first");
+  builder.Add(item);
+  added.AddItem(item);
+
+  auto built = builder.Build();
+  ASSERT_EQ(4, built.NumItems());
+  for (const auto* file : {&built, &added}) {
+    const auto& items = file->GetItems();
+    ASSERT_EQ("first\n", items.at(0)->GetPayload());
+    ASSERT_EQ("c\n", items.at(1)->GetPayload());
+    ASSERT_EQ("a\n", items.at(2)->GetPayload());
+    ASSERT_EQ("b\n", items.at(3)->GetPayload());
+  }
+}
+
+TEST(SubRipFileBuilderTest, BuildEmptiesBuilder) {
+  SubRipItem item;
+  item.start(1s)->duration(1s)->AppendLine("hi");
+  SubRipFile::Builder builder;
+  builder.Add(item);
+  ASSERT_EQ(1, builder.Build().NumItems());
+  ASSERT_EQ(0, builder.Build().NumItems());
+}
+
+TEST(SubRipFileBuilderTest, RejectsNullItem) {
+  SubRipFile::Builder builder;
+  ASSERT_THROW(builder.Add(std::shared_ptr<SubRipItem>{}),
+               std::invalid_argument);
+  const std::shared_ptr<SubRipItem> null_item;
+  ASSERT_THROW(builder.Add(null_item), std::invalid_argument);
+}
+
+TEST(SubRipFileBuilderTest, TakesOverMovedItems) {
+  auto shared = std::make_shared<SubRipItem>();
+  auto moved = std::make_shared<SubRipItem>();
+  auto* moved_raw = moved.get();
+  SubRipFile::Builder builder;
+  builder.Add(shared);
+  builder.Add(std::move(moved));
+  ASSERT_EQ(2, shared.use_count());
+  ASSERT_EQ(nullptr, moved);
+  auto file = builder.Build();
+  ASSERT_EQ(moved_raw, file.GetItem(2).get());
+  ASSERT_EQ(1, file.GetItem(2).use_count());
+}
@@ -0,0 +1,180 @@
+#include "subtitler/srt/subrip_history.h"
+
+#include <algorithm>
+#include <bit>
+#include <map>
+
+namespace subtitler {
+namespace srt {
+
+SubRipHistory::SubRipHistory() : SubRipHistory(Limits{}) {}
+
+SubRipHistory::SubRipHistory(const Limits& limits)
+    : limits_{limits}, versions_(1) {}
+
+void SubRipHistory::Reset(const SubRipFile& file) {
+  working_ = SubRipSnapshot::Of(file);
+  versions_.assign(1, {working_, 0});
+  current_ = 0;
+  total_changed_ = 0;
+  recorded_.clear();
+  recorded_all_ = false;
+  ResetTimings(file);
+}
+
+void SubRipHistory::ResetTimings(const SubRipFile& file) {
+  timings_.clear();
+  timings_.reserve(file.NumItems());
+  if (file.NumItems() == 0) {
+    return;
+  }
+  std::vector<CueId> ids;
+  std::vector<std::chrono::milliseconds> starts;
+  std::vector<std::chrono::milliseconds> durations;
+  file.GetTimings(1, file.NumItems(), ids, starts, durations);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    timings_[ids[i]] = {starts[i], starts[i] + durations[i]};
+  }
+}
+
+void SubRipHistory::Record(CueId id, const SubRipItem* item) {
+  if (auto it = timings_.find(id); it != timings_.end()) {
+    working_ = working_.Erase(id, it->second.first, it->second.second);
+    timings_.erase(it);
+  }
+  if (item) {
+    working_ = working_.Insert(id, std::make_shared<const SubRipItem>(*item));
+    timings_[id] = {item->start(), item->start() + item->duration()};
+  }
+  recorded_.insert(id);
+}
+
+void SubRipHistory::Record(const SubRipFile& file,
+                           const std::vector<CueId>& ids) {
+  // Each Record() of a single cue copies O(log n) nodes.
+  auto log_n = static_cast<std::size_t>(std::bit_width(file.NumItems()));
+  if (ids.size() * log_n <= file.NumItems()) {
+    for (auto id : ids) {
+      Record(id, file.Contains(id) ? file.GetItemById(id).get() : nullptr);
+    }
+    return;
+  }
+  working_ = SubRipSnapshot::Of(file);
+  ResetTimings(file);
+  recorded_.insert(ids.begin(), ids.end());
+  recorded_all_ = true;
+}
+
+bool SubRipHistory::Commit() {
+  if (recorded_.empty()) {
+    return false;
+  }
+  auto num_changed = recorded_all_ ? std::max(recorded_.size(),
+                                              working_.NumItems())
+                                   : recorded_.size();
+  recorded_.clear();
+  recorded_all_ = false;
+
+  // Drops the steps which could be redone.
+  for (auto i = current_ + 1; i < versions_.size(); ++i) {
+    total_changed_ -= versions_[i].num_changed;
+  }
+  versions_.resize(current_ + 1);
+  versions_.push_back({working_, num_changed});
+  total_changed_ += num_changed;
+  ++current_;
+
+  while (versions_.size() > 2 &&
+         (versions_.size() - 1 > limits_.max_steps ||
+          total_changed_ > limits_.max_changed_cues)) {
+    // The second version becomes the oldest one, which has no step.
+    total_changed_ -= versions_[1].num_changed;
+    versions_[1].num_changed = 0;
+    versions_.pop_front();
+    --current_;
+  }
+  return true;
+}
+
+std::vector<SubRipHistory::Change> SubRipHistory::Undo() {
+  Commit();
+  if (current_ == 0) {
+    return {};
+  }
+  return MoveTo(current_ - 1);
+}
+
+std::vector<SubRipHistory::Change> SubRipHistory::Redo() {
+  Commit();
+  if (current_ + 1 >= versions_.size()) {
+    return {};
+  }
+  return MoveTo(current_ + 1);
+}
+
+std::vector<SubRipHistory::Change> SubRipHistory::MoveTo(
+    std::size_t version) {
+  std::map<CueId, Change> changes;
+  SubRipSnapshot::Diff(
+      versions_[current_].snapshot, versions_[version].snapshot,
+      [&](CueId id, const std::shared_ptr<const SubRipItem>& item) {
+        auto& change = changes[id];
+        change.id = id;
+        change.before = item;
+      },
+      [&](CueId id, const std::shared_ptr<const SubRipItem>& item) {
+        auto& change = changes[id];
+        change.id = id;
+        change.after = item;
+      });
+
+  current_ = version;
+  working_ = versions_[version].snapshot;
+  std::vector<Change> result;
+  result.reserve(changes.size());
+  for (auto& [id, change] : changes) {
+    if (change.after) {
+      timings_[id] = {change.after->start(),
+                      change.after->start() + change.after->duration()};
+    } else {
+      timings_.erase(id);
+    }
+    result.push_back(std::move(change));
+  }
+  return result;
+}
+
+std::vector<std::shared_ptr<SubRipItem>> ApplyChanges(
+    SubRipFile& file, const std::vector<SubRipHistory::Change>& changes) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  items.reserve(changes.size());
+  for (const auto& change : changes) {
+    if (!change.after) {
+      items.push_back(file.RemoveItemById(change.id));
+      continue;
+    }
+    if (!file.Contains(change.id)) {
+      auto item = std::make_shared<SubRipItem>(*change.after);
+      file.RestoreItem(change.id, item);
+      items.push_back(std::move(item));
+      continue;
+    }
+    auto item = file.GetItemById(change.id);
+    // The timing of an item of the file may only change through
+    // RetimeItem(), so the rest is copied first.
+    auto start = item->start();
+    auto duration = item->duration();
+    *item = *change.after;
+    item->start(start)->duration(duration);
+    if (start != change.after->start() ||
+        duration != change.after->duration()) {
+      file.RetimeItem(change.id, change.after->start(),
+                      change.after->duration());
+    }
+    items.push_back(std::move(item));
+  }
+  return items;
+}
+
+}  // namespace srt
+}  // namespace subtitler
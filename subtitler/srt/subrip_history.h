@@ -0,0 +1,140 @@
+#ifndef SUBTITLER_SRT_SUBRIP_HISTORY_H
+#define SUBTITLER_SRT_SUBRIP_HISTORY_H
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_snapshot.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Undo and redo of edits to a SubRipFile, kept as SubRipSnapshot versions
+ * which share most of their structure. A step costs memory in proportion to
+ * the cues it changed rather than to the size of the file, and undoing it
+ * only looks at those cues.
+ *
+ * Like with SubRipJournal, callers edit the file themselves and then record
+ * the cues they changed by id. Commit() makes everything recorded since the
+ * last commit one undo step, e.g:
+ *
+ * SubRipHistory history;
+ * history.Reset(file);
+ * auto id = file.AddItem(item);
+ * history.Record(id, item.get());
+ * history.Commit();
+ * ...
+ * ApplyChanges(file, history.Undo());
+ *
+ * Front ends which don't keep a SubRipFile apply the changes to their own
+ * state instead, using the ids they recorded.
+ */
+class SubRipHistory {
+ public:
+  using CueId = SubRipFile::CueId;
+
+  struct Limits {
+    // Oldest steps are dropped past either limit, but the most recent step
+    // is always kept.
+    std::size_t max_steps = 100;
+    // Total number of cues changed by the steps kept. Each step keeps a copy
+    // of every cue it changed, and O(log n) tree nodes for each.
+    std::size_t max_changed_cues = 1 << 20;
+  };
+
+  // A cue which differs between two versions. before is null if the cue was
+  // added, and after is null if it was removed.
+  struct Change {
+    CueId id;
+    std::shared_ptr<const SubRipItem> before;
+    std::shared_ptr<const SubRipItem> after;
+  };
+
+  SubRipHistory();
+  explicit SubRipHistory(const Limits& limits);
+
+  // Forgets all steps and starts over from the cues of file. O(n).
+  void Reset(const SubRipFile& file);
+
+  // Records the state of cue id after an edit, copying item. Pass null if
+  // the cue was removed. Only the state at Commit() matters, so a cue may be
+  // recorded several times per step. O(log n).
+  void Record(CueId id, const SubRipItem* item);
+
+  // Records the cues of file with the given ids, and those of ids which are
+  // not in file as removed. When ids are a large part of the file, copying
+  // all of it is faster, which is done instead, though that version then
+  // shares no memory with the others.
+  void Record(const SubRipFile& file, const std::vector<CueId>& ids);
+
+  // Makes the edits recorded since the last commit one undo step, and drops
+  // the steps which could be redone. Returns false if nothing was recorded.
+  bool Commit();
+
+  std::size_t NumUndoSteps() const { return current_; }
+  std::size_t NumRedoSteps() const { return versions_.size() - 1 - current_; }
+
+  // Commits any recorded edits, then moves back one step. Returns the
+  // changes which get from the current version to the previous one, sorted
+  // by id, or nothing if there are no steps to undo.
+  std::vector<Change> Undo();
+
+  // Commits any recorded edits, which drops the steps which could be
+  // redone, then moves forward one step. Returns the changes like Undo().
+  std::vector<Change> Redo();
+
+  // The last committed version. Copying it is O(1), and the copy can be
+  // read on other threads while editing goes on, e.g. to autosave.
+  const SubRipSnapshot& snapshot() const {
+    return versions_[current_].snapshot;
+  }
+
+ private:
+  struct Version {
+    SubRipSnapshot snapshot;
+    // Number of cues changed from the previous version.
+    std::size_t num_changed = 0;
+  };
+
+  Limits limits_;
+  std::deque<Version> versions_;
+  std::size_t current_ = 0;
+  std::size_t total_changed_ = 0;
+
+  // The version edits are recorded into, and the start and end of its cues,
+  // to find them by id.
+  SubRipSnapshot working_;
+  std::unordered_map<CueId,
+                     std::pair<std::chrono::milliseconds,
+                               std::chrono::milliseconds>>
+      timings_;
+  std::unordered_set<CueId> recorded_;
+  bool recorded_all_ = false;
+
+  void ResetTimings(const SubRipFile& file);
+  std::vector<Change> MoveTo(std::size_t version);
+};
+
+// Applies changes returned by SubRipHistory::Undo() or Redo() to file.
+// Added cues are restored under their ids, and changed ones are updated in
+// place, so the file keeps the same SubRipItem objects. Returns the item of
+// each change in the file, in the same order, which for a removed cue is the
+// item that was removed.
+// Throws std::out_of_range or std::invalid_argument if the changes don't
+// apply to file.
+std::vector<std::shared_ptr<SubRipItem>> ApplyChanges(
+    SubRipFile& file, const std::vector<SubRipHistory::Change>& changes);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_history.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_snapshot.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::ApplyChanges;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipHistory;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubRipSnapshot;
+
+namespace {
+
+SubRipFile MakeFile(std::size_t num_items) {
+  SubRipFile::Builder builder;
+  builder.Reserve(num_items);
+  for (std::size_t i = 0; i < num_items; ++i) {
+    auto item = std::make_shared<SubRipItem>();
+    item->start(std::chrono::seconds{i})->duration(1s)->AppendLine(
+        "Hello world!");
+    builder.Add(item);
+  }
+  return builder.Build();
+}
+
+// Edits one cue and commits a step, as an editor does per user action.
+// Undo keeps the file the same across iterations, and is timed too.
+void BM_CommitAndUndo(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  SubRipHistory history;
+  history.Reset(file);
+  std::mt19937 rng{42};
+  for (auto _ : state) {
+    auto id = file.GetId(1 + rng() % file.NumItems());
+    file.RetimeItem(id, file.GetItemById(id)->start() + 500ms, 1s);
+    history.Record(id, file.GetItemById(id).get());
+    history.Commit();
+    ApplyChanges(file, history.Undo());
+  }
+}
+
+// Keeping a full copy of the file per step instead.
+void BM_CopyFile(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    SubRipFile copy = file;
+    benchmark::DoNotOptimize(copy.NumItems());
+  }
+}
+
+void BM_SnapshotOfFile(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    auto snapshot = SubRipSnapshot::Of(file);
+    benchmark::DoNotOptimize(snapshot.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_CommitAndUndo)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_CopyFile)->Arg(10'000)->Arg(1'000'000)->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_SnapshotOfFile)
+    ->Arg(10'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond);
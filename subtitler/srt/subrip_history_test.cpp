@@ -0,0 +1,256 @@
+#include "subtitler/srt/subrip_history.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_retime.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+
+SubRipItem MakeItem(std::chrono::milliseconds start,
+                    std::chrono::milliseconds duration,
+                    const std::string& text) {
+  SubRipItem item;
+  item.start(start)->duration(duration)->AppendLine(text);
+  return item;
+}
+
+std::string ToString(const SubRipFile& file) {
+  std::ostringstream output;
+  file.ToStream(output);
+  return output.str();
+}
+
+std::string ToString(const SubRipSnapshot& snapshot) {
+  std::ostringstream output;
+  snapshot.ToStream(output);
+  return output.str();
+}
+
+// Contents of the file by id, which unlike the sequence numbers don't
+// depend on how ties are ordered.
+using Contents = std::map<SubRipFile::CueId, std::string>;
+
+Contents GetContents(const SubRipFile& file) {
+  Contents contents;
+  file.ForEachItem(
+      [&](std::size_t sequence_number, const std::shared_ptr<SubRipItem>& item) {
+        std::ostringstream output;
+        item->ToStream(0, output, /* flush= */ false);
+        contents[file.GetId(sequence_number)] = output.str();
+      });
+  return contents;
+}
+
+std::vector<SubRipFile::CueId> Ids(
+    const std::vector<SubRipHistory::Change>& changes) {
+  std::vector<SubRipFile::CueId> ids;
+  for (const auto& change : changes) {
+    ids.push_back(change.id);
+  }
+  return ids;
+}
+
+}  // namespace
+
+class SubRipHistoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < 5; ++i) {
+      ids_.push_back(file_.AddItem(
+          MakeItem(std::chrono::seconds{i * 10}, 2s, std::to_string(i))));
+    }
+    history_.Reset(file_);
+  }
+
+  SubRipFile file_;
+  SubRipHistory history_;
+  std::vector<SubRipFile::CueId> ids_;
+};
+
+TEST_F(SubRipHistoryTest, NothingToUndo) {
+  EXPECT_EQ(history_.NumUndoSteps(), 0);
+  EXPECT_EQ(history_.NumRedoSteps(), 0);
+  EXPECT_FALSE(history_.Commit());
+  EXPECT_THAT(history_.Undo(), IsEmpty());
+  EXPECT_THAT(history_.Redo(), IsEmpty());
+  EXPECT_EQ(ToString(history_.snapshot()), ToString(file_));
+}
+
+TEST_F(SubRipHistoryTest, UndoAndRedoEachKindOfEdit) {
+  const auto original = ToString(file_);
+
+  auto added = file_.AddItem(MakeItem(15s, 1s, "added"));
+  history_.Record(added, file_.GetItemById(added).get());
+  history_.Commit();
+  const auto after_add = ToString(file_);
+
+  auto removed = file_.RemoveItemById(ids_[0]);
+  history_.Record(ids_[0], nullptr);
+  history_.Commit();
+  const auto after_remove = ToString(file_);
+
+  file_.RetimeItem(ids_[4], 1s, 1s);
+  file_.EditItemPosition(file_.GetSequenceNumber(ids_[4]), "top-left");
+  history_.Record(ids_[4], file_.GetItemById(ids_[4]).get());
+  history_.Commit();
+  const auto after_edit = ToString(file_);
+  EXPECT_EQ(ToString(history_.snapshot()), after_edit);
+  EXPECT_EQ(history_.NumUndoSteps(), 3);
+
+  auto item = file_.GetItemById(ids_[4]);
+  auto changes = history_.Undo();
+  ASSERT_EQ(changes.size(), 1);
+  EXPECT_EQ(changes[0].id, ids_[4]);
+  EXPECT_EQ(changes[0].before->start(), 1s);
+  EXPECT_EQ(changes[0].after->start(), 40s);
+  auto items = ApplyChanges(file_, changes);
+  // Changed items are updated in place.
+  EXPECT_EQ(items[0], item);
+  EXPECT_EQ(ToString(file_), after_remove);
+  EXPECT_EQ(ToString(history_.snapshot()), after_remove);
+
+  // The removed cue comes back under its old id.
+  changes = history_.Undo();
+  EXPECT_THAT(Ids(changes), ElementsAre(ids_[0]));
+  EXPECT_EQ(changes[0].before, nullptr);
+  ApplyChanges(file_, changes);
+  EXPECT_EQ(ToString(file_), after_add);
+  EXPECT_EQ(file_.GetSequenceNumber(ids_[0]), 1);
+
+  changes = history_.Undo();
+  EXPECT_THAT(Ids(changes), ElementsAre(added));
+  items = ApplyChanges(file_, changes);
+  EXPECT_EQ(items[0]->payload(), "added\n");
+  EXPECT_EQ(ToString(file_), original);
+  EXPECT_THAT(history_.Undo(), IsEmpty());
+  EXPECT_EQ(history_.NumRedoSteps(), 3);
+
+  for (const auto& expected : {after_add, after_remove, after_edit}) {
+    ApplyChanges(file_, history_.Redo());
+    EXPECT_EQ(ToString(file_), expected);
+  }
+  EXPECT_THAT(history_.Redo(), IsEmpty());
+}
+
+TEST_F(SubRipHistoryTest, NewEditDropsRedo) {
+  file_.RemoveItemById(ids_[1]);
+  history_.Record(ids_[1], nullptr);
+  history_.Commit();
+  ApplyChanges(file_, history_.Undo());
+  ASSERT_EQ(history_.NumRedoSteps(), 1);
+
+  file_.GetItemById(ids_[2])->AppendLine("more");
+  history_.Record(ids_[2], file_.GetItemById(ids_[2]).get());
+  // Undo commits the recorded edit first, then undoes it.
+  EXPECT_THAT(Ids(history_.Undo()), ElementsAre(ids_[2]));
+  EXPECT_EQ(history_.NumUndoSteps(), 0);
+  EXPECT_EQ(history_.NumRedoSteps(), 1);
+}
+
+TEST_F(SubRipHistoryTest, RecordsBulkEdits) {
+  const auto original = GetContents(file_);
+  auto edit = RetimeAll(file_, TimeMap::Shift(1s));
+  history_.Record(file_, edit.ids());
+  history_.Commit();
+  const auto retimed = GetContents(file_);
+
+  ApplyChanges(file_, history_.Undo());
+  EXPECT_EQ(GetContents(file_), original);
+  ApplyChanges(file_, history_.Redo());
+  EXPECT_EQ(GetContents(file_), retimed);
+}
+
+TEST(SubRipHistoryLimitsTest, DropsOldestSteps) {
+  SubRipFile file;
+  auto id = file.AddItem(MakeItem(0s, 1s, "text"));
+  SubRipHistory history{{.max_steps = 3, .max_changed_cues = 100}};
+  history.Reset(file);
+  for (int i = 0; i < 10; ++i) {
+    file.GetItemById(id)->AppendLine(std::to_string(i));
+    history.Record(id, file.GetItemById(id).get());
+    history.Commit();
+  }
+  EXPECT_EQ(history.NumUndoSteps(), 3);
+
+  SubRipHistory small{{.max_steps = 100, .max_changed_cues = 2}};
+  small.Reset(file);
+  for (int i = 0; i < 3; ++i) {
+    file.AddItem(MakeItem(std::chrono::seconds{i}, 1s, "text"));
+  }
+  // The most recent step is kept even if it is over the limit.
+  small.Record(file, {2, 3, 4});
+  small.Commit();
+  EXPECT_EQ(small.NumUndoSteps(), 1);
+  small.Record(2, nullptr);
+  small.Commit();
+  EXPECT_EQ(small.NumUndoSteps(), 1);
+}
+
+TEST(SubRipHistoryRandomTest, MatchesFileAtEveryStep) {
+  std::mt19937 rng{7};
+  std::uniform_int_distribution<int> time_dist{0, 10'000'000};
+  SubRipFile file;
+  for (int i = 0; i < 300; ++i) {
+    file.AddItem(MakeItem(std::chrono::milliseconds{time_dist(rng)}, 1s,
+                          std::to_string(i)));
+  }
+  SubRipHistory history{{.max_steps = 1000}};
+  history.Reset(file);
+  std::vector<Contents> versions{GetContents(file)};
+
+  for (int step = 0; step < 200; ++step) {
+    // A few edits per step.
+    for (int edit = 0; edit < 3; ++edit) {
+      auto sequence_number = 1 + rng() % file.NumItems();
+      auto id = file.GetId(sequence_number);
+      switch (rng() % 4) {
+        case 0: {
+          auto added = file.AddItem(
+              MakeItem(std::chrono::milliseconds{time_dist(rng)}, 1s, "new"));
+          history.Record(added, file.GetItemById(added).get());
+          break;
+        }
+        case 1:
+          file.RemoveItemById(id);
+          history.Record(id, nullptr);
+          break;
+        case 2:
+          file.RetimeItem(id, std::chrono::milliseconds{time_dist(rng)}, 2s);
+          history.Record(id, file.GetItemById(id).get());
+          break;
+        default:
+          file.GetItemById(id)->AppendLine("edit");
+          history.Record(id, file.GetItemById(id).get());
+          break;
+      }
+    }
+    history.Commit();
+    versions.push_back(GetContents(file));
+  }
+
+  for (auto i = versions.size() - 1; i > 0; --i) {
+    ApplyChanges(file, history.Undo());
+    ASSERT_EQ(GetContents(file), versions[i - 1]) << i;
+  }
+  for (std::size_t i = 1; i < versions.size(); ++i) {
+    ApplyChanges(file, history.Redo());
+    ASSERT_EQ(GetContents(file), versions[i]) << i;
+    ASSERT_EQ(ToString(history.snapshot()), ToString(file));
+  }
+}
@@ -1,10 +1,15 @@
 #include "subtitler/srt/subrip_item.h"
 
 #include <array>
+#include <charconv>
+#include <optional>
 #include <regex>
+#include <sstream>
 #include <string>
 #include <tuple>
+#include <utility>
 
+#include "subtitler/srt/subrip_text_pool.h"
 #include "subtitler/util/duration_format.h"
 
 namespace subtitler {
@@ -99,54 +104,98 @@ SubRipItem::SubRipItem(const std::string& payload) {
     if (num_lines_ == 0) {
       // First line, may contain position token.
       // Line may be modified.
-      ass_pos_id_ = ExtractPosIdIfExists(line);
+      if (auto pos_id = ExtractPosIdIfExists(line)) {
+        ass_pos_id_ = static_cast<std::int8_t>(*pos_id);
+      }
     }
     AppendLine(line);
   }
 }
 
-SubRipItem::SubRipItem(const SubRipItem& other) {
+SubRipItem::SubRipItem(const SubRipItem& other) { *this = other; }
+
+SubRipItem::SubRipItem(SubRipItem&& other) noexcept {
+  *this = std::move(other);
+}
+
+SubRipItem& SubRipItem::operator=(const SubRipItem& other) {
+  if (this == &other) {
+    return *this;
+  }
   start_ = other.start_;
   duration_ = other.duration_;
-  ass_pos_id_ = other.ass_pos_id_;
-  payload_ << other.payload_.str();
   num_lines_ = other.num_lines_;
+  ass_pos_id_ = other.ass_pos_id_;
+  if (other.payload_interned_) {
+    SetInternedPayload(other.interned_payload_);
+  } else {
+    OwnPayload() = other.payload_;
+  }
+  return *this;
 }
 
-SubRipItem& SubRipItem::operator=(const SubRipItem& other) {
+SubRipItem& SubRipItem::operator=(SubRipItem&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
   start_ = other.start_;
   duration_ = other.duration_;
-  ass_pos_id_ = other.ass_pos_id_;
-  // Move new one
-  payload_ = std::ostringstream{};
-  payload_ << other.payload_.str();
   num_lines_ = other.num_lines_;
+  ass_pos_id_ = other.ass_pos_id_;
+  if (other.payload_interned_) {
+    SetInternedPayload(std::move(other.interned_payload_));
+    // Leave other with an empty owned payload rather than a null pointer.
+    other.OwnPayload();
+  } else {
+    OwnPayload() = std::move(other.payload_);
+  }
   return *this;
 }
 
+SubRipItem::~SubRipItem() {
+  if (payload_interned_) {
+    interned_payload_.~InternedText();
+  } else {
+    payload_.~basic_string();
+  }
+}
+
 void SubRipItem::ToStream(std::size_t sequence_number, std::ostream& output,
                           bool flush) const {
+  std::string buffer;
+  buffer.reserve(payload().size() + 64);
+  AppendTo(sequence_number, buffer);
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  if (flush) {
+    output << std::flush;
+  }
+}
+
+void SubRipItem::AppendTo(std::size_t sequence_number,
+                          std::string& output) const {
   // Refer to https://docs.fileformat.com/video/srt/
   // Line 1: the subtitle sequence id.
-  output << sequence_number << '\n';
+  char digits[24];
+  auto result = std::to_chars(digits, digits + sizeof(digits), sequence_number);
+  output.append(digits, result.ptr);
+  output += '\n';
 
   // Line 2: The timestamp.
-  output << ToSubRipDuration(start_);
-  output << " --> ";
-  output << ToSubRipDuration(start_ + duration_) << '\n';
+  AppendSubRipDuration(start_, output);
+  output += " --> ";
+  AppendSubRipDuration(start_ + duration_, output);
+  output += '\n';
 
   // TODO: extended SRT format for specifying location of subtitle
 
   // Line 3 and onwards: Subtitle lines and styling.
-  auto payload = payload_.str();
-  if (!payload.empty()) {
-    if (ass_pos_id_) {
-      output << "{\\an" << *ass_pos_id_ << "}";
+  if (auto text = payload(); !text.empty()) {
+    if (ass_pos_id_ != kNoPosition) {
+      output += "{\\an";
+      output += static_cast<char>('0' + ass_pos_id_);
+      output += '}';
     }
-    output << payload;
-  }
-  if (flush) {
-    output << std::flush;
+    output += text;
   }
 }
 
@@ -157,20 +206,68 @@ bool SubRipItem::operator<(const SubRipItem& other) const {
   return duration_ < other.duration_;
 }
 
-SubRipItem* SubRipItem::AppendLine(const std::string& payload) {
-  payload_ << payload;
+SubRipItem* SubRipItem::AppendLine(std::string_view payload) {
+  auto& text = MutablePayload();
+  text.append(payload);
   if (!payload.empty() && payload.back() != '\n') {
-    payload_ << '\n';
+    text += '\n';
   }
   ++num_lines_;
   return this;
 }
 
+SubRipItem* SubRipItem::ReservePayload(std::size_t size) {
+  MutablePayload().reserve(size);
+  return this;
+}
+
 SubRipItem* SubRipItem::ClearPayload() {
-  payload_ = std::ostringstream{};
+  // Drops the reference to an interned payload rather than copying it.
+  OwnPayload().clear();
   num_lines_ = 0;
   return this;
 }
 
+SubRipItem* SubRipItem::InternPayload() {
+  if (!payload_interned_ && payload_.size() > std::string{}.capacity()) {
+    SetInternedPayload(SubRipTextPool::Global().Intern(std::move(payload_)));
+  }
+  return this;
+}
+
+bool SubRipItem::SamePayload(const SubRipItem& other) const {
+  if (payload_interned_ && other.payload_interned_) {
+    return interned_payload_ == other.interned_payload_;
+  }
+  return payload() == other.payload();
+}
+
+std::string& SubRipItem::OwnPayload() {
+  if (payload_interned_) {
+    interned_payload_.~InternedText();
+    new (&payload_) std::string;
+    payload_interned_ = false;
+  }
+  return payload_;
+}
+
+std::string& SubRipItem::MutablePayload() {
+  if (payload_interned_) {
+    // Copy on write, other items keep the interned text.
+    auto interned = std::move(interned_payload_);
+    OwnPayload() = *interned;
+  }
+  return payload_;
+}
+
+void SubRipItem::SetInternedPayload(InternedText interned) {
+  if (!payload_interned_) {
+    payload_.~basic_string();
+    new (&interned_payload_) InternedText;
+    payload_interned_ = true;
+  }
+  interned_payload_ = std::move(interned);
+}
+
 }  // namespace srt
 }  // namespace subtitler
@@ -2,8 +2,12 @@
 #define SUBTITLER_SRT_SUBRIP_ITEM_H
 
 #include <chrono>
-#include <optional>
-#include <sstream>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -11,12 +15,18 @@ namespace subtitler {
 namespace srt {
 
 // Internal representation of a SRT subtitle item.
+// The payload is kept in a single string, so short cues fit in the small
+// string buffer and copies are a plain string copy. Longer payloads can be
+// interned instead, see InternPayload().
 class SubRipItem {
  public:
-  SubRipItem() = default;
+  SubRipItem() {}
   explicit SubRipItem(const std::string& payload);
   SubRipItem(const SubRipItem& other);
+  SubRipItem(SubRipItem&& other) noexcept;
   SubRipItem& operator=(const SubRipItem& other);
+  SubRipItem& operator=(SubRipItem&& other) noexcept;
+  ~SubRipItem();
   // Sort by start and then by duration.
   bool operator<(const SubRipItem& other) const;
 
@@ -28,6 +38,10 @@ class SubRipItem {
   void ToStream(std::size_t sequence_number, std::ostream& output,
                 bool flush = true) const;
 
+  // Appends the same text as ToStream to output, without any temporary
+  // strings. Used to serialize many items into a single buffer.
+  void AppendTo(std::size_t sequence_number, std::string& output) const;
+
   std::chrono::milliseconds start() const { return start_; }
 
   SubRipItem* start(std::chrono::milliseconds start) {
@@ -42,20 +56,63 @@ class SubRipItem {
     return this;
   }
 
-  SubRipItem* AppendLine(const std::string& payload);
-  std::string GetPayload() const { return payload_.str(); }
+  SubRipItem* AppendLine(std::string_view payload);
+  // Makes room for a payload of size bytes, so that appending lines up to
+  // that size doesn't reallocate.
+  SubRipItem* ReservePayload(std::size_t size);
+  // Returns a copy of the payload, prefer payload() to avoid the copy.
+  std::string GetPayload() const { return std::string{payload()}; }
+  // View of the payload, valid until the item is modified or destroyed.
+  std::string_view payload() const {
+    if (payload_interned_) {
+      return *interned_payload_;
+    }
+    return payload_;
+  }
   SubRipItem* ClearPayload();
 
+  // Shares the payload with every other interned item with the same text,
+  // through SubRipTextPool::Global(). Editing the payload afterwards copies
+  // it first. Payloads which fit in the small string buffer are left as is,
+  // sharing them wouldn't save any memory.
+  SubRipItem* InternPayload();
+  bool payload_interned() const { return payload_interned_; }
+  // Same as payload() == other.payload(), in constant time if both are
+  // interned since the pool holds a single copy of each text.
+  bool SamePayload(const SubRipItem& other) const;
+
   int substation_alpha_position() const {
-    if (ass_pos_id_) {
-      return *ass_pos_id_;
+    if (ass_pos_id_ != kNoPosition) {
+      return ass_pos_id_;
     }
     return pos_to_id.at("bottom-center");
   }
 
+  // Compares the positions as set, so a cue without a position differs from
+  // one explicitly placed at bottom-center.
+  bool SamePosition(const SubRipItem& other) const {
+    return ass_pos_id_ == other.ass_pos_id_;
+  }
+
+  // Copies the position of other as set, including having none.
+  SubRipItem* CopyPosition(const SubRipItem& other) {
+    ass_pos_id_ = other.ass_pos_id_;
+    return this;
+  }
+
   // Throws out_of_range if invalid position provided.
   SubRipItem* position(const std::string& position_id) {
-    ass_pos_id_ = pos_to_id.at(position_id);
+    ass_pos_id_ = static_cast<std::int8_t>(pos_to_id.at(position_id));
+    return this;
+  }
+
+  // Sets the substation alpha id directly, e.g. from a parsed {\anX} tag.
+  // Throws out_of_range if pos_id is not between [1, 9].
+  SubRipItem* substation_alpha_position(int pos_id) {
+    if (pos_id < 1 || pos_id > 9) {
+      throw std::out_of_range{"Position id must be between [1, 9]"};
+    }
+    ass_pos_id_ = static_cast<std::int8_t>(pos_id);
     return this;
   }
 
@@ -76,13 +133,33 @@ class SubRipItem {
       {"bottom-right", 3},  {"br", 3}};
 
  private:
-  std::chrono::milliseconds start_;
-  std::chrono::milliseconds duration_;
-  std::optional<int> ass_pos_id_;
-  std::ostringstream payload_;
+  // Value of ass_pos_id_ when no position was set.
+  static constexpr std::int8_t kNoPosition = 0;
+
+  using InternedText = std::shared_ptr<const std::string>;
+
+  // Switches to an empty payload owned by the item if it was interned.
+  std::string& OwnPayload();
+  // Same, but copies the interned payload, so it can be modified.
+  std::string& MutablePayload();
+  void SetInternedPayload(InternedText interned);
+
+  std::chrono::milliseconds start_{};
+  std::chrono::milliseconds duration_{};
+  // A union rather than std::variant, whose tag would not fit in the padding
+  // after ass_pos_id_.
+  union {
+    std::string payload_{};
+    InternedText interned_payload_;
+  };
   int num_lines_ = 0;
+  std::int8_t ass_pos_id_ = kNoPosition;
+  bool payload_interned_ = false;
 
   friend class SubRipFile;
+  friend class SubRipTable;
+  friend class SubRipJournal;
+  friend class SubRipCache;
 };
 
 }  // namespace srt
@@ -4,7 +4,9 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 
 using namespace std::chrono_literals;
 using namespace subtitler;
@@ -63,6 +65,20 @@ TEST(SubRipItemTest, GetPosition) {
   ASSERT_EQ(item.substation_alpha_position(), item.pos_to_id.at("bl"));
 }
 
+TEST(SubRipItemTest, SamePositionTellsUnsetFromBottomCenter) {
+  SubRipItem unset;
+  SubRipItem bottom_center;
+  bottom_center.position("bc");
+
+  ASSERT_EQ(unset.substation_alpha_position(),
+            bottom_center.substation_alpha_position());
+  ASSERT_FALSE(unset.SamePosition(bottom_center));
+  ASSERT_TRUE(unset.SamePosition(SubRipItem{}));
+
+  unset.position("bottom-center");
+  ASSERT_TRUE(unset.SamePosition(bottom_center));
+}
+
 TEST(SubRipItemTest, SetPosition) {
   SubRipItem item;
   item.start(1s + 123ms)->duration(5s)->AppendLine("Hello World!");
@@ -273,3 +289,122 @@ TEST(SubRipItemTest, ConstructFromString_UsingLegacyPositionTagThrowsError) {
                  e.what());
   }
 }
+
+TEST(SubRipItemTest, PayloadViewMatchesCopy) {
+  SubRipItem item;
+  item.start(1s)->duration(1s)->AppendLine("Hello")->AppendLine("World");
+  ASSERT_EQ("Hello\nWorld\n", item.payload());
+  ASSERT_EQ(item.GetPayload(), item.payload());
+
+  item.ClearPayload();
+  ASSERT_TRUE(item.payload().empty());
+  ASSERT_EQ(0, item.num_lines());
+}
+
+TEST(SubRipItemTest, CopiesAreIndependent) {
+  SubRipItem item;
+  item.start(1s)->duration(1s)->position("top-left")->AppendLine("Hello");
+
+  SubRipItem copy{item};
+  copy.AppendLine("World");
+  ASSERT_EQ("Hello\n", item.payload());
+  ASSERT_EQ("Hello\nWorld\n", copy.payload());
+  ASSERT_EQ(2, copy.num_lines());
+  ASSERT_EQ(7, copy.substation_alpha_position());
+
+  copy = item;
+  ASSERT_EQ("Hello\n", copy.payload());
+  ASSERT_EQ(1, copy.num_lines());
+}
+
+TEST(SubRipItemTest, IsCompact) {
+  // Timings, the payload string and a few bytes of metadata.
+  ASSERT_LE(sizeof(SubRipItem), 2 * sizeof(std::chrono::milliseconds) +
+                                    sizeof(std::string) + 8);
+}
+
+TEST(SubRipItemTest, AppendToMatchesToStream) {
+  SubRipItem item;
+  item.start(1h + 2min + 3s + 4ms)
+      ->duration(1s)
+      ->position("middle-right")
+      ->AppendLine("Hello")
+      ->AppendLine("World");
+
+  std::ostringstream stream;
+  item.ToStream(1234, stream);
+  std::string buffer = "previous\n";
+  item.AppendTo(1234, buffer);
+
+  ASSERT_EQ(
+      "previous\n"
+      "1234\n"
+      "01:02:03,004 --> 01:02:04,004\n"
+      "{\\an6}Hello\n"
+      "World\n",
+      buffer);
+  ASSERT_EQ(buffer.substr(9), stream.str());
+}
+
+TEST(SubRipItemTest, InternsLongPayloads) {
+  SubRipItem a;
+  a.AppendLine("[MAN SPEAKING IN SPANISH]")->InternPayload();
+  SubRipItem b;
+  b.AppendLine("[MAN SPEAKING IN SPANISH]")->InternPayload();
+  ASSERT_TRUE(a.payload_interned());
+  ASSERT_EQ(a.payload().data(), b.payload().data());
+  ASSERT_TRUE(a.SamePayload(b));
+  ASSERT_EQ(1, b.num_lines());
+
+  // Too short to be worth sharing.
+  SubRipItem music;
+  music.AppendLine("[Music]")->InternPayload();
+  ASSERT_FALSE(music.payload_interned());
+  ASSERT_FALSE(music.SamePayload(a));
+
+  SubRipItem copy{a};
+  ASSERT_EQ(a.payload().data(), copy.payload().data());
+  SubRipItem moved{std::move(copy)};
+  ASSERT_EQ(a.payload().data(), moved.payload().data());
+  music = moved;
+  ASSERT_TRUE(music.payload_interned());
+  ASSERT_EQ("[MAN SPEAKING IN SPANISH]\n", music.payload());
+}
+
+TEST(SubRipItemTest, CopiesInternedPayloadOnWrite) {
+  SubRipItem a;
+  a.AppendLine("[WOMAN SPEAKING IN FRENCH]")->InternPayload();
+  SubRipItem b{a};
+
+  b.AppendLine("Bonjour");
+  ASSERT_FALSE(b.payload_interned());
+  ASSERT_EQ("[WOMAN SPEAKING IN FRENCH]\nBonjour\n", b.payload());
+  ASSERT_EQ("[WOMAN SPEAKING IN FRENCH]\n", a.payload());
+  ASSERT_FALSE(a.SamePayload(b));
+
+  b.ClearPayload()->AppendLine("[WOMAN SPEAKING IN FRENCH]");
+  ASSERT_TRUE(a.SamePayload(b));
+  b.InternPayload();
+  ASSERT_EQ(a.payload().data(), b.payload().data());
+  ASSERT_EQ(1, b.num_lines());
+}
+
+TEST(SubRipItemTest, MovedFromInternedItemIsUsable) {
+  SubRipItem a;
+  a.AppendLine("[CROWD CHEERING IN THE DISTANCE]")->InternPayload();
+  SubRipItem b{std::move(a)};
+  ASSERT_TRUE(b.payload_interned());
+  ASSERT_EQ("[CROWD CHEERING IN THE DISTANCE]\n", b.payload());
+
+  ASSERT_FALSE(a.payload_interned());
+  ASSERT_EQ("", a.payload());
+  ASSERT_EQ("", a.GetPayload());
+  a.AppendLine("Hello");
+  ASSERT_EQ("Hello\n", a.payload());
+
+  SubRipItem c;
+  c = std::move(b);
+  ASSERT_EQ("[CROWD CHEERING IN THE DISTANCE]\n", c.payload());
+  ASSERT_FALSE(b.payload_interned());
+  ASSERT_EQ("", b.payload());
+}
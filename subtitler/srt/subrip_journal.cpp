@@ -0,0 +1,542 @@
+#include "subtitler/srt/subrip_journal.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/memory_mapped_file.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+constexpr std::string_view kHeader = "subtitler-journal 1";
+constexpr std::string_view kCheckpointHeader = "subtitler-checkpoint 1";
+
+// Header line of a file which applies to the contents described by source.
+std::string HeaderFor(std::string_view header, const SubRipSource& source) {
+  std::ostringstream line;
+  line << header << ' ' << source.size << ' ' << source.hash;
+  return line.str();
+}
+
+// Writes to a temp file first, so a crash never leaves a half written file.
+template <typename Write>
+void ReplaceFile(const fs::path& path, std::ios::openmode mode, Write write) {
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream output{temp_path,
+                         std::ofstream::out | std::ofstream::trunc | mode};
+    if (!output) {
+      throw std::runtime_error{"Could not open file " + temp_path.string()};
+    }
+    write(output);
+    if (!output) {
+      throw std::runtime_error{"Could not write file " + temp_path.string()};
+    }
+  }
+  fs::rename(temp_path, path);
+}
+
+std::string Escape(std::string_view payload) {
+  std::string escaped;
+  escaped.reserve(payload.size());
+  for (char c : payload) {
+    switch (c) {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      case '\r':
+        escaped += "\\r";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::optional<std::string> Unescape(std::string_view escaped) {
+  std::string payload;
+  payload.reserve(escaped.size());
+  for (std::size_t i = 0; i < escaped.size(); ++i) {
+    if (escaped[i] != '\\') {
+      payload += escaped[i];
+      continue;
+    }
+    if (++i >= escaped.size()) {
+      return std::nullopt;
+    }
+    switch (escaped[i]) {
+      case '\\':
+        payload += '\\';
+        break;
+      case 'n':
+        payload += '\n';
+        break;
+      case 'r':
+        payload += '\r';
+        break;
+      default:
+        return std::nullopt;
+    }
+  }
+  return payload;
+}
+
+// Replaces the payload, keeping the line count of the item correct.
+void SetPayload(SubRipItem& item, std::string_view payload) {
+  item.ClearPayload();
+  while (!payload.empty()) {
+    auto newline = payload.find('\n');
+    auto line_size =
+        newline == std::string_view::npos ? payload.size() : newline + 1;
+    item.AppendLine(payload.substr(0, line_size));
+    payload.remove_prefix(line_size);
+  }
+}
+
+// Splits a journal line into space separated fields.
+class FieldReader {
+ public:
+  explicit FieldReader(std::string_view line) : line_{line} {}
+
+  bool Next(std::string_view& field) {
+    if (done_) {
+      return false;
+    }
+    auto space = line_.find(' ');
+    if (space == std::string_view::npos) {
+      field = line_;
+      done_ = true;
+    } else {
+      field = line_.substr(0, space);
+      line_.remove_prefix(space + 1);
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool Next(T& number) {
+    std::string_view field;
+    if (!Next(field)) {
+      return false;
+    }
+    auto [ptr, ec] =
+        std::from_chars(field.data(), field.data() + field.size(), number);
+    return ec == std::errc{} && ptr == field.data() + field.size();
+  }
+
+  // The rest of the line, which may contain spaces.
+  bool Rest(std::string_view& rest) {
+    if (done_) {
+      return false;
+    }
+    rest = line_;
+    done_ = true;
+    return true;
+  }
+
+  bool AtEnd() const { return done_; }
+
+ private:
+  std::string_view line_;
+  bool done_ = false;
+};
+
+}  // namespace
+
+SubRipJournal::SubRipJournal(const fs::path& srt_path,
+                             std::size_t compact_threshold)
+    : srt_path_{srt_path},
+      journal_path_{JournalPath(srt_path)},
+      checkpoint_path_{CheckpointPath(srt_path)},
+      compact_threshold_{compact_threshold} {}
+
+fs::path SubRipJournal::JournalPath(const fs::path& srt_path) {
+  auto journal_path = srt_path;
+  journal_path += ".journal";
+  return journal_path;
+}
+
+fs::path SubRipJournal::CheckpointPath(const fs::path& srt_path) {
+  auto checkpoint_path = srt_path;
+  checkpoint_path += ".checkpoint";
+  return checkpoint_path;
+}
+
+std::vector<std::shared_ptr<SubRipItem>> SubRipJournal::Open() {
+  opened_ = false;
+  CloseJournal();
+  journal_size_ = 0;
+  has_checkpoint_ = false;
+  recovered_changes_ = false;
+
+  if (fs::exists(srt_path_)) {
+    Track(LoadSubRipCached(srt_path_, &srt_));
+  } else {
+    srt_ = SubRipSource{};
+    srt_.hash = HashSubRipSource("");
+    Track({});
+  }
+  base_ = srt_;
+
+  if (fs::exists(checkpoint_path_) && !LoadCheckpoint()) {
+    // Left over from before the SRT was last saved.
+    fs::remove(checkpoint_path_);
+  }
+  if (fs::exists(journal_path_)) {
+    if (Replay()) {
+      // Fold the recovered edits into the checkpoint, so new edits start a
+      // fresh journal rather than following a possibly truncated line.
+      Checkpoint();
+    } else {
+      fs::remove(journal_path_);
+    }
+  }
+  recovered_changes_ = has_checkpoint_;
+  opened_ = true;
+
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  items.reserve(items_.size());
+  for (const auto& [id, item] : items_) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+void SubRipJournal::Added(const std::shared_ptr<SubRipItem>& item) {
+  if (!item) {
+    throw std::invalid_argument{"Cannot add null SubRipItem"};
+  }
+  if (ids_.count(item.get())) {
+    throw std::invalid_argument{"SubRipItem is already tracked"};
+  }
+  auto id = next_id_++;
+  items_[id] = item;
+  ids_[item.get()] = id;
+  std::ostringstream line;
+  line << "add " << id << ' ' << item->start().count() << ' '
+       << item->duration().count() << ' ' << static_cast<int>(item->ass_pos_id_)
+       << ' ' << Escape(item->payload());
+  Append(line.str());
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::Removed(const SubRipItem* item) {
+  auto id = GetId(item);
+  Append("remove " + std::to_string(id));
+  items_.erase(id);
+  ids_.erase(item);
+  // Only once the item is untracked, so the checkpoint doesn't include it.
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::Retimed(const SubRipItem* item) {
+  auto id = GetId(item);
+  std::ostringstream line;
+  line << "retime " << id << ' ' << item->start().count() << ' '
+       << item->duration().count();
+  Append(line.str());
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::Retimed(const std::vector<const SubRipItem*>& items) {
+  if (items.empty()) {
+    return;
+  }
+  // Nothing is written until every id is found, so an untracked item
+  // doesn't leave part of the batch in the journal.
+  std::ostringstream lines;
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    if (i > 0) {
+      lines << '\n';
+    }
+    lines << "retime " << GetId(items[i]) << ' ' << items[i]->start().count()
+          << ' ' << items[i]->duration().count();
+  }
+  Append(lines.str());
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::TextEdited(const SubRipItem* item) {
+  auto id = GetId(item);
+  Append("text " + std::to_string(id) + ' ' + Escape(item->payload()));
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::PositionEdited(const SubRipItem* item) {
+  auto id = GetId(item);
+  Append("position " + std::to_string(id) + ' ' +
+         std::to_string(static_cast<int>(item->ass_pos_id_)));
+  CheckpointIfLarge();
+}
+
+void SubRipJournal::Compact() {
+  if (!opened_) {
+    throw std::runtime_error{"Cannot compact " + srt_path_.string() +
+                             ", it was not opened"};
+  }
+  auto file = BuildFile();
+  ReplaceFile(srt_path_, std::ios::openmode{},
+              [&file](std::ostream& output) { file.ToStream(output); });
+  {
+    MemoryMappedFile written{srt_path_};
+    srt_ = SubRipSource::Of(srt_path_, written.contents());
+  }
+  // So the next Open() doesn't need to parse what was just written.
+  RebuildSubRipCacheInBackground(srt_path_, srt_, file.GetItems());
+  // If we crash before the journal and checkpoint are removed, their headers
+  // no longer match the SRT and they are discarded on the next Open().
+  Discard();
+  Track(file.GetItems());
+}
+
+void SubRipJournal::Discard() {
+  RemoveJournal();
+  std::error_code ignored;
+  fs::remove(checkpoint_path_, ignored);
+  has_checkpoint_ = false;
+  base_ = srt_;
+}
+
+SubRipJournal::CueId SubRipJournal::GetId(const SubRipItem* item) const {
+  auto it = ids_.find(item);
+  if (it == ids_.end()) {
+    throw std::invalid_argument{"SubRipItem is not tracked by the journal"};
+  }
+  return it->second;
+}
+
+void SubRipJournal::Track(
+    const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  items_.clear();
+  ids_.clear();
+  next_id_ = 1;
+  for (const auto& item : items) {
+    auto id = next_id_++;
+    items_[id] = item;
+    ids_[item.get()] = id;
+  }
+}
+
+SubRipFile SubRipJournal::BuildFile() const {
+  SubRipFile::Builder builder;
+  for (const auto& [id, item] : items_) {
+    builder.Add(item);
+  }
+  return builder.Build();
+}
+
+bool SubRipJournal::LoadCheckpoint() {
+  MemoryMappedFile file{checkpoint_path_};
+  auto contents = file.contents();
+  auto newline = contents.find('\n');
+  if (newline == std::string_view::npos ||
+      contents.substr(0, newline) != HeaderFor(kCheckpointHeader, srt_)) {
+    return false;
+  }
+  // Written in sorted order, so ids match the ones Checkpoint() assigned.
+  SubRipFile::Builder builder;
+  for (auto& item : ParseSubRip(contents.substr(newline + 1))) {
+    builder.Add(std::move(item));
+  }
+  Track(builder.Build().GetItems());
+  base_ = SubRipSource::Of(checkpoint_path_, contents);
+  has_checkpoint_ = true;
+  return true;
+}
+
+void SubRipJournal::Checkpoint() {
+  auto file = BuildFile();
+  ReplaceFile(checkpoint_path_, std::ios::binary,
+              [this, &file](std::ostream& output) {
+                output << HeaderFor(kCheckpointHeader, srt_) << '\n';
+                file.ToStream(output);
+              });
+  {
+    MemoryMappedFile written{checkpoint_path_};
+    base_ = SubRipSource::Of(checkpoint_path_, written.contents());
+  }
+  has_checkpoint_ = true;
+  // If we crash before the journal is removed, its header no longer matches
+  // the checkpoint, which already holds its edits, so it is discarded on the
+  // next Open().
+  RemoveJournal();
+  Track(file.GetItems());
+}
+
+void SubRipJournal::CheckpointIfLarge() {
+  if (journal_size_ > compact_threshold_) {
+    Checkpoint();
+  }
+}
+
+bool SubRipJournal::Replay() {
+  std::string contents;
+  {
+    std::ifstream input{journal_path_, std::ios::binary};
+    if (!input) {
+      throw std::runtime_error{"Could not open file " +
+                               journal_path_.string()};
+    }
+    std::ostringstream buffer;
+    buffer << input.rdbuf();
+    contents = buffer.str();
+  }
+
+  std::string_view remaining = contents;
+  std::size_t line_number = 0;
+  bool applied = false;
+  auto malformed = [&](std::string_view line) {
+    return std::runtime_error{"Malformed journal " + journal_path_.string() +
+                              " at line " + std::to_string(line_number) +
+                              ": " + std::string{line}};
+  };
+
+  // A line without its newline was cut off by a crash, and is ignored.
+  for (auto newline = remaining.find('\n'); newline != std::string_view::npos;
+       newline = remaining.find('\n')) {
+    auto line = remaining.substr(0, newline);
+    remaining.remove_prefix(newline + 1);
+    ++line_number;
+
+    if (line_number == 1) {
+      if (line != HeaderFor(kHeader, base_)) {
+        // Written against a different base, e.g. an SRT saved since.
+        return false;
+      }
+      continue;
+    }
+
+    FieldReader fields{line};
+    std::string_view op;
+    CueId id = 0;
+    if (!fields.Next(op) || !fields.Next(id)) {
+      throw malformed(line);
+    }
+    auto item_it = items_.find(id);
+    if (op != "add" && item_it == items_.end()) {
+      throw malformed(line);
+    }
+
+    if (op == "add") {
+      std::int64_t start = 0, duration = 0;
+      int pos_id = 0;
+      std::string_view escaped;
+      if (!fields.Next(start) || !fields.Next(duration) ||
+          !fields.Next(pos_id) || !fields.Rest(escaped) ||
+          item_it != items_.end()) {
+        throw malformed(line);
+      }
+      auto payload = Unescape(escaped);
+      if (!payload) {
+        throw malformed(line);
+      }
+      auto item = std::make_shared<SubRipItem>();
+      item->start(std::chrono::milliseconds{start})
+          ->duration(std::chrono::milliseconds{duration});
+      if (pos_id != 0) {
+        try {
+          item->substation_alpha_position(pos_id);
+        } catch (const std::out_of_range&) {
+          throw malformed(line);
+        }
+      }
+      SetPayload(*item, *payload);
+      items_[id] = item;
+      ids_[item.get()] = id;
+      next_id_ = std::max(next_id_, id + 1);
+    } else if (op == "remove") {
+      if (!fields.AtEnd()) {
+        throw malformed(line);
+      }
+      ids_.erase(item_it->second.get());
+      items_.erase(item_it);
+    } else if (op == "retime") {
+      std::int64_t start = 0, duration = 0;
+      if (!fields.Next(start) || !fields.Next(duration) || !fields.AtEnd()) {
+        throw malformed(line);
+      }
+      item_it->second->start(std::chrono::milliseconds{start})
+          ->duration(std::chrono::milliseconds{duration});
+    } else if (op == "text") {
+      std::string_view escaped;
+      std::optional<std::string> payload;
+      if (!fields.Rest(escaped) || !(payload = Unescape(escaped))) {
+        throw malformed(line);
+      }
+      SetPayload(*item_it->second, *payload);
+    } else if (op == "position") {
+      int pos_id = 0;
+      if (!fields.Next(pos_id) || !fields.AtEnd()) {
+        throw malformed(line);
+      }
+      if (pos_id == SubRipItem::kNoPosition) {
+        // The position was cleared, e.g. by undoing an edit.
+        item_it->second->ass_pos_id_ = SubRipItem::kNoPosition;
+      } else {
+        try {
+          item_it->second->substation_alpha_position(pos_id);
+        } catch (const std::out_of_range&) {
+          throw malformed(line);
+        }
+      }
+    } else {
+      throw malformed(line);
+    }
+    applied = true;
+  }
+  return applied;
+}
+
+void SubRipJournal::Append(const std::string& line) {
+  if (!journal_.is_open()) {
+    journal_.open(journal_path_,
+                  std::ofstream::out | std::ofstream::trunc |
+                      std::ofstream::binary);
+    if (!journal_) {
+      throw std::runtime_error{"Could not open file " +
+                               journal_path_.string()};
+    }
+    auto header = HeaderFor(kHeader, base_);
+    journal_ << header << '\n';
+    journal_size_ = header.size() + 1;
+  }
+  journal_ << line << '\n' << std::flush;
+  if (!journal_) {
+    throw std::runtime_error{"Could not write file " + journal_path_.string()};
+  }
+  journal_size_ += line.size() + 1;
+}
+
+void SubRipJournal::CloseJournal() {
+  if (journal_.is_open()) {
+    journal_.close();
+  }
+  journal_.clear();
+}
+
+void SubRipJournal::RemoveJournal() {
+  CloseJournal();
+  std::error_code ignored;
+  fs::remove(journal_path_, ignored);
+  journal_size_ = 0;
+}
+
+}  // namespace srt
+}  // namespace subtitler
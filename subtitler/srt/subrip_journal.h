@@ -0,0 +1,173 @@
+#ifndef SUBTITLER_SRT_SUBRIP_JOURNAL_H
+#define SUBTITLER_SRT_SUBRIP_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "subtitler/srt/subrip_cache.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Append-only log of edits made to an SRT file, kept next to it as
+ * "<file>.journal". Recording an edit appends a single line, so saving is
+ * proportional to the size of the edit rather than of the file. The SRT is
+ * only rewritten by Compact(), which callers run on an explicit save.
+ *
+ * Once the journal grows past a threshold, its edits are folded into a
+ * checkpoint, "<file>.checkpoint", which holds every cue as of the last
+ * edit, and the journal starts over on top of it. The SRT is left alone, so
+ * Discard() still restores the last saved state.
+ *
+ * If the program exits without saving, the next Open() loads the checkpoint
+ * and replays the journal, so no edits are lost. Recovered edits stay in the
+ * checkpoint until the next Compact() or Discard().
+ *
+ * The journal tracks the SubRipItems returned by Open() or passed to
+ * Added(). Callers modify the items themselves, then report the change with
+ * the matching method, e.g:
+ *
+ * SubRipJournal journal{"subs.srt"};
+ * auto items = journal.Open();
+ * items[0]->start(1s);
+ * journal.Retimed(items[0].get());
+ * ...
+ * journal.Compact();
+ *
+ * Journal format, one operation per line, where <id> identifies a cue:
+ * subtitler-journal 1 <base size> <base hash>
+ * add <id> <start ms> <duration ms> <position id or 0> <payload>
+ * remove <id>
+ * retime <id> <start ms> <duration ms>
+ * text <id> <payload>
+ * position <id> <position id or 0>
+ * Payloads escape '\\', '\n' and '\r'. The base is the checkpoint if there
+ * is one, the SRT otherwise. Cues of the base have ids 1 to n in sorted
+ * order, added cues take the following ids.
+ *
+ * Checkpoint format, an SRT file after a header line:
+ * subtitler-checkpoint 1 <srt size> <srt hash>
+ *
+ * The headers record what each file applies to, so a journal or checkpoint
+ * left over from before a save or checkpoint is discarded instead of being
+ * applied twice.
+ */
+class SubRipJournal {
+ public:
+  // Journals larger than this are folded into the checkpoint.
+  static constexpr std::size_t kDefaultCompactThreshold = 1 << 20;
+
+  explicit SubRipJournal(
+      const std::filesystem::path& srt_path,
+      std::size_t compact_threshold = kDefaultCompactThreshold);
+
+  SubRipJournal(const SubRipJournal&) = delete;
+  SubRipJournal& operator=(const SubRipJournal&) = delete;
+
+  // Path of the journal and checkpoint belonging to srt_path.
+  static std::filesystem::path JournalPath(
+      const std::filesystem::path& srt_path);
+  static std::filesystem::path CheckpointPath(
+      const std::filesystem::path& srt_path);
+
+  // Loads the SRT (empty if it doesn't exist), and recovers the checkpoint
+  // and journal left by a previous session, if any. Recovered edits are
+  // folded into the checkpoint, the SRT is not modified.
+  // Returns the items sorted by start time, which are now tracked.
+  // Throws if the SRT, checkpoint or journal can't be read or are malformed.
+  // A partially written last line of the journal is ignored.
+  std::vector<std::shared_ptr<SubRipItem>> Open();
+
+  // True if the last Open() recovered edits from a previous session.
+  bool recovered_changes() const { return recovered_changes_; }
+
+  // Record an edit. Items must be tracked, except for Added.
+  // Throws std::invalid_argument for untracked (or already tracked) items,
+  // and std::runtime_error if the journal can't be written.
+  void Added(const std::shared_ptr<SubRipItem>& item);
+  void Removed(const SubRipItem* item);
+  void Retimed(const SubRipItem* item);
+  // Records a retime of every item with a single write, for bulk retimes.
+  void Retimed(const std::vector<const SubRipItem*>& items);
+  void TextEdited(const SubRipItem* item);
+  void PositionEdited(const SubRipItem* item);
+
+  // True if edits have been recorded or recovered since the last Compact().
+  bool HasPendingChanges() const {
+    return journal_size_ > 0 || has_checkpoint_;
+  }
+
+  std::size_t journal_size() const { return journal_size_; }
+
+  // Rewrites the SRT from the tracked items and removes the journal and
+  // checkpoint. The SRT is replaced atomically, so it is never left half
+  // written.
+  // Throws std::runtime_error if Open() has not succeeded, so a file which
+  // failed to load is never overwritten.
+  void Compact();
+
+  // Removes the journal and checkpoint without applying them, e.g. when
+  // quitting without saving. The SRT keeps its last saved state. Open()
+  // must be called again before recording more edits.
+  void Discard();
+
+ private:
+  using CueId = std::uint64_t;
+
+  std::filesystem::path srt_path_;
+  std::filesystem::path journal_path_;
+  std::filesystem::path checkpoint_path_;
+  std::size_t compact_threshold_;
+  std::ofstream journal_;
+  std::size_t journal_size_ = 0;
+  bool has_checkpoint_ = false;
+  bool recovered_changes_ = false;
+  // Set once Open() succeeds, until it is called again.
+  bool opened_ = false;
+
+  // The SRT as last saved, which the checkpoint applies to.
+  SubRipSource srt_;
+  // The contents that the journal applies to, the checkpoint if there is
+  // one and the SRT otherwise. Only the size and hash are set for a
+  // checkpoint.
+  SubRipSource base_;
+
+  std::map<CueId, std::shared_ptr<SubRipItem>> items_;
+  std::unordered_map<const SubRipItem*, CueId> ids_;
+  CueId next_id_ = 1;
+
+  CueId GetId(const SubRipItem* item) const;
+  // Assigns ids 1 to n to items, which must be sorted.
+  void Track(const std::vector<std::shared_ptr<SubRipItem>>& items);
+  // The tracked items, sorted.
+  SubRipFile BuildFile() const;
+  // Returns true if any operation was applied.
+  bool Replay();
+  // Loads and tracks the items of the checkpoint. Returns false if it
+  // doesn't apply to the SRT.
+  bool LoadCheckpoint();
+  // Writes the tracked items to the checkpoint and starts a new journal on
+  // top of it.
+  void Checkpoint();
+  // Checkpoint() once the journal is larger than compact_threshold_.
+  void CheckpointIfLarge();
+  void Append(const std::string& line);
+  void CloseJournal();
+  // Closes and removes the journal.
+  void RemoveJournal();
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,380 @@
+#include "subtitler/srt/subrip_journal.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "subtitler/srt/subrip_cache.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::HasSubstr;
+
+namespace {
+
+std::string ReadFile(const fs::path& path) {
+  std::ifstream input{path, std::ios::binary};
+  std::ostringstream buffer;
+  buffer << input.rdbuf();
+  return buffer.str();
+}
+
+}  // namespace
+
+class SubRipJournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    srt_path = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+               "subrip_journal_test.srt";
+    journal_path = SubRipJournal::JournalPath(srt_path);
+    checkpoint_path = SubRipJournal::CheckpointPath(srt_path);
+    fs::remove(journal_path);
+    fs::remove(checkpoint_path);
+    std::ofstream output{srt_path, std::ofstream::trunc};
+    output << "1\n"
+              "00:00:01,000 --> 00:00:02,000\n"
+              "first\n"
+              "\n"
+              "2\n"
+              "00:00:03,000 --> 00:00:04,000\n"
+              "second\n"
+              "\n";
+  }
+
+  void TearDown() override {
+    WaitForSubRipCacheWrites();
+    fs::remove(srt_path);
+    fs::remove(journal_path);
+    fs::remove(checkpoint_path);
+    fs::remove(SubRipCache::CachePath(srt_path));
+  }
+
+  fs::path srt_path;
+  fs::path journal_path;
+  fs::path checkpoint_path;
+};
+
+TEST_F(SubRipJournalTest, EditsAreAppendedWithoutRewritingSrt) {
+  auto original = ReadFile(srt_path);
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_EQ(2, items.size());
+  ASSERT_FALSE(journal.recovered_changes());
+  ASSERT_FALSE(journal.HasPendingChanges());
+
+  items[0]->start(5s);
+  journal.Retimed(items[0].get());
+  ASSERT_TRUE(journal.HasPendingChanges());
+  ASSERT_EQ(original, ReadFile(srt_path));
+  ASSERT_THAT(ReadFile(journal_path), HasSubstr("retime 1 5000 1000\n"));
+
+  journal.Compact();
+  ASSERT_FALSE(journal.HasPendingChanges());
+  ASSERT_FALSE(fs::exists(journal_path));
+  ASSERT_EQ(
+      "1\n"
+      "00:00:03,000 --> 00:00:04,000\n"
+      "second\n"
+      "\n"
+      "2\n"
+      "00:00:05,000 --> 00:00:06,000\n"
+      "first\n"
+      "\n",
+      ReadFile(srt_path));
+}
+
+TEST_F(SubRipJournalTest, BulkRetimeIsOneWrite) {
+  {
+    SubRipJournal journal{srt_path, /* compact_threshold= */ 60};
+    auto items = journal.Open();
+    items[0]->start(5s);
+    items[1]->start(7s);
+    journal.Retimed({items[0].get(), items[1].get()});
+    // Past the threshold only after both lines are written.
+    ASSERT_FALSE(fs::exists(journal_path));
+    ASSERT_TRUE(fs::exists(checkpoint_path));
+
+    SubRipItem untracked;
+    items[0]->start(9s);
+    ASSERT_THROW(journal.Retimed({items[0].get(), &untracked}),
+                 std::invalid_argument);
+    ASSERT_FALSE(fs::exists(journal_path));
+  }
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_EQ(2, items.size());
+  ASSERT_EQ(5s, items[0]->start());
+  ASSERT_EQ(7s, items[1]->start());
+}
+
+TEST_F(SubRipJournalTest, ReplaysEveryOperationOnOpen) {
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+
+    auto added = std::make_shared<SubRipItem>();
+    added->start(0s)->duration(500ms)->position("tc");
+    added->AppendLine("added \\ with")->AppendLine("two lines");
+    journal.Added(added);
+
+    journal.Removed(items[1].get());
+
+    items[0]->ClearPayload()->AppendLine("edited text");
+    journal.TextEdited(items[0].get());
+    items[0]->position("br");
+    journal.PositionEdited(items[0].get());
+
+    added->start(10s);
+    journal.Retimed(added.get());
+    // Exits without compacting, like a crash.
+  }
+  ASSERT_TRUE(fs::exists(journal_path));
+
+  auto original = ReadFile(srt_path);
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_TRUE(journal.recovered_changes());
+  ASSERT_TRUE(journal.HasPendingChanges());
+  // Recovered edits are kept aside until the next save.
+  ASSERT_FALSE(fs::exists(journal_path));
+  ASSERT_TRUE(fs::exists(checkpoint_path));
+  ASSERT_EQ(original, ReadFile(srt_path));
+  ASSERT_EQ(2, items.size());
+  ASSERT_EQ("edited text\n", items[0]->payload());
+  ASSERT_EQ(3, items[0]->substation_alpha_position());
+  ASSERT_EQ(10s, items[1]->start());
+  ASSERT_EQ(2, items[1]->num_lines());
+
+  journal.Compact();
+  ASSERT_FALSE(journal.HasPendingChanges());
+  ASSERT_FALSE(fs::exists(checkpoint_path));
+  ASSERT_EQ(
+      "1\n"
+      "00:00:01,000 --> 00:00:02,000\n"
+      "{\\an3}edited text\n"
+      "\n"
+      "2\n"
+      "00:00:10,000 --> 00:00:10,500\n"
+      "{\\an8}added \\ with\n"
+      "two lines\n"
+      "\n",
+      ReadFile(srt_path));
+
+  // Recovered items are tracked like any others.
+  journal.Removed(items[0].get());
+  journal.Compact();
+  SubRipJournal reopened{srt_path};
+  ASSERT_EQ(1, reopened.Open().size());
+}
+
+TEST_F(SubRipJournalTest, IgnoresTruncatedLastLine) {
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+    journal.Removed(items[0].get());
+  }
+  {
+    std::ofstream output{journal_path, std::ios::app | std::ios::binary};
+    output << "remove 2";
+  }
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_EQ(1, items.size());
+  ASSERT_EQ("second\n", items[0]->payload());
+}
+
+TEST_F(SubRipJournalTest, DiscardsJournalOfDifferentSrt) {
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+    journal.Removed(items[0].get());
+    journal.Removed(items[1].get());
+  }
+  // SRT changes after the journal was written, e.g. a crash right after
+  // compaction replaced it.
+  {
+    std::ofstream output{srt_path, std::ofstream::app};
+    output << "3\n00:00:05,000 --> 00:00:06,000\nthird\n";
+  }
+  SubRipJournal journal{srt_path};
+  ASSERT_EQ(3, journal.Open().size());
+  ASSERT_FALSE(journal.recovered_changes());
+  ASSERT_FALSE(fs::exists(journal_path));
+}
+
+TEST_F(SubRipJournalTest, DiscardKeepsLastCompactedState) {
+  auto original = ReadFile(srt_path);
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+    journal.Removed(items[0].get());
+    journal.Discard();
+  }
+  SubRipJournal journal{srt_path};
+  ASSERT_EQ(2, journal.Open().size());
+  ASSERT_EQ(original, ReadFile(srt_path));
+}
+
+TEST_F(SubRipJournalTest, CompactNeverOverwritesAnSrtThatFailedToOpen) {
+  {
+    std::ofstream output{srt_path, std::ofstream::app};
+    output << "3\n00:00:05,000 --> 00:00:06,000\n{\\a6}bad position\n";
+  }
+  auto original = ReadFile(srt_path);
+  SubRipJournal journal{srt_path};
+  EXPECT_THROW(journal.Compact(), std::runtime_error);
+  EXPECT_ANY_THROW(journal.Open());
+  EXPECT_THROW(journal.Compact(), std::runtime_error);
+  EXPECT_FALSE(journal.HasPendingChanges());
+  EXPECT_EQ(original, ReadFile(srt_path));
+}
+
+TEST_F(SubRipJournalTest, CheckpointsPastThresholdWithoutRewritingSrt) {
+  auto original = ReadFile(srt_path);
+  {
+    SubRipJournal journal{srt_path, /* compact_threshold= */ 100};
+    auto items = journal.Open();
+    for (int i = 0; i < 10; ++i) {
+      items[0]->start(std::chrono::milliseconds{i});
+      journal.Retimed(items[0].get());
+      ASSERT_LE(journal.journal_size(), 100);
+    }
+    ASSERT_TRUE(journal.HasPendingChanges());
+    ASSERT_EQ(original, ReadFile(srt_path));
+    ASSERT_THAT(ReadFile(checkpoint_path), HasSubstr("00:00:00,00"));
+
+    // Edits after the checkpoint go into a journal on top of it.
+    journal.Removed(items[1].get());
+    ASSERT_TRUE(fs::exists(journal_path));
+    // Exits without saving, like a crash.
+  }
+
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_TRUE(journal.recovered_changes());
+  ASSERT_EQ(1, items.size());
+  ASSERT_EQ(9ms, items[0]->start());
+  ASSERT_EQ(original, ReadFile(srt_path));
+
+  // Not saving restores the SRT as it was.
+  journal.Discard();
+  ASSERT_FALSE(fs::exists(checkpoint_path));
+  ASSERT_FALSE(fs::exists(journal_path));
+  SubRipJournal reopened{srt_path};
+  ASSERT_EQ(2, reopened.Open().size());
+  ASSERT_FALSE(reopened.recovered_changes());
+  ASSERT_EQ(original, ReadFile(srt_path));
+}
+
+TEST_F(SubRipJournalTest, DiscardsCheckpointOfDifferentSrt) {
+  {
+    SubRipJournal journal{srt_path, /* compact_threshold= */ 10};
+    auto items = journal.Open();
+    journal.Removed(items[0].get());
+  }
+  ASSERT_TRUE(fs::exists(checkpoint_path));
+  // The SRT was saved, but the checkpoint not yet removed.
+  {
+    std::ofstream output{srt_path, std::ofstream::app};
+    output << "3\n00:00:05,000 --> 00:00:06,000\nthird\n";
+  }
+  SubRipJournal journal{srt_path};
+  ASSERT_EQ(3, journal.Open().size());
+  ASSERT_FALSE(journal.recovered_changes());
+  ASSERT_FALSE(fs::exists(checkpoint_path));
+}
+
+TEST_F(SubRipJournalTest, MissingSrtStartsEmpty) {
+  fs::remove(srt_path);
+  SubRipJournal journal{srt_path};
+  ASSERT_TRUE(journal.Open().empty());
+  auto item = std::make_shared<SubRipItem>();
+  item->start(1s)->duration(1s)->AppendLine("new");
+  journal.Added(item);
+  ASSERT_THROW(journal.Added(item), std::invalid_argument);
+  journal.Compact();
+  ASSERT_THAT(ReadFile(srt_path), HasSubstr("new\n"));
+}
+
+TEST_F(SubRipJournalTest, RejectsUntrackedItemsAndMalformedJournals) {
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  SubRipItem untracked;
+  ASSERT_THROW(journal.Retimed(&untracked), std::invalid_argument);
+
+  journal.Removed(items[0].get());
+  {
+    std::ofstream output{journal_path, std::ios::app | std::ios::binary};
+    output << "retime 1 0 1000\n";
+  }
+  SubRipJournal reopened{srt_path};
+  try {
+    reopened.Open();
+    FAIL() << "Expected runtime_error";
+  } catch (const std::runtime_error& e) {
+    ASSERT_THAT(e.what(), HasSubstr("at line 3: retime 1 0 1000"));
+  }
+}
+
+TEST_F(SubRipJournalTest, RejectsAddWithInvalidPosition) {
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+    journal.Removed(items[0].get());
+  }
+  {
+    std::ofstream output{journal_path, std::ios::app | std::ios::binary};
+    output << "add 9 0 1000 12 text\n";
+  }
+  SubRipJournal reopened{srt_path};
+  try {
+    reopened.Open();
+    FAIL() << "Expected runtime_error";
+  } catch (const std::out_of_range&) {
+    FAIL() << "Expected malformed journal error";
+  } catch (const std::runtime_error& e) {
+    ASSERT_THAT(e.what(), HasSubstr("at line 3: add 9 0 1000 12 text"));
+  }
+}
+
+TEST_F(SubRipJournalTest, ReplaysClearedPosition) {
+  {
+    SubRipJournal journal{srt_path};
+    auto items = journal.Open();
+    SubRipItem unpositioned{*items[0]};
+    items[0]->position("tc");
+    journal.PositionEdited(items[0].get());
+    // Back to no position, like undoing the edit above.
+    *items[0] = unpositioned;
+    journal.PositionEdited(items[0].get());
+  }
+  ASSERT_THAT(ReadFile(journal_path), HasSubstr("position 1 0\n"));
+
+  SubRipJournal journal{srt_path};
+  auto items = journal.Open();
+  ASSERT_TRUE(journal.recovered_changes());
+  ASSERT_EQ(2, items.size());
+  journal.Compact();
+  ASSERT_EQ(
+      "1\n"
+      "00:00:01,000 --> 00:00:02,000\n"
+      "first\n"
+      "\n"
+      "2\n"
+      "00:00:03,000 --> 00:00:04,000\n"
+      "second\n"
+      "\n",
+      ReadFile(srt_path));
+}
@@ -0,0 +1,135 @@
+#include "subtitler/srt/subrip_linter.h"
+
+#include "subtitler/srt/subrip_loader.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+double Milliseconds(std::chrono::milliseconds duration) {
+  return static_cast<double>(duration.count());
+}
+
+}  // namespace
+
+std::string_view ToString(LintIssueType type) {
+  switch (type) {
+    case LintIssueType::kOverlap:
+      return "overlap";
+    case LintIssueType::kShortGap:
+      return "short_gap";
+    case LintIssueType::kTooShort:
+      return "too_short";
+    case LintIssueType::kTooLong:
+      return "too_long";
+    case LintIssueType::kReadingSpeed:
+      return "reading_speed";
+    case LintIssueType::kTooManyLines:
+      return "too_many_lines";
+  }
+  return "unknown";
+}
+
+std::size_t CountDisplayedChars(std::string_view payload) {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    char c = payload[i];
+    if (c == '<' || c == '{') {
+      auto close = payload.find(c == '<' ? '>' : '}', i + 1);
+      if (close != std::string_view::npos) {
+        i = close;
+        continue;
+      }
+    }
+    // Counts the first byte of every UTF-8 sequence.
+    if (c != '\n' && c != '\r' &&
+        (static_cast<unsigned char>(c) & 0xC0) != 0x80) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void LintSubRip(const SubRipFile& file, const LintOptions& options,
+                std::vector<LintIssue>& issues) {
+  // The cue ending last among those seen so far.
+  std::size_t last_ending = 0;
+  std::chrono::milliseconds last_end{0};
+
+  file.ForEachItem([&](std::size_t sequence_number,
+                       const std::shared_ptr<SubRipItem>& item) {
+    const auto start = item->start();
+    const auto duration = item->duration();
+    const auto end = start + duration;
+
+    if (last_ending != 0) {
+      if (start < last_end) {
+        issues.push_back({LintIssueType::kOverlap, sequence_number,
+                          last_ending, Milliseconds(last_end - start)});
+      } else if (auto gap = start - last_end;
+                 gap > std::chrono::milliseconds{0} && gap < options.min_gap) {
+        issues.push_back({LintIssueType::kShortGap, sequence_number,
+                          last_ending, Milliseconds(gap)});
+      }
+    }
+    if (last_ending == 0 || end > last_end) {
+      last_ending = sequence_number;
+      last_end = end;
+    }
+
+    if (duration < options.min_duration) {
+      issues.push_back({LintIssueType::kTooShort, sequence_number, 0,
+                        Milliseconds(duration)});
+    } else if (duration > options.max_duration) {
+      issues.push_back({LintIssueType::kTooLong, sequence_number, 0,
+                        Milliseconds(duration)});
+    }
+    if (duration > std::chrono::milliseconds{0}) {
+      auto chars_per_second =
+          static_cast<double>(CountDisplayedChars(item->payload())) * 1000 /
+          Milliseconds(duration);
+      if (chars_per_second > options.max_chars_per_second) {
+        issues.push_back({LintIssueType::kReadingSpeed, sequence_number, 0,
+                          chars_per_second});
+      }
+    }
+    if (item->num_lines() > options.max_lines) {
+      issues.push_back({LintIssueType::kTooManyLines, sequence_number, 0,
+                        static_cast<double>(item->num_lines())});
+    }
+  });
+}
+
+std::vector<LintIssue> LintSubRip(const SubRipFile& file,
+                                  const LintOptions& options) {
+  std::vector<LintIssue> issues;
+  LintSubRip(file, options, issues);
+  return issues;
+}
+
+std::vector<LintReport> LintSubRipDirectory(const fs::path& directory,
+                                            const LintOptions& options,
+                                            std::size_t num_threads) {
+  std::vector<LintReport> reports;
+  auto paths = ListSubRipFiles(directory);
+  reports.resize(paths.size());
+  // Each thread only writes its own reports, so no locking is needed.
+  ForEachSubRipFile(paths, num_threads,
+                    [&](std::size_t i, const SubRipFile* file,
+                        const std::string& error) {
+                      auto& report = reports[i];
+                      report.path = paths[i];
+                      if (file) {
+                        LintSubRip(*file, options, report.issues);
+                      } else {
+                        report.error = error;
+                      }
+                    });
+  return reports;
+}
+
+}  // namespace srt
+}  // namespace subtitler
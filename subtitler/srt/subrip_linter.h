@@ -0,0 +1,91 @@
+#ifndef SUBTITLER_SRT_SUBRIP_LINTER_H
+#define SUBTITLER_SRT_SUBRIP_LINTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+
+namespace subtitler {
+namespace srt {
+
+// Limits checked by the linter. The defaults follow common broadcast
+// guidelines.
+struct LintOptions {
+  // Gaps between consecutive cues shorter than this are reported, except
+  // for cues which are back to back (a gap of 0).
+  std::chrono::milliseconds min_gap{84};
+  std::chrono::milliseconds min_duration{833};
+  std::chrono::milliseconds max_duration{7000};
+  // Characters per second of the payload, not counting line breaks and
+  // formatting tags.
+  double max_chars_per_second = 20;
+  int max_lines = 2;
+};
+
+enum class LintIssueType {
+  kOverlap,
+  kShortGap,
+  kTooShort,
+  kTooLong,
+  kReadingSpeed,
+  kTooManyLines,
+};
+
+// Name of the type, as used in reports, e.g. "overlap".
+std::string_view ToString(LintIssueType type);
+
+struct LintIssue {
+  LintIssueType type;
+  std::size_t sequence_number;
+  // For kOverlap and kShortGap, the earlier cue involved, else 0.
+  std::size_t other_sequence_number;
+  // The offending measure: the overlap or gap, duration or characters per
+  // second, or number of lines.
+  double value;
+};
+
+/**
+ * Checks the cues of file against options, appending the issues found to
+ * issues in order of sequence number.
+ *
+ * Overlaps and gaps are found in a single sweep over the cues in sorted
+ * order, which tracks the cue ending last so far. A cue starting before it
+ * ends is reported as overlapping that cue, so a cue overlapped by several
+ * others is reported once per later cue rather than once per pair. Every
+ * other check only looks at the cue itself. Linear in the number of cues,
+ * and allocates only for the issues.
+ */
+void LintSubRip(const SubRipFile& file, const LintOptions& options,
+                std::vector<LintIssue>& issues);
+
+std::vector<LintIssue> LintSubRip(const SubRipFile& file,
+                                  const LintOptions& options = {});
+
+// Counts the characters (code points) of payload which are displayed, so
+// skipping line breaks and tags like <i> or {\an8}.
+std::size_t CountDisplayedChars(std::string_view payload);
+
+struct LintReport {
+  std::filesystem::path path;
+  std::vector<LintIssue> issues;
+  // Set to the exception message if the file failed to load.
+  std::string error;
+};
+
+// Lints every file ListSubRipFiles() finds under directory, with files
+// loaded and checked concurrently, see ForEachSubRipFile(). Results are
+// sorted by path. num_threads = 0 means std::thread::hardware_concurrency.
+// Throws std::filesystem::filesystem_error if the directory can't be read.
+std::vector<LintReport> LintSubRipDirectory(
+    const std::filesystem::path& directory, const LintOptions& options = {},
+    std::size_t num_threads = 0);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
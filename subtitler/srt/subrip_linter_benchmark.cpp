@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_linter.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::LintIssue;
+using subtitler::srt::LintSubRip;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+
+namespace {
+
+// Cues of 0.5-8s with gaps of -1-1s, so some of every issue.
+SubRipFile MakeFile(std::size_t num_items) {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<int> length_dist{500, 8000};
+  std::uniform_int_distribution<int> gap_dist{-1000, 1000};
+  SubRipFile::Builder builder;
+  builder.Reserve(num_items);
+  std::chrono::milliseconds start = 1h;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    auto item = std::make_shared<SubRipItem>();
+    std::chrono::milliseconds length{length_dist(rng)};
+    item->start(start)->duration(length)->AppendLine("<i>Hello world!</i>");
+    if (i % 7 == 0) {
+      item->AppendLine("Second line")->AppendLine("Third line");
+    }
+    builder.Add(item);
+    start += length + std::chrono::milliseconds{gap_dist(rng)};
+  }
+  return builder.Build();
+}
+
+void BM_LintSubRip(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  std::vector<LintIssue> issues;
+  for (auto _ : state) {
+    // Reuses the storage, like a batch run linting file after file.
+    issues.clear();
+    LintSubRip(file, {}, issues);
+    benchmark::DoNotOptimize(issues.data());
+  }
+  state.counters["issues"] = static_cast<double>(issues.size());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Overlap checks through per-cue collision queries instead of the sweep.
+void BM_CollisionsPerCue(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    std::size_t overlaps = 0;
+    for (std::size_t sequence = 1; sequence <= file.NumItems(); ++sequence) {
+      const auto& item = file.GetItem(sequence);
+      overlaps += file.GetCollisions(item->start(), item->duration()).size();
+    }
+    benchmark::DoNotOptimize(overlaps);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_LintSubRip)->Arg(10'000)->Arg(1'000'000)->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_CollisionsPerCue)
+    ->Arg(10'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,140 @@
+#include "subtitler/srt/subrip_linter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_cache.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+namespace {
+
+struct Issue {
+  std::string type;
+  std::size_t sequence_number;
+  std::size_t other_sequence_number;
+  double value;
+
+  bool operator==(const Issue& other) const {
+    return type == other.type && sequence_number == other.sequence_number &&
+           other_sequence_number == other.other_sequence_number &&
+           value == other.value;
+  }
+};
+
+std::ostream& operator<<(std::ostream& output, const Issue& issue) {
+  return output << issue.type << ' ' << issue.sequence_number << ' '
+                << issue.other_sequence_number << ' ' << issue.value;
+}
+
+std::vector<Issue> Lint(const SubRipFile& file,
+                        const LintOptions& options = {}) {
+  std::vector<Issue> issues;
+  for (const auto& issue : LintSubRip(file, options)) {
+    issues.push_back({std::string{ToString(issue.type)},
+                      issue.sequence_number, issue.other_sequence_number,
+                      issue.value});
+  }
+  return issues;
+}
+
+void Add(SubRipFile& file, std::chrono::milliseconds start,
+         std::chrono::milliseconds duration, const std::string& text = "ok") {
+  SubRipItem item;
+  item.start(start)->duration(duration)->AppendLine(text);
+  file.AddItem(item);
+}
+
+}  // namespace
+
+TEST(SubRipLinterTest, CleanFileHasNoIssues) {
+  SubRipFile file;
+  Add(file, 0s, 2s);
+  // Back to back is fine.
+  Add(file, 2s, 2s);
+  Add(file, 5s, 2s);
+  ASSERT_TRUE(Lint(file).empty());
+  ASSERT_TRUE(Lint(SubRipFile{}).empty());
+}
+
+TEST(SubRipLinterTest, OverlapsAndGapsInOneSweep) {
+  SubRipFile file;
+  Add(file, 0s, 10s);
+  // Overlaps 1, and so does 3 even though 2 ended before it.
+  Add(file, 1s, 2s);
+  Add(file, 4s, 2s);
+  // 50ms after 1 ends.
+  Add(file, 10s + 50ms, 2s);
+  ASSERT_THAT(Lint(file), ElementsAre(Issue{"too_long", 1, 0, 10000},
+                                      Issue{"overlap", 2, 1, 9000},
+                                      Issue{"overlap", 3, 1, 6000},
+                                      Issue{"short_gap", 4, 1, 50}));
+}
+
+TEST(SubRipLinterTest, PerCueChecks) {
+  SubRipFile file;
+  Add(file, 0s, 500ms);
+  Add(file, 10s, 1s, "<i>This line is far too long</i>");
+  SubRipItem item;
+  item.start(20s)->duration(5s)->AppendLine("one")->AppendLine("two")
+      ->AppendLine("three");
+  file.AddItem(item);
+
+  LintOptions options;
+  options.max_chars_per_second = 15;
+  ASSERT_THAT(Lint(file, options),
+              ElementsAre(Issue{"too_short", 1, 0, 500},
+                          Issue{"reading_speed", 2, 0, 25},
+                          Issue{"too_many_lines", 3, 0, 3}));
+}
+
+TEST(SubRipLinterTest, CountDisplayedChars) {
+  EXPECT_EQ(CountDisplayedChars("ab\ncd\r\n"), 4);
+  EXPECT_EQ(CountDisplayedChars("<i>hé</i> {\\an8}x"), 4);
+  // Unclosed brackets are text.
+  EXPECT_EQ(CountDisplayedChars("a < b"), 5);
+  EXPECT_EQ(CountDisplayedChars(""), 0);
+}
+
+TEST(SubRipLinterTest, LintsDirectory) {
+  auto dir = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+             "subrip_linter_test_dir";
+  fs::create_directories(dir / "nested");
+  {
+    std::ofstream{dir / "clean.srt"} << "1\n00:00:01,000 --> 00:00:03,000\nok\n";
+    std::ofstream{dir / "nested" / "short.srt"}
+        << "1\n00:00:01,000 --> 00:00:01,100\nok\n";
+    std::ofstream{dir / "broken.srt"} << "1\n00:00:01,000 -> 00:00:02,000\n";
+  }
+
+  auto reports = LintSubRipDirectory(dir, {}, 2);
+  ASSERT_EQ(3, reports.size());
+  ASSERT_EQ(dir / "broken.srt", reports[0].path);
+  ASSERT_THAT(reports[0].error, HasSubstr("Expected \"-->\""));
+  ASSERT_EQ(dir / "clean.srt", reports[1].path);
+  ASSERT_TRUE(reports[1].issues.empty());
+  ASSERT_TRUE(reports[1].error.empty());
+  ASSERT_EQ(dir / "nested" / "short.srt", reports[2].path);
+  ASSERT_EQ(1, reports[2].issues.size());
+  ASSERT_EQ(LintIssueType::kTooShort, reports[2].issues[0].type);
+
+  // Linting doesn't write caches next to the files.
+  ASSERT_FALSE(fs::exists(SubRipCache::CachePath(dir / "clean.srt")));
+  fs::remove_all(dir);
+  ASSERT_THROW(LintSubRipDirectory(dir), fs::filesystem_error);
+}
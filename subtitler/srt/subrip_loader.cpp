@@ -0,0 +1,248 @@
+#include "subtitler/srt/subrip_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <functional>
+#include <future>
+#include <thread>
+#include <utility>
+
+#include "subtitler/srt/subrip_encoding.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/memory_mapped_file.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+// Chunks smaller than this are not worth a thread.
+constexpr std::size_t kMinChunkSize = 256 * 1024;
+// More chunks than threads, so that a slow chunk doesn't stall the rest.
+constexpr std::size_t kChunksPerThread = 4;
+
+std::size_t ResolveNumThreads(std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  return std::max<std::size_t>(num_threads, 1);
+}
+
+// Returns the position just after the first blank line ("\n" or "\r\n")
+// starting at or after pos, or contents.size() if there is none.
+std::size_t NextCueBoundary(std::string_view contents, std::size_t pos) {
+  while (pos < contents.size()) {
+    auto newline = contents.find('\n', pos);
+    if (newline == std::string_view::npos) {
+      break;
+    }
+    auto line_start = newline + 1;
+    if (line_start < contents.size() && contents[line_start] == '\n') {
+      return line_start + 1;
+    }
+    if (line_start + 1 < contents.size() && contents[line_start] == '\r' &&
+        contents[line_start + 1] == '\n') {
+      return line_start + 2;
+    }
+    pos = line_start;
+  }
+  return contents.size();
+}
+
+// Splits contents into roughly num_chunks pieces, each ending just after a
+// blank line. A cue never spans a blank line, so each chunk parses on its
+// own exactly as it would as part of the whole. Keeping the blank line in
+// the preceding chunk also keeps "Timestamps were missing." errors at the
+// same offset.
+std::vector<std::string_view> SplitAtCueBoundaries(std::string_view contents,
+                                                   std::size_t num_chunks) {
+  std::vector<std::string_view> chunks;
+  auto target_size = contents.size() / num_chunks;
+  std::size_t begin = 0;
+  while (begin < contents.size()) {
+    auto end = NextCueBoundary(contents, begin + target_size);
+    chunks.push_back(contents.substr(begin, end - begin));
+    begin = end;
+  }
+  return chunks;
+}
+
+bool ItemLess(const std::shared_ptr<SubRipItem>& a,
+              const std::shared_ptr<SubRipItem>& b) {
+  return *a < *b;
+}
+
+// Well formed files are usually sorted already, so check before sorting.
+void SortRun(std::vector<std::shared_ptr<SubRipItem>>& run) {
+  if (!std::is_sorted(run.begin(), run.end(), ItemLess)) {
+    std::stable_sort(run.begin(), run.end(), ItemLess);
+  }
+}
+
+bool IsSubRipFile(const fs::directory_entry& entry) {
+  if (!entry.is_regular_file()) {
+    return false;
+  }
+  auto extension = entry.path().extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension == ".srt";
+}
+
+}  // namespace
+
+std::vector<std::shared_ptr<SubRipItem>> ParseSubRipParallel(
+    std::string_view contents, std::size_t num_threads) {
+  num_threads = ResolveNumThreads(num_threads);
+  auto num_chunks = std::min(num_threads * kChunksPerThread,
+                             contents.size() / kMinChunkSize);
+  if (num_threads == 1 || num_chunks <= 1) {
+    auto items = ParseSubRip(contents);
+    SortRun(items);
+    return items;
+  }
+
+  auto chunks = SplitAtCueBoundaries(contents, num_chunks);
+  std::vector<std::vector<std::shared_ptr<SubRipItem>>> runs(chunks.size());
+  std::vector<std::exception_ptr> errors(chunks.size());
+  ParallelFor(chunks.size(), num_threads, [&](std::size_t i) {
+    try {
+      runs[i] = ParseSubRip(chunks[i]);
+      SortRun(runs[i]);
+    } catch (const SubRipParseError& e) {
+      // Offsets are relative to the chunk, make them relative to contents.
+      auto chunk_offset =
+          static_cast<std::size_t>(chunks[i].data() - contents.data());
+      errors[i] = std::make_exception_ptr(
+          SubRipParseError{e.message(), chunk_offset + e.offset()});
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+  // The first error in file order is the one the single threaded parser
+  // would have thrown.
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Concatenate, then merge neighbouring sorted runs pairwise. Merging
+  // earlier runs before later ones keeps ties in file order.
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  std::vector<std::size_t> run_begins;
+  for (auto& run : runs) {
+    run_begins.push_back(items.size());
+    items.insert(items.end(), std::make_move_iterator(run.begin()),
+                 std::make_move_iterator(run.end()));
+  }
+  run_begins.push_back(items.size());
+  while (run_begins.size() > 2) {
+    std::vector<std::size_t> merged_begins;
+    std::size_t i = 0;
+    for (; i + 2 < run_begins.size(); i += 2) {
+      auto begin = items.begin() + run_begins[i];
+      auto middle = items.begin() + run_begins[i + 1];
+      auto end = items.begin() + run_begins[i + 2];
+      // Runs of a sorted file are already in order relative to each other.
+      if (begin != middle && middle != end &&
+          ItemLess(*middle, *(middle - 1))) {
+        std::inplace_merge(begin, middle, end, ItemLess);
+      }
+      merged_begins.push_back(run_begins[i]);
+    }
+    for (; i < run_begins.size(); ++i) {
+      merged_begins.push_back(run_begins[i]);
+    }
+    run_begins = std::move(merged_begins);
+  }
+  return items;
+}
+
+SubRipFile LoadSubRipParallel(const fs::path& file_name,
+                              std::size_t num_threads) {
+  MemoryMappedFile file{file_name};
+  std::string decoded;
+  SubRipFile::Builder builder;
+  for (auto& item : ParseSubRipParallel(DecodeSubRip(file.contents(), decoded),
+                                        num_threads)) {
+    builder.Add(std::move(item));
+  }
+  // Already sorted, so this only builds the index.
+  return builder.Build();
+}
+
+std::vector<SubRipLoadResult> LoadSubRipDirectory(const fs::path& directory,
+                                                  std::size_t num_threads) {
+  std::vector<SubRipLoadResult> results;
+  for (auto& path : ListSubRipFiles(directory)) {
+    results.push_back(SubRipLoadResult{std::move(path), std::nullopt, ""});
+  }
+
+  ParallelFor(results.size(), ResolveNumThreads(num_threads),
+              [&results](std::size_t i) {
+                auto& result = results[i];
+                try {
+                  SubRipFile file;
+                  file.LoadState(result.path);
+                  result.file = std::move(file);
+                } catch (const std::exception& e) {
+                  result.error = e.what();
+                }
+              });
+  return results;
+}
+
+void ParallelFor(std::size_t num_tasks, std::size_t num_threads,
+                 const std::function<void(std::size_t)>& task) {
+  std::atomic<std::size_t> next_task{0};
+  auto worker = [&]() {
+    for (auto i = next_task++; i < num_tasks; i = next_task++) {
+      task(i);
+    }
+  };
+  std::vector<std::future<void>> workers;
+  auto num_workers = std::min(ResolveNumThreads(num_threads), num_tasks);
+  for (std::size_t i = 1; i < num_workers; ++i) {
+    workers.push_back(std::async(std::launch::async, worker));
+  }
+  worker();
+  for (auto& future : workers) {
+    future.get();
+  }
+}
+
+std::vector<fs::path> ListSubRipFiles(const fs::path& directory) {
+  std::vector<fs::path> paths;
+  for (const auto& entry : fs::recursive_directory_iterator{directory}) {
+    if (IsSubRipFile(entry)) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+void ForEachSubRipFile(
+    const std::vector<fs::path>& paths, std::size_t num_threads,
+    const std::function<void(std::size_t, const SubRipFile*,
+                             const std::string&)>& on_load) {
+  ParallelFor(paths.size(), ResolveNumThreads(num_threads),
+              [&](std::size_t i) {
+                SubRipFile file;
+                try {
+                  file.LoadState(paths[i]);
+                } catch (const std::exception& e) {
+                  on_load(i, nullptr, e.what());
+                  return;
+                }
+                on_load(i, &file, "");
+              });
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,90 @@
+#ifndef SUBTITLER_SRT_SUBRIP_LOADER_H
+#define SUBTITLER_SRT_SUBRIP_LOADER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Parallel loading of large SRT files and of whole directories of them,
+ * for batch jobs. Interactive code should keep using SubRipFile::LoadState.
+ *
+ * In every function num_threads = 0 means std::thread::hardware_concurrency.
+ */
+
+/**
+ * Splits contents into chunks just after blank lines, which are always cue
+ * boundaries, parses the chunks concurrently and merges the sorted runs.
+ *
+ * The result is identical to SubRipFile::LoadState on the same contents:
+ * items are sorted by start time, with ties in file order. If any cue is
+ * malformed, throws the same SubRipParseError (message and byte offset) that
+ * the single threaded parser would, i.e. the first error in the file.
+ */
+std::vector<std::shared_ptr<SubRipItem>> ParseSubRipParallel(
+    std::string_view contents, std::size_t num_threads = 0);
+
+// Memory maps the file and parses it with ParseSubRipParallel.
+// Throws on failure, like SubRipFile::LoadState.
+SubRipFile LoadSubRipParallel(const std::filesystem::path& file_name,
+                              std::size_t num_threads = 0);
+
+struct SubRipLoadResult {
+  std::filesystem::path path;
+  // Set if the file loaded successfully.
+  std::optional<SubRipFile> file;
+  // Set to the exception message if the file failed to load.
+  std::string error;
+};
+
+/**
+ * Loads every file with a .srt extension (any case) under directory,
+ * recursively, with one file per thread at a time. A file which fails to load
+ * does not stop the others, its error is reported in the result instead.
+ *
+ * Results are sorted by path.
+ * Throws std::filesystem::filesystem_error if the directory can't be read.
+ */
+std::vector<SubRipLoadResult> LoadSubRipDirectory(
+    const std::filesystem::path& directory, std::size_t num_threads = 0);
+
+// Every file with a .srt extension (any case) under directory, recursively,
+// sorted. Throws std::filesystem::filesystem_error if the directory can't be
+// read.
+std::vector<std::filesystem::path> ListSubRipFiles(
+    const std::filesystem::path& directory);
+
+/**
+ * Same as LoadSubRipDirectory on the given paths, but each file is handed to
+ * on_load(index into paths, file, error) as soon as it is loaded, and then
+ * dropped. Memory stays bounded by the number of threads rather than the
+ * number of files. file is null and error set if the file failed to load.
+ *
+ * on_load is called concurrently from several threads, and must not throw.
+ */
+void ForEachSubRipFile(
+    const std::vector<std::filesystem::path>& paths, std::size_t num_threads,
+    const std::function<void(std::size_t, const SubRipFile*,
+                             const std::string&)>& on_load);
+
+// Runs task(0), ..., task(num_tasks - 1) on up to num_threads threads,
+// including the calling thread, each taking the next task as soon as it is
+// done with one. task must not throw.
+void ParallelFor(std::size_t num_tasks, std::size_t num_threads,
+                 const std::function<void(std::size_t)>& task);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,196 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "subtitler/srt/lazy_subrip_file.h"
+#include "subtitler/srt/subrip_cache.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_loader.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::LazySubRipFile;
+using subtitler::srt::LoadSubRipCached;
+using subtitler::srt::LoadSubRipDirectory;
+using subtitler::srt::LoadSubRipParallel;
+using subtitler::srt::RebuildSubRipCacheInBackground;
+using subtitler::srt::SubRipCache;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubRipSource;
+using subtitler::srt::WaitForSubRipCacheWrites;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void WriteFile(const fs::path& path, std::size_t num_items) {
+  std::ofstream stream{path};
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})
+        ->duration(2s)
+        ->AppendLine("This is the subtitle for cue number " + std::to_string(i))
+        ->AppendLine("and a second line of dialogue.");
+    item.ToStream(i + 1, stream, /* flush= */ false);
+    stream << '\n';
+  }
+}
+
+// Single large file, parsed with state.range(0) threads.
+void BM_LoadSubRipParallel(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, 500'000);
+  std::size_t num_threads = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LoadSubRipParallel(path, num_threads).NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * 500'000);
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+// Parses every time, LoadState doesn't use the cache.
+void BM_LoadState(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, 500'000);
+  for (auto _ : state) {
+    SubRipFile file;
+    file.LoadState(path);
+    benchmark::DoNotOptimize(file.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * 500'000);
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+// Loads from a fresh cache, materializing every cue.
+void BM_LoadSubRipCached(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, state.range(0));
+  LoadSubRipCached(path);
+  WaitForSubRipCacheWrites();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LoadSubRipCached(path).size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  fs::remove(SubRipCache::CachePath(path));
+  fs::remove(path);
+}
+
+// Only maps and validates the cache, which doesn't depend on the number of
+// cues.
+void BM_OpenCache(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, state.range(0));
+  LoadSubRipCached(path);
+  WaitForSubRipCacheWrites();
+  for (auto _ : state) {
+    auto cache = SubRipCache::Open(path);
+    benchmark::DoNotOptimize(cache->payload(cache->NumItems() - 1));
+  }
+  fs::remove(SubRipCache::CachePath(path));
+  fs::remove(path);
+}
+
+// Time the caller of RebuildSubRipCacheInBackground is blocked for, the
+// serialization happens on the writer thread.
+void BM_ScheduleCacheRebuild(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, state.range(0));
+  SubRipSource source;
+  auto items = LoadSubRipCached(path, &source);
+  for (auto _ : state) {
+    RebuildSubRipCacheInBackground(path, source, items);
+    state.PauseTiming();
+    WaitForSubRipCacheWrites();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  fs::remove(SubRipCache::CachePath(path));
+  fs::remove(path);
+}
+
+// What the caller used to be blocked for.
+void BM_SerializeCache(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, state.range(0));
+  SubRipSource source;
+  auto items = LoadSubRipCached(path, &source);
+  WaitForSubRipCacheWrites();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SubRipCache::Serialize(source, items).size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  fs::remove(SubRipCache::CachePath(path));
+  fs::remove(path);
+}
+
+// Only indexes timings, payloads are decoded on access.
+void BM_LazyOpen(benchmark::State& state) {
+  auto path = fs::temp_directory_path() / "subrip_loader_benchmark.srt";
+  WriteFile(path, 500'000);
+  for (auto _ : state) {
+    LazySubRipFile file{path};
+    benchmark::DoNotOptimize(file.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * 500'000);
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+// Directory of 200 files with 2k cues each, loaded with state.range(0)
+// threads.
+void BM_LoadSubRipDirectory(benchmark::State& state) {
+  auto dir = fs::temp_directory_path() / "subrip_loader_benchmark_dir";
+  fs::create_directories(dir);
+  for (int i = 0; i < 200; ++i) {
+    WriteFile(dir / (std::to_string(i) + ".srt"), 2'000);
+  }
+  std::size_t num_threads = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LoadSubRipDirectory(dir, num_threads).size());
+  }
+  state.SetItemsProcessed(state.iterations() * 200 * 2'000);
+  fs::remove_all(dir);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoadState)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LazyOpen)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadSubRipCached)
+    ->Arg(1'000)
+    ->Arg(500'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_OpenCache)->Arg(1'000)->Arg(500'000)->UseRealTime();
+BENCHMARK(BM_ScheduleCacheRebuild)
+    ->Arg(500'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_SerializeCache)
+    ->Arg(500'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+// The CPU column is the time of all threads, so CPU / Time is the number of
+// cores kept busy. The warm-up runs first, so that the page cache and the
+// allocator are in the same state at every thread count.
+BENCHMARK(BM_LoadSubRipParallel)
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->Unit(benchmark::kMillisecond)
+    ->MinWarmUpTime(1)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+BENCHMARK(BM_LoadSubRipDirectory)
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->Unit(benchmark::kMillisecond)
+    ->MinWarmUpTime(1)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
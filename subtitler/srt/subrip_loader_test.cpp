@@ -0,0 +1,188 @@
+#include "subtitler/srt/subrip_loader.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "subtitler/srt/subrip_cache.h"
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::HasSubstr;
+
+namespace {
+
+// Large enough to be split into many chunks. Start times go backwards every
+// few cues and repeat, so merging and tie order both matter.
+std::string MakeContents(std::size_t num_items) {
+  std::ostringstream output;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{(i % 1000) * 100 + (i % 7) * 10})
+        ->duration(1s)
+        ->AppendLine("cue " + std::to_string(i))
+        ->AppendLine("second line");
+    if (i % 5 == 0) {
+      item.position("top-left");
+    }
+    item.ToStream(i + 1, output, /* flush= */ false);
+    // Mix of line endings and extra blank lines between cues.
+    output << (i % 3 == 0 ? "\r\n" : "\n");
+    if (i % 11 == 0) {
+      output << "\n";
+    }
+  }
+  return output.str();
+}
+
+std::string Print(const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  std::ostringstream output;
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    items[i]->ToStream(i + 1, output, /* flush= */ false);
+  }
+  return output.str();
+}
+
+fs::path TestDir() {
+  return GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR"));
+}
+
+void ExpectSameError(const std::string& contents) {
+  std::string expected;
+  try {
+    ParseSubRip(contents);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    expected = e.what();
+  }
+  try {
+    ParseSubRipParallel(contents, 4);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    ASSERT_EQ(expected, e.what());
+  }
+}
+
+}  // namespace
+
+TEST(SubRipLoaderTest, MatchesLoadState) {
+  auto contents = MakeContents(40'000);
+  auto path = TestDir() / "parallel.srt";
+  {
+    std::ofstream stream{path, std::ios::binary};
+    stream << contents;
+  }
+  SubRipFile expected;
+  expected.LoadState(path);
+
+  for (std::size_t num_threads : {1, 2, 3, 8}) {
+    auto actual = LoadSubRipParallel(path, num_threads);
+    ASSERT_EQ(expected.NumItems(), actual.NumItems());
+    ASSERT_EQ(Print(expected.GetItems()), Print(actual.GetItems()));
+    ASSERT_EQ(expected.GetCollisions(50s, 1s).size(),
+              actual.GetCollisions(50s, 1s).size());
+  }
+  fs::remove(path);
+}
+
+TEST(SubRipLoaderTest, ReportsFirstErrorInFile) {
+  auto contents = MakeContents(40'000);
+  // Error late in the file.
+  ExpectSameError(contents + "1\n00:00:01,000 --> 00:00:00,000\n");
+
+  // Two errors, the later one in an earlier position of some chunk.
+  auto middle = contents.size() / 2;
+  auto broken = contents;
+  broken.insert(contents.find("\n\n", middle) + 2, "abc\n");
+  ExpectSameError(broken + "1\n00:00:01,000 --> 00:00:00,000\n");
+
+  // Sequence number directly followed by a blank line, at every boundary
+  // candidate.
+  auto missing = contents;
+  missing.insert(contents.find("\n\n", middle) + 2, "5\n\n");
+  ExpectSameError(missing);
+}
+
+TEST(SubRipLoaderTest, DecodesOtherEncodings) {
+  // UTF-16LE with a byte order mark, and Windows-1252.
+  std::string utf16 = "\xFF\xFE";
+  for (char c : std::string_view{"1\r\n00:00:01,000 --> 00:00:02,000\r\n"}) {
+    utf16 += c;
+    utf16 += '\0';
+  }
+  utf16.append("\xE9\0\x20\x20\r\0\n\0", 8);
+  const std::string windows1252 =
+      "1\n00:00:01,000 --> 00:00:02,000\n\xE9\x80\n";
+  for (const auto& [contents, payload] :
+       {std::pair{utf16, "\xC3\xA9\xE2\x80\xA0\n"},
+        std::pair{windows1252, "\xC3\xA9\xE2\x82\xAC\n"}}) {
+    auto path = TestDir() / "encoded.srt";
+    {
+      std::ofstream stream{path, std::ios::binary};
+      stream << contents;
+    }
+    auto file = LoadSubRipParallel(path, 2);
+    ASSERT_EQ(1, file.NumItems());
+    ASSERT_EQ(payload, file.GetItems()[0]->payload());
+
+    SubRipFile loaded;
+    loaded.LoadState(path);
+    ASSERT_EQ(1, loaded.NumItems());
+    ASSERT_EQ(payload, loaded.GetItems()[0]->payload());
+    fs::remove(path);
+  }
+}
+
+TEST(SubRipLoaderTest, SmallInputs) {
+  ASSERT_TRUE(ParseSubRipParallel("", 4).empty());
+  auto items = ParseSubRipParallel(
+      "1\n00:00:02,000 --> 00:00:03,000\nb\n\n"
+      "2\n00:00:01,000 --> 00:00:02,000\na\n",
+      4);
+  ASSERT_EQ(2, items.size());
+  ASSERT_EQ("a\n", items[0]->payload());
+}
+
+TEST(SubRipLoaderTest, LoadsDirectory) {
+  auto dir = TestDir() / "subrip_loader_test_dir";
+  fs::create_directories(dir / "nested");
+  {
+    std::ofstream{dir / "b.srt"} << "1\n00:00:01,000 --> 00:00:02,000\nb\n";
+    std::ofstream{dir / "nested" / "a.SRT"}
+        << "1\n00:00:01,000 --> 00:00:02,000\na\n\n"
+           "2\n00:00:03,000 --> 00:00:04,000\na\n";
+    std::ofstream{dir / "c.srt"} << "1\n00:00:01,000 -> 00:00:02,000\n";
+    std::ofstream{dir / "ignored.txt"} << "not a subtitle";
+  }
+
+  auto results = LoadSubRipDirectory(dir, 2);
+  ASSERT_EQ(3, results.size());
+  ASSERT_EQ(dir / "b.srt", results[0].path);
+  ASSERT_EQ(1, results[0].file->NumItems());
+  ASSERT_EQ(dir / "c.srt", results[1].path);
+  ASSERT_FALSE(results[1].file);
+  ASSERT_THAT(results[1].error, HasSubstr("Expected \"-->\" but got: ->"));
+  ASSERT_EQ(dir / "nested" / "a.SRT", results[2].path);
+  ASSERT_EQ(2, results[2].file->NumItems());
+  ASSERT_TRUE(results[2].error.empty());
+
+  // Batch loads leave the directory as it was.
+  ASSERT_FALSE(fs::exists(SubRipCache::CachePath(dir / "b.srt")));
+  ASSERT_FALSE(fs::exists(SubRipCache::CachePath(dir / "nested" / "a.SRT")));
+  fs::remove_all(dir);
+  ASSERT_THROW(LoadSubRipDirectory(dir), fs::filesystem_error);
+}
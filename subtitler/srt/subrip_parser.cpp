@@ -0,0 +1,451 @@
+#include "subtitler/srt/subrip_parser.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Walks the contents line by line without copying.
+class LineReader {
+ public:
+  explicit LineReader(std::string_view contents) : contents_{contents} {}
+
+  // Returns false once all lines are consumed. The line excludes the line
+  // ending, including the '\r' of a "\r\n" ending.
+  bool Next(std::string_view& line, std::size_t& line_offset) {
+    if (pos_ >= contents_.size()) {
+      return false;
+    }
+    line_offset = pos_;
+    auto newline = contents_.find('\n', pos_);
+    if (newline == std::string_view::npos) {
+      line = contents_.substr(pos_);
+      pos_ = contents_.size();
+    } else {
+      line = contents_.substr(pos_, newline - pos_);
+      pos_ = newline + 1;
+    }
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    return true;
+  }
+
+ private:
+  std::string_view contents_;
+  std::size_t pos_ = 0;
+};
+
+[[noreturn]] void ThrowAt(const std::string& message, std::size_t offset) {
+  throw SubRipParseError{message, offset};
+}
+
+// Same as std::stoi: skips leading whitespace, accepts a sign, and ignores
+// anything after the digits.
+bool ParseSequenceNumber(std::string_view line) {
+  std::size_t i = 0;
+  while (i < line.size() && IsSpace(line[i])) {
+    ++i;
+  }
+  if (i < line.size() && line[i] == '+') {
+    ++i;
+  }
+  int ignored = 0;
+  auto [ptr, ec] =
+      std::from_chars(line.data() + i, line.data() + line.size(), ignored);
+  return ec == std::errc{};
+}
+
+// Parses [[H:]M:]S[,mmm] where the fraction may also be separated by '.'.
+std::optional<std::chrono::milliseconds> ParseTimestamp(
+    std::string_view token) {
+  std::int64_t fields[3] = {0, 0, 0};
+  int num_fields = 0;
+  std::size_t i = 0;
+  for (;;) {
+    if (num_fields == 3 || i >= token.size() || !IsDigit(token[i])) {
+      return std::nullopt;
+    }
+    std::int64_t value = 0;
+    while (i < token.size() && IsDigit(token[i])) {
+      value = value * 10 + (token[i] - '0');
+      if (value > 1'000'000'000) {
+        return std::nullopt;
+      }
+      ++i;
+    }
+    fields[num_fields++] = value;
+    if (i < token.size() && token[i] == ':') {
+      ++i;
+      continue;
+    }
+    break;
+  }
+  std::int64_t millis = 0;
+  if (i < token.size() && (token[i] == ',' || token[i] == '.')) {
+    ++i;
+    // Only millisecond precision is kept, extra digits are truncated.
+    std::int64_t scale = 100;
+    while (i < token.size() && IsDigit(token[i])) {
+      millis += (token[i] - '0') * scale;
+      scale /= 10;
+      ++i;
+    }
+  }
+  if (i != token.size()) {
+    return std::nullopt;
+  }
+  std::int64_t hours = 0, minutes = 0, seconds = 0;
+  switch (num_fields) {
+    case 1:
+      seconds = fields[0];
+      break;
+    case 2:
+      minutes = fields[0];
+      seconds = fields[1];
+      break;
+    default:
+      hours = fields[0];
+      minutes = fields[1];
+      seconds = fields[2];
+      break;
+  }
+  // Like the legacy parser, minutes and seconds don't roll over.
+  if (minutes >= 60 || seconds >= 60) {
+    return std::nullopt;
+  }
+  return std::chrono::milliseconds{((hours * 60 + minutes) * 60 + seconds) *
+                                       1000 +
+                                   millis};
+}
+
+// Splits the line into the first 3 whitespace separated tokens.
+// Returns false if there are fewer than 3.
+bool SplitTimestampLine(std::string_view line, std::string_view (&tokens)[3]) {
+  std::size_t i = 0;
+  for (auto& token : tokens) {
+    while (i < line.size() && IsSpace(line[i])) {
+      ++i;
+    }
+    auto begin = i;
+    while (i < line.size() && !IsSpace(line[i])) {
+      ++i;
+    }
+    if (begin == i) {
+      return false;
+    }
+    token = line.substr(begin, i - begin);
+  }
+  return true;
+}
+
+// Parses a timestamp of the form HH:MM:SS,mmm, which is what SRT writers
+// produce, without the general tokenizer. Returns nullopt for any other
+// form, even if ParseTimestamp accepts it.
+std::optional<std::chrono::milliseconds> ParseCanonicalTimestamp(
+    std::string_view token) {
+  constexpr std::string_view kPattern = "00:00:00,000";
+  if (token.size() != kPattern.size()) {
+    return std::nullopt;
+  }
+  std::int64_t fields[4] = {0, 0, 0, 0};
+  std::size_t field = 0;
+  for (std::size_t i = 0; i < token.size(); ++i) {
+    if (kPattern[i] == '0') {
+      if (!IsDigit(token[i])) {
+        return std::nullopt;
+      }
+      fields[field] = fields[field] * 10 + (token[i] - '0');
+    } else if (token[i] == kPattern[i] || (i == 8 && token[i] == '.')) {
+      ++field;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (fields[1] >= 60 || fields[2] >= 60) {
+    return std::nullopt;
+  }
+  return std::chrono::milliseconds{
+      ((fields[0] * 60 + fields[1]) * 60 + fields[2]) * 1000 + fields[3]};
+}
+
+void ParseTimestamps(std::string_view line, std::size_t offset,
+                     SubRipItem& item) {
+  // Fast path for "HH:MM:SS,mmm --> HH:MM:SS,mmm", possibly followed by
+  // more tokens which are ignored. Anything else, including errors, goes
+  // through the general path below.
+  constexpr std::size_t kCanonicalSize = 29;
+  if (line.size() >= kCanonicalSize &&
+      (line.size() == kCanonicalSize || IsSpace(line[kCanonicalSize])) &&
+      line.substr(12, 5) == " --> ") {
+    auto start = ParseCanonicalTimestamp(line.substr(0, 12));
+    auto end = ParseCanonicalTimestamp(line.substr(17, 12));
+    if (start && end && *start <= *end) {
+      item.start(*start)->duration(*end - *start);
+      return;
+    }
+  }
+
+  std::string_view tokens[3];
+  if (!SplitTimestampLine(line, tokens)) {
+    ThrowAt("Could not parse timestamp line: " + std::string{line}, offset);
+  }
+  if (tokens[1] != "-->") {
+    ThrowAt("Expected \"-->\" but got: " + std::string{tokens[1]}, offset);
+  }
+  auto start = ParseTimestamp(tokens[0]);
+  auto end = ParseTimestamp(tokens[2]);
+  if (!start || !end) {
+    ThrowAt("Could not parse timestamp values: " + std::string{line}, offset);
+  }
+  if (*start > *end) {
+    ThrowAt("Start time cannot be greater than end: " + std::string{line},
+            offset);
+  }
+  item.start(*start)->duration(*end - *start);
+}
+
+// Should be called on the FIRST line of the subtitle body.
+// If line is "{\anX}Hello World!" then sets the position to X and
+// removes the tag from line.
+void ExtractPosIdIfExists(std::string_view& line, std::size_t offset,
+                          SubRipItem& item) {
+  constexpr std::string_view kPosTagPrefix = "{\\an";
+  if (line.rfind("{\\a", 0) != 0) {
+    return;
+  }
+  std::size_t i = kPosTagPrefix.size();
+  bool did_match = line.rfind(kPosTagPrefix, 0) == 0;
+  auto digits_begin = i;
+  while (did_match && i < line.size() && IsDigit(line[i])) {
+    ++i;
+  }
+  did_match = did_match && i > digits_begin && i < line.size() &&
+              line[i] == '}';
+  if (!did_match) {
+    ThrowAt("Unsupported position token format: " + std::string{line},
+            offset);
+  }
+  int pos_id = 0;
+  auto [ptr, ec] =
+      std::from_chars(line.data() + digits_begin, line.data() + i, pos_id);
+  if (ec != std::errc{} || pos_id < 1 || pos_id > 9) {
+    ThrowAt("Position id must be between [1, 9]: " + std::string{line},
+            offset);
+  }
+  item.substation_alpha_position(pos_id);
+  line.remove_prefix(i + 1);
+}
+
+// Parses the cue whose sequence number is line, up to the blank line after
+// it, into item.
+void ParseCue(LineReader& reader, std::string_view line, std::size_t offset,
+              SubRipItem& item) {
+  if (!ParseSequenceNumber(line)) {
+    ThrowAt("Could not parse sequence number from: " + std::string{line},
+            offset);
+  }
+  // Next line is the timestamps
+  if (!reader.Next(line, offset) || line.empty()) {
+    ThrowAt("Timestamps were missing.", offset);
+  }
+  ParseTimestamps(line, offset, item);
+
+  // Sizes the payload up front, with a newline per line, so that appending
+  // the lines doesn't reallocate.
+  std::size_t payload_size = 0;
+  for (auto body = reader; body.Next(line, offset) && !line.empty();) {
+    payload_size += line.size() + 1;
+  }
+  item.ReservePayload(payload_size);
+
+  bool first_line = true;
+  while (reader.Next(line, offset) && !line.empty()) {
+    // Add subtitle body
+    if (first_line) {
+      // First line, may contain position token.
+      ExtractPosIdIfExists(line, offset, item);
+      first_line = false;
+    }
+    item.AppendLine(line);
+  }
+}
+
+// Payloads this short are left inline by SubRipItem::InternPayload().
+bool IsInternable(std::string_view payload) {
+  return payload.size() > std::string{}.capacity();
+}
+
+// Interns the payloads which occur more than once in items, given the hash
+// of every internable payload. Unique payloads stay owned by their item, so
+// loading a file without repeats never takes the locks of the global pool.
+void InternRepeatedPayloads(
+    const std::vector<std::shared_ptr<SubRipItem>>& items,
+    const std::vector<std::size_t>& hashes) {
+  // Indices are 32 bits to keep the table small, files with more cues are
+  // not checked for repeats.
+  if (items.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    return;
+  }
+  // Open addressing table of item indices, at most half full.
+  constexpr auto kEmpty = std::numeric_limits<std::uint32_t>::max();
+  std::size_t num_slots = 16;
+  while (num_slots < 2 * items.size()) {
+    num_slots *= 2;
+  }
+  std::vector<std::uint32_t> slots(num_slots, kEmpty);
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    auto& item = *items[i];
+    auto text = item.payload();
+    if (!IsInternable(text)) {
+      continue;
+    }
+    for (auto slot = hashes[i] & (num_slots - 1);;
+         slot = (slot + 1) & (num_slots - 1)) {
+      auto first = slots[slot];
+      if (first == kEmpty) {
+        slots[slot] = static_cast<std::uint32_t>(i);
+        break;
+      }
+      if (hashes[first] == hashes[i] && items[first]->payload() == text) {
+        // InternPayload() is a no-op after the first repeat.
+        items[first]->InternPayload();
+        item.InternPayload();
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+SubRipParseError::SubRipParseError(const std::string& message,
+                                   std::size_t offset)
+    : std::runtime_error{message + " (byte offset " + std::to_string(offset) +
+                         ")"},
+      message_{message},
+      offset_{offset} {}
+
+std::vector<std::shared_ptr<SubRipItem>> ParseSubRip(
+    std::string_view contents) {
+  std::vector<std::shared_ptr<SubRipItem>> items;
+  LineReader reader{contents};
+  std::string_view line;
+  std::size_t offset = 0;
+
+  // Hash of every internable payload, taken while it is still in cache.
+  std::vector<std::size_t> hashes;
+  const std::hash<std::string_view> hash;
+
+  while (reader.Next(line, offset)) {
+    if (line.empty()) {
+      continue;
+    }
+    // Encountered first non-empty line, which is the sequence number.
+    // This is required to be present but ignored, since in the context of
+    // the entire file we will reorder the sequence numbers.
+    auto& item = *items.emplace_back(std::make_shared<SubRipItem>());
+    ParseCue(reader, line, offset, item);
+    hashes.push_back(IsInternable(item.payload()) ? hash(item.payload()) : 0);
+  }
+
+  InternRepeatedPayloads(items, hashes);
+  return items;
+}
+
+void InternRepeatedSubRipPayloads(
+    const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  std::vector<std::size_t> hashes;
+  hashes.reserve(items.size());
+  const std::hash<std::string_view> hash;
+  for (const auto& item : items) {
+    hashes.push_back(IsInternable(item->payload()) ? hash(item->payload())
+                                                   : 0);
+  }
+  InternRepeatedPayloads(items, hashes);
+}
+
+void ParseSubRipCue(std::string_view contents, SubRipItem& item) {
+  LineReader reader{contents};
+  std::string_view line;
+  std::size_t offset = 0;
+  bool found = false;
+  while (reader.Next(line, offset)) {
+    if (line.empty()) {
+      continue;
+    }
+    if (found) {
+      ThrowAt("Expected a single cue", offset);
+    }
+    item = SubRipItem{};
+    ParseCue(reader, line, offset, item);
+    found = true;
+  }
+  if (!found) {
+    ThrowAt("Expected a single cue", 0);
+  }
+}
+
+std::optional<std::chrono::milliseconds> ParseSubRipTimestamp(
+    std::string_view token) {
+  return ParseTimestamp(token);
+}
+
+std::vector<SubRipCueSpan> IndexSubRip(std::string_view contents) {
+  std::vector<SubRipCueSpan> spans;
+  LineReader reader{contents};
+  std::string_view line;
+  std::size_t offset = 0;
+  // Receives the timestamps and position, the payload is never appended.
+  SubRipItem scratch;
+
+  while (reader.Next(line, offset)) {
+    if (line.empty()) {
+      continue;
+    }
+    if (!ParseSequenceNumber(line)) {
+      ThrowAt("Could not parse sequence number from: " + std::string{line},
+              offset);
+    }
+    if (!spans.empty()) {
+      spans.back().size = offset - spans.back().offset;
+    }
+    const std::size_t cue_offset = offset;
+    if (!reader.Next(line, offset) || line.empty()) {
+      ThrowAt("Timestamps were missing.", offset);
+    }
+    ParseTimestamps(line, offset, scratch);
+
+    bool first_line = true;
+    while (reader.Next(line, offset) && !line.empty()) {
+      if (first_line) {
+        ExtractPosIdIfExists(line, offset, scratch);
+        first_line = false;
+      }
+    }
+    spans.push_back({scratch.start(), scratch.duration(), cue_offset, 0});
+  }
+  if (!spans.empty()) {
+    spans.back().size = contents.size() - spans.back().offset;
+  }
+
+  return spans;
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,98 @@
+#ifndef SUBTITLER_SRT_SUBRIP_PARSER_H
+#define SUBTITLER_SRT_SUBRIP_PARSER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Thrown when SRT contents are malformed. The byte offset is the position
+ * of the start of the offending line, relative to the start of the contents.
+ */
+class SubRipParseError : public std::runtime_error {
+ public:
+  SubRipParseError(const std::string& message, std::size_t offset);
+
+  // The message without the byte offset.
+  const std::string& message() const { return message_; }
+  std::size_t offset() const { return offset_; }
+
+ private:
+  std::string message_;
+  std::size_t offset_;
+};
+
+/**
+ * Single pass SRT parser over an in-memory view of the file, such as a
+ * MemoryMappedFile. Lines are tokenized in place as string_views, and
+ * timestamps and {\anX} position tags are parsed by hand, so the only
+ * allocations are the resulting SubRipItems, each on its own so that a cue
+ * kept alive elsewhere doesn't pin its neighbours, and their payloads.
+ *
+ * Accepts the same inputs as SubRipItem(const std::string&), and additionally
+ * treats "\r\n" as a line ending.
+ *
+ * Payloads which occur more than once in contents are interned, see
+ * SubRipItem::InternPayload(). Unique payloads are left to the items.
+ *
+ * Returns the items in file order (NOT sorted by start time).
+ * Throws SubRipParseError if any cue is malformed.
+ */
+std::vector<std::shared_ptr<SubRipItem>> ParseSubRip(
+    std::string_view contents);
+
+// Interns the payloads which occur more than once in items, like
+// ParseSubRip() does, for items built some other way. Unique payloads stay
+// owned by their item, so items without repeats never take the locks of the
+// global pool.
+void InternRepeatedSubRipPayloads(
+    const std::vector<std::shared_ptr<SubRipItem>>& items);
+
+// Same as ParseSubRip on contents holding exactly one cue, possibly
+// surrounded by blank lines, which is parsed into item without the vector
+// and shared_ptr allocations. Throws SubRipParseError if the cue is
+// malformed or contents don't hold a single cue.
+void ParseSubRipCue(std::string_view contents, SubRipItem& item);
+
+// Parses a timestamp of the form [[H:]M:]S[,mmm], where the fraction may
+// also be separated by '.' and have any number of digits (only milliseconds
+// are kept). Also matches WebVTT and ASS timestamps. Returns nullopt if
+// token isn't one.
+std::optional<std::chrono::milliseconds> ParseSubRipTimestamp(
+    std::string_view token);
+
+// Location and timing of a cue, without its payload.
+struct SubRipCueSpan {
+  std::chrono::milliseconds start;
+  std::chrono::milliseconds duration;
+  // Byte range of the cue, from its sequence number up to the sequence
+  // number of the next cue (or the end of the contents), so that it includes
+  // the blank lines after the cue.
+  std::size_t offset;
+  std::size_t size;
+};
+
+/**
+ * Same validation as ParseSubRip, but only decodes the timestamps. Payload
+ * lines are skipped over, except to check the {\anX} tag of the first one.
+ * ParseSubRip(contents.substr(span.offset, span.size)) decodes a single cue.
+ *
+ * Returns the spans in file order.
+ * Throws SubRipParseError if any cue is malformed.
+ */
+std::vector<SubRipCueSpan> IndexSubRip(std::string_view contents);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
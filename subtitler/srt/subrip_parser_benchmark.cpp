@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/memory_mapped_file.h"
+
+using namespace std::chrono_literals;
+using subtitler::MemoryMappedFile;
+using subtitler::srt::ParseSubRip;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Writes an SRT file with num_items two line cues, every 10th positioned.
+fs::path WriteFile(std::size_t num_items) {
+  auto path = fs::temp_directory_path() /
+              ("subrip_parser_benchmark_" + std::to_string(num_items) + ".srt");
+  SubRipFile file;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})
+        ->duration(2s)
+        ->AppendLine("This is the subtitle for cue number " + std::to_string(i))
+        ->AppendLine("and a second line of dialogue.");
+    if (i % 10 == 0) {
+      item.position("top-center");
+    }
+    file.AddItem(item);
+  }
+  std::ofstream stream{path};
+  file.ToStream(stream);
+  return path;
+}
+
+// The previous implementation of SubRipFile::LoadState.
+std::vector<std::shared_ptr<SubRipItem>> LegacyLoad(const fs::path& path) {
+  std::ifstream stream{path};
+  std::vector<std::shared_ptr<SubRipItem>> new_items;
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::ostringstream item_stream;
+    item_stream << line << std::endl;
+    while (std::getline(stream, line) && !line.empty()) {
+      item_stream << line << std::endl;
+    }
+    auto item = std::make_shared<SubRipItem>(item_stream.str());
+    auto insert_here = std::lower_bound(
+        new_items.begin(), new_items.end(), item,
+        [](const auto& a, const auto& b) { return *a < *b; });
+    new_items.insert(insert_here, item);
+  }
+  return new_items;
+}
+
+void BM_LegacyLoadState(benchmark::State& state) {
+  auto path = WriteFile(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LegacyLoad(path));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+void BM_MappedParse(benchmark::State& state) {
+  auto path = WriteFile(state.range(0));
+  for (auto _ : state) {
+    MemoryMappedFile file{path};
+    benchmark::DoNotOptimize(ParseSubRip(file.contents()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+// The path SubtitleIntervalContainer::LoadSubripFile takes. The goal is 10x
+// BM_LegacyLoadState at every size.
+void BM_LoadState(benchmark::State& state) {
+  auto path = WriteFile(state.range(0));
+  for (auto _ : state) {
+    SubRipFile file;
+    file.LoadState(path);
+    benchmark::DoNotOptimize(file.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * fs::file_size(path));
+  fs::remove(path);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LegacyLoadState)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+BENCHMARK(BM_MappedParse)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+BENCHMARK(BM_LoadState)->Arg(1'000)->Arg(10'000)->Arg(100'000);
@@ -0,0 +1,229 @@
+#include "subtitler/srt/subrip_parser.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+
+namespace {
+
+std::string Print(const SubRipItem& item, std::size_t sequence_number) {
+  std::ostringstream output;
+  item.ToStream(sequence_number, output);
+  return output.str();
+}
+
+void ExpectParseError(const std::string& contents, const std::string& message,
+                      std::size_t offset) {
+  try {
+    ParseSubRip(contents);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    EXPECT_EQ(message + " (byte offset " + std::to_string(offset) + ")",
+              e.what());
+    EXPECT_EQ(offset, e.offset());
+  }
+}
+
+}  // namespace
+
+TEST(SubRipParserTest, ParsesItemsInFileOrder) {
+  std::string contents =
+      "\n"
+      "1\n"
+      "00:00:05,000 --> 00:00:06,500\n"
+      "{\\an8}Hello world\n"
+      "Second line\n"
+      "\n"
+      "\n"
+      "2\n"
+      "00:00:01,000 --> 00:00:02,000\n"
+      "Earlier\n";
+
+  auto items = ParseSubRip(contents);
+  ASSERT_EQ(2, items.size());
+
+  EXPECT_EQ(5s, items[0]->start());
+  EXPECT_EQ(1500ms, items[0]->duration());
+  EXPECT_EQ(8, items[0]->substation_alpha_position());
+  EXPECT_EQ(2, items[0]->num_lines());
+  EXPECT_EQ("Hello world\nSecond line\n", items[0]->GetPayload());
+
+  EXPECT_EQ(
+      "2\n"
+      "00:00:01,000 --> 00:00:02,000\n"
+      "Earlier\n",
+      Print(*items[1], 2));
+}
+
+TEST(SubRipParserTest, OwnsEachItemSeparately) {
+  std::shared_ptr<SubRipItem> kept;
+  std::weak_ptr<SubRipItem> dropped;
+  {
+    auto items = ParseSubRip(
+        "1\n00:00:01,000 --> 00:00:02,000\na\n\n"
+        "2\n00:00:03,000 --> 00:00:04,000\nb\n");
+    ASSERT_EQ(2, items.size());
+    kept = items[0];
+    dropped = items[1];
+  }
+  EXPECT_EQ("a\n", kept->GetPayload());
+  EXPECT_TRUE(dropped.expired());
+}
+
+TEST(SubRipParserTest, MatchesStringConstructor) {
+  std::string cue =
+      "456\n"
+      "01:02:03,004 --> 01:02:04,400\n"
+      "{\\an1}Hello world\n"
+      "Goodbye world\n";
+
+  auto items = ParseSubRip(cue);
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(Print(SubRipItem{cue}, 456), Print(*items[0], 456));
+}
+
+TEST(SubRipParserTest, InternsRepeatedPayloads) {
+  auto items = ParseSubRip(
+      "1\n00:00:01,000 --> 00:00:02,000\n[THUNDER RUMBLING]\n\n"
+      "2\n00:00:03,000 --> 00:00:04,000\n{\\an8}[THUNDER RUMBLING]\n\n"
+      "3\n00:00:05,000 --> 00:00:06,000\n[Music]\n\n"
+      "4\n00:00:07,000 --> 00:00:08,000\n[THUNDER RUMBLING AGAIN]\n");
+  ASSERT_EQ(4, items.size());
+  ASSERT_TRUE(items[0]->payload_interned());
+  ASSERT_EQ(items[0]->payload().data(), items[1]->payload().data());
+  ASSERT_FALSE(items[2]->payload_interned());
+  // Unique payloads are left to their item.
+  ASSERT_FALSE(items[3]->payload_interned());
+}
+
+TEST(SubRipParserTest, HandlesWindowsLineEndings) {
+  std::string contents =
+      "1\r\n"
+      "00:00:01,000 --> 00:00:02,000\r\n"
+      "Hello\r\n"
+      "\r\n"
+      "2\r\n"
+      "00:00:03,000 --> 00:00:04,000\r\n"
+      "World\r\n";
+
+  auto items = ParseSubRip(contents);
+  ASSERT_EQ(2, items.size());
+  EXPECT_EQ("Hello\n", items[0]->GetPayload());
+  EXPECT_EQ("World\n", items[1]->GetPayload());
+}
+
+TEST(SubRipParserTest, HandlesMissingTrailingNewlineAndNoBody) {
+  auto items = ParseSubRip("1\n00:00:01,000 --> 00:00:02,000");
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(0, items[0]->num_lines());
+  EXPECT_EQ(1s, items[0]->duration());
+}
+
+TEST(SubRipParserTest, ReportsErrorsWithByteOffsets) {
+  ExpectParseError("\nabc\n00:00:01,000 --> 00:00:02,000\n",
+                   "Could not parse sequence number from: abc", 1);
+  ExpectParseError("1\n\n", "Timestamps were missing.", 2);
+  ExpectParseError("1\n00:00:01,000 -->\n",
+                   "Could not parse timestamp line: 00:00:01,000 -->", 2);
+  ExpectParseError("1\n00:00:01,000 -> 00:00:02,000\n",
+                   "Expected \"-->\" but got: ->", 2);
+  ExpectParseError("1\n00:00:01,000 --> 00:00:0x,000\n",
+                   "Could not parse timestamp values: "
+                   "00:00:01,000 --> 00:00:0x,000",
+                   2);
+  ExpectParseError("1\n00:00:03,000 --> 00:00:02,000\n",
+                   "Start time cannot be greater than end: "
+                   "00:00:03,000 --> 00:00:02,000",
+                   2);
+  std::string first_cue = "1\n00:00:01,000 --> 00:00:02,000\nok\n\n";
+  ExpectParseError(first_cue + "2\n00:00:01,000 --> 00:00:02,000\n{\\a8}hi\n",
+                   "Unsupported position token format: {\\a8}hi",
+                   first_cue.size() + 32);
+  ExpectParseError(first_cue + "2\n00:00:01,000 --> 00:00:02,000\n{\\an0}hi\n",
+                   "Position id must be between [1, 9]: {\\an0}hi",
+                   first_cue.size() + 32);
+}
+
+TEST(SubRipParserTest, IndexMatchesParse) {
+  const std::string contents =
+      "\n1\r\n00:00:05,000 --> 00:00:06,500\r\n{\\an8}late\r\n\r\n"
+      "2\n0:1 --> 0:2\nearly\nsecond line\n\n\n"
+      "3\n00:00:07,000 --> 00:00:08,000";
+  auto spans = IndexSubRip(contents);
+  auto items = ParseSubRip(contents);
+  ASSERT_EQ(spans.size(), items.size());
+  for (std::size_t i = 0; i < spans.size(); ++i) {
+    EXPECT_EQ(spans[i].start, items[i]->start());
+    EXPECT_EQ(spans[i].duration, items[i]->duration());
+    auto cue = ParseSubRip(contents.substr(spans[i].offset, spans[i].size));
+    ASSERT_EQ(cue.size(), 1);
+    EXPECT_EQ(Print(*cue[0], 1), Print(*items[i], 1));
+  }
+  // Spans cover everything after the leading blank line.
+  EXPECT_EQ(spans[0].offset, 1);
+  EXPECT_EQ(spans[1].offset, spans[0].offset + spans[0].size);
+  EXPECT_EQ(spans[2].offset + spans[2].size, contents.size());
+
+  EXPECT_THROW(IndexSubRip("1\n00:00:01,000 --> 00:00:02,000\n{\\an0}hi\n"),
+               SubRipParseError);
+}
+
+TEST(SubRipParserTest, ParsesSingleCue) {
+  SubRipItem item;
+  item.substation_alpha_position(7)->AppendLine("stale");
+  ParseSubRipCue("\n1\r\n00:00:01,000 --> 00:00:02,000\r\nhi\r\n\r\n", item);
+  EXPECT_EQ(Print(item, 1), "1\n00:00:01,000 --> 00:00:02,000\nhi\n");
+
+  EXPECT_THROW(ParseSubRipCue("", item), SubRipParseError);
+  EXPECT_THROW(ParseSubRipCue("\n\n", item), SubRipParseError);
+  EXPECT_THROW(ParseSubRipCue("1\n00:00:01,000 --> 00:00:02,000\na\n\n"
+                              "2\n00:00:03,000 --> 00:00:04,000\nb\n",
+                              item),
+               SubRipParseError);
+}
+
+TEST(SubRipParserTest, ParsesTimestamps) {
+  EXPECT_EQ(ParseSubRipTimestamp("01:02:03,004"), 3'723'004ms);
+  EXPECT_EQ(ParseSubRipTimestamp("02:03.5"), 123'500ms);
+  EXPECT_EQ(ParseSubRipTimestamp("1:00:00.25"), 3'600'250ms);
+  EXPECT_FALSE(ParseSubRipTimestamp("").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("1:2:3:4").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("00:01,000x").has_value());
+}
+
+TEST(SubRipParserTest, RejectsMinutesAndSecondsPastRange) {
+  EXPECT_EQ(ParseSubRipTimestamp("00:59:59,999"), 3'599'999ms);
+  EXPECT_EQ(ParseSubRipTimestamp("100:00:00,000"), 360'000'000ms);
+  EXPECT_FALSE(ParseSubRipTimestamp("00:60:00,000").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("00:00:60,000").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("00:00:75.5").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("75:00").has_value());
+  EXPECT_FALSE(ParseSubRipTimestamp("60").has_value());
+  ExpectParseError("1\n00:00:01,000 --> 00:01:60,000\n",
+                   "Could not parse timestamp values: "
+                   "00:00:01,000 --> 00:01:60,000",
+                   2);
+}
+
+TEST(SubRipParserTest, ParsesTimestampLines) {
+  auto items = ParseSubRip(
+      "1\n00:00:01.250 --> 00:00:02,000 X1:10 X2:20\n\n"
+      "2\n 1:02,5 --> 00:01:03,000\n\n"
+      "3\n00:00:03,000 --> 00:00:04,000\t\n");
+  ASSERT_EQ(3, items.size());
+  EXPECT_EQ(1250ms, items[0]->start());
+  EXPECT_EQ(750ms, items[0]->duration());
+  EXPECT_EQ(62'500ms, items[1]->start());
+  EXPECT_EQ(500ms, items[1]->duration());
+  EXPECT_EQ(3s, items[2]->start());
+  EXPECT_EQ(1s, items[2]->duration());
+}
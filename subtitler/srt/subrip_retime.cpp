@@ -0,0 +1,184 @@
+#include "subtitler/srt/subrip_retime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+std::chrono::milliseconds MapLinear(std::chrono::milliseconds time,
+                                    std::chrono::milliseconds from,
+                                    std::chrono::milliseconds to,
+                                    double slope) {
+  auto offset = std::llround(static_cast<double>((time - from).count()) * slope);
+  return std::max(to + std::chrono::milliseconds{offset},
+                  std::chrono::milliseconds{0});
+}
+
+}  // namespace
+
+TimeMap::TimeMap(std::vector<Segment> segments)
+    : segments_{std::move(segments)} {}
+
+TimeMap TimeMap::Shift(std::chrono::milliseconds offset) {
+  TimeMap map{{{std::chrono::milliseconds{0}, offset, 1.0}}};
+  map.is_shift_ = true;
+  return map;
+}
+
+TimeMap TimeMap::Stretch(std::chrono::milliseconds anchor, double factor) {
+  if (!(factor > 0) || !std::isfinite(factor)) {
+    throw std::invalid_argument{"Stretch factor must be positive"};
+  }
+  return TimeMap{{{anchor, anchor, factor}}};
+}
+
+TimeMap TimeMap::FrameRate(double from_fps, double to_fps) {
+  if (!(from_fps > 0) || !(to_fps > 0)) {
+    throw std::invalid_argument{"Frame rates must be positive"};
+  }
+  // The same frame is shown earlier when played back faster.
+  return Stretch(std::chrono::milliseconds{0}, from_fps / to_fps);
+}
+
+TimeMap TimeMap::Piecewise(
+    std::vector<std::pair<std::chrono::milliseconds,
+                          std::chrono::milliseconds>>
+        anchors) {
+  if (anchors.empty()) {
+    throw std::invalid_argument{"Piecewise map needs at least one anchor"};
+  }
+  if (anchors.size() == 1) {
+    return Shift(anchors.front().second - anchors.front().first);
+  }
+  std::vector<Segment> segments;
+  segments.reserve(anchors.size() - 1);
+  for (std::size_t i = 0; i + 1 < anchors.size(); ++i) {
+    const auto& [from, to] = anchors[i];
+    const auto& [next_from, next_to] = anchors[i + 1];
+    if (next_from <= from) {
+      throw std::invalid_argument{"Anchors must be sorted without duplicates"};
+    }
+    if (next_to < to) {
+      throw std::invalid_argument{"Anchors must not reorder times"};
+    }
+    segments.push_back({from, to,
+                        static_cast<double>((next_to - to).count()) /
+                            static_cast<double>((next_from - from).count())});
+  }
+  return TimeMap{std::move(segments)};
+}
+
+std::chrono::milliseconds TimeMap::operator()(
+    std::chrono::milliseconds time) const {
+  if (is_shift_) {
+    return std::max(time + (segments_.front().to - segments_.front().from),
+                    std::chrono::milliseconds{0});
+  }
+  // The last segment starting at or before time, or the first one.
+  auto it = std::upper_bound(
+      segments_.begin() + 1, segments_.end(), time,
+      [](std::chrono::milliseconds t, const Segment& s) { return t < s.from; });
+  const auto& segment = *(it - 1);
+  return MapLinear(time, segment.from, segment.to, segment.slope);
+}
+
+void TimeMap::Apply(std::vector<std::chrono::milliseconds>& times) const {
+  if (is_shift_) {
+    const auto offset = segments_.front().to - segments_.front().from;
+    for (auto& time : times) {
+      time = std::max(time + offset, std::chrono::milliseconds{0});
+    }
+    return;
+  }
+  if (segments_.size() == 1) {
+    const auto& [from, to, slope] = segments_.front();
+    for (auto& time : times) {
+      time = MapLinear(time, from, to, slope);
+    }
+    return;
+  }
+  // Walks the segments along with the times, so sorted input only looks at
+  // each segment once.
+  std::size_t segment = 0;
+  for (auto& time : times) {
+    while (segment + 1 < segments_.size() &&
+           segments_[segment + 1].from <= time) {
+      ++segment;
+    }
+    while (segment > 0 && time < segments_[segment].from) {
+      --segment;
+    }
+    const auto& [from, to, slope] = segments_[segment];
+    time = MapLinear(time, from, to, slope);
+  }
+}
+
+void RetimeEdit::Undo(SubRipFile& file) const {
+  Apply(file, old_starts_, old_durations_, !reordered_);
+}
+
+void RetimeEdit::Redo(SubRipFile& file) const {
+  Apply(file, new_starts_, new_durations_, /* in_order= */ true);
+}
+
+void RetimeEdit::Apply(SubRipFile& file,
+                       const std::vector<std::chrono::milliseconds>& starts,
+                       const std::vector<std::chrono::milliseconds>& durations,
+                       bool in_order) const {
+  if (ids_.empty()) {
+    return;
+  }
+  if (in_order) {
+    file.RetimeItems(first_sequence_, starts, durations);
+    return;
+  }
+  for (std::size_t i = 0; i < ids_.size(); ++i) {
+    file.RetimeItem(ids_[i], starts[i], durations[i]);
+  }
+}
+
+RetimeEdit Retime(SubRipFile& file, const TimeMap& map,
+                  std::size_t first_sequence, std::size_t last_sequence) {
+  if (first_sequence <= 0 || last_sequence < first_sequence ||
+      last_sequence > file.NumItems()) {
+    throw std::out_of_range("invalid index passed to Retime()");
+  }
+  RetimeEdit edit;
+  edit.first_sequence_ = first_sequence;
+  auto count = last_sequence - first_sequence + 1;
+  file.GetTimings(first_sequence, count, edit.ids_, edit.old_starts_,
+                  edit.old_durations_);
+
+  // Ends are mapped separately rather than scaling durations, so that
+  // touching cues stay touching.
+  edit.new_starts_ = edit.old_starts_;
+  std::vector<std::chrono::milliseconds> ends(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    ends[i] = edit.old_starts_[i] + edit.old_durations_[i];
+  }
+  map.Apply(edit.new_starts_);
+  map.Apply(ends);
+  edit.new_durations_.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    edit.new_durations_[i] = std::max(ends[i] - edit.new_starts_[i],
+                                      std::chrono::milliseconds{0});
+  }
+
+  edit.reordered_ =
+      !file.RetimeItems(first_sequence, edit.new_starts_, edit.new_durations_);
+  return edit;
+}
+
+RetimeEdit RetimeAll(SubRipFile& file, const TimeMap& map) {
+  if (file.NumItems() == 0) {
+    return {};
+  }
+  return Retime(file, map, 1, file.NumItems());
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,131 @@
+#ifndef SUBTITLER_SRT_SUBRIP_RETIME_H
+#define SUBTITLER_SRT_SUBRIP_RETIME_H
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Monotonic piecewise linear map of subtitle times, e.g. to fix subtitles
+ * after a re-cut or a frame rate conversion. Times which would map below 0
+ * are clamped to 0.
+ *
+ * Sample Usage:
+ * // Subtitles timed for 23.976 fps, video sped up to 25 fps.
+ * auto map = TimeMap::FrameRate(23.976, 25);
+ * auto edit = RetimeAll(file, map);
+ * ...
+ * edit.Undo(file);
+ */
+class TimeMap {
+ public:
+  // Adds offset to every time.
+  static TimeMap Shift(std::chrono::milliseconds offset);
+
+  // Scales the distance of every time to anchor by factor, which must be
+  // positive. Throws std::invalid_argument otherwise.
+  static TimeMap Stretch(std::chrono::milliseconds anchor, double factor);
+
+  // Converts times for video at from_fps to the same frames at to_fps.
+  // Throws std::invalid_argument unless both are positive.
+  static TimeMap FrameRate(double from_fps, double to_fps);
+
+  // Maps each anchor.first to anchor.second, linearly in between. Times
+  // before the first or after the last anchor follow the nearest segment,
+  // or are shifted if there is a single anchor.
+  // Throws std::invalid_argument if there are no anchors, if they are not
+  // sorted by first without duplicates, or if the map would reorder times
+  // (second is decreasing).
+  static TimeMap Piecewise(
+      std::vector<std::pair<std::chrono::milliseconds,
+                            std::chrono::milliseconds>>
+          anchors);
+
+  std::chrono::milliseconds operator()(std::chrono::milliseconds time) const;
+
+  // Maps all times in place. Mostly sorted input, like the start times of a
+  // SubRipFile, is the fast case for piecewise maps.
+  void Apply(std::vector<std::chrono::milliseconds>& times) const;
+
+ private:
+  // Maps times at or after from (or before the first segment) to
+  // to + (time - from) * slope.
+  struct Segment {
+    std::chrono::milliseconds from;
+    std::chrono::milliseconds to;
+    double slope;
+  };
+
+  explicit TimeMap(std::vector<Segment> segments);
+
+  std::vector<Segment> segments_;
+  // Exact integer shift, which doesn't round through a double.
+  bool is_shift_ = false;
+};
+
+/**
+ * A bulk retime of a SubRipFile, which can be undone and redone as one
+ * edit. Records the ids and both old and new timings of the retimed items.
+ * Undo() and Redo() must be applied to the file in the state right after
+ * the edit, or right after Undo() respectively, like entries of an undo
+ * stack.
+ */
+class RetimeEdit {
+ public:
+  RetimeEdit() = default;
+
+  std::size_t NumItems() const { return ids_.size(); }
+
+  // The retimed items, in their order before the edit.
+  const std::vector<SubRipFile::CueId>& ids() const { return ids_; }
+
+  // True if items had to move past other items, rather than keeping their
+  // sequence numbers.
+  bool reordered() const { return reordered_; }
+
+  void Undo(SubRipFile& file) const;
+  void Redo(SubRipFile& file) const;
+
+ private:
+  std::size_t first_sequence_ = 1;
+  bool reordered_ = false;
+  std::vector<SubRipFile::CueId> ids_;
+  std::vector<std::chrono::milliseconds> old_starts_;
+  std::vector<std::chrono::milliseconds> old_durations_;
+  std::vector<std::chrono::milliseconds> new_starts_;
+  std::vector<std::chrono::milliseconds> new_durations_;
+
+  // Sets the timings of ids_, which are at first_sequence in order unless
+  // the file was reordered.
+  void Apply(SubRipFile& file,
+             const std::vector<std::chrono::milliseconds>& starts,
+             const std::vector<std::chrono::milliseconds>& durations,
+             bool in_order) const;
+
+  friend RetimeEdit Retime(SubRipFile& file, const TimeMap& map,
+                           std::size_t first_sequence,
+                           std::size_t last_sequence);
+};
+
+// Maps the start and end of the items with sequence numbers in
+// [first_sequence, last_sequence] through map. The items keep their ids.
+// The timings are gathered into contiguous arrays and mapped in one pass, and
+// as long as the items stay sorted, which they do unless map moves them past
+// items outside of the range, the file is not re-sorted.
+// Throws std::out_of_range if invalid sequence is provided.
+RetimeEdit Retime(SubRipFile& file, const TimeMap& map,
+                  std::size_t first_sequence, std::size_t last_sequence);
+
+// Same as above, for all items.
+RetimeEdit RetimeAll(SubRipFile& file, const TimeMap& map);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_retime.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::RetimeAll;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::TimeMap;
+
+namespace {
+
+// Back to back cues of 1-6s, like a transcription.
+SubRipFile MakeFile(std::size_t num_items) {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<int> length_dist{1000, 6000};
+  SubRipFile::Builder builder;
+  builder.Reserve(num_items);
+  std::chrono::milliseconds start = 0ms;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    auto item = std::make_shared<SubRipItem>();
+    std::chrono::milliseconds length{length_dist(rng)};
+    item->start(start)->duration(length)->AppendLine("Hello world!");
+    builder.Add(item);
+    start += length;
+  }
+  return builder.Build();
+}
+
+void RunRetimeAll(benchmark::State& state, const TimeMap& map) {
+  auto file = MakeFile(state.range(0));
+  for (auto _ : state) {
+    // Undo keeps the file the same across iterations, and is timed too.
+    auto edit = RetimeAll(file, map);
+    edit.Undo(file);
+    benchmark::DoNotOptimize(edit.NumItems());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RetimeAllShift(benchmark::State& state) {
+  RunRetimeAll(state, TimeMap::Shift(1500ms));
+}
+
+void BM_RetimeAllFrameRate(benchmark::State& state) {
+  RunRetimeAll(state, TimeMap::FrameRate(23.976, 25));
+}
+
+void BM_RetimeAllPiecewise(benchmark::State& state) {
+  RunRetimeAll(state, TimeMap::Piecewise(
+                          {{0s, 0s}, {10min, 11min}, {1h, 1h}, {100h, 99h}}));
+}
+
+// Retiming cue by cue, as an editor would without the bulk operation.
+void BM_RetimeItemByItem(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  auto map = TimeMap::Shift(1500ms);
+  for (auto _ : state) {
+    for (std::size_t sequence = 1; sequence <= file.NumItems(); ++sequence) {
+      const auto& item = file.GetItem(sequence);
+      file.RetimeItem(file.GetId(sequence), map(item->start()),
+                      item->duration());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_RetimeAllShift)->Arg(10'000)->Arg(1'000'000)->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_RetimeAllFrameRate)
+    ->Arg(10'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RetimeAllPiecewise)
+    ->Arg(10'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RetimeItemByItem)
+    ->Arg(10'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,144 @@
+#include "subtitler/srt/subrip_retime.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+namespace {
+
+std::string ToString(const SubRipFile& file) {
+  std::ostringstream output;
+  file.ToStream(output);
+  return output.str();
+}
+
+std::vector<std::chrono::milliseconds> Starts(const SubRipFile& file) {
+  std::vector<std::chrono::milliseconds> starts;
+  for (const auto& item : file.GetItems()) {
+    starts.push_back(item->start());
+  }
+  return starts;
+}
+
+}  // namespace
+
+class SubRipRetimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SubRipItem item;
+    for (int i = 0; i < 5; ++i) {
+      item.start(std::chrono::seconds{10 * i})
+          ->duration(2s)
+          ->ClearPayload()
+          ->AppendLine(std::to_string(i));
+      ids.push_back(file.AddItem(item));
+    }
+  }
+
+  SubRipFile file;
+  std::vector<SubRipFile::CueId> ids;
+};
+
+TEST(TimeMapTest, Shift) {
+  auto map = TimeMap::Shift(-1500ms);
+  EXPECT_EQ(map(10s), 8500ms);
+  // Clamped at 0.
+  EXPECT_EQ(map(1s), 0ms);
+
+  std::vector<std::chrono::milliseconds> times{0ms, 2s, 3s};
+  map.Apply(times);
+  EXPECT_THAT(times, ElementsAre(0ms, 500ms, 1500ms));
+}
+
+TEST(TimeMapTest, StretchAndFrameRate) {
+  auto stretch = TimeMap::Stretch(10s, 2);
+  EXPECT_EQ(stretch(10s), 10s);
+  EXPECT_EQ(stretch(12s), 14s);
+  EXPECT_EQ(stretch(9s), 8s);
+
+  auto pal = TimeMap::FrameRate(23.976, 25);
+  EXPECT_EQ(pal(25s), 23976ms);
+  EXPECT_EQ(pal(0ms), 0ms);
+
+  EXPECT_THROW(TimeMap::Stretch(0s, 0), std::invalid_argument);
+  EXPECT_THROW(TimeMap::FrameRate(25, -1), std::invalid_argument);
+}
+
+TEST(TimeMapTest, Piecewise) {
+  auto map = TimeMap::Piecewise({{10s, 10s}, {20s, 30s}, {30s, 35s}});
+  EXPECT_EQ(map(15s), 20s);
+  EXPECT_EQ(map(20s), 30s);
+  EXPECT_EQ(map(25s), 32500ms);
+  // Extrapolated with the first and last segments.
+  EXPECT_EQ(map(8s), 6s);
+  EXPECT_EQ(map(40s), 40s);
+
+  // Unsorted input gives the same results as mapping one at a time.
+  std::vector<std::chrono::milliseconds> times{25s, 8s, 40s, 15s, 20s};
+  map.Apply(times);
+  EXPECT_THAT(times, ElementsAre(32500ms, 6s, 40s, 20s, 30s));
+
+  EXPECT_EQ(TimeMap::Piecewise({{5s, 7s}})(10s), 12s);
+  EXPECT_THROW(TimeMap::Piecewise({}), std::invalid_argument);
+  EXPECT_THROW(TimeMap::Piecewise({{2s, 0s}, {1s, 1s}}),
+               std::invalid_argument);
+  EXPECT_THROW(TimeMap::Piecewise({{1s, 2s}, {2s, 1s}}),
+               std::invalid_argument);
+}
+
+TEST_F(SubRipRetimeTest, RetimeAllKeepsIdsAndOrder) {
+  auto before = ToString(file);
+  auto edit = RetimeAll(file, TimeMap::Stretch(0s, 0.5));
+  EXPECT_EQ(edit.NumItems(), 5);
+  EXPECT_FALSE(edit.reordered());
+  EXPECT_THAT(Starts(file), ElementsAre(0s, 5s, 10s, 15s, 20s));
+  EXPECT_EQ(file.GetItem(2)->duration(), 1s);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(file.GetSequenceNumber(ids[i]), i + 1);
+  }
+  // The overlap index follows the new timings.
+  EXPECT_EQ(file.GetCollisions(20s, 0s).size(), 1);
+
+  edit.Undo(file);
+  EXPECT_EQ(ToString(file), before);
+  edit.Redo(file);
+  EXPECT_THAT(Starts(file), ElementsAre(0s, 5s, 10s, 15s, 20s));
+}
+
+TEST_F(SubRipRetimeTest, RetimeRangeWhichOvertakesOtherItems) {
+  auto before = ToString(file);
+  // Moves items 2 and 3 (10s and 20s) past item 5 (40s).
+  auto edit = Retime(file, TimeMap::Shift(35s), 2, 3);
+  EXPECT_TRUE(edit.reordered());
+  EXPECT_THAT(Starts(file), ElementsAre(0s, 30s, 40s, 45s, 55s));
+  EXPECT_EQ(file.GetSequenceNumber(ids[1]), 4);
+  EXPECT_EQ(file.GetSequenceNumber(ids[4]), 3);
+
+  edit.Undo(file);
+  EXPECT_EQ(ToString(file), before);
+  EXPECT_EQ(file.GetSequenceNumber(ids[1]), 2);
+  edit.Redo(file);
+  EXPECT_EQ(file.GetSequenceNumber(ids[2]), 5);
+}
+
+TEST_F(SubRipRetimeTest, InvalidRanges) {
+  EXPECT_THROW(Retime(file, TimeMap::Shift(1s), 0, 1), std::out_of_range);
+  EXPECT_THROW(Retime(file, TimeMap::Shift(1s), 3, 2), std::out_of_range);
+  EXPECT_THROW(Retime(file, TimeMap::Shift(1s), 1, 6), std::out_of_range);
+
+  SubRipFile empty;
+  EXPECT_EQ(RetimeAll(empty, TimeMap::Shift(1s)).NumItems(), 0);
+}
@@ -0,0 +1,220 @@
+#include "subtitler/srt/subrip_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+constexpr std::size_t kTrigramSize = 3;
+// Posting lists intersected per query, see SubRipSearchIndex::Find().
+constexpr std::size_t kMaxLists = 3;
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+char ToLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+// Text as it is searched: markup removed, ASCII letters lowercased and
+// whitespace collapsed to single spaces, without leading or trailing ones.
+// A '<' or '{' without its closing bracket is kept as text.
+std::string Normalize(std::string_view text) {
+  std::string normalized;
+  normalized.reserve(text.size());
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '<' || c == '{') {
+      auto end = text.find(c == '<' ? '>' : '}', i + 1);
+      if (end != std::string_view::npos) {
+        i = end;
+        continue;
+      }
+    }
+    if (IsSpace(c)) {
+      if (!normalized.empty() && normalized.back() != ' ') {
+        normalized.push_back(' ');
+      }
+      continue;
+    }
+    normalized.push_back(ToLower(c));
+  }
+  if (!normalized.empty() && normalized.back() == ' ') {
+    normalized.pop_back();
+  }
+  return normalized;
+}
+
+// Distinct trigrams of normalized text, sorted.
+std::vector<std::uint32_t> GetTrigrams(std::string_view text) {
+  std::vector<std::uint32_t> trigrams;
+  if (text.size() < kTrigramSize) {
+    return trigrams;
+  }
+  trigrams.reserve(text.size() - kTrigramSize + 1);
+  for (std::size_t i = 0; i + kTrigramSize <= text.size(); ++i) {
+    trigrams.push_back(static_cast<unsigned char>(text[i]) << 16 |
+                       static_cast<unsigned char>(text[i + 1]) << 8 |
+                       static_cast<unsigned char>(text[i + 2]));
+  }
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                 trigrams.end());
+  return trigrams;
+}
+
+}  // namespace
+
+SubRipSearchIndex::SubRipSearchIndex(const SubRipFile& file) {
+  if (file.NumItems() == 0) {
+    return;
+  }
+  std::vector<CueId> ids;
+  std::vector<std::chrono::milliseconds> starts;
+  std::vector<std::chrono::milliseconds> durations;
+  file.GetTimings(1, file.NumItems(), ids, starts, durations);
+  cues_.reserve(ids.size());
+  file.ForEachItem([&](std::size_t sequence_number, const auto& item) {
+    Append(ids[sequence_number - 1], item->payload());
+  });
+}
+
+SubRipSearchIndex::SubRipSearchIndex(
+    const std::vector<std::pair<CueId, std::string>>& cues) {
+  cues_.reserve(cues.size());
+  for (const auto& [id, payload] : cues) {
+    Append(id, payload);
+  }
+}
+
+void SubRipSearchIndex::Append(CueId id, std::string_view payload) {
+  const auto slot = static_cast<Slot>(cues_.size());
+  cues_.push_back({id, Normalize(payload)});
+  slot_of_.emplace(id, slot);
+  for (auto trigram : GetTrigrams(cues_.back().text)) {
+    postings_[trigram].push_back(slot);
+  }
+}
+
+void SubRipSearchIndex::Update(CueId id, std::string_view payload) {
+  auto text = Normalize(payload);
+  Slot slot;
+  std::vector<Trigram> old_trigrams;
+  if (auto it = slot_of_.find(id); it != slot_of_.end()) {
+    slot = it->second;
+    if (cues_[slot].text == text) {
+      return;
+    }
+    old_trigrams = GetTrigrams(cues_[slot].text);
+  } else if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    slot_of_.emplace(id, slot);
+  } else {
+    slot = static_cast<Slot>(cues_.size());
+    cues_.emplace_back();
+    slot_of_.emplace(id, slot);
+  }
+  auto new_trigrams = GetTrigrams(text);
+  cues_[slot] = {id, std::move(text)};
+
+  // Only touch the lists of trigrams which were added or removed.
+  std::vector<Trigram> removed;
+  std::set_difference(old_trigrams.begin(), old_trigrams.end(),
+                      new_trigrams.begin(), new_trigrams.end(),
+                      std::back_inserter(removed));
+  for (auto trigram : removed) {
+    auto& slots = postings_[trigram];
+    slots.erase(std::lower_bound(slots.begin(), slots.end(), slot));
+    if (slots.empty()) {
+      postings_.erase(trigram);
+    }
+  }
+  std::vector<Trigram> added;
+  std::set_difference(new_trigrams.begin(), new_trigrams.end(),
+                      old_trigrams.begin(), old_trigrams.end(),
+                      std::back_inserter(added));
+  for (auto trigram : added) {
+    auto& slots = postings_[trigram];
+    slots.insert(std::lower_bound(slots.begin(), slots.end(), slot), slot);
+  }
+}
+
+void SubRipSearchIndex::Remove(CueId id) {
+  auto it = slot_of_.find(id);
+  if (it == slot_of_.end()) {
+    return;
+  }
+  const auto slot = it->second;
+  for (auto trigram : GetTrigrams(cues_[slot].text)) {
+    auto& slots = postings_[trigram];
+    slots.erase(std::lower_bound(slots.begin(), slots.end(), slot));
+    if (slots.empty()) {
+      postings_.erase(trigram);
+    }
+  }
+  cues_[slot] = {};
+  free_slots_.push_back(slot);
+  slot_of_.erase(it);
+}
+
+std::vector<SubRipSearchIndex::CueId> SubRipSearchIndex::Find(
+    std::string_view query) const {
+  const auto text = Normalize(query);
+  std::vector<CueId> ids;
+  if (text.empty()) {
+    return ids;
+  }
+  if (text.size() < kTrigramSize) {
+    for (const auto& [id, slot] : slot_of_) {
+      if (cues_[slot].text.find(text) != std::string::npos) {
+        ids.push_back(id);
+      }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
+  std::vector<const std::vector<Slot>*> lists;
+  for (auto trigram : GetTrigrams(text)) {
+    auto it = postings_.find(trigram);
+    if (it == postings_.end()) {
+      return ids;
+    }
+    lists.push_back(&it->second);
+  }
+  // Candidates come from the shortest list. Each further list makes the
+  // text check needed less often, but costs a search per candidate, so only
+  // the next shortest ones are used.
+  std::sort(lists.begin(), lists.end(),
+            [](const auto* a, const auto* b) { return a->size() < b->size(); });
+  const auto num_filters = std::min<std::size_t>(lists.size(), kMaxLists) - 1;
+  // A query of a single trigram needs no check against the text.
+  const bool verify = text.size() > kTrigramSize;
+  std::vector<Slot> candidates = *lists.front();
+  for (std::size_t i = 1; i <= num_filters; ++i) {
+    std::vector<Slot> matches;
+    std::set_intersection(candidates.begin(), candidates.end(),
+                          lists[i]->begin(), lists[i]->end(),
+                          std::back_inserter(matches));
+    candidates = std::move(matches);
+  }
+  ids.reserve(candidates.size());
+  for (auto slot : candidates) {
+    if (!verify || cues_[slot].text.find(text) != std::string::npos) {
+      ids.push_back(cues_[slot].id);
+    }
+  }
+  // Usually sorted already, as files hand out ids in increasing order too.
+  if (!std::is_sorted(ids.begin(), ids.end())) {
+    std::sort(ids.begin(), ids.end());
+  }
+  return ids;
+}
+
+}  // namespace srt
+}  // namespace subtitler
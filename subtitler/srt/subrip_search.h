@@ -0,0 +1,88 @@
+#ifndef SUBTITLER_SRT_SUBRIP_SEARCH_H
+#define SUBTITLER_SRT_SUBRIP_SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Full-text index over the text of cues, to find a line without scrolling
+ * through the whole file.
+ *
+ * Text is searched as it is displayed: markup such as <i> and {\an8} is
+ * ignored, ASCII letters match in any case and line breaks match spaces.
+ * A cue matches if its text contains the query.
+ *
+ * Inverted index from every trigram (3 bytes) of the text to the sorted
+ * list of cues containing it. A query intersects the lists of its rarest
+ * trigrams, and then checks the candidates against their text. Queries
+ * shorter than 3 bytes scan every cue.
+ *
+ * Cues are identified by the caller, e.g. by SubRipFile::CueId, and the
+ * index is kept current with Update() and Remove() as cues are edited.
+ *
+ * Sample Usage:
+ * SubRipSearchIndex index{file};
+ * for (auto id : index.Find("where are you")) {
+ *   auto sequence_number = file.GetSequenceNumber(id);
+ * }
+ */
+class SubRipSearchIndex {
+ public:
+  using CueId = SubRipFile::CueId;
+
+  SubRipSearchIndex() = default;
+  // Indexes every item of file by its CueId.
+  explicit SubRipSearchIndex(const SubRipFile& file);
+  // Indexes cues given as (id, payload). Ids must be unique.
+  explicit SubRipSearchIndex(
+      const std::vector<std::pair<CueId, std::string>>& cues);
+
+  // Sets the text of the cue, adding it if it isn't indexed yet.
+  void Update(CueId id, std::string_view payload);
+  // Does nothing if the cue isn't indexed.
+  void Remove(CueId id);
+
+  // Ids of the cues whose text contains query, sorted. Empty if the query
+  // has no text.
+  std::vector<CueId> Find(std::string_view query) const;
+
+  std::size_t size() const { return slot_of_.size(); }
+
+ private:
+  using Trigram = std::uint32_t;
+  // Index into cues_. Posting lists hold slots rather than ids to halve
+  // their size.
+  using Slot = std::uint32_t;
+
+  struct Cue {
+    CueId id = 0;
+    // Normalized text.
+    std::string text;
+  };
+
+  std::vector<Cue> cues_;
+  // Slots of removed cues, reused before growing cues_.
+  std::vector<Slot> free_slots_;
+  std::unordered_map<CueId, Slot> slot_of_;
+  std::unordered_map<Trigram, std::vector<Slot>> postings_;
+
+  // Adds the cue at the end of cues_. Its slot is the largest yet, so it is
+  // pushed to the back of the posting lists without a search. Used to build
+  // the index in bulk.
+  void Append(CueId id, std::string_view payload);
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_search.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubRipSearchIndex;
+
+namespace {
+
+constexpr std::size_t kNumItems = 100'000;
+
+// File of num_items cues of dialogue drawn from a small vocabulary, so that
+// common words are in most cues and numbered ones in few.
+SubRipFile MakeFile(std::size_t num_items) {
+  static const char* const kLines[] = {
+      "Where are you going?", "<i>I told you, nowhere.</i>",
+      "We should get back before it gets dark.", "- Did you hear that?\n- No.",
+      "[DOOR CLOSES]"};
+  SubRipFile file;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})->duration(2s);
+    item.AppendLine(kLines[i % 5]);
+    item.AppendLine("Line " + std::to_string(i) + ".");
+    file.AddItem(item);
+  }
+  return file;
+}
+
+const SubRipFile& GetFile() {
+  static const auto* file = new SubRipFile{MakeFile(kNumItems)};
+  return *file;
+}
+
+void BM_BuildIndex(benchmark::State& state) {
+  const auto& file = GetFile();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SubRipSearchIndex{file});
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(kNumItems));
+}
+
+void FindQuery(benchmark::State& state, const char* query) {
+  SubRipSearchIndex index{GetFile()};
+  std::size_t num_hits = 0;
+  for (auto _ : state) {
+    auto ids = index.Find(query);
+    num_hits = ids.size();
+    benchmark::DoNotOptimize(ids);
+  }
+  state.counters["hits"] = static_cast<double>(num_hits);
+}
+
+// A handful of hits, found through the rare trigrams of the number.
+void BM_FindRare(benchmark::State& state) { FindQuery(state, "line 4242."); }
+
+// A fifth of the cues.
+void BM_FindCommon(benchmark::State& state) {
+  FindQuery(state, "where are you");
+}
+
+// No hits, although every trigram of the query is in the file.
+void BM_FindMissing(benchmark::State& state) {
+  FindQuery(state, "you going nowhere");
+}
+
+void BM_UpdateCue(benchmark::State& state) {
+  SubRipSearchIndex index{GetFile()};
+  const auto id = GetFile().GetId(kNumItems / 2);
+  bool edited = false;
+  for (auto _ : state) {
+    index.Update(id, edited ? "Where are you going?\nLine 1."
+                            : "Where were you going?\nLine 1.");
+    edited = !edited;
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_BuildIndex)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FindRare)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindCommon)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindMissing)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_UpdateCue)->Unit(benchmark::kMicrosecond);
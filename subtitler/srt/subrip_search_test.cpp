@@ -0,0 +1,76 @@
+#include "subtitler/srt/subrip_search.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(SubRipSearchIndexTest, FindsTextOfFile) {
+  SubRipFile file;
+  SubRipItem item;
+  item.start(0s)->duration(1s)->AppendLine("Where are you going?");
+  auto going = file.AddItem(item);
+  item.start(2s)->ClearPayload()->AppendLine("<i>Nowhere.</i>");
+  auto nowhere = file.AddItem(item);
+  item.start(3s)->ClearPayload()->AppendLine("{\\an8}Where")->AppendLine(
+      "ARE you?");
+  auto are_you = file.AddItem(item);
+
+  SubRipSearchIndex index{file};
+  ASSERT_EQ(3, index.size());
+  EXPECT_THAT(index.Find("where"), ElementsAre(going, nowhere, are_you));
+  // Markup is ignored, case and line breaks don't matter.
+  EXPECT_THAT(index.Find("nowhere."), ElementsAre(nowhere));
+  EXPECT_THAT(index.Find("where are you"), ElementsAre(going, are_you));
+  EXPECT_THAT(index.Find("  WHERE\nare "), ElementsAre(going, are_you));
+  EXPECT_THAT(index.Find("an8"), IsEmpty());
+  EXPECT_THAT(index.Find("i>"), IsEmpty());
+  // Short queries scan every cue.
+  EXPECT_THAT(index.Find("?"), ElementsAre(going, are_you));
+  EXPECT_THAT(index.Find(""), IsEmpty());
+  EXPECT_THAT(index.Find("<b>"), IsEmpty());
+  // All the trigrams of the query are in the cue, but not the query.
+  EXPECT_THAT(index.Find("you going? where"), IsEmpty());
+}
+
+TEST(SubRipSearchIndexTest, KeepsUnclosedBrackets) {
+  SubRipSearchIndex index{{{1, "1 < 2"}, {2, "a {b"}, {3, "<b>1 2</b>"}}};
+  EXPECT_THAT(index.Find("1 < 2"), ElementsAre(1));
+  EXPECT_THAT(index.Find("{b"), ElementsAre(2));
+  EXPECT_THAT(index.Find("1 2"), ElementsAre(3));
+}
+
+TEST(SubRipSearchIndexTest, UpdatesOnEdit) {
+  SubRipSearchIndex index{{{1, "red apple"}, {2, "green apple"}}};
+  index.Update(1, "red pear");
+  EXPECT_THAT(index.Find("apple"), ElementsAre(2));
+  EXPECT_THAT(index.Find("pear"), ElementsAre(1));
+  EXPECT_THAT(index.Find("red"), ElementsAre(1));
+
+  index.Update(3, "pear tree");
+  EXPECT_THAT(index.Find("pear"), ElementsAre(1, 3));
+  index.Remove(1);
+  index.Remove(42);
+  EXPECT_EQ(2, index.size());
+  EXPECT_THAT(index.Find("pear"), ElementsAre(3));
+  EXPECT_THAT(index.Find("red"), IsEmpty());
+
+  // Reuses the slot of the removed cue.
+  index.Update(4, "red pear");
+  EXPECT_THAT(index.Find("pear"), ElementsAre(3, 4));
+  EXPECT_THAT(index.Find("apple"), ElementsAre(2));
+  index.Update(4, "");
+  EXPECT_THAT(index.Find("pear"), ElementsAre(3));
+  EXPECT_EQ(3, index.size());
+}
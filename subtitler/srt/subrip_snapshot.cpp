@@ -0,0 +1,344 @@
+#include "subtitler/srt/subrip_snapshot.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace subtitler {
+namespace srt {
+
+struct SubRipSnapshot::Node {
+  std::chrono::milliseconds start;
+  std::chrono::milliseconds end;
+  CueId id = 0;
+  std::uint64_t priority = 0;
+  std::size_t size = 1;
+  std::shared_ptr<const SubRipItem> item;
+  NodePtr left;
+  NodePtr right;
+};
+
+struct SubRipSnapshot::Treap {
+  struct Key {
+    std::chrono::milliseconds start;
+    std::chrono::milliseconds end;
+    CueId id;
+  };
+
+  static Key KeyOf(const Node& node) { return {node.start, node.end, node.id}; }
+
+  static bool Less(const Key& a, const Key& b) {
+    return std::tie(a.start, a.end, a.id) < std::tie(b.start, b.end, b.id);
+  }
+
+  static bool Equal(const Key& a, const Key& b) {
+    return !Less(a, b) && !Less(b, a);
+  }
+
+  // Mixes the bits of the id (splitmix64), so priorities look random but
+  // are the same in every version.
+  static std::uint64_t Priority(CueId id) {
+    std::uint64_t x = id + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  // Total order on priorities, so the tree of a set of cues is unique.
+  static bool Higher(const Node& a, const Node& b) {
+    if (a.priority != b.priority) {
+      return a.priority > b.priority;
+    }
+    return Less(KeyOf(a), KeyOf(b));
+  }
+
+  static std::size_t Size(const NodePtr& node) {
+    return node ? node->size : 0;
+  }
+
+  // Copy of node with new children.
+  static NodePtr With(const Node& node, NodePtr left, NodePtr right) {
+    auto size = 1 + Size(left) + Size(right);
+    return std::make_shared<const Node>(Node{node.start, node.end, node.id,
+                                             node.priority, size, node.item,
+                                             std::move(left),
+                                             std::move(right)});
+  }
+
+  // Splits node into the cues before key and the rest, copying only the
+  // nodes on the path to key.
+  static void Split(const NodePtr& node, const Key& key, NodePtr& left,
+                    NodePtr& right) {
+    if (!node) {
+      left = right = nullptr;
+      return;
+    }
+    if (Less(KeyOf(*node), key)) {
+      NodePtr middle;
+      Split(node->right, key, middle, right);
+      left = With(*node, node->left, std::move(middle));
+    } else {
+      NodePtr middle;
+      Split(node->left, key, left, middle);
+      right = With(*node, std::move(middle), node->right);
+    }
+  }
+
+  // All cues of left must come before the cues of right.
+  static NodePtr Merge(const NodePtr& left, const NodePtr& right) {
+    if (!left || !right) {
+      return left ? left : right;
+    }
+    if (Higher(*left, *right)) {
+      return With(*left, left->left, Merge(left->right, right));
+    }
+    return With(*right, Merge(left, right->left), right->right);
+  }
+
+  static NodePtr Insert(const NodePtr& node, const NodePtr& leaf) {
+    if (!node) {
+      return leaf;
+    }
+    if (Higher(*leaf, *node)) {
+      NodePtr left;
+      NodePtr right;
+      Split(node, KeyOf(*leaf), left, right);
+      return With(*leaf, std::move(left), std::move(right));
+    }
+    if (Less(KeyOf(*leaf), KeyOf(*node))) {
+      return With(*node, Insert(node->left, leaf), node->right);
+    }
+    return With(*node, node->left, Insert(node->right, leaf));
+  }
+
+  static NodePtr Erase(const NodePtr& node, const Key& key) {
+    if (!node) {
+      throw std::out_of_range{"No cue with id " + std::to_string(key.id)};
+    }
+    if (Less(key, KeyOf(*node))) {
+      return With(*node, Erase(node->left, key), node->right);
+    }
+    if (Less(KeyOf(*node), key)) {
+      return With(*node, node->left, Erase(node->right, key));
+    }
+    return Merge(node->left, node->right);
+  }
+
+  static const Node* At(const Node* node, std::size_t rank) {
+    for (;;) {
+      auto left_size = Size(node->left);
+      if (rank < left_size) {
+        node = node->left.get();
+      } else if (rank == left_size) {
+        return node;
+      } else {
+        rank -= left_size + 1;
+        node = node->right.get();
+      }
+    }
+  }
+
+  static void Visit(const Node* node, std::size_t& rank,
+                    const Visitor& visit) {
+    if (!node) {
+      return;
+    }
+    Visit(node->left.get(), rank, visit);
+    visit(++rank, node->id, *node->item);
+    Visit(node->right.get(), rank, visit);
+  }
+
+  static void VisitAll(const Node* node, const DiffVisitor& visit) {
+    if (!node) {
+      return;
+    }
+    VisitAll(node->left.get(), visit);
+    visit(node->id, node->item);
+    VisitAll(node->right.get(), visit);
+  }
+
+  // Both trees are unique for their cues, so if the roots hold the same cue
+  // the subtrees hold the same range of cues and are compared pairwise.
+  // Otherwise the root with the higher priority can't be in the other tree,
+  // which is split around it.
+  static void Diff(const NodePtr& before, const NodePtr& after,
+                   const DiffVisitor& on_removed,
+                   const DiffVisitor& on_added) {
+    if (before == after) {
+      return;
+    }
+    if (!before || !after) {
+      VisitAll(before ? before.get() : after.get(),
+               before ? on_removed : on_added);
+      return;
+    }
+    auto before_key = KeyOf(*before);
+    auto after_key = KeyOf(*after);
+    if (Equal(before_key, after_key)) {
+      if (before->item != after->item) {
+        on_removed(before->id, before->item);
+        on_added(after->id, after->item);
+      }
+      Diff(before->left, after->left, on_removed, on_added);
+      Diff(before->right, after->right, on_removed, on_added);
+    } else if (Higher(*before, *after)) {
+      on_removed(before->id, before->item);
+      NodePtr left;
+      NodePtr right;
+      Split(after, before_key, left, right);
+      Diff(before->left, left, on_removed, on_added);
+      Diff(before->right, right, on_removed, on_added);
+    } else {
+      on_added(after->id, after->item);
+      NodePtr left;
+      NodePtr right;
+      Split(before, after_key, left, right);
+      Diff(left, after->left, on_removed, on_added);
+      Diff(right, after->right, on_removed, on_added);
+    }
+  }
+
+  // Builds the subtree rooted at nodes[i] from the links found by Of().
+  static NodePtr Build(std::vector<Node>& nodes,
+                       const std::vector<std::size_t>& left,
+                       const std::vector<std::size_t>& right, std::size_t i) {
+    constexpr auto kNone = std::numeric_limits<std::size_t>::max();
+    auto& node = nodes[i];
+    if (left[i] != kNone) {
+      node.left = Build(nodes, left, right, left[i]);
+    }
+    if (right[i] != kNone) {
+      node.right = Build(nodes, left, right, right[i]);
+    }
+    node.size = 1 + Size(node.left) + Size(node.right);
+    return std::make_shared<const Node>(std::move(node));
+  }
+};
+
+SubRipSnapshot::SubRipSnapshot() = default;
+
+SubRipSnapshot::~SubRipSnapshot() = default;
+
+SubRipSnapshot::SubRipSnapshot(const SubRipSnapshot& other) = default;
+
+SubRipSnapshot& SubRipSnapshot::operator=(const SubRipSnapshot& other) =
+    default;
+
+SubRipSnapshot::SubRipSnapshot(SubRipSnapshot&& other) noexcept = default;
+
+SubRipSnapshot& SubRipSnapshot::operator=(SubRipSnapshot&& other) noexcept =
+    default;
+
+SubRipSnapshot::SubRipSnapshot(NodePtr root) : root_{std::move(root)} {}
+
+SubRipSnapshot SubRipSnapshot::Of(const SubRipFile& file) {
+  if (file.NumItems() == 0) {
+    return {};
+  }
+  // Gets all ids in one pass, rather than a lookup per item.
+  std::vector<CueId> ids;
+  std::vector<std::chrono::milliseconds> starts;
+  std::vector<std::chrono::milliseconds> durations;
+  file.GetTimings(1, file.NumItems(), ids, starts, durations);
+  std::vector<Node> nodes;
+  nodes.reserve(file.NumItems());
+  file.ForEachItem([&](std::size_t sequence_number,
+                       const std::shared_ptr<SubRipItem>& item) {
+    auto id = ids[sequence_number - 1];
+    nodes.push_back({item->start(), item->start() + item->duration(), id,
+                     Treap::Priority(id), 1,
+                     std::make_shared<const SubRipItem>(*item), nullptr,
+                     nullptr});
+  });
+  auto less = [](const Node& a, const Node& b) {
+    return Treap::Less(Treap::KeyOf(a), Treap::KeyOf(b));
+  };
+  if (!std::is_sorted(nodes.begin(), nodes.end(), less)) {
+    std::sort(nodes.begin(), nodes.end(), less);
+  }
+
+  // Links the sorted nodes into a treap in O(n). The stack holds the right
+  // spine of the tree built so far.
+  constexpr auto kNone = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> left(nodes.size(), kNone);
+  std::vector<std::size_t> right(nodes.size(), kNone);
+  std::vector<std::size_t> spine;
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    auto last_popped = kNone;
+    while (!spine.empty() && Treap::Higher(nodes[i], nodes[spine.back()])) {
+      last_popped = spine.back();
+      spine.pop_back();
+    }
+    left[i] = last_popped;
+    if (!spine.empty()) {
+      right[spine.back()] = i;
+    }
+    spine.push_back(i);
+  }
+  return SubRipSnapshot{Treap::Build(nodes, left, right, spine.front())};
+}
+
+std::size_t SubRipSnapshot::NumItems() const {
+  return Treap::Size(root_);
+}
+
+const SubRipItem& SubRipSnapshot::GetItem(std::size_t sequence_number) const {
+  if (sequence_number <= 0 || sequence_number > NumItems()) {
+    throw std::out_of_range("invalid index passed to GetItem()");
+  }
+  return *Treap::At(root_.get(), sequence_number - 1)->item;
+}
+
+SubRipSnapshot::CueId SubRipSnapshot::GetId(
+    std::size_t sequence_number) const {
+  if (sequence_number <= 0 || sequence_number > NumItems()) {
+    throw std::out_of_range("invalid index passed to GetId()");
+  }
+  return Treap::At(root_.get(), sequence_number - 1)->id;
+}
+
+void SubRipSnapshot::ForEachItem(const Visitor& visit) const {
+  std::size_t rank = 0;
+  Treap::Visit(root_.get(), rank, visit);
+}
+
+void SubRipSnapshot::ToStream(std::ostream& output) const {
+  std::string buffer;
+  ForEachItem([&](std::size_t sequence_number, CueId,
+                  const SubRipItem& item) {
+    item.AppendTo(sequence_number, buffer);
+    buffer += '\n';
+  });
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+SubRipSnapshot SubRipSnapshot::Insert(
+    CueId id, std::shared_ptr<const SubRipItem> item) const {
+  auto start = item->start();
+  auto end = start + item->duration();
+  auto leaf = std::make_shared<const Node>(Node{
+      start, end, id, Treap::Priority(id), 1, std::move(item), nullptr,
+      nullptr});
+  return SubRipSnapshot{Treap::Insert(root_, leaf)};
+}
+
+SubRipSnapshot SubRipSnapshot::Erase(CueId id,
+                                     std::chrono::milliseconds start,
+                                     std::chrono::milliseconds end) const {
+  return SubRipSnapshot{Treap::Erase(root_, {start, end, id})};
+}
+
+void SubRipSnapshot::Diff(const SubRipSnapshot& before,
+                          const SubRipSnapshot& after,
+                          const DiffVisitor& on_removed,
+                          const DiffVisitor& on_added) {
+  Treap::Diff(before.root_, after.root_, on_removed, on_added);
+}
+
+}  // namespace srt
+}  // namespace subtitler
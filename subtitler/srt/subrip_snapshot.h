@@ -0,0 +1,107 @@
+#ifndef SUBTITLER_SRT_SUBRIP_SNAPSHOT_H
+#define SUBTITLER_SRT_SUBRIP_SNAPSHOT_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Immutable version of the cues of a SubRipFile, which shares structure with
+ * the versions it was derived from. Copying a snapshot is O(1), and a
+ * version with one cue changed is derived in O(log n), copying only that cue
+ * and O(log n) tree nodes. So an editor can keep many versions of a large
+ * file around, see SubRipHistory.
+ *
+ * Nothing reachable from a snapshot is modified after it is created, so a
+ * snapshot can be read from any thread, e.g. by autosave or export, while
+ * the editor keeps deriving new versions.
+ *
+ * Implemented as a persistent treap sorted by start time, end time and then
+ * id. Priorities are a hash of the id, so the shape of the tree depends only
+ * on the cues it holds, and two versions share every subtree whose cues are
+ * the same in both. Cues with the same start and end are ordered by id,
+ * which can differ from their order in the file once they have been
+ * retimed.
+ */
+class SubRipSnapshot {
+ public:
+  using CueId = SubRipFile::CueId;
+  using Visitor =
+      std::function<void(std::size_t, CueId, const SubRipItem&)>;
+
+  // An empty snapshot.
+  SubRipSnapshot();
+  ~SubRipSnapshot();
+  SubRipSnapshot(const SubRipSnapshot& other);
+  SubRipSnapshot& operator=(const SubRipSnapshot& other);
+  SubRipSnapshot(SubRipSnapshot&& other) noexcept;
+  SubRipSnapshot& operator=(SubRipSnapshot&& other) noexcept;
+
+  // Copies every item of file, under its id. O(n) if the ids of items with
+  // identical timings are in order, which they are unless retimed.
+  static SubRipSnapshot Of(const SubRipFile& file);
+
+  std::size_t NumItems() const;
+
+  // O(log n). Throw std::out_of_range if invalid sequence is provided.
+  const SubRipItem& GetItem(std::size_t sequence_number) const;
+  CueId GetId(std::size_t sequence_number) const;
+
+  // Calls visit(sequence_number, id, item) for every item, in order.
+  void ForEachItem(const Visitor& visit) const;
+
+  // Prints the snapshot as an SRT file, same as SubRipFile::ToStream().
+  void ToStream(std::ostream& output) const;
+
+  // True if both are the same version, not just equal. O(1).
+  bool SameVersion(const SubRipSnapshot& other) const {
+    return root_ == other.root_;
+  }
+
+ private:
+  struct Node;
+  // Operations on the nodes.
+  struct Treap;
+  using NodePtr = std::shared_ptr<const Node>;
+  // Called with the id and item of a cue of one version which is not in the
+  // other, see Diff().
+  using DiffVisitor =
+      std::function<void(CueId, const std::shared_ptr<const SubRipItem>&)>;
+
+  NodePtr root_;
+
+  explicit SubRipSnapshot(NodePtr root);
+
+  // Returns a version with the cue added. The id must not be in this
+  // snapshot, and item must never be modified.
+  SubRipSnapshot Insert(CueId id,
+                        std::shared_ptr<const SubRipItem> item) const;
+
+  // Returns a version without the cue, which is found by the timing it has
+  // in this snapshot. Throws std::out_of_range if there is no such cue.
+  SubRipSnapshot Erase(CueId id, std::chrono::milliseconds start,
+                       std::chrono::milliseconds end) const;
+
+  // Calls on_removed for the cues of before which aren't in after, and
+  // on_added for those of after which aren't in before. A changed cue is
+  // reported by both. Subtrees shared by both versions are skipped, so this
+  // is O(k log n) for versions k edits apart.
+  static void Diff(const SubRipSnapshot& before, const SubRipSnapshot& after,
+                   const DiffVisitor& on_removed,
+                   const DiffVisitor& on_added);
+
+  friend class SubRipHistory;
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
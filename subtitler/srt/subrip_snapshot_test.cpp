@@ -0,0 +1,127 @@
+#include "subtitler/srt/subrip_snapshot.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_history.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+namespace {
+
+SubRipItem MakeItem(std::chrono::milliseconds start,
+                    std::chrono::milliseconds duration,
+                    const std::string& text) {
+  SubRipItem item;
+  item.start(start)->duration(duration)->AppendLine(text);
+  return item;
+}
+
+template <typename T>
+std::string ToString(const T& file) {
+  std::ostringstream output;
+  file.ToStream(output);
+  return output.str();
+}
+
+}  // namespace
+
+TEST(SubRipSnapshotTest, EmptySnapshot) {
+  SubRipSnapshot snapshot;
+  EXPECT_EQ(snapshot.NumItems(), 0);
+  EXPECT_EQ(ToString(snapshot), "");
+  EXPECT_THROW(snapshot.GetItem(1), std::out_of_range);
+  EXPECT_TRUE(snapshot.SameVersion(SubRipSnapshot::Of(SubRipFile{})));
+}
+
+TEST(SubRipSnapshotTest, CopiesFile) {
+  SubRipFile file;
+  auto second = file.AddItem(MakeItem(5s, 1s, "second"));
+  auto first = file.AddItem(MakeItem(1s, 1s, "first"));
+  file.AddItem(MakeItem(9s, 1s, "third"));
+
+  auto snapshot = SubRipSnapshot::Of(file);
+  ASSERT_EQ(snapshot.NumItems(), 3);
+  EXPECT_EQ(snapshot.GetItem(1).payload(), "first\n");
+  EXPECT_EQ(snapshot.GetId(1), first);
+  EXPECT_EQ(snapshot.GetId(2), second);
+  EXPECT_THROW(snapshot.GetItem(0), std::out_of_range);
+  EXPECT_THROW(snapshot.GetId(4), std::out_of_range);
+  EXPECT_EQ(ToString(snapshot), ToString(file));
+
+  std::vector<std::size_t> sequence_numbers;
+  snapshot.ForEachItem(
+      [&](std::size_t sequence_number, SubRipSnapshot::CueId id,
+          const SubRipItem& item) {
+        EXPECT_EQ(id, file.GetId(sequence_number));
+        EXPECT_EQ(item.payload(), file.GetItem(sequence_number)->payload());
+        sequence_numbers.push_back(sequence_number);
+      });
+  EXPECT_THAT(sequence_numbers, ElementsAre(1, 2, 3));
+
+  // The snapshot keeps its own copy of the items.
+  file.GetItem(1)->AppendLine("edited");
+  file.RemoveItem(3);
+  EXPECT_EQ(snapshot.GetItem(1).payload(), "first\n");
+  EXPECT_EQ(snapshot.NumItems(), 3);
+}
+
+TEST(SubRipSnapshotTest, OrdersTiesById) {
+  SubRipFile file;
+  auto a = file.AddItem(MakeItem(1s, 1s, "a"));
+  auto b = file.AddItem(MakeItem(1s, 1s, "b"));
+  // Retimed cues go after their ties in the file.
+  file.RetimeItem(a, 1s, 1s);
+  ASSERT_EQ(file.GetId(1), b);
+
+  auto snapshot = SubRipSnapshot::Of(file);
+  EXPECT_EQ(snapshot.GetId(1), a);
+  EXPECT_EQ(snapshot.GetId(2), b);
+}
+
+TEST(SubRipSnapshotTest, ReadersSeeFixedVersions) {
+  SubRipFile file;
+  for (int i = 0; i < 2000; ++i) {
+    file.AddItem(MakeItem(std::chrono::seconds{i}, 1s, "line"));
+  }
+  SubRipHistory history;
+  history.Reset(file);
+  auto snapshot = history.snapshot();
+  const auto expected = ToString(snapshot);
+
+  // Serializes the snapshot on another thread while the editor derives new
+  // versions from it, like an autosave.
+  std::atomic<bool> done = false;
+  std::thread reader{[&] {
+    while (!done) {
+      EXPECT_EQ(ToString(snapshot), expected);
+    }
+  }};
+  for (int i = 0; i < 500; ++i) {
+    auto id = file.GetId(1 + i % file.NumItems());
+    auto& item = file.GetItemById(id);
+    item->AppendLine("edited");
+    history.Record(id, item.get());
+    history.Commit();
+    if (i % 3 == 0) {
+      ApplyChanges(file, history.Undo());
+    }
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(ToString(snapshot), expected);
+  EXPECT_EQ(ToString(history.snapshot()), ToString(file));
+}
@@ -0,0 +1,181 @@
+#include "subtitler/srt/subrip_table.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <stdexcept>
+
+namespace subtitler {
+namespace srt {
+
+SubRipTable::SubRipTable(const SubRipFile& file) {
+  const auto& items = file.GetItems();
+  std::size_t text_size = 0;
+  for (const auto& item : items) {
+    text_size += item->payload().size();
+  }
+  starts_.reserve(items.size());
+  durations_.reserve(items.size());
+  pos_ids_.reserve(items.size());
+  text_offsets_.reserve(items.size());
+  text_sizes_.reserve(items.size());
+  text_capacities_.reserve(items.size());
+  text_.reserve(text_size);
+  for (const auto& item : items) {
+    AppendRow(*item);
+  }
+}
+
+std::size_t SubRipTable::AppendRow(const SubRipItem& item) {
+  starts_.push_back(item.start());
+  durations_.push_back(item.duration());
+  pos_ids_.push_back(item.ass_pos_id_);
+  auto payload = item.payload();
+  text_offsets_.push_back(text_.size());
+  text_sizes_.push_back(payload.size());
+  text_capacities_.push_back(payload.size());
+  text_.append(payload);
+  return starts_.size() - 1;
+}
+
+std::string_view SubRipTable::payload(std::size_t row) const {
+  CheckRow(row);
+  return std::string_view{text_}.substr(text_offsets_[row], text_sizes_[row]);
+}
+
+void SubRipTable::SetPayload(std::size_t row, std::string_view payload) {
+  CheckRow(row);
+  if (payload.size() > text_capacities_[row]) {
+    // The payload may be a view into the arena, such as the payload of
+    // another row, which growing the arena invalidates. Find it again by
+    // its offset afterwards.
+    const std::less<const char*> before;
+    bool in_arena = !before(payload.data(), text_.data()) &&
+                    before(payload.data(), text_.data() + text_.size());
+    auto source = static_cast<std::size_t>(payload.data() - text_.data());
+    // At least double the slot, so a payload which keeps growing, e.g. one
+    // edited a keystroke at a time, is moved O(log n) times rather than on
+    // every edit.
+    text_offsets_[row] = text_.size();
+    text_capacities_[row] =
+        std::max(payload.size(), 2 * text_capacities_[row]);
+    text_.resize(text_.size() + text_capacities_[row]);
+    if (in_arena) {
+      payload = std::string_view{text_}.substr(source, payload.size());
+    }
+  }
+  // Moves rather than copies, since a payload taken from this row's own
+  // text overlaps it.
+  std::char_traits<char>::move(text_.data() + text_offsets_[row],
+                               payload.data(), payload.size());
+  text_sizes_[row] = payload.size();
+}
+
+void SubRipTable::CompactText() {
+  std::string compacted;
+  std::size_t live_size = 0;
+  for (auto size : text_sizes_) {
+    live_size += size;
+  }
+  compacted.reserve(live_size);
+  for (std::size_t i = 0; i < text_offsets_.size(); ++i) {
+    auto offset = compacted.size();
+    compacted.append(text_, text_offsets_[i], text_sizes_[i]);
+    text_offsets_[i] = offset;
+    text_capacities_[i] = text_sizes_[i];
+  }
+  text_ = std::move(compacted);
+}
+
+void SubRipTable::Shift(std::chrono::milliseconds delta) {
+  if (starts_.empty()) {
+    return;
+  }
+  auto earliest = *std::min_element(starts_.begin(), starts_.end());
+  if (earliest + delta < std::chrono::milliseconds::zero()) {
+    throw std::invalid_argument{"Shift would make start time negative"};
+  }
+  for (auto& start : starts_) {
+    start += delta;
+  }
+}
+
+std::size_t SubRipTable::CountOverlapping(std::chrono::milliseconds start,
+                                          std::chrono::milliseconds end) const {
+  // Branch free so the loop can be vectorized.
+  std::size_t count = 0;
+  const auto* starts = starts_.data();
+  const auto* durations = durations_.data();
+  for (std::size_t i = 0; i < starts_.size(); ++i) {
+    count += (start <= starts[i] + durations[i]) & (starts[i] <= end);
+  }
+  return count;
+}
+
+void SubRipTable::ForEachOverlapping(
+    std::chrono::milliseconds start, std::chrono::milliseconds end,
+    const std::function<void(std::size_t)>& on_find) const {
+  for (std::size_t i = 0; i < starts_.size(); ++i) {
+    if (start <= starts_[i] + durations_[i] && starts_[i] <= end) {
+      on_find(i);
+    }
+  }
+}
+
+SubRipTable::Stats SubRipTable::ComputeStats() const {
+  Stats stats;
+  stats.num_rows = starts_.size();
+  if (starts_.empty()) {
+    return stats;
+  }
+  auto total = std::chrono::milliseconds::zero();
+  auto min_duration = durations_.front();
+  auto max_duration = durations_.front();
+  auto max_end = starts_.front() + durations_.front();
+  for (std::size_t i = 0; i < starts_.size(); ++i) {
+    total += durations_[i];
+    min_duration = std::min(min_duration, durations_[i]);
+    max_duration = std::max(max_duration, durations_[i]);
+    max_end = std::max(max_end, starts_[i] + durations_[i]);
+  }
+  stats.total_duration = total;
+  stats.min_duration = min_duration;
+  stats.max_duration = max_duration;
+  stats.max_end = max_end;
+  return stats;
+}
+
+SubRipItem SubRipTable::ToItem(std::size_t row) const {
+  CheckRow(row);
+  SubRipItem item;
+  item.start(starts_[row])->duration(durations_[row]);
+  item.ass_pos_id_ = pos_ids_[row];
+  auto text = payload(row);
+  while (!text.empty()) {
+    auto newline = text.find('\n');
+    auto line_size = newline == std::string_view::npos ? text.size()
+                                                       : newline + 1;
+    item.AppendLine(text.substr(0, line_size));
+    text.remove_prefix(line_size);
+  }
+  return item;
+}
+
+SubRipFile SubRipTable::ToFile() const {
+  SubRipFile::Builder builder;
+  builder.Reserve(NumRows());
+  for (std::size_t i = 0; i < NumRows(); ++i) {
+    builder.Add(ToItem(i));
+  }
+  return builder.Build();
+}
+
+void SubRipTable::CheckRow(std::size_t row) const {
+  if (row >= starts_.size()) {
+    throw std::out_of_range{"Row " + std::to_string(row) +
+                            " is out of range"};
+  }
+}
+
+}  // namespace srt
+}  // namespace subtitler
@@ -0,0 +1,124 @@
+#ifndef SUBTITLER_SRT_SUBRIP_TABLE_H
+#define SUBTITLER_SRT_SUBRIP_TABLE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Columnar (structure of arrays) representation of a subtitle file.
+ *
+ * Where SubRipFile keeps a vector of shared_ptr<SubRipItem>, SubRipTable
+ * keeps one contiguous array per field, and the payloads of every row packed
+ * into a single text arena. Bulk operations such as overlap scans, time
+ * shifts and statistics then stream over dense arrays of timings, never
+ * touching the text or any reference counts, and the compiler is free to
+ * vectorize them.
+ *
+ * Rows are addressed by index and keep their index for the lifetime of the
+ * table. Rows are NOT kept sorted: AppendRow() adds to the end whatever the
+ * start time, and ToFile() sorts on output.
+ *
+ * Sample Usage:
+ * SubRipTable table{file};
+ * table.Shift(1s);
+ * auto stats = table.ComputeStats();
+ */
+class SubRipTable {
+ public:
+  struct Stats {
+    std::size_t num_rows = 0;
+    std::chrono::milliseconds total_duration{0};
+    std::chrono::milliseconds min_duration{0};
+    std::chrono::milliseconds max_duration{0};
+    // Latest end time of any row.
+    std::chrono::milliseconds max_end{0};
+  };
+
+  SubRipTable() = default;
+  // Rows are created in the order of file.GetItems().
+  explicit SubRipTable(const SubRipFile& file);
+
+  std::size_t NumRows() const { return starts_.size(); }
+
+  // Appends a copy of item and returns its row.
+  std::size_t AppendRow(const SubRipItem& item);
+
+  const std::vector<std::chrono::milliseconds>& starts() const {
+    return starts_;
+  }
+  const std::vector<std::chrono::milliseconds>& durations() const {
+    return durations_;
+  }
+  // 0 if the row has no position set, otherwise the substation alpha id.
+  const std::vector<std::int8_t>& pos_ids() const { return pos_ids_; }
+
+  // View into the text arena, valid until the next call which modifies
+  // any payload or appends a row.
+  // Throws std::out_of_range if row >= NumRows().
+  std::string_view payload(std::size_t row) const;
+
+  // Replaces the payload of the row, in place if it fits in the space the
+  // row has in the arena. Otherwise the row moves to the end of the arena
+  // with at least twice its space, and the old text stays there until
+  // CompactText() is called.
+  // Throws std::out_of_range if row >= NumRows().
+  void SetPayload(std::size_t row, std::string_view payload);
+
+  // Rewrites the arena with only the live text of every row, leaving no
+  // spare space.
+  void CompactText();
+
+  std::size_t text_arena_size() const { return text_.size(); }
+
+  // Adds delta to the start time of every row.
+  // Throws std::invalid_argument if any start time would become negative,
+  // in which case the table is left untouched.
+  void Shift(std::chrono::milliseconds delta);
+
+  // Number of rows which have a non-empty intersection with [start, end].
+  std::size_t CountOverlapping(std::chrono::milliseconds start,
+                               std::chrono::milliseconds end) const;
+
+  // Calls on_find(row) for every row which has a non-empty intersection
+  // with [start, end], in increasing order of row.
+  void ForEachOverlapping(std::chrono::milliseconds start,
+                          std::chrono::milliseconds end,
+                          const std::function<void(std::size_t)>& on_find) const;
+
+  Stats ComputeStats() const;
+
+  // Throws std::out_of_range if row >= NumRows().
+  SubRipItem ToItem(std::size_t row) const;
+
+  // Converts to a SubRipFile, sorted by start time.
+  SubRipFile ToFile() const;
+
+ private:
+  void CheckRow(std::size_t row) const;
+
+  std::vector<std::chrono::milliseconds> starts_;
+  std::vector<std::chrono::milliseconds> durations_;
+  std::vector<std::int8_t> pos_ids_;
+  // Location of each row's payload in text_, and the space it may grow
+  // into in place.
+  std::vector<std::size_t> text_offsets_;
+  std::vector<std::size_t> text_sizes_;
+  std::vector<std::size_t> text_capacities_;
+  std::string text_;
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
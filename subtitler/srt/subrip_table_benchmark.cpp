@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_table.h"
+
+// Compares bulk scans over SubRipFile (vector of shared_ptr) against the
+// columnar SubRipTable. To see the difference in cache misses directly,
+// run with --benchmark_perf_counters=CYCLES,CACHE-MISSES on a benchmark
+// library built with libpfm. Every benchmark also reports cache_lines, see
+// CountCacheLines().
+
+using namespace std::chrono_literals;
+using subtitler::srt::SubRipFile;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubRipTable;
+
+namespace {
+
+constexpr std::uintptr_t kCacheLineSize = 64;
+
+// Number of distinct cache lines holding the given [address, address + size)
+// ranges, i.e. the lines one scan over them has to load. Once they outgrow
+// the last level cache, every one of them misses on every scan, so this is
+// the miss count to expect where hardware counters aren't available.
+std::size_t CountCacheLines(
+    const std::vector<std::pair<const void*, std::size_t>>& ranges) {
+  std::unordered_set<std::uintptr_t> lines;
+  for (const auto& [address, size] : ranges) {
+    auto begin = reinterpret_cast<std::uintptr_t>(address);
+    for (auto line = begin / kCacheLineSize;
+         line <= (begin + size - 1) / kCacheLineSize; ++line) {
+      lines.insert(line);
+    }
+  }
+  return lines.size();
+}
+
+// The item pointers and the items they point to. Doesn't count the
+// reference counts, which BM_FileTotalDuration also touches.
+std::size_t CountCacheLines(
+    const std::vector<std::shared_ptr<SubRipItem>>& items) {
+  std::vector<std::pair<const void*, std::size_t>> ranges;
+  ranges.reserve(items.size() + 1);
+  ranges.emplace_back(items.data(), items.size() * sizeof(items.front()));
+  for (const auto& item : items) {
+    ranges.emplace_back(item.get(), sizeof(SubRipItem));
+  }
+  return CountCacheLines(ranges);
+}
+
+// The start and duration columns, which overlap scans and statistics read.
+std::size_t CountCacheLines(const SubRipTable& table) {
+  return CountCacheLines(
+      {{table.starts().data(),
+        table.starts().size() * sizeof(table.starts().front())},
+       {table.durations().data(),
+        table.durations().size() * sizeof(table.durations().front())}});
+}
+
+// Items are allocated in random order, the way they end up after a session
+// of editing, so neighbouring cues are not neighbours on the heap.
+SubRipFile MakeFile(std::size_t num_items) {
+  std::vector<std::size_t> order(num_items);
+  for (std::size_t i = 0; i < num_items; ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+  SubRipFile::Builder builder;
+  builder.Reserve(num_items);
+  for (auto i : order) {
+    auto item = std::make_shared<SubRipItem>();
+    item->start(std::chrono::milliseconds{i * 2500})
+        ->duration(std::chrono::milliseconds{1000 + i % 5000})
+        ->AppendLine("Subtitle text long enough to live on the heap.");
+    builder.Add(item);
+  }
+  return builder.Build();
+}
+
+void BM_FileCountOverlapping(benchmark::State& state) {
+  auto file = MakeFile(state.range(0));
+  const auto& items = file.GetItems();
+  auto start = 1000s;
+  auto end = start + 10s;
+  for (auto _ : state) {
+    std::size_t count = 0;
+    for (const auto& item : items) {
+      count += start <= item->start() + item->duration() &&
+               item->start() <= end;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.counters["cache_lines"] = CountCacheLines(items);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TableCountOverlapping(benchmark::State& state) {
+  SubRipTable table{MakeFile(state.range(0))};
+  auto start = 1000s;
+  auto end = start + 10s;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.CountOverlapping(start, end));
+  }
+  state.counters["cache_lines"] = CountCacheLines(table);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// GetItems() copies, so it is called once outside of the loop.
+void BM_FileShift(benchmark::State& state) {
+  auto items = MakeFile(state.range(0)).GetItems();
+  for (auto _ : state) {
+    for (const auto& item : items) {
+      item->start(item->start() + 1ms);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.counters["cache_lines"] = CountCacheLines(items);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TableShift(benchmark::State& state) {
+  SubRipTable table{MakeFile(state.range(0))};
+  for (auto _ : state) {
+    table.Shift(1ms);
+    benchmark::ClobberMemory();
+  }
+  // Only reads the start times.
+  state.counters["cache_lines"] = CountCacheLines(
+      {{table.starts().data(),
+        table.starts().size() * sizeof(table.starts().front())}});
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_FileTotalDuration(benchmark::State& state) {
+  auto items = MakeFile(state.range(0)).GetItems();
+  for (auto _ : state) {
+    auto total = 0ms;
+    for (std::shared_ptr<SubRipItem> item : items) {
+      total += item->duration();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["cache_lines"] = CountCacheLines(items);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TableStats(benchmark::State& state) {
+  SubRipTable table{MakeFile(state.range(0))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.ComputeStats());
+  }
+  state.counters["cache_lines"] = CountCacheLines(table);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_FileCountOverlapping)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_TableCountOverlapping)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_FileShift)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_TableShift)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_FileTotalDuration)->Arg(10'000)->Arg(1'000'000);
+BENCHMARK(BM_TableStats)->Arg(10'000)->Arg(1'000'000);
@@ -0,0 +1,143 @@
+#include "subtitler/srt/subrip_table.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "subtitler/srt/subrip_file.h"
+#include "subtitler/srt/subrip_item.h"
+
+using namespace std::chrono_literals;
+using namespace subtitler::srt;
+using ::testing::ElementsAre;
+
+class SubRipTableTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SubRipItem item;
+    item.start(0s)->duration(20s)->AppendLine("first");
+    file.AddItem(item);
+
+    item.start(1s)->duration(4s)->ClearPayload()->AppendLine("second");
+    item.position("top-left");
+    file.AddItem(item);
+
+    item.start(2s)->duration(5s)->ClearPayload();
+    item.AppendLine("third")->AppendLine("has two lines");
+    file.AddItem(item);
+  }
+
+  std::string Print(const SubRipFile& srt_file) {
+    std::ostringstream output;
+    srt_file.ToStream(output);
+    return output.str();
+  }
+
+  SubRipFile file;
+};
+
+TEST_F(SubRipTableTest, RoundTripsThroughFile) {
+  SubRipTable table{file};
+  ASSERT_EQ(3, table.NumRows());
+  ASSERT_THAT(table.starts(), ElementsAre(0s, 1s, 2s));
+  ASSERT_THAT(table.durations(), ElementsAre(20s, 4s, 5s));
+  ASSERT_THAT(table.pos_ids(), ElementsAre(0, 7, 7));
+  ASSERT_EQ("third\nhas two lines\n", table.payload(2));
+  ASSERT_EQ(2, table.ToItem(2).num_lines());
+  ASSERT_EQ(Print(file), Print(table.ToFile()));
+}
+
+TEST_F(SubRipTableTest, EditsRowsInPlace) {
+  SubRipTable table{file};
+  table.SetPayload(1, "a much longer payload than before\n");
+  ASSERT_EQ("a much longer payload than before\n", table.payload(1));
+  ASSERT_EQ(1s, table.ToItem(1).start());
+  ASSERT_EQ(7, table.ToItem(1).substation_alpha_position());
+  ASSERT_EQ(2, table.ToItem(0).substation_alpha_position());
+  ASSERT_THROW(table.SetPayload(3, "out of range\n"), std::out_of_range);
+  ASSERT_THROW(table.payload(3), std::out_of_range);
+}
+
+TEST_F(SubRipTableTest, CompactTextDropsReplacedPayloads) {
+  SubRipTable table{file};
+  auto original_size = table.text_arena_size();
+  table.SetPayload(0, "this payload does not fit in place\n");
+  ASSERT_GT(table.text_arena_size(),
+            original_size + table.payload(0).size() - 6);
+
+  table.CompactText();
+  ASSERT_EQ(original_size - 6 + table.payload(0).size(),
+            table.text_arena_size());
+  ASSERT_EQ("this payload does not fit in place\n", table.payload(0));
+  ASSERT_EQ("second\n", table.payload(1));
+  ASSERT_EQ("third\nhas two lines\n", table.payload(2));
+}
+
+TEST_F(SubRipTableTest, GrowingPayloadReusesItsSpace) {
+  SubRipTable table{file};
+  auto original_size = table.text_arena_size();
+  // Like typing the text one key at a time.
+  std::string payload;
+  for (int i = 0; i < 1000; ++i) {
+    payload += 'a';
+    table.SetPayload(1, payload);
+  }
+  ASSERT_EQ(payload, table.payload(1));
+  // Each move at least doubles the space, so the arena grows linearly
+  // rather than by the sum of every payload typed.
+  ASSERT_LT(table.text_arena_size(), original_size + 4 * payload.size());
+
+  // Shorter payloads keep the space for the next longer one.
+  auto grown_size = table.text_arena_size();
+  table.SetPayload(1, "b");
+  table.SetPayload(1, payload);
+  ASSERT_EQ(grown_size, table.text_arena_size());
+  ASSERT_EQ("first\n", table.payload(0));
+  ASSERT_EQ("third\nhas two lines\n", table.payload(2));
+}
+
+TEST_F(SubRipTableTest, SetsPayloadFromTheTablesOwnText) {
+  SubRipTable table{file};
+  // Growing row 0 reallocates the arena which holds the payload of row 2.
+  table.SetPayload(0, table.payload(2));
+  ASSERT_EQ("third\nhas two lines\n", table.payload(0));
+  // A part of the row's own payload, which overlaps its destination.
+  table.SetPayload(2, table.payload(2).substr(6));
+  ASSERT_EQ("has two lines\n", table.payload(2));
+  ASSERT_EQ("third\nhas two lines\n", table.payload(0));
+}
+
+TEST_F(SubRipTableTest, BulkOperations) {
+  SubRipTable table{file};
+  ASSERT_EQ(3, table.CountOverlapping(4s, 4s));
+  ASSERT_EQ(1, table.CountOverlapping(10s, 12s));
+
+  std::vector<std::size_t> found;
+  table.ForEachOverlapping(5s + 500ms, 6s,
+                           [&found](std::size_t row) { found.push_back(row); });
+  ASSERT_THAT(found, ElementsAre(0, 2));
+
+  table.Shift(1s);
+  ASSERT_THAT(table.starts(), ElementsAre(1s, 2s, 3s));
+  ASSERT_THROW(table.Shift(-2s), std::invalid_argument);
+  ASSERT_THAT(table.starts(), ElementsAre(1s, 2s, 3s));
+
+  auto stats = table.ComputeStats();
+  ASSERT_EQ(3, stats.num_rows);
+  ASSERT_EQ(29s, stats.total_duration);
+  ASSERT_EQ(4s, stats.min_duration);
+  ASSERT_EQ(20s, stats.max_duration);
+  ASSERT_EQ(21s, stats.max_end);
+}
+
+TEST(SubRipTableEmptyTest, EmptyTable) {
+  SubRipTable table;
+  ASSERT_EQ(0, table.CountOverlapping(0s, 1s));
+  ASSERT_EQ(0, table.ComputeStats().num_rows);
+  table.Shift(-1s);
+  ASSERT_EQ(0, table.ToFile().NumItems());
+}
@@ -0,0 +1,79 @@
+#include "subtitler/srt/subrip_text_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace subtitler {
+namespace srt {
+
+SubRipTextPool& SubRipTextPool::Global() {
+  // Never destroyed, items may still reference it during static destruction.
+  static auto* pool = new SubRipTextPool;
+  return *pool;
+}
+
+std::shared_ptr<const std::string> SubRipTextPool::Intern(
+    std::string_view text) {
+  return InternImpl(text);
+}
+
+std::shared_ptr<const std::string> SubRipTextPool::Intern(std::string&& text) {
+  return InternImpl(std::move(text));
+}
+
+template <typename Text>
+std::shared_ptr<const std::string> SubRipTextPool::InternImpl(Text&& text) {
+  const auto hash = std::hash<std::string_view>{}(text);
+  auto& shard = shards_[hash % shards_.size()];
+  std::lock_guard lock{shard.mutex};
+  ++shard.num_lookups;
+  if (auto it = shard.texts.find(std::string_view{text});
+      it != shard.texts.end()) {
+    ++shard.num_hits;
+    shard.bytes_saved += text.size();
+    return it->second;
+  }
+  if (shard.texts.size() >= shard.prune_at) {
+    shard.Prune();
+    shard.prune_at = std::max(kMinPruneSize, 2 * shard.texts.size());
+  }
+  auto interned =
+      std::make_shared<const std::string>(std::forward<Text>(text));
+  shard.texts.emplace(*interned, interned);
+  return interned;
+}
+
+void SubRipTextPool::Prune() {
+  for (auto& shard : shards_) {
+    std::lock_guard lock{shard.mutex};
+    shard.Prune();
+  }
+}
+
+void SubRipTextPool::Shard::Prune() {
+  // A use count of 1 can't go up concurrently, since new references are
+  // only handed out by Intern() under the lock or copied from an existing
+  // reference.
+  std::erase_if(texts, [](const auto& entry) {
+    return entry.second.use_count() == 1;
+  });
+}
+
+SubRipTextPool::Stats SubRipTextPool::GetStats() const {
+  Stats stats;
+  for (const auto& shard : shards_) {
+    std::lock_guard lock{shard.mutex};
+    stats.num_texts += shard.texts.size();
+    for (const auto& [text, interned] : shard.texts) {
+      stats.text_bytes += text.size();
+    }
+    stats.num_lookups += shard.num_lookups;
+    stats.num_hits += shard.num_hits;
+    stats.bytes_saved += shard.bytes_saved;
+  }
+  return stats;
+}
+
+}  // namespace srt
+}  // namespace subtitler
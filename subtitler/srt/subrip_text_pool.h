@@ -0,0 +1,92 @@
+#ifndef SUBTITLER_SRT_SUBRIP_TEXT_POOL_H
+#define SUBTITLER_SRT_SUBRIP_TEXT_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Interning pool for cue text. Auto-transcribed and SDH tracks repeat the
+ * same bodies, e.g. "[Music]" or speaker tags, thousands of times; interned
+ * items share a single immutable copy of each instead of one per cue.
+ *
+ * Texts stay in the pool while any item references them. Unreferenced texts
+ * are dropped by Prune(), which Intern() also runs whenever the pool has
+ * doubled in size since the last time, so edits don't accumulate garbage.
+ *
+ * Thread safe. The pool is split into shards by hash, each with its own
+ * lock, so that the parallel loaders don't contend on a single mutex.
+ *
+ * Sample Usage:
+ * auto a = SubRipTextPool::Global().Intern("[DOOR CLOSES]\n");
+ * auto b = SubRipTextPool::Global().Intern("[DOOR CLOSES]\n");
+ * assert(a == b);
+ */
+class SubRipTextPool {
+ public:
+  struct Stats {
+    // Texts currently in the pool, and their total size in bytes.
+    std::size_t num_texts = 0;
+    std::size_t text_bytes = 0;
+    // Calls to Intern() so far, and how many of them found the text already
+    // in the pool.
+    std::size_t num_lookups = 0;
+    std::size_t num_hits = 0;
+    // Total size of the texts found, i.e. bytes not allocated again.
+    std::size_t bytes_saved = 0;
+  };
+
+  SubRipTextPool() = default;
+  SubRipTextPool(const SubRipTextPool&) = delete;
+  SubRipTextPool& operator=(const SubRipTextPool&) = delete;
+
+  // The process wide pool used by SubRipItem::InternPayload.
+  static SubRipTextPool& Global();
+
+  // Returns the copy of text in the pool, adding one if there is none.
+  std::shared_ptr<const std::string> Intern(std::string_view text);
+  // Same, but moves text into the pool rather than copying it.
+  std::shared_ptr<const std::string> Intern(std::string&& text);
+  std::shared_ptr<const std::string> Intern(const char* text) {
+    return Intern(std::string_view{text});
+  }
+
+  // Drops every text which is only referenced by the pool.
+  void Prune();
+
+  Stats GetStats() const;
+
+ private:
+  // Pool size below which Intern() doesn't prune.
+  static constexpr std::size_t kMinPruneSize = 1024;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    // Keys view the mapped string, which never moves.
+    std::unordered_map<std::string_view, std::shared_ptr<const std::string>>
+        texts;
+    std::size_t prune_at = kMinPruneSize;
+    std::size_t num_lookups = 0;
+    std::size_t num_hits = 0;
+    std::size_t bytes_saved = 0;
+
+    void Prune();
+  };
+
+  template <typename Text>
+  std::shared_ptr<const std::string> InternImpl(Text&& text);
+
+  std::array<Shard, 16> shards_;
+};
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
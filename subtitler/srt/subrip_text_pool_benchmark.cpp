@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/srt/subrip_text_pool.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::ParseSubRip;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubRipTextPool;
+
+namespace {
+
+// Contents of an SDH track with num_items cues, every other one a sound
+// description from a small set.
+std::string MakeContents(std::size_t num_items) {
+  static const char* const kDescriptions[] = {
+      "[DRAMATIC MUSIC PLAYING]", "[MAN SPEAKING IN SPANISH]",
+      "[INDISTINCT CHATTER]", "[DOOR CLOSES]", "[PHONE RINGING]"};
+  std::ostringstream output;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})->duration(2s);
+    if (i % 2 == 0) {
+      item.AppendLine(kDescriptions[i / 2 % 5]);
+    } else {
+      item.AppendLine("Dialogue line number " + std::to_string(i));
+    }
+    item.ToStream(i + 1, output, /* flush= */ false);
+    output << '\n';
+  }
+  return output.str();
+}
+
+// Parses into interned items, reporting the bytes shared per parse.
+void BM_ParseSdhTrack(benchmark::State& state) {
+  auto contents = MakeContents(static_cast<std::size_t>(state.range(0)));
+  auto before = SubRipTextPool::Global().GetStats();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseSubRip(contents));
+  }
+  auto after = SubRipTextPool::Global().GetStats();
+  state.counters["bytes_saved"] = benchmark::Counter(
+      static_cast<double>(after.bytes_saved - before.bytes_saved),
+      benchmark::Counter::kAvgIterations);
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+// Compares every pair of neighbouring cues, as the diff does for
+// overlapping ones.
+void ComparePayloads(benchmark::State& state, bool interned) {
+  auto items = ParseSubRip(MakeContents(10'000));
+  if (!interned) {
+    for (auto& item : items) {
+      auto copy = std::make_shared<SubRipItem>();
+      copy->AppendLine(item->payload());
+      item = std::move(copy);
+    }
+  }
+  for (auto _ : state) {
+    std::size_t num_same = 0;
+    for (std::size_t i = 2; i < items.size(); ++i) {
+      num_same += items[i]->SamePayload(*items[i - 2]);
+    }
+    benchmark::DoNotOptimize(num_same);
+  }
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(items.size()));
+}
+
+void BM_SamePayloadInterned(benchmark::State& state) {
+  ComparePayloads(state, /* interned= */ true);
+}
+
+void BM_SamePayloadOwned(benchmark::State& state) {
+  ComparePayloads(state, /* interned= */ false);
+}
+
+}  // namespace
+
+BENCHMARK(BM_ParseSdhTrack)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_SamePayloadInterned);
+BENCHMARK(BM_SamePayloadOwned);
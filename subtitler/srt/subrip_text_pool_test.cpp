@@ -0,0 +1,68 @@
+#include "subtitler/srt/subrip_text_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace subtitler::srt;
+
+TEST(SubRipTextPoolTest, SharesEqualTexts) {
+  SubRipTextPool pool;
+  auto a = pool.Intern("[APPLAUSE CONTINUES]\n");
+  auto b = pool.Intern(std::string{"[APPLAUSE CONTINUES]\n"});
+  auto c = pool.Intern("[CROWD CHEERING]\n");
+  ASSERT_EQ(a, b);
+  ASSERT_NE(a, c);
+  ASSERT_EQ("[APPLAUSE CONTINUES]\n", *a);
+
+  auto stats = pool.GetStats();
+  EXPECT_EQ(2, stats.num_texts);
+  EXPECT_EQ(a->size() + c->size(), stats.text_bytes);
+  EXPECT_EQ(3, stats.num_lookups);
+  EXPECT_EQ(1, stats.num_hits);
+  EXPECT_EQ(a->size(), stats.bytes_saved);
+}
+
+TEST(SubRipTextPoolTest, PrunesUnreferencedTexts) {
+  SubRipTextPool pool;
+  auto kept = pool.Intern("kept");
+  pool.Intern("dropped");
+  pool.Prune();
+  ASSERT_EQ(1, pool.GetStats().num_texts);
+  ASSERT_EQ(kept, pool.Intern("kept"));
+
+  // Intern prunes by itself as the pool grows.
+  for (int i = 0; i < 100'000; ++i) {
+    pool.Intern("edit " + std::to_string(i));
+  }
+  ASSERT_LT(pool.GetStats().num_texts, 50'000);
+  ASSERT_EQ(kept, pool.Intern("kept"));
+}
+
+TEST(SubRipTextPoolTest, InternsConcurrently) {
+  SubRipTextPool pool;
+  std::vector<std::vector<std::shared_ptr<const std::string>>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&pool, &result] {
+      for (int i = 0; i < 10'000; ++i) {
+        result.push_back(pool.Intern("text " + std::to_string(i % 100)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& result : results) {
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      ASSERT_EQ(results[0][i], result[i]);
+    }
+  }
+  auto stats = pool.GetStats();
+  EXPECT_EQ(100, stats.num_texts);
+  EXPECT_EQ(40'000, stats.num_lookups);
+  EXPECT_EQ(40'000 - 100, stats.num_hits);
+}
@@ -0,0 +1,815 @@
+#include "subtitler/srt/subtitle_converter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <streambuf>
+#include <system_error>
+
+#include "subtitler/srt/subrip_encoding.h"
+#include "subtitler/srt/subrip_loader.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/duration_format.h"
+
+namespace fs = std::filesystem;
+
+namespace subtitler {
+namespace srt {
+
+namespace {
+
+// Readers decode their input in blocks of this size.
+constexpr std::size_t kReadSize = 64 * 1024;
+
+// Writers hand their buffer to the output stream once it reaches this size.
+constexpr std::size_t kFlushSize = 64 * 1024;
+
+// Position id of cues without a position, bottom center.
+constexpr int kDefaultPosition = 2;
+
+// Fields of the [Events] section when there is no Format line.
+constexpr std::string_view kDefaultAssFormat =
+    "Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text";
+
+// Same as the header ffmpeg writes when converting SRT to ASS, so the
+// output renders the same.
+constexpr std::string_view kAssHeader =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "PlayResX: 384\n"
+    "PlayResY: 288\n"
+    "WrapStyle: 0\n"
+    "ScaledBorderAndShadow: yes\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+    "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, "
+    "ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, "
+    "MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Default,Arial,16,&Hffffff,&Hffffff,&H0,&H0,0,0,0,0,100,100,0,0,"
+    "1,1,0,2,10,10,10,0\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+    "Effect, Text\n";
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && IsSpace(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && IsSpace(text.back())) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](unsigned char x, unsigned char y) {
+                      return std::tolower(x) == std::tolower(y);
+                    });
+}
+
+// Splits text into at most max_fields fields at separator, so the last field
+// holds the rest of text.
+std::vector<std::string_view> Split(std::string_view text, char separator,
+                                    std::size_t max_fields) {
+  std::vector<std::string_view> fields;
+  while (fields.size() + 1 < max_fields) {
+    auto end = text.find(separator);
+    if (end == std::string_view::npos) {
+      break;
+    }
+    fields.push_back(text.substr(0, end));
+    text.remove_prefix(end + 1);
+  }
+  fields.push_back(text);
+  return fields;
+}
+
+[[noreturn]] void ThrowAt(const std::string& message, std::size_t offset) {
+  throw SubRipParseError{message, offset};
+}
+
+// Stream buffer over the UTF-8 of input, decoded a block at a time by
+// TextDecoder. Throws SubRipParseError from underflow() if input isn't in
+// the encoding it was detected as.
+class DecodingStreamBuf : public std::streambuf {
+ public:
+  explicit DecodingStreamBuf(std::istream& input)
+      : input_{input}, block_(kReadSize, '\0') {}
+
+ protected:
+  int_type underflow() override {
+    while (gptr() == egptr()) {
+      if (done_) {
+        return traits_type::eof();
+      }
+      input_.read(block_.data(), static_cast<std::streamsize>(block_.size()));
+      done_ = !input_;
+      decoded_.clear();
+      const auto size = static_cast<std::size_t>(input_.gcount());
+      decoder_.Decode({block_.data(), size}, done_, decoded_);
+      setg(decoded_.data(), decoded_.data(), decoded_.data() + decoded_.size());
+    }
+    return traits_type::to_int_type(*gptr());
+  }
+
+ private:
+  std::istream& input_;
+  std::string block_;
+  std::string decoded_;
+  TextDecoder decoder_;
+  bool done_ = false;
+};
+
+// Reads lines one at a time, so that memory is bounded by the longest line.
+// Input in any encoding TextDecoder detects is read as UTF-8.
+class StreamLineReader {
+ public:
+  explicit StreamLineReader(std::istream& input)
+      : buffer_{input}, input_{&buffer_} {
+    // Lets decoding errors out of std::getline.
+    input_.exceptions(std::ios::badbit);
+  }
+
+  // Returns false once all lines are consumed. The line excludes the line
+  // ending, and is valid until the next call. Offsets are in the input as
+  // UTF-8, without a byte order mark.
+  bool Next(std::string_view& line, std::size_t& line_offset) {
+    if (!std::getline(input_, line_buffer_)) {
+      return false;
+    }
+    line = line_buffer_;
+    line_offset = offset_;
+    offset_ += line_buffer_.size() + 1;
+    carriage_return_ = !line.empty() && line.back() == '\r';
+    if (carriage_return_) {
+      line.remove_suffix(1);
+    }
+    return true;
+  }
+
+  // True if the last line ended with "\r\n".
+  bool carriage_return() const { return carriage_return_; }
+
+ private:
+  DecodingStreamBuf buffer_;
+  std::istream input_;
+  std::string line_buffer_;
+  std::size_t offset_ = 0;
+  bool carriage_return_ = false;
+};
+
+class SubRipReader : public SubtitleReader {
+ public:
+  explicit SubRipReader(std::istream& input) : lines_{input} {}
+
+  bool Next(SubRipItem& item) override {
+    std::string_view line;
+    std::size_t offset = 0;
+    do {
+      if (!lines_.Next(line, offset)) {
+        return false;
+      }
+    } while (line.empty());
+
+    // Collects the lines of the cue with their line endings, so that the
+    // offsets of errors within it map straight back to the input.
+    const std::size_t cue_offset = offset;
+    cue_.clear();
+    bool more = true;
+    while (more) {
+      cue_ += line;
+      if (lines_.carriage_return()) {
+        cue_ += '\r';
+      }
+      cue_ += '\n';
+      more = !line.empty() && lines_.Next(line, offset);
+    }
+    try {
+      ParseSubRipCue(cue_, item);
+    } catch (const SubRipParseError& e) {
+      throw SubRipParseError{e.message(), cue_offset + e.offset()};
+    }
+    return true;
+  }
+
+ private:
+  StreamLineReader lines_;
+  std::string cue_;
+};
+
+// Parses the start and end of a "start --> end" line into item, and returns
+// whatever follows the end timestamp.
+std::string_view ParseTimingLine(std::string_view line, std::size_t offset,
+                                 SubRipItem& item) {
+  auto arrow = line.find("-->");
+  if (arrow == std::string_view::npos) {
+    ThrowAt("Could not parse timestamp line: " + std::string{line}, offset);
+  }
+  auto rest = line.substr(arrow + 3);
+  while (!rest.empty() && IsSpace(rest.front())) {
+    rest.remove_prefix(1);
+  }
+  auto end_size = std::min(rest.size(), rest.find_first_of(" \t"));
+  auto start = ParseSubRipTimestamp(Trim(line.substr(0, arrow)));
+  auto end = ParseSubRipTimestamp(rest.substr(0, end_size));
+  if (!start || !end) {
+    ThrowAt("Could not parse timestamp values: " + std::string{line}, offset);
+  }
+  if (*start > *end) {
+    ThrowAt("Start time cannot be greater than end: " + std::string{line},
+            offset);
+  }
+  item.start(*start)->duration(*end - *start);
+  return rest.substr(end_size);
+}
+
+// Position id set by WebVTT cue settings, e.g. "line:0 align:left", or 0
+// if they don't set one. The line is split into thirds of the video.
+int ParseWebVttPosition(std::string_view settings) {
+  int row = -1;
+  int column = -1;
+  while (!(settings = Trim(settings)).empty()) {
+    auto size = std::min(settings.size(), settings.find_first_of(" \t"));
+    auto setting = settings.substr(0, size);
+    settings.remove_prefix(size);
+    if (setting.starts_with("line:")) {
+      auto value = setting.substr(5);
+      value = value.substr(0, value.find(','));
+      int number = 0;
+      auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), number);
+      if (ec != std::errc{}) {
+        continue;
+      }
+      if (value.ends_with('%')) {
+        row = number < 34 ? 2 : (number < 67 ? 1 : 0);
+      } else {
+        // Line numbers count from the top, or from the bottom if negative.
+        row = number < 0 ? 0 : 2;
+      }
+    } else if (setting.starts_with("align:")) {
+      auto value = setting.substr(6);
+      if (value == "left" || value == "start") {
+        column = 0;
+      } else if (value == "right" || value == "end") {
+        column = 2;
+      } else {
+        column = 1;
+      }
+    }
+  }
+  if (row == -1 && column == -1) {
+    return 0;
+  }
+  return std::max(row, 0) * 3 + (column == -1 ? 1 : column) + 1;
+}
+
+class WebVttReader : public SubtitleReader {
+ public:
+  explicit WebVttReader(std::istream& input) : lines_{input} {}
+
+  bool Next(SubRipItem& item) override {
+    std::string_view line;
+    std::size_t offset = 0;
+    if (!read_header_) {
+      if (!lines_.Next(line, offset) || !line.starts_with("WEBVTT")) {
+        ThrowAt("Missing WEBVTT header", 0);
+      }
+      read_header_ = true;
+      SkipBlock();
+    }
+    for (;;) {
+      do {
+        if (!lines_.Next(line, offset)) {
+          return false;
+        }
+      } while (line.empty());
+      if (line.find("-->") == std::string_view::npos) {
+        // Comment, style or region blocks have no timing line, and the
+        // optional identifier of a cue is followed by its timing line.
+        if (line.starts_with("NOTE") || line.starts_with("STYLE") ||
+            line.starts_with("REGION")) {
+          SkipBlock();
+          continue;
+        }
+        if (!lines_.Next(line, offset) || line.empty()) {
+          ThrowAt("Timestamps were missing.", offset);
+        }
+      }
+      break;
+    }
+
+    item = SubRipItem{};
+    auto settings = ParseTimingLine(line, offset, item);
+    if (auto position = ParseWebVttPosition(settings); position != 0) {
+      item.substation_alpha_position(position);
+    }
+    while (lines_.Next(line, offset) && !line.empty()) {
+      item.AppendLine(line);
+    }
+    return true;
+  }
+
+ private:
+  StreamLineReader lines_;
+  bool read_header_ = false;
+
+  // Skips the rest of the block, up to the next blank line.
+  void SkipBlock() {
+    std::string_view line;
+    std::size_t offset = 0;
+    while (lines_.Next(line, offset) && !line.empty()) {
+    }
+  }
+};
+
+// Appends a SRT or WebVTT style tag for the ASS override tag, e.g. "<i>" for
+// "i1". Other override tags are dropped.
+void AppendTagForOverride(std::string_view tag, SubRipItem& item,
+                          std::string& line) {
+  if (tag.size() == 3 && tag.starts_with("an") && tag[2] >= '1' &&
+      tag[2] <= '9') {
+    item.substation_alpha_position(tag[2] - '0');
+    return;
+  }
+  if (tag.empty()) {
+    return;
+  }
+  // \i1, \b1 (or a weight like \b700), \u1 and \s1, or 0 to turn off.
+  auto value = tag.substr(1);
+  if (std::string_view{"ibus"}.find(tag[0]) != std::string_view::npos &&
+      std::all_of(value.begin(), value.end(),
+                  [](char c) { return c >= '0' && c <= '9'; })) {
+    bool on = !value.empty() && value != "0";
+    line += on ? "<" : "</";
+    line += tag[0];
+    line += '>';
+    return;
+  }
+  // \c&HBBGGRR& or \1c&HBBGGRR&, or \c to reset.
+  if (tag.starts_with("1c")) {
+    tag.remove_prefix(1);
+  }
+  if (tag == "c") {
+    line += "</font>";
+  } else if (tag.starts_with("c&H") || tag.starts_with("c&h")) {
+    auto hex = tag.substr(3);
+    hex = hex.substr(0, hex.find('&'));
+    if (hex.size() > 6 || hex.empty()) {
+      return;
+    }
+    std::string bgr(6 - hex.size(), '0');
+    bgr += hex;
+    line += "<font color=\"#";
+    line.append(bgr, 4, 2);
+    line.append(bgr, 2, 2);
+    line.append(bgr, 0, 2);
+    line += "\">";
+  }
+}
+
+// Appends the text field of an ASS Dialogue line to item, one payload line
+// per \N.
+void AppendAssText(std::string_view text, SubRipItem& item) {
+  std::string line;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    if (c == '{') {
+      auto close = text.find('}', i);
+      if (close == std::string_view::npos) {
+        line.append(text.substr(i));
+        break;
+      }
+      auto block = text.substr(i + 1, close - i - 1);
+      while (!block.empty()) {
+        auto tag_begin = block.find('\\');
+        if (tag_begin == std::string_view::npos) {
+          break;
+        }
+        block.remove_prefix(tag_begin + 1);
+        auto tag_end = std::min(block.size(), block.find('\\'));
+        AppendTagForOverride(Trim(block.substr(0, tag_end)), item, line);
+        block.remove_prefix(tag_end);
+      }
+      i = close;
+    } else if (c == '\\' && i + 1 < text.size() &&
+               (text[i + 1] == 'N' || text[i + 1] == 'n')) {
+      if (!line.empty()) {
+        item.AppendLine(line);
+        line.clear();
+      }
+      ++i;
+    } else if (c == '\\' && i + 1 < text.size() && text[i + 1] == 'h') {
+      // Hard space.
+      line += "\xC2\xA0";
+      ++i;
+    } else {
+      line += c;
+    }
+  }
+  if (!line.empty()) {
+    item.AppendLine(line);
+  }
+}
+
+class SubStationAlphaReader : public SubtitleReader {
+ public:
+  explicit SubStationAlphaReader(std::istream& input) : lines_{input} {
+    SetFormat(kDefaultAssFormat, 0);
+  }
+
+  bool Next(SubRipItem& item) override {
+    std::string_view line;
+    std::size_t offset = 0;
+    while (lines_.Next(line, offset)) {
+      if (line.starts_with('[')) {
+        in_events_ = EqualsIgnoreCase(Trim(line), "[Events]");
+      } else if (!in_events_) {
+        continue;
+      } else if (line.starts_with("Format:")) {
+        SetFormat(line.substr(7), offset);
+      } else if (line.starts_with("Dialogue:")) {
+        auto fields = Split(line.substr(9), ',', num_fields_);
+        if (fields.size() != num_fields_) {
+          ThrowAt("Expected " + std::to_string(num_fields_) +
+                      " fields: " + std::string{line},
+                  offset);
+        }
+        auto start = ParseSubRipTimestamp(Trim(fields[start_field_]));
+        auto end = ParseSubRipTimestamp(Trim(fields[end_field_]));
+        if (!start || !end) {
+          ThrowAt("Could not parse timestamp values: " + std::string{line},
+                  offset);
+        }
+        if (*start > *end) {
+          ThrowAt(
+              "Start time cannot be greater than end: " + std::string{line},
+              offset);
+        }
+        item = SubRipItem{};
+        item.start(*start)->duration(*end - *start);
+        AppendAssText(fields.back(), item);
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  StreamLineReader lines_;
+  bool in_events_ = false;
+  std::size_t num_fields_ = 0;
+  std::size_t start_field_ = 0;
+  std::size_t end_field_ = 0;
+
+  void SetFormat(std::string_view format, std::size_t offset) {
+    auto names = Split(format, ',', std::string_view::npos);
+    start_field_ = end_field_ = names.size();
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      auto name = Trim(names[i]);
+      if (name == "Start") {
+        start_field_ = i;
+      } else if (name == "End") {
+        end_field_ = i;
+      }
+    }
+    if (start_field_ == names.size() || end_field_ == names.size() ||
+        Trim(names.back()) != "Text") {
+      ThrowAt("Unsupported Format line: " + std::string{format}, offset);
+    }
+    num_fields_ = names.size();
+  }
+};
+
+// Buffers the output, so that the stream is written in large blocks.
+class BufferedWriter : public SubtitleWriter {
+ public:
+  void Finish() override {
+    Flush();
+    output_.flush();
+  }
+
+ protected:
+  explicit BufferedWriter(std::ostream& output) : output_{output} {
+    buffer_.reserve(kFlushSize * 2);
+  }
+
+  std::string buffer_;
+
+  // Called after each cue.
+  void MaybeFlush() {
+    if (buffer_.size() >= kFlushSize) {
+      Flush();
+    }
+  }
+
+ private:
+  std::ostream& output_;
+
+  void Flush() {
+    output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+};
+
+class SubRipWriter : public BufferedWriter {
+ public:
+  explicit SubRipWriter(std::ostream& output) : BufferedWriter{output} {}
+
+  void Write(const SubRipItem& item) override {
+    item.AppendTo(++num_cues_, buffer_);
+    buffer_ += '\n';
+    MaybeFlush();
+  }
+
+ private:
+  std::size_t num_cues_ = 0;
+};
+
+// HH:MM:SS.mmm
+void AppendWebVttTimestamp(std::chrono::milliseconds time,
+                           std::string& output) {
+  AppendSubRipDuration(time, output);
+  output[output.size() - 4] = '.';
+}
+
+class WebVttWriter : public BufferedWriter {
+ public:
+  explicit WebVttWriter(std::ostream& output) : BufferedWriter{output} {
+    buffer_ += "WEBVTT\n\n";
+  }
+
+  void Write(const SubRipItem& item) override {
+    AppendWebVttTimestamp(item.start(), buffer_);
+    buffer_ += " --> ";
+    AppendWebVttTimestamp(item.start() + item.duration(), buffer_);
+    const int position = item.substation_alpha_position();
+    const int row = (position - 1) / 3;
+    const int column = (position - 1) % 3;
+    if (row == 2) {
+      buffer_ += " line:0";
+    } else if (row == 1) {
+      buffer_ += " line:50%,center";
+    }
+    if (column == 0) {
+      buffer_ += " align:left";
+    } else if (column == 2) {
+      buffer_ += " align:right";
+    }
+    buffer_ += '\n';
+    buffer_ += item.payload();
+    buffer_ += '\n';
+    MaybeFlush();
+  }
+};
+
+// H:MM:SS.cc, rounded to the nearest centisecond.
+void AppendAssTimestamp(std::chrono::milliseconds time, std::string& output) {
+  auto centiseconds = static_cast<std::uint64_t>((time.count() + 5) / 10);
+  char digits[24];
+  auto result =
+      std::to_chars(digits, digits + sizeof(digits), centiseconds / 360000);
+  output.append(digits, result.ptr);
+  auto append_two_digits = [&output](std::uint64_t value) {
+    output += static_cast<char>('0' + value / 10);
+    output += static_cast<char>('0' + value % 10);
+  };
+  output += ':';
+  append_two_digits(centiseconds / 6000 % 60);
+  output += ':';
+  append_two_digits(centiseconds / 100 % 60);
+  output += '.';
+  append_two_digits(centiseconds % 100);
+}
+
+// Appends the override tag for a SRT style tag, e.g. "{\i1}" for "<i>", or
+// returns false if it has none.
+bool AppendOverrideForTag(std::string_view tag, std::string& output) {
+  bool closing = tag.starts_with('/');
+  if (closing) {
+    tag.remove_prefix(1);
+  }
+  if (tag.size() == 1 &&
+      std::string_view{"ibusIBUS"}.find(tag[0]) != std::string_view::npos) {
+    output += "{\\";
+    output += static_cast<char>(
+        std::tolower(static_cast<unsigned char>(tag[0])));
+    output += closing ? "0}" : "1}";
+    return true;
+  }
+  if (!EqualsIgnoreCase(tag.substr(0, 4), "font")) {
+    return false;
+  }
+  if (closing) {
+    output += "{\\c}";
+    return true;
+  }
+  auto color = tag.find("color=\"#");
+  if (color == std::string_view::npos || tag.size() < color + 14) {
+    return false;
+  }
+  auto rgb = tag.substr(color + 8, 6);
+  output += "{\\c&H";
+  output.append(rgb.substr(4, 2));
+  output.append(rgb.substr(2, 2));
+  output.append(rgb.substr(0, 2));
+  output += "&}";
+  return true;
+}
+
+class SubStationAlphaWriter : public BufferedWriter {
+ public:
+  explicit SubStationAlphaWriter(std::ostream& output)
+      : BufferedWriter{output} {
+    buffer_ += kAssHeader;
+  }
+
+  void Write(const SubRipItem& item) override {
+    buffer_ += "Dialogue: 0,";
+    AppendAssTimestamp(item.start(), buffer_);
+    buffer_ += ',';
+    AppendAssTimestamp(item.start() + item.duration(), buffer_);
+    buffer_ += ",Default,,0,0,0,,";
+    if (const int position = item.substation_alpha_position();
+        position != kDefaultPosition) {
+      buffer_ += "{\\an";
+      buffer_ += static_cast<char>('0' + position);
+      buffer_ += '}';
+    }
+    auto payload = item.payload();
+    if (payload.ends_with('\n')) {
+      payload.remove_suffix(1);
+    }
+    for (std::size_t i = 0; i < payload.size(); ++i) {
+      char c = payload[i];
+      if (c == '\n') {
+        buffer_ += "\\N";
+      } else if (c == '<') {
+        auto close = payload.find('>', i);
+        if (close != std::string_view::npos &&
+            AppendOverrideForTag(payload.substr(i + 1, close - i - 1),
+                                 buffer_)) {
+          i = close;
+        } else {
+          buffer_ += c;
+        }
+      } else {
+        buffer_ += c;
+      }
+    }
+    buffer_ += '\n';
+    MaybeFlush();
+  }
+};
+
+}  // namespace
+
+std::string_view ToString(SubtitleFormat format) {
+  switch (format) {
+    case SubtitleFormat::kSubRip:
+      return "srt";
+    case SubtitleFormat::kWebVtt:
+      return "vtt";
+    case SubtitleFormat::kSubStationAlpha:
+      return "ass";
+  }
+  return "unknown";
+}
+
+std::optional<SubtitleFormat> SubtitleFormatFromExtension(
+    std::string_view extension) {
+  if (extension.starts_with('.')) {
+    extension.remove_prefix(1);
+  }
+  for (auto format : {SubtitleFormat::kSubRip, SubtitleFormat::kWebVtt,
+                      SubtitleFormat::kSubStationAlpha}) {
+    if (EqualsIgnoreCase(extension, ToString(format))) {
+      return format;
+    }
+  }
+  return std::nullopt;
+}
+
+std::unique_ptr<SubtitleReader> MakeSubtitleReader(SubtitleFormat format,
+                                                   std::istream& input) {
+  switch (format) {
+    case SubtitleFormat::kSubRip:
+      return std::make_unique<SubRipReader>(input);
+    case SubtitleFormat::kWebVtt:
+      return std::make_unique<WebVttReader>(input);
+    case SubtitleFormat::kSubStationAlpha:
+      return std::make_unique<SubStationAlphaReader>(input);
+  }
+  throw std::invalid_argument{"Unknown subtitle format"};
+}
+
+std::unique_ptr<SubtitleWriter> MakeSubtitleWriter(SubtitleFormat format,
+                                                   std::ostream& output) {
+  switch (format) {
+    case SubtitleFormat::kSubRip:
+      return std::make_unique<SubRipWriter>(output);
+    case SubtitleFormat::kWebVtt:
+      return std::make_unique<WebVttWriter>(output);
+    case SubtitleFormat::kSubStationAlpha:
+      return std::make_unique<SubStationAlphaWriter>(output);
+  }
+  throw std::invalid_argument{"Unknown subtitle format"};
+}
+
+std::size_t ConvertSubtitles(std::istream& input, SubtitleFormat from,
+                             std::ostream& output, SubtitleFormat to) {
+  auto reader = MakeSubtitleReader(from, input);
+  auto writer = MakeSubtitleWriter(to, output);
+  // The same item is reused for every cue.
+  SubRipItem item;
+  std::size_t num_cues = 0;
+  while (reader->Next(item)) {
+    writer->Write(item);
+    ++num_cues;
+  }
+  writer->Finish();
+  return num_cues;
+}
+
+std::vector<ConvertResult> ConvertSubtitleDirectory(
+    const fs::path& input_directory, const fs::path& output_directory,
+    SubtitleFormat format, std::size_t num_threads) {
+  std::vector<ConvertResult> results;
+  for (const auto& entry : fs::recursive_directory_iterator{input_directory}) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    auto from = SubtitleFormatFromExtension(entry.path().extension().string());
+    if (!from || *from == format) {
+      continue;
+    }
+    ConvertResult result;
+    result.input = entry.path();
+    result.output =
+        output_directory / entry.path().lexically_relative(input_directory);
+    result.output.replace_extension(ToString(format));
+    results.push_back(std::move(result));
+  }
+  std::sort(results.begin(), results.end(),
+            [](const auto& a, const auto& b) { return a.input < b.input; });
+  // Inputs which only differ by extension, e.g. a.srt and a.ass, have the
+  // same output. Neither is converted rather than both racing to write it.
+  std::map<fs::path, std::size_t> first_with_output;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto [it, inserted] = first_with_output.emplace(results[i].output, i);
+    if (inserted) {
+      continue;
+    }
+    auto& first = results[it->second];
+    results[i].error = results[i].output.string() +
+                       " is also the output of " + first.input.string();
+    if (first.error.empty()) {
+      first.error = first.output.string() + " is also the output of " +
+                    results[i].input.string();
+    }
+  }
+
+  ParallelFor(results.size(), num_threads, [&](std::size_t i) {
+    auto& result = results[i];
+    if (!result.error.empty()) {
+      return;
+    }
+    try {
+      auto from =
+          *SubtitleFormatFromExtension(result.input.extension().string());
+      fs::create_directories(result.output.parent_path());
+      std::ifstream input{result.input, std::ios::binary};
+      if (!input) {
+        throw std::runtime_error{"Could not open " + result.input.string()};
+      }
+      std::ofstream output{result.output, std::ios::binary};
+      if (!output) {
+        throw std::runtime_error{"Could not open " + result.output.string()};
+      }
+      result.num_cues = ConvertSubtitles(input, from, output, format);
+      if (!output) {
+        throw std::runtime_error{"Could not write " + result.output.string()};
+      }
+    } catch (const std::exception& e) {
+      result.error = e.what();
+      std::error_code ignored;
+      fs::remove(result.output, ignored);
+    }
+  });
+  return results;
+}
+
+}  // namespace srt
+}  // namespace subtitler
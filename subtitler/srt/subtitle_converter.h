@@ -0,0 +1,121 @@
+#ifndef SUBTITLER_SRT_SUBTITLE_CONVERTER_H
+#define SUBTITLER_SRT_SUBTITLE_CONVERTER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "subtitler/srt/subrip_item.h"
+
+namespace subtitler {
+namespace srt {
+
+/**
+ * Streaming conversion between SRT, WebVTT and ASS. Readers and writers
+ * handle one cue at a time, so memory use is bounded by the largest cue
+ * rather than the size of the file, and cues are written in input order.
+ *
+ * Positions are carried by SubRipItem::substation_alpha_position: {\anX}
+ * tags in SRT and ASS, and the line and align cue settings in WebVTT.
+ * Italic, bold, underline and strikeout tags are mapped between <i> and
+ * {\i1} etc, as is <font color>. Other styling is dropped when reading ASS
+ * and kept as is otherwise.
+ *
+ * Readers decode their input with TextDecoder, so it may be UTF-8, with or
+ * without a byte order mark, UTF-16 or Windows-1252. Offsets of errors are
+ * in the input as UTF-8.
+ *
+ * Sample Usage:
+ * std::ifstream input{"movie.srt", std::ios::binary};
+ * std::ofstream output{"movie.vtt", std::ios::binary};
+ * ConvertSubtitles(input, SubtitleFormat::kSubRip, output,
+ *                  SubtitleFormat::kWebVtt);
+ */
+
+enum class SubtitleFormat {
+  kSubRip,
+  kWebVtt,
+  // Advanced SubStation Alpha.
+  kSubStationAlpha,
+};
+
+// File extension of the format without the dot, e.g. "vtt".
+std::string_view ToString(SubtitleFormat format);
+
+// Format with the given file extension, in any case and with or without the
+// dot, e.g. ".VTT". Returns nullopt if there is none.
+std::optional<SubtitleFormat> SubtitleFormatFromExtension(
+    std::string_view extension);
+
+class SubtitleReader {
+ public:
+  virtual ~SubtitleReader() = default;
+
+  // Reads the next cue into item, replacing its contents. Returns false
+  // once there are no more cues.
+  // Throws SubRipParseError with the byte offset in the input if the cue is
+  // malformed.
+  virtual bool Next(SubRipItem& item) = 0;
+};
+
+class SubtitleWriter {
+ public:
+  virtual ~SubtitleWriter() = default;
+
+  virtual void Write(const SubRipItem& item) = 0;
+
+  // Writes out anything still buffered. Must be called after the last cue,
+  // nothing is written on destruction.
+  virtual void Finish() = 0;
+};
+
+std::unique_ptr<SubtitleReader> MakeSubtitleReader(SubtitleFormat format,
+                                                   std::istream& input);
+
+// Writes the header of the format, if it has one, before the first cue.
+std::unique_ptr<SubtitleWriter> MakeSubtitleWriter(SubtitleFormat format,
+                                                   std::ostream& output);
+
+// Converts every cue of input to output. Returns the number of cues.
+// Throws SubRipParseError if input is malformed, in which case output is
+// left incomplete.
+std::size_t ConvertSubtitles(std::istream& input, SubtitleFormat from,
+                             std::ostream& output, SubtitleFormat to);
+
+struct ConvertResult {
+  std::filesystem::path input;
+  std::filesystem::path output;
+  std::size_t num_cues = 0;
+  // Set to the exception message if the file failed to convert.
+  std::string error;
+};
+
+/**
+ * Converts every .srt, .vtt and .ass file (any case) under input_directory,
+ * recursively, which isn't already in format. Each is written to the same
+ * relative path under output_directory, with the extension of format, and
+ * directories are created as needed. Files are converted concurrently, one
+ * per thread at a time, see ParallelFor(). A file which fails to convert
+ * does not stop the others, its partial output is removed and its error
+ * reported in the result instead. Files with the same output, e.g. a.srt
+ * and a.ass, are reported as errors up front and none of them is written.
+ *
+ * Results are sorted by input path. num_threads = 0 means
+ * std::thread::hardware_concurrency.
+ * Throws std::filesystem::filesystem_error if input_directory can't be read.
+ */
+std::vector<ConvertResult> ConvertSubtitleDirectory(
+    const std::filesystem::path& input_directory,
+    const std::filesystem::path& output_directory, SubtitleFormat format,
+    std::size_t num_threads = 0);
+
+}  // namespace srt
+}  // namespace subtitler
+
+#endif
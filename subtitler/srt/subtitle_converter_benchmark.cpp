@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/srt/subtitle_converter.h"
+
+using namespace std::chrono_literals;
+using subtitler::srt::ConvertSubtitles;
+using subtitler::srt::ParseSubRip;
+using subtitler::srt::SubRipItem;
+using subtitler::srt::SubtitleFormat;
+
+namespace {
+
+// Contents of an SRT file with num_items two line cues, every 10th
+// positioned.
+std::string MakeContents(std::size_t num_items) {
+  std::ostringstream output;
+  for (std::size_t i = 0; i < num_items; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 2500})
+        ->duration(2s)
+        ->AppendLine("This is the <i>subtitle</i> for cue " + std::to_string(i))
+        ->AppendLine("and a second line of dialogue.");
+    if (i % 10 == 0) {
+      item.position("top-center");
+    }
+    item.ToStream(i + 1, output, /* flush= */ false);
+    output << '\n';
+  }
+  return output.str();
+}
+
+void Convert(benchmark::State& state, SubtitleFormat from, SubtitleFormat to) {
+  auto contents = MakeContents(static_cast<std::size_t>(state.range(0)));
+  if (from != SubtitleFormat::kSubRip) {
+    std::istringstream input{contents};
+    std::ostringstream output;
+    ConvertSubtitles(input, SubtitleFormat::kSubRip, output, from);
+    contents = output.str();
+  }
+  for (auto _ : state) {
+    std::istringstream input{contents};
+    std::ostringstream output;
+    benchmark::DoNotOptimize(ConvertSubtitles(input, from, output, to));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+void BM_SubRipToWebVtt(benchmark::State& state) {
+  Convert(state, SubtitleFormat::kSubRip, SubtitleFormat::kWebVtt);
+}
+
+void BM_SubRipToSubStationAlpha(benchmark::State& state) {
+  Convert(state, SubtitleFormat::kSubRip, SubtitleFormat::kSubStationAlpha);
+}
+
+void BM_SubStationAlphaToSubRip(benchmark::State& state) {
+  Convert(state, SubtitleFormat::kSubStationAlpha, SubtitleFormat::kSubRip);
+}
+
+// Materializing every cue before writing, for comparison.
+void BM_ParseWholeFile(benchmark::State& state) {
+  auto contents = MakeContents(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto items = ParseSubRip(contents);
+    std::string output;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+      items[i]->AppendTo(i + 1, output);
+      output += '\n';
+    }
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(contents.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_SubRipToWebVtt)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_SubRipToSubStationAlpha)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_SubStationAlphaToSubRip)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_ParseWholeFile)->Arg(1'000)->Arg(100'000);
@@ -0,0 +1,309 @@
+#include "subtitler/srt/subtitle_converter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "subtitler/srt/subrip_item.h"
+#include "subtitler/srt/subrip_parser.h"
+#include "subtitler/util/unicode.h"
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace subtitler;
+using namespace subtitler::srt;
+using ::testing::HasSubstr;
+
+namespace {
+
+constexpr std::string_view kSubRip =
+    "1\n"
+    "00:00:01,000 --> 00:00:02,500\n"
+    "{\\an8}<i>Top</i> line\n"
+    "second line\n"
+    "\n"
+    "2\n"
+    "01:02:03,040 --> 01:02:05,000\n"
+    "<font color=\"#ff8000\">plain</font>\n"
+    "\n"
+    "3\n"
+    "01:02:06,000 --> 01:02:07,000\n"
+    "{\\an4}left\n"
+    "\n";
+
+std::string Convert(std::string_view contents, SubtitleFormat from,
+                    SubtitleFormat to) {
+  std::istringstream input{std::string{contents}};
+  std::ostringstream output;
+  ConvertSubtitles(input, from, output, to);
+  return output.str();
+}
+
+void ExpectConvertError(std::string_view contents, SubtitleFormat from,
+                        const std::string& message, std::size_t offset) {
+  try {
+    Convert(contents, from, SubtitleFormat::kSubRip);
+    FAIL() << "Expected SubRipParseError";
+  } catch (const SubRipParseError& e) {
+    EXPECT_THAT(e.message(), HasSubstr(message));
+    EXPECT_EQ(offset, e.offset());
+  }
+}
+
+}  // namespace
+
+TEST(SubtitleConverterTest, FormatNames) {
+  EXPECT_EQ("vtt", ToString(SubtitleFormat::kWebVtt));
+  EXPECT_EQ(SubtitleFormat::kSubStationAlpha,
+            SubtitleFormatFromExtension(".ASS"));
+  EXPECT_EQ(SubtitleFormat::kSubRip, SubtitleFormatFromExtension("srt"));
+  EXPECT_FALSE(SubtitleFormatFromExtension(".txt").has_value());
+  EXPECT_FALSE(SubtitleFormatFromExtension("").has_value());
+}
+
+TEST(SubtitleConverterTest, CopiesSubRip) {
+  EXPECT_EQ(kSubRip,
+            Convert(kSubRip, SubtitleFormat::kSubRip, SubtitleFormat::kSubRip));
+  // Line endings and sequence numbers are normalized.
+  EXPECT_EQ(
+      "1\n00:00:01,000 --> 00:00:02,000\na\n\n",
+      Convert("\xEF\xBB\xBF\r\n7\r\n00:00:01,000 --> 00:00:02,000\r\na\r\n",
+              SubtitleFormat::kSubRip, SubtitleFormat::kSubRip));
+}
+
+TEST(SubtitleConverterTest, WritesWebVtt) {
+  EXPECT_EQ(
+      "WEBVTT\n"
+      "\n"
+      "00:00:01.000 --> 00:00:02.500 line:0\n"
+      "<i>Top</i> line\n"
+      "second line\n"
+      "\n"
+      "01:02:03.040 --> 01:02:05.000\n"
+      "<font color=\"#ff8000\">plain</font>\n"
+      "\n"
+      "01:02:06.000 --> 01:02:07.000 line:50%,center align:left\n"
+      "left\n"
+      "\n",
+      Convert(kSubRip, SubtitleFormat::kSubRip, SubtitleFormat::kWebVtt));
+}
+
+TEST(SubtitleConverterTest, ReadsWebVtt) {
+  constexpr std::string_view kWebVtt =
+      "WEBVTT - some title\n"
+      "Kind: captions\n"
+      "\n"
+      "NOTE a comment\n"
+      "spanning lines\n"
+      "\n"
+      "STYLE\n"
+      "::cue { color: yellow }\n"
+      "\n"
+      "intro\n"
+      "00:01.000 --> 00:02.000 align:right line:0\n"
+      "first\n"
+      "\n"
+      "1:00:00.000 --> 1:00:01.000 line:-1\n"
+      "bottom\n"
+      "\n"
+      "01:00:02.000 --> 01:00:03.000 position:10% align:start\n"
+      "left\n";
+  EXPECT_EQ(
+      "1\n"
+      "00:00:01,000 --> 00:00:02,000\n"
+      "{\\an9}first\n"
+      "\n"
+      "2\n"
+      "01:00:00,000 --> 01:00:01,000\n"
+      "{\\an2}bottom\n"
+      "\n"
+      "3\n"
+      "01:00:02,000 --> 01:00:03,000\n"
+      "{\\an1}left\n"
+      "\n",
+      Convert(kWebVtt, SubtitleFormat::kWebVtt, SubtitleFormat::kSubRip));
+  // Round trip.
+  EXPECT_EQ(kSubRip, Convert(Convert(kSubRip, SubtitleFormat::kSubRip,
+                                     SubtitleFormat::kWebVtt),
+                             SubtitleFormat::kWebVtt, SubtitleFormat::kSubRip));
+}
+
+TEST(SubtitleConverterTest, WritesSubStationAlpha) {
+  auto ass = Convert(kSubRip, SubtitleFormat::kSubRip,
+                     SubtitleFormat::kSubStationAlpha);
+  EXPECT_THAT(ass, HasSubstr("[Script Info]\n"));
+  EXPECT_THAT(ass, HasSubstr("\n[Events]\nFormat: Layer, Start, End, Style, "
+                             "Name, MarginL, MarginR, MarginV, Effect, Text\n"
+                             "Dialogue: 0,0:00:01.00,0:00:02.50,Default,,0,0,"
+                             "0,,{\\an8}{\\i1}Top{\\i0} line\\Nsecond line\n"
+                             "Dialogue: 0,1:02:03.04,1:02:05.00,Default,,0,0,"
+                             "0,,{\\c&H0080ff&}plain{\\c}\n"
+                             "Dialogue: 0,1:02:06.00,1:02:07.00,Default,,0,0,"
+                             "0,,{\\an4}left\n"));
+}
+
+TEST(SubtitleConverterTest, ReadsSubStationAlpha) {
+  constexpr std::string_view kSubStationAlpha =
+      "[Script Info]\n"
+      "Title: Dialogue: not an event\n"
+      "\n"
+      "[V4+ Styles]\n"
+      "Style: Default,Arial,16\n"
+      "\n"
+      "[Events]\n"
+      "Format: Layer, Start, End, Style, Text\n"
+      "Comment: 0,0:00:00.00,0:00:01.00,Default,ignored\n"
+      "Dialogue: 0,0:00:01.50,0:00:02.00,Default,{\\an7\\b1}Hi, there{\\b0}"
+      "\\Nline{\\fs20\\bord2} two\\hend\n"
+      "Dialogue: 0,10:00:00.00,10:00:01.00,Default,{\\1c&HFF&}red{\\c}\n"
+      "\n"
+      "[Fonts]\n"
+      "Dialogue: not an event either\n";
+  EXPECT_EQ(
+      "1\n"
+      "00:00:01,500 --> 00:00:02,000\n"
+      "{\\an7}<b>Hi, there</b>\n"
+      "line two\xC2\xA0"
+      "end\n"
+      "\n"
+      "2\n"
+      "10:00:00,000 --> 10:00:01,000\n"
+      "<font color=\"#FF0000\">red</font>\n"
+      "\n",
+      Convert(kSubStationAlpha, SubtitleFormat::kSubStationAlpha,
+              SubtitleFormat::kSubRip));
+  // Round trip.
+  EXPECT_EQ(kSubRip,
+            Convert(Convert(kSubRip, SubtitleFormat::kSubRip,
+                            SubtitleFormat::kSubStationAlpha),
+                    SubtitleFormat::kSubStationAlpha, SubtitleFormat::kSubRip));
+}
+
+TEST(SubtitleConverterTest, ReportsOffsetsOfErrors) {
+  // Same offsets as ParseSubRip on the whole contents.
+  ExpectConvertError("1\r\n00:00:01,000 --> 00:00:02,000\r\na\r\n\r\n"
+                     "2\r\n00:00:01,000 -> 00:00:02,000\r\n",
+                     SubtitleFormat::kSubRip, "Expected \"-->\"", 42);
+  ExpectConvertError("1\n00:00:01,000 --> 00:00:02,000\n\n2\n\n",
+                     SubtitleFormat::kSubRip, "Timestamps were missing.", 35);
+  ExpectConvertError("1\n00:00:01,000 --> 00:00:02,000\n\n2\n\n",
+                     SubtitleFormat::kWebVtt, "Missing WEBVTT header", 0);
+  ExpectConvertError("WEBVTT\n\n00:02.000 --> 00:01.000\n",
+                     SubtitleFormat::kWebVtt, "Start time cannot be greater",
+                     8);
+  ExpectConvertError("[Events]\nDialogue: 0,0:00:01.00,Default\n",
+                     SubtitleFormat::kSubStationAlpha, "Expected 10 fields",
+                     9);
+  ExpectConvertError("[Events]\nFormat: Start, Text, End\n",
+                     SubtitleFormat::kSubStationAlpha,
+                     "Unsupported Format line", 9);
+}
+
+TEST(SubtitleConverterTest, ConvertsLargeInputInBlocks) {
+  std::ostringstream contents;
+  for (std::size_t i = 0; i < 20'000; ++i) {
+    SubRipItem item;
+    item.start(std::chrono::milliseconds{i * 1000})
+        ->duration(500ms)
+        ->AppendLine("cue " + std::to_string(i));
+    item.ToStream(i + 1, contents, /* flush= */ false);
+    contents << '\n';
+  }
+  std::istringstream input{contents.str()};
+  std::ostringstream output;
+  ASSERT_EQ(20'000, ConvertSubtitles(input, SubtitleFormat::kSubRip, output,
+                                     SubtitleFormat::kWebVtt));
+  ASSERT_EQ(contents.str(),
+            Convert(output.str(), SubtitleFormat::kWebVtt,
+                    SubtitleFormat::kSubRip));
+}
+
+TEST(SubtitleConverterTest, ConvertsDirectory) {
+  auto dir = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+             "subtitle_converter_test_dir";
+  auto input = dir / "input";
+  auto output = dir / "output";
+  fs::create_directories(input / "nested");
+  {
+    std::ofstream{input / "a.srt"} << "1\n00:00:01,000 --> 00:00:02,000\na\n";
+    std::ofstream{input / "nested" / "b.ASS"}
+        << "[Events]\nDialogue: 0,0:00:01.00,0:00:02.00,,,0,0,0,,b\n";
+    std::ofstream{input / "broken.srt"} << "1\n00:00:01,000 -> 00:00:02,000\n";
+    std::ofstream{input / "already.vtt"} << "WEBVTT\n";
+    std::ofstream{input / "ignored.txt"} << "not a subtitle";
+  }
+
+  auto results =
+      ConvertSubtitleDirectory(input, output, SubtitleFormat::kWebVtt, 2);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(input / "a.srt", results[0].input);
+  EXPECT_EQ(output / "a.vtt", results[0].output);
+  EXPECT_EQ(1, results[0].num_cues);
+  EXPECT_TRUE(results[0].error.empty());
+  EXPECT_EQ(input / "broken.srt", results[1].input);
+  EXPECT_THAT(results[1].error, HasSubstr("Expected \"-->\""));
+  EXPECT_FALSE(fs::exists(results[1].output));
+  EXPECT_EQ(output / "nested" / "b.vtt", results[2].output);
+  EXPECT_EQ(1, results[2].num_cues);
+
+  std::ifstream stream{output / "nested" / "b.vtt", std::ios::binary};
+  std::ostringstream contents;
+  contents << stream.rdbuf();
+  EXPECT_EQ("WEBVTT\n\n00:00:01.000 --> 00:00:02.000\nb\n\n", contents.str());
+  EXPECT_FALSE(fs::exists(output / "already.vtt"));
+
+  fs::remove_all(dir);
+  ASSERT_THROW(ConvertSubtitleDirectory(input, output, SubtitleFormat::kWebVtt),
+               fs::filesystem_error);
+}
+
+TEST(SubtitleConverterTest, DecodesUtf16AndWindows1252) {
+  // "1\n00:00:01,000 --> 00:00:02,000\ncafé\n" in UTF-16LE with a byte order
+  // mark.
+  std::string utf16 = "\xFF\xFE";
+  for (char c : std::string_view{"1\n00:00:01,000 --> 00:00:02,000\ncaf"}) {
+    utf16 += c;
+    utf16 += '\0';
+  }
+  utf16 += std::string_view{"\xE9\0\n\0", 4};
+  EXPECT_EQ("WEBVTT\n\n00:00:01.000 --> 00:00:02.000\ncaf\xC3\xA9\n\n",
+            Convert(utf16, SubtitleFormat::kSubRip, SubtitleFormat::kWebVtt));
+  EXPECT_EQ("WEBVTT\n\n00:00:01.000 --> 00:00:02.000\ncaf\xC3\xA9\n\n",
+            Convert("1\n00:00:01,000 --> 00:00:02,000\ncaf\xE9\n",
+                    SubtitleFormat::kSubRip, SubtitleFormat::kWebVtt));
+  ExpectConvertError("1\n00:00:01,000 --> 00:00:02,000\n\xC3\xA9\xE9\n",
+                     SubtitleFormat::kSubRip, "Invalid UTF-8", 34);
+}
+
+TEST(SubtitleConverterTest, ReportsDirectoryInputsWithTheSameOutput) {
+  auto dir = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) /
+             "subtitle_converter_test_collisions";
+  auto input = dir / "input";
+  auto output = dir / "output";
+  fs::create_directories(input);
+  {
+    std::ofstream{input / "a.srt"} << "1\n00:00:01,000 --> 00:00:02,000\na\n";
+    std::ofstream{input / "a.ass"}
+        << "[Events]\nDialogue: 0,0:00:01.00,0:00:02.00,,,0,0,0,,a\n";
+    std::ofstream{input / "b.srt"} << "1\n00:00:01,000 --> 00:00:02,000\nb\n";
+  }
+
+  auto results =
+      ConvertSubtitleDirectory(input, output, SubtitleFormat::kWebVtt, 2);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(input / "a.ass", results[0].input);
+  EXPECT_THAT(results[0].error, HasSubstr("a.srt"));
+  EXPECT_EQ(input / "a.srt", results[1].input);
+  EXPECT_THAT(results[1].error, HasSubstr("a.ass"));
+  EXPECT_FALSE(fs::exists(output / "a.vtt"));
+  EXPECT_TRUE(results[2].error.empty());
+  EXPECT_TRUE(fs::exists(output / "b.vtt"));
+
+  fs::remove_all(dir);
+}
@@ -18,7 +18,15 @@ class MockSubprocessExecutor : public SubprocessExecutor {
   MOCK_METHOD(void, SetCommand, (std::string_view), (override));
   MOCK_METHOD(void, SetCallback, (std::function<void(const char*)> callback),
               (override));
+  MOCK_METHOD(void, SetDataCallback,
+              (std::function<void(std::string_view)> callback), (override));
   MOCK_METHOD(void, CaptureOutput, (bool), (override));
+  MOCK_METHOD(void, SetCaptureOptions, (const CaptureOptions&), (override));
+  MOCK_METHOD(void, RedirectOutput, (int), (override));
+  MOCK_METHOD(void, OpenInput, (), (override));
+  MOCK_METHOD(bool, WriteInput, (std::string_view), (override));
+  MOCK_METHOD(void, CloseInput, (), (override));
+  MOCK_METHOD(void, SetInputCallback, (InputCallback), (override));
   MOCK_METHOD(void, Start, (), (override));
   MOCK_METHOD(SubprocessExecutor::Output, WaitUntilFinished,
               (std::optional<int>), (override));
@@ -0,0 +1,44 @@
+#include "subtitler/subprocess/output_buffer.h"
+
+#include <algorithm>
+
+namespace subtitler {
+namespace subprocess {
+
+OutputBuffer::OutputBuffer(std::size_t reserve, std::size_t max_size)
+    : max_size_{max_size} {
+  data_.reserve(max_size_ == 0 ? reserve : std::min(reserve, max_size_));
+}
+
+void OutputBuffer::Append(std::string_view data) {
+  if (max_size_ == 0) {
+    data_.append(data);
+    return;
+  }
+  if (data.size() >= max_size_) {
+    data_.assign(data.substr(data.size() - max_size_));
+    start_ = 0;
+    return;
+  }
+  // Fill up the ring first, then overwrite the oldest bytes.
+  if (data_.size() < max_size_) {
+    const auto fits = std::min(data.size(), max_size_ - data_.size());
+    data_.append(data.substr(0, fits));
+    data.remove_prefix(fits);
+  }
+  while (!data.empty()) {
+    const auto fits = std::min(data.size(), max_size_ - start_);
+    std::copy_n(data.begin(), fits, data_.begin() + start_);
+    start_ = (start_ + fits) % max_size_;
+    data.remove_prefix(fits);
+  }
+}
+
+std::string OutputBuffer::Release() {
+  std::rotate(data_.begin(), data_.begin() + start_, data_.end());
+  start_ = 0;
+  return std::move(data_);
+}
+
+}  // namespace subprocess
+}  // namespace subtitler
@@ -0,0 +1,45 @@
+#ifndef SUBTITLER_SUBPROCESS_OUTPUT_BUFFER_H
+#define SUBTITLER_SUBPROCESS_OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace subtitler {
+namespace subprocess {
+
+/**
+ * Collects the output of a subprocess as it is read, in one buffer.
+ * Output is binary safe, null bytes are kept like any other.
+ *
+ * If max_size is set, only the last max_size bytes are kept, in a ring
+ * which is never reallocated once full. Useful for stderr of long running
+ * processes, which is only looked at if they fail.
+ *
+ * Sample Usage:
+ * OutputBuffer buffer{0, 4};
+ * buffer.Append("hello");
+ * buffer.Append(" world");
+ * assert(buffer.Release() == "orld");
+ */
+class OutputBuffer {
+ public:
+  // Reserves reserve bytes up front. A max_size of 0 keeps everything.
+  explicit OutputBuffer(std::size_t reserve = 0, std::size_t max_size = 0);
+
+  void Append(std::string_view data);
+
+  // Returns the output, oldest byte first, and empties the buffer.
+  std::string Release();
+
+ private:
+  std::string data_;
+  std::size_t max_size_;
+  // Oldest byte in data_ once the ring is full.
+  std::size_t start_ = 0;
+};
+
+}  // namespace subprocess
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,30 @@
+#include "subtitler/subprocess/output_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using subtitler::subprocess::OutputBuffer;
+using namespace std::string_literals;
+
+TEST(OutputBufferTest, KeepsEverything) {
+  OutputBuffer buffer{/* reserve= */ 16};
+  buffer.Append("hello");
+  buffer.Append("\0world"s);
+  ASSERT_EQ("hello\0world"s, buffer.Release());
+}
+
+TEST(OutputBufferTest, KeepsLastBytes) {
+  OutputBuffer buffer{/* reserve= */ 0, /* max_size= */ 8};
+  buffer.Append("abc");
+  buffer.Append("defgh");
+  buffer.Append("ij");
+  buffer.Append("klmnopq");
+  ASSERT_EQ("jklmnopq", buffer.Release());
+
+  buffer.Append("0123456789");
+  ASSERT_EQ("23456789", buffer.Release());
+
+  buffer.Append("xyz");
+  ASSERT_EQ("xyz", buffer.Release());
+}
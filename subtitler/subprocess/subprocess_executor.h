@@ -1,6 +1,8 @@
 #ifndef SUBTITLER_SUBPROCESS_SUBPROCESS_EXECUTOR_H
 #define SUBTITLER_SUBPROCESS_SUBPROCESS_EXECUTOR_H
 
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -40,26 +42,108 @@ class SubprocessExecutor {
   //
   // Can be used in conjunction with CaptureOutput if you want the full stdout
   // to be returned by WaitUntilFinished as well.
+  //
+  // On Linux, the pipes of all executors are read by one shared thread,
+  // which runs the callbacks. They should return quickly so as not to hold
+  // up the output of other processes.
   virtual void SetCallback(std::function<void(const char*)> callback);
 
+  // Binary safe version of SetCallback(): each chunk read from stdout is
+  // passed with its size, and may contain null bytes. Replaces the callback
+  // set by SetCallback() and vice versa, and is reset the same way.
+  virtual void SetDataCallback(std::function<void(std::string_view)> callback);
+
   // Sets whether stdout and stderr should be captured and returned
   // by WaitUntilFinished.
   virtual void CaptureOutput(bool capture_output);
 
+  struct CaptureOptions {
+    // Capacity reserved up front for captured stdout, for commands with
+    // large outputs. Output past it still grows the buffer.
+    std::size_t reserve_stdout = 0;
+    // If not 0, only the last max_stderr bytes of stderr are captured, e.g.
+    // for long running processes which log progress to stderr.
+    std::size_t max_stderr = 0;
+  };
+
+  // Sets how output is captured, if CaptureOutput() is set. Kept across
+  // runs.
+  virtual void SetCaptureOptions(const CaptureOptions& options);
+
+  // Makes fd, e.g. an open file, the stdout of the process started next,
+  // which then writes to it directly rather than through a pipe to us.
+  // Stdout is then neither captured nor passed to the callback. fd must
+  // stay open until Start() returns. Set -1 to read stdout again.
+  virtual void RedirectOutput(int fd);
+
+  // Called with a buffer of size bytes to fill with input for the process.
+  // Returns how many bytes were written, 0 at the end of the input.
+  using InputCallback =
+      std::function<std::size_t(char* buffer, std::size_t size)>;
+
+  // Connects a pipe to stdin of the process started next, to be written
+  // with WriteInput() until CloseInput(). Otherwise stdin is inherited.
+  // Reset by WaitUntilFinished() like the callback.
+  virtual void OpenInput();
+
+  // Writes data to stdin of the running process, blocking while the pipe is
+  // full until the process has read enough of it. Returns false if the
+  // process has closed its stdin, e.g. because it exited. Requires
+  // OpenInput().
+  virtual bool WriteInput(std::string_view data);
+
+  // Closes stdin, so the process reads end of file. Done by
+  // WaitUntilFinished() too, if still open.
+  virtual void CloseInput();
+
+  // Feeds stdin of the process started next from callback, which is called
+  // whenever the pipe has room, until it returns 0 or the process closes
+  // its stdin. Input is thus produced only as fast as it is read. Like
+  // output callbacks, it runs on the shared reader thread on Linux and must
+  // not block. Reset by WaitUntilFinished(), which waits for its last call.
+  virtual void SetInputCallback(InputCallback callback);
+
+  // InputCallback which writes data.
+  static InputCallback InputFrom(std::string data);
+
   // Start executing the command. Throws std::runtime_error if unable to
   // Start() the command.
   virtual void Start();
 
+  // Resources used by a process, from when it was started until it exited.
+  struct ResourceUsage {
+    std::chrono::microseconds wall_time{0};
+    std::chrono::microseconds user_cpu{0};
+    std::chrono::microseconds system_cpu{0};
+    // Peak resident set size, or peak working set on Windows.
+    long max_rss_kb = 0;
+    // Always 0 on Windows.
+    long voluntary_context_switches = 0;
+    long involuntary_context_switches = 0;
+    // Blocks read from and written to the file system. Counts read and
+    // write operations instead on Windows.
+    long input_blocks = 0;
+    long output_blocks = 0;
+  };
+
   struct Output {
     std::string subproc_stdout;
     std::string subproc_stderr;
+    // Exit code of the process, if it exited rather than being terminated.
+    std::optional<int> exit_code;
+    // Signal which terminated the process, e.g. SIGTERM after a timeout.
+    // Always empty on Windows.
+    std::optional<int> term_signal;
+    ResourceUsage usage;
   };
 
   // Wait until process finishes and return its stdout and stderr.
   // If capture output is set false, then returns empty string.
   // If timeout is not set then wait forever.
-  // If timeout is set, then wait at most 2 * timeout_ms before force
-  // terminating the process. Also resets the callback.
+  // If timeout is set, then wait at most timeout_ms before asking the
+  // process to terminate (SIGTERM, or WM_CLOSE on Windows), and at most
+  // another timeout_ms before force terminating it. Returns as soon as the
+  // process exits. Also resets the callback.
   virtual Output WaitUntilFinished(
       std::optional<int> timeout_ms = std::nullopt);
 
@@ -67,12 +151,28 @@ class SubprocessExecutor {
   std::string command_;
   bool capture_output_;
   bool is_running_;
-  std::function<void(const char*)> callback_;
+  // Callbacks set by SetCallback() are adapted, chunks passed to callback_
+  // are followed by a null byte.
+  std::function<void(std::string_view)> callback_;
+  CaptureOptions capture_options_;
+  int redirect_fd_;
+  bool open_input_;
+  InputCallback input_callback_;
 
   struct PlatformDependentFields;
   std::unique_ptr<PlatformDependentFields> fields;
 };
 
+inline SubprocessExecutor::InputCallback SubprocessExecutor::InputFrom(
+    std::string data) {
+  return [data = std::move(data), offset = std::size_t{0}](
+             char* buffer, std::size_t size) mutable {
+    const auto copied = data.copy(buffer, size, offset);
+    offset += copied;
+    return copied;
+  };
+}
+
 }  // namespace subprocess
 }  // namespace subtitler
 
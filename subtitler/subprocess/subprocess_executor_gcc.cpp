@@ -1,18 +1,31 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <wordexp.h>
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <future>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
+#include <vector>
 
+#include "subtitler/subprocess/output_buffer.h"
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/util/unicode.h"
 
@@ -25,89 +38,397 @@ namespace subprocess {
 
 namespace {
 
-const int BUFFER_SIZE = 1024;
+// Size of a pipe on Linux, so one read usually empties it.
+const std::size_t BUFFER_SIZE = 64 * 1024;
+const int MAX_EVENTS = 64;
 
-std::string PollHandle(int fd, bool return_output,
-                       std::function<void(const char*)> callback) {
-  int bytes_read = 0;
-  char buffer[BUFFER_SIZE + 1];
-  std::ostringstream str;
+// A pipe to a child watched by the reactor.
+struct WatchedPipe {
+  int fd = -1;
 
-  // Spin until we are unable to read the pipe anymore
-  for (;;) {
-    bytes_read = read(
-        /* fd= */ fd,
-        /* buf= */ buffer,
-        /* count= */ BUFFER_SIZE);
-    if (bytes_read < 0 || bytes_read == 0) {
-      break;
+  virtual ~WatchedPipe() = default;
+  // Called when the pipe is ready, with a buffer of BUFFER_SIZE + 1 bytes
+  // shared by all pipes. Returns false once done with the pipe.
+  virtual bool OnReady(std::vector<char>& buffer) = 0;
+  // Called once the pipe is closed.
+  virtual void OnClosed() = 0;
+};
+
+// Reads the pipe of a child until it is closed.
+struct PipeReader : WatchedPipe {
+  bool capture_output = false;
+  OutputBuffer output;
+  std::function<void(std::string_view)> callback;
+  std::promise<std::string> finished;
+
+  bool OnReady(std::vector<char>& buffer) override {
+    auto bytes_read = read(fd, buffer.data(), BUFFER_SIZE);
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR)) {
+      return true;
+    }
+    if (bytes_read <= 0) {
+      // End of file, or the pipe broke.
+      return false;
     }
-    // Ensure null termiantion
+    // Ensure null termination, for callbacks set by SetCallback().
     buffer[bytes_read] = '\0';
-
+    const std::string_view data{buffer.data(),
+                                static_cast<std::size_t>(bytes_read)};
     if (callback) {
-      callback(buffer);
+      callback(data);
+    }
+    if (capture_output) {
+      output.Append(data);
+    }
+    return true;
+  }
+
+  void OnClosed() override { finished.set_value(output.Release()); }
+};
+
+// Writes the input of a child as it reads it, until the input ends or the
+// child closes its end.
+struct PipeWriter : WatchedPipe {
+  SubprocessExecutor::InputCallback callback;
+  // Input produced but not written yet, as the pipe was full.
+  std::string pending;
+  std::promise<void> finished;
+
+  bool OnReady(std::vector<char>& buffer) override {
+    std::string_view data = pending;
+    if (data.empty()) {
+      const auto size = callback(buffer.data(), BUFFER_SIZE);
+      if (size == 0) {
+        return false;
+      }
+      data = {buffer.data(), size};
+    }
+    auto bytes_written = write(fd, data.data(), data.size());
+    if (bytes_written < 0 && errno != EAGAIN && errno != EINTR) {
+      // The child closed its end, SIGPIPE is blocked on the reactor thread.
+      return false;
+    }
+    data.remove_prefix(std::max<ssize_t>(bytes_written, 0));
+    pending = std::string{data};
+    return true;
+  }
+
+  void OnClosed() override { finished.set_value(); }
+};
+
+/**
+ * Reads and writes the pipes of every running SubprocessExecutor on one
+ * thread, rather than blocking a thread on each pipe. Pipes are
+ * non-blocking and watched with epoll, which is level triggered so that
+ * each wake up reads or writes one buffer, and busy children don't starve
+ * the others.
+ *
+ * The thread is started on first use and runs until the process exits.
+ */
+class PipeReactor {
+ public:
+  static PipeReactor& Global() {
+    // Never destroyed, the thread may still be waiting at exit.
+    static auto* reactor = new PipeReactor;
+    return *reactor;
+  }
+
+  // Takes ownership of fd and reads it on the reactor thread, which closes
+  // it at end of file and then sets the result of the returned future to the
+  // captured output. Callbacks are run on the reactor thread too, with
+  // chunks followed by a null byte.
+  std::future<std::string> Watch(
+      int fd, bool capture_output, OutputBuffer output,
+      std::function<void(std::string_view)> callback) {
+    auto reader = std::make_unique<PipeReader>();
+    reader->capture_output = capture_output;
+    reader->output = std::move(output);
+    reader->callback = std::move(callback);
+    auto finished = reader->finished.get_future();
+    Add(fd, EPOLLIN, std::move(reader));
+    return finished;
+  }
+
+  // Takes ownership of fd and writes the input produced by callback to it
+  // on the reactor thread, which closes it at the end of the input and then
+  // makes the returned future ready.
+  std::future<void> WatchInput(int fd,
+                               SubprocessExecutor::InputCallback callback) {
+    auto writer = std::make_unique<PipeWriter>();
+    writer->callback = std::move(callback);
+    auto finished = writer->finished.get_future();
+    Add(fd, EPOLLOUT, std::move(writer));
+    return finished;
+  }
+
+  // Takes ownership of fd and calls pipe->OnReady() on the reactor thread
+  // when it is ready for events, until it returns false.
+  void Add(int fd, std::uint32_t events, std::unique_ptr<WatchedPipe> pipe) {
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+      close(fd);
+      throw std::runtime_error("Could not make pipe non-blocking");
+    }
+    pipe->fd = fd;
+    epoll_event event{};
+    event.events = events;
+    event.data.ptr = pipe.get();
+    // From here on only the reactor thread touches the pipe.
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      throw std::runtime_error("Could not watch pipe");
+    }
+    pipe.release();
+  }
+
+ private:
+  int epoll_fd_;
+
+  PipeReactor() : epoll_fd_{epoll_create1(EPOLL_CLOEXEC)} {
+    if (epoll_fd_ < 0) {
+      throw std::runtime_error("Could not create epoll instance");
+    }
+    std::thread{[this] { Run(); }}.detach();
+  }
+
+  void Run() {
+    // Writing to a child which exited raises SIGPIPE, which would kill the
+    // whole process. Blocked, the write fails with EPIPE instead.
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+    std::vector<char> buffer(BUFFER_SIZE + 1);
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+      int num_events = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+      for (int i = 0; i < num_events; ++i) {
+        auto* pipe = static_cast<WatchedPipe*>(events[i].data.ptr);
+        if (!pipe->OnReady(buffer)) {
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, pipe->fd, nullptr);
+          close(pipe->fd);
+          pipe->OnClosed();
+          delete pipe;
+        }
+      }
     }
-    if (return_output) {
-      str << buffer;
+  }
+};
+
+// Writes all of data to the blocking fd. Returns false if the reader closed
+// the pipe. SIGPIPE is blocked while writing, and discarded if raised.
+bool WriteAll(int fd, std::string_view data) {
+  sigset_t sigpipe;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  sigset_t old_mask;
+  pthread_sigmask(SIG_BLOCK, &sigpipe, &old_mask);
+  sigset_t pending_before;
+  sigpending(&pending_before);
+
+  int error = 0;
+  while (!data.empty()) {
+    auto bytes_written = write(fd, data.data(), data.size());
+    if (bytes_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = errno;
+      break;
     }
+    data.remove_prefix(bytes_written);
+  }
+  // Only discard a SIGPIPE raised by the write above.
+  if (error == EPIPE && !sigismember(&pending_before, SIGPIPE)) {
+    const timespec no_wait{};
+    sigtimedwait(&sigpipe, nullptr, &no_wait);
   }
+  pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
 
-  return str.str();
+  if (error != 0 && error != EPIPE) {
+    throw std::runtime_error("Could not write input to subprocess");
+  }
+  return error == 0;
 }
 
-void WaitTimeoutOrKill(pid_t pid, int timeout_ms) {
-  int status = 0;
-  // Check if already terminated
-  auto ret = waitpid(pid, &status, WNOHANG);
-  if (ret < 0) {
-    throw std::runtime_error("waitpid() error");
-  }
-  if (ret == 0) {
-    // Didn't see it terminate.
-    // Wait timeout / 2
-    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms / 2));
-    // Try again
-    ret = waitpid(pid, &status, WNOHANG);
-    if (ret < 0) {
-      throw std::runtime_error("waitpid() error after timeout");
+using Clock = std::chrono::steady_clock;
+
+// Drains the pipe written by the SIGCHLD handler of ChildExitNotifier.
+struct SignalPipe : WatchedPipe {
+  std::function<void()> on_signal;
+
+  bool OnReady(std::vector<char>& buffer) override {
+    while (read(fd, buffer.data(), BUFFER_SIZE) > 0) {
+    }
+    on_signal();
+    return true;
+  }
+
+  void OnClosed() override {}
+};
+
+/**
+ * Wakes up threads waiting for children to exit, for kernels without
+ * pidfd_open() (before Linux 5.3). A SIGCHLD handler writes to a pipe read
+ * by the reactor, which then bumps a count of exits and notifies waiters,
+ * who check whether their child was the one which exited.
+ *
+ * Installed on first use, and chains to the SIGCHLD handler set before.
+ */
+class ChildExitNotifier {
+ public:
+  static ChildExitNotifier& Global() {
+    // Never destroyed, the signal handler may still run at exit.
+    static auto* notifier = new ChildExitNotifier;
+    return *notifier;
+  }
+
+  // Number of SIGCHLD received so far.
+  std::uint64_t generation() {
+    std::lock_guard lock{mutex_};
+    return generation_;
+  }
+
+  // Waits until a SIGCHLD is received after generation() returned seen, or
+  // until deadline.
+  void WaitUntil(std::uint64_t seen, Clock::time_point deadline) {
+    std::unique_lock lock{mutex_};
+    exited_.wait_until(lock, deadline, [&] { return generation_ != seen; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable exited_;
+  std::uint64_t generation_ = 0;
+
+  static inline int write_fd_ = -1;
+  static inline struct sigaction previous_action_ {};
+
+  ChildExitNotifier() {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) < 0) {
+      throw std::runtime_error("Could not create SIGCHLD pipe");
     }
-    if (ret == 0) {
-      // Still nothing... send terminate.
-      ret = kill(pid, SIGTERM);
-      std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms / 2));
-      ret = waitpid(pid, &status, WNOHANG);
-      if (ret < 0) {
-        throw std::runtime_error("waitpid() error after SIGTERM");
+    write_fd_ = fds[1];
+    auto pipe = std::make_unique<SignalPipe>();
+    pipe->on_signal = [this] {
+      {
+        std::lock_guard lock{mutex_};
+        ++generation_;
       }
-      if (ret == 0) {
-        // Not responding to terminate
-        // Hard kill it.
-        kill(pid, SIGKILL);
-        ret = waitpid(pid, &status, 0);
-        if (ret < 0) {
-          throw std::runtime_error("waitpid() error after SIGKILL");
-        }
+      exited_.notify_all();
+    };
+    PipeReactor::Global().Add(fds[0], EPOLLIN, std::move(pipe));
+
+    struct sigaction action {};
+    action.sa_sigaction = &OnSigchld;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+    if (sigaction(SIGCHLD, &action, &previous_action_) < 0) {
+      throw std::runtime_error("Could not install SIGCHLD handler");
+    }
+  }
+
+  static void OnSigchld(int signal, siginfo_t* info, void* context) {
+    const int saved_errno = errno;
+    [[maybe_unused]] auto ignored = write(write_fd_, "", 1);
+    errno = saved_errno;
+    if (previous_action_.sa_flags & SA_SIGINFO) {
+      previous_action_.sa_sigaction(signal, info, context);
+    } else if (previous_action_.sa_handler != SIG_DFL &&
+               previous_action_.sa_handler != SIG_IGN) {
+      previous_action_.sa_handler(signal);
+    }
+  }
+};
+
+// Returns a pidfd, which becomes readable when the process exits, or -1 if
+// the kernel doesn't support them.
+int OpenPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  return -1;
+#endif
+}
+
+// Reaps the child into status and usage if it exited, without blocking
+// unless block.
+bool Reap(pid_t pid, int& status, rusage& usage, bool block = false) {
+  pid_t ret;
+  do {
+    ret = wait4(pid, &status, block ? 0 : WNOHANG, &usage);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    throw std::runtime_error("wait4() error");
+  }
+  return ret == pid;
+}
+
+// Waits until the child exits and reaps it into status and usage, or until
+// deadline. Returns whether it exited. Wakes up as soon as it exits, with
+// pidfd or else with ChildExitNotifier.
+bool WaitUntil(pid_t pid, int pidfd, Clock::time_point deadline, int& status,
+               rusage& usage) {
+  if (pidfd >= 0) {
+    for (;;) {
+      const auto remaining = std::chrono::duration_cast<
+          std::chrono::nanoseconds>(deadline - Clock::now());
+      const auto wait = std::max(remaining, std::chrono::nanoseconds::zero());
+      const timespec timeout{
+          static_cast<time_t>(wait.count() / 1'000'000'000),
+          static_cast<long>(wait.count() % 1'000'000'000)};
+      pollfd exited{pidfd, POLLIN, 0};
+      const int ready = ppoll(&exited, 1, &timeout, nullptr);
+      if (ready >= 0) {
+        return Reap(pid, status, usage);
+      }
+      if (errno != EINTR) {
+        throw std::runtime_error("ppoll() error");
       }
     }
   }
+  auto& notifier = ChildExitNotifier::Global();
+  for (;;) {
+    // Read before checking, so that an exit in between isn't missed.
+    const auto seen = notifier.generation();
+    if (Reap(pid, status, usage)) {
+      return true;
+    }
+    if (Clock::now() >= deadline) {
+      return false;
+    }
+    notifier.WaitUntil(seen, deadline);
+  }
+}
+
+std::chrono::microseconds ToDuration(const timeval& time) {
+  return std::chrono::seconds{time.tv_sec} +
+         std::chrono::microseconds{time.tv_usec};
 }
 
 }  // namespace
 
 struct SubprocessExecutor::PlatformDependentFields {
-  int stderr_fd = -1;
-  int stdout_fd = -1;
   pid_t pid = -1;
+  Clock::time_point started;
+  // Becomes readable when the process exits, -1 if unsupported.
+  int pidfd = -1;
   std::unique_ptr<posix_spawn_file_actions_t> actions = nullptr;
   std::unique_ptr<std::future<std::string>> captured_output = nullptr;
   std::unique_ptr<std::future<std::string>> captured_error = nullptr;
+  // Our end of stdin, for WriteInput().
+  int stdin_fd = -1;
+  // Ready once the reactor is done with the input callback.
+  std::unique_ptr<std::future<void>> input_written = nullptr;
 };
 
 SubprocessExecutor::SubprocessExecutor()
     : command_{},
       capture_output_{false},
       is_running_{false},
+      redirect_fd_{-1},
+      open_input_{false},
       fields{std::make_unique<PlatformDependentFields>()} {}
 
 SubprocessExecutor::SubprocessExecutor(const std::string_view command,
@@ -115,6 +436,8 @@ SubprocessExecutor::SubprocessExecutor(const std::string_view command,
     : command_{command},
       capture_output_{capture_output},
       is_running_{false},
+      redirect_fd_{-1},
+      open_input_{false},
       fields{std::make_unique<PlatformDependentFields>()} {}
 
 SubprocessExecutor::~SubprocessExecutor() {
@@ -122,20 +445,33 @@ SubprocessExecutor::~SubprocessExecutor() {
     // Force kill other process.
     // No throw and no block so it's "safe" to call in dtor.
     kill(fields->pid, SIGKILL);
-    // Dtor of future will block until both threads terminate.
-    // Since we have killed the other process, this should terminate
-    // eventually.
+    CloseInput();
+    // The callbacks may reference this, so wait until the reactor is done
+    // with all pipes. Since we have killed the other process, this should
+    // terminate eventually.
+    if (fields->captured_output) {
+      fields->captured_output->wait();
+    }
+    if (fields->captured_error) {
+      fields->captured_error->wait();
+    }
+    if (fields->input_written) {
+      fields->input_written->wait();
+    }
     fields->captured_output.reset();
     fields->captured_error.reset();
-
-    close(fields->stdout_fd);
-    fields->stdout_fd = -1;
-    close(fields->stderr_fd);
-    fields->stderr_fd = -1;
+    fields->input_written.reset();
+    // Reap the child.
+    waitpid(fields->pid, nullptr, 0);
     fields->pid = -1;
+    if (fields->pidfd >= 0) {
+      close(fields->pidfd);
+      fields->pidfd = -1;
+    }
     posix_spawn_file_actions_destroy(fields->actions.get());
     fields->actions.reset();
     callback_ = {};
+    input_callback_ = {};
   }
 }
 
@@ -145,13 +481,50 @@ void SubprocessExecutor::SetCommand(const std::string_view command) {
 
 void SubprocessExecutor::SetCallback(
     std::function<void(const char*)> callback) {
-  callback_ = callback;
+  callback_ = {};
+  if (callback) {
+    callback_ = [callback = std::move(callback)](std::string_view data) {
+      callback(data.data());
+    };
+  }
+}
+
+void SubprocessExecutor::SetDataCallback(
+    std::function<void(std::string_view)> callback) {
+  callback_ = std::move(callback);
 }
 
 void SubprocessExecutor::CaptureOutput(bool capture) {
   capture_output_ = capture;
 }
 
+void SubprocessExecutor::SetCaptureOptions(const CaptureOptions& options) {
+  capture_options_ = options;
+}
+
+void SubprocessExecutor::RedirectOutput(int fd) { redirect_fd_ = fd; }
+
+void SubprocessExecutor::OpenInput() { open_input_ = true; }
+
+bool SubprocessExecutor::WriteInput(std::string_view data) {
+  if (!is_running_ || fields->stdin_fd < 0) {
+    throw std::runtime_error(
+        "You must call OpenInput() and Start() before writing input.");
+  }
+  return WriteAll(fields->stdin_fd, data);
+}
+
+void SubprocessExecutor::CloseInput() {
+  if (fields->stdin_fd >= 0) {
+    close(fields->stdin_fd);
+    fields->stdin_fd = -1;
+  }
+}
+
+void SubprocessExecutor::SetInputCallback(InputCallback callback) {
+  input_callback_ = std::move(callback);
+}
+
 void SubprocessExecutor::Start() {
   if (is_running_) {
     throw std::runtime_error(
@@ -161,82 +534,129 @@ void SubprocessExecutor::Start() {
     throw std::runtime_error("Cannot start process with empty command!");
   }
 
-  // pipe[0] is for our side, pipe[1] is for subprocess side.
-  int cout_pipe[2] = {-1};
-  int cerr_pipe[2] = {-1};
+  // For output pipe[0] is for our side, pipe[1] is for subprocess side.
+  // For input it is the other way around.
+  int cout_pipe[2] = {-1, -1};
+  int cerr_pipe[2] = {-1, -1};
+  int cin_pipe[2] = {-1, -1};
+  auto close_pipes = [&] {
+    for (int fd : {cout_pipe[0], cout_pipe[1], cerr_pipe[0], cerr_pipe[1],
+                   cin_pipe[0], cin_pipe[1]}) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  };
   auto action = std::make_unique<posix_spawn_file_actions_t>();
+  if (posix_spawn_file_actions_init(action.get())) {
+    throw std::runtime_error("Error while initializing subprocess");
+  }
 
-  if (capture_output_ || callback_) {
-    if (pipe(cout_pipe) < 0) {
-      throw std::runtime_error("Could not create stdout pipe");
-    }
-    if (pipe(cerr_pipe) < 0) {
-      throw std::runtime_error("Could not create stderr pipe");
-    }
-    if (posix_spawn_file_actions_init(action.get())) {
-      throw std::runtime_error("Error while initializing subprocess");
-    }
-    // Tell spawned process to close our side of the pipes
-    if (posix_spawn_file_actions_addclose(action.get(), cout_pipe[0])) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
-    if (posix_spawn_file_actions_addclose(action.get(), cerr_pipe[0])) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
-    // Tell spawned process to make a duplicate of their end of the pipe.
-    if (posix_spawn_file_actions_adddup2(action.get(), cout_pipe[1], 1)) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
-    if (posix_spawn_file_actions_adddup2(action.get(), cerr_pipe[1], 2)) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
-    // Tell spanwed process to close their (old) end of the pipe.
-    if (posix_spawn_file_actions_addclose(action.get(), cout_pipe[1])) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
-    if (posix_spawn_file_actions_addclose(action.get(), cerr_pipe[1])) {
-      throw std::runtime_error("Error while configuring subprocess");
-    }
+  const bool redirect = redirect_fd_ >= 0;
+  const bool read_output = !redirect && (capture_output_ || callback_);
+  const bool read_error = capture_output_ || callback_;
+  const bool write_input = open_input_ || input_callback_;
+  // Close on exec, so that processes started concurrently by other
+  // executors don't inherit the pipes and hold them open. The child's
+  // copies made by dup2 below don't keep the flag.
+  if (read_output && pipe2(cout_pipe, O_CLOEXEC) < 0) {
+    posix_spawn_file_actions_destroy(action.get());
+    throw std::runtime_error("Could not create stdout pipe");
+  }
+  if (read_error && pipe2(cerr_pipe, O_CLOEXEC) < 0) {
+    posix_spawn_file_actions_destroy(action.get());
+    close_pipes();
+    throw std::runtime_error("Could not create stderr pipe");
+  }
+  if (write_input && pipe2(cin_pipe, O_CLOEXEC) < 0) {
+    posix_spawn_file_actions_destroy(action.get());
+    close_pipes();
+    throw std::runtime_error("Could not create stdin pipe");
+  }
+  // Tell spawned process to make a duplicate of their end of the pipe, or of
+  // the file output is redirected to, and then to close their (old) end of
+  // the pipe. Our side of the pipes is closed on exec.
+  bool configured = true;
+  if (write_input) {
+    configured &= !posix_spawn_file_actions_adddup2(action.get(),
+                                                    cin_pipe[0], 0);
+    configured &= !posix_spawn_file_actions_addclose(action.get(),
+                                                     cin_pipe[0]);
+  }
+  if (redirect) {
+    configured &= !posix_spawn_file_actions_adddup2(action.get(),
+                                                    redirect_fd_, 1);
+  } else if (read_output) {
+    configured &= !posix_spawn_file_actions_adddup2(action.get(),
+                                                    cout_pipe[1], 1);
+    configured &= !posix_spawn_file_actions_addclose(action.get(),
+                                                     cout_pipe[1]);
+  }
+  if (read_error) {
+    configured &= !posix_spawn_file_actions_adddup2(action.get(),
+                                                    cerr_pipe[1], 2);
+    configured &= !posix_spawn_file_actions_addclose(action.get(),
+                                                     cerr_pipe[1]);
+  }
+  if (!configured) {
+    posix_spawn_file_actions_destroy(action.get());
+    close_pipes();
+    throw std::runtime_error("Error while configuring subprocess");
   }
 
   // Expands command str into an array of args
   // Ex: foo bar "baz ham" -> ["foo", "bar", "baz ham"] etc.
   wordexp_t arg_expansion;
   if (wordexp(command_.c_str(), &arg_expansion, WRDE_NOCMD)) {
+    posix_spawn_file_actions_destroy(action.get());
+    close_pipes();
     throw std::runtime_error("Could not expand command!");
   }
 
   pid_t pid = 0;
+  // The CPU time of the child counts from here too.
+  fields->started = Clock::now();
   if (posix_spawnp(&pid, arg_expansion.we_wordv[0], action.get(), nullptr,
                    arg_expansion.we_wordv, environ)) {
     wordfree(&arg_expansion);
     posix_spawn_file_actions_destroy(action.get());
-    close(cout_pipe[0]), close(cout_pipe[1]);
-    close(cerr_pipe[0]), close(cerr_pipe[1]);
+    close_pipes();
     throw std::runtime_error("Unable to create process to run: " + command_);
   }
   wordfree(&arg_expansion);
 
   // Close pipe ends on subprocess' side.
-  close(cout_pipe[1]);
-  close(cerr_pipe[1]);
+  for (int fd : {cout_pipe[1], cerr_pipe[1], cin_pipe[0]}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
 
   is_running_ = true;
   // Store needed fields
-  fields->stdout_fd = cout_pipe[0];
-  fields->stderr_fd = cerr_pipe[0];
   fields->pid = pid;
+  fields->pidfd = OpenPidFd(pid);
   fields->actions = std::move(action);
 
-  if (capture_output_ || callback_) {
+  // The reactor closes our ends of the pipes once the child closes theirs.
+  auto& reactor = PipeReactor::Global();
+  if (read_output) {
     fields->captured_output = std::make_unique<std::future<std::string>>(
-        std::async(std::launch::async, [this] {
-          return PollHandle(fields->stdout_fd, capture_output_, callback_);
-        }));
+        reactor.Watch(cout_pipe[0], capture_output_,
+                      OutputBuffer{capture_options_.reserve_stdout},
+                      callback_));
+  }
+  if (read_error) {
     fields->captured_error = std::make_unique<std::future<std::string>>(
-        std::async(std::launch::async, [this] {
-          return PollHandle(fields->stderr_fd, capture_output_, {});
-        }));
+        reactor.Watch(cerr_pipe[0], capture_output_,
+                      OutputBuffer{0, capture_options_.max_stderr}, {}));
+  }
+  if (input_callback_) {
+    // Closed by the reactor at the end of the input.
+    fields->input_written = std::make_unique<std::future<void>>(
+        reactor.WatchInput(cin_pipe[1], input_callback_));
+  } else if (write_input) {
+    fields->stdin_fd = cin_pipe[1];
   }
 }
 
@@ -247,16 +667,48 @@ SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
         "You must call Start() before you are able to wait.");
   }
 
+  // Or the process may wait for the end of its input forever.
+  CloseInput();
+  int status = 0;
+  rusage usage{};
+  bool exited = false;
   if (timeout_ms) {
-    // Wait with timeout
-    WaitTimeoutOrKill(fields->pid, *timeout_ms);
-  } else {
-    int status = 0;
+    // Ask the process to terminate once the timeout expires, and force it
+    // if it hasn't after another timeout.
+    const std::chrono::milliseconds timeout{*timeout_ms};
+    exited = WaitUntil(fields->pid, fields->pidfd, Clock::now() + timeout,
+                       status, usage);
+    if (!exited) {
+      kill(fields->pid, SIGTERM);
+      exited = WaitUntil(fields->pid, fields->pidfd, Clock::now() + timeout,
+                         status, usage);
+    }
+    if (!exited) {
+      kill(fields->pid, SIGKILL);
+    }
+  }
+  if (!exited) {
     // Wait forever
-    waitpid(fields->pid, &status, 0);
+    Reap(fields->pid, status, usage, /* block= */ true);
   }
+  const auto wall_time = Clock::now() - fields->started;
 
   SubprocessExecutor::Output output;
+  if (WIFEXITED(status)) {
+    output.exit_code = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    output.term_signal = WTERMSIG(status);
+  }
+  output.usage.wall_time =
+      std::chrono::duration_cast<std::chrono::microseconds>(wall_time);
+  output.usage.user_cpu = ToDuration(usage.ru_utime);
+  output.usage.system_cpu = ToDuration(usage.ru_stime);
+  // In kilobytes on Linux.
+  output.usage.max_rss_kb = usage.ru_maxrss;
+  output.usage.voluntary_context_switches = usage.ru_nvcsw;
+  output.usage.involuntary_context_switches = usage.ru_nivcsw;
+  output.usage.input_blocks = usage.ru_inblock;
+  output.usage.output_blocks = usage.ru_oublock;
   if (fields->captured_output) {
     // Block until stdout thread finishes
     output.subproc_stdout = fields->captured_output->get();
@@ -265,20 +717,27 @@ SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
     // Block until stderr thread finishes
     output.subproc_stderr = fields->captured_error->get();
   }
+  if (fields->input_written) {
+    // The process exited, so the write end is closed soon if not yet.
+    fields->input_written->wait();
+  }
 
   is_running_ = false;
 
   // Cleanup everything
-  close(fields->stdout_fd);
-  fields->stdout_fd = -1;
-  close(fields->stderr_fd);
-  fields->stderr_fd = -1;
   fields->pid = -1;
+  if (fields->pidfd >= 0) {
+    close(fields->pidfd);
+    fields->pidfd = -1;
+  }
   posix_spawn_file_actions_destroy(fields->actions.get());
   fields->actions.reset();
   fields->captured_output.reset();
   fields->captured_error.reset();
+  fields->input_written.reset();
   callback_ = {};
+  input_callback_ = {};
+  open_input_ = false;
 
   return output;
 }
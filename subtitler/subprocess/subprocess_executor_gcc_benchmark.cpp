@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "subtitler/subprocess/subprocess_executor.h"
+#include "subtitler/util/allocation_counter.h"
+
+using subtitler::subprocess::SubprocessExecutor;
+
+namespace {
+
+// Command writing size zero bytes to stdout, or to stderr.
+std::string MakeCommand(std::size_t size, bool to_stderr = false) {
+  auto command = "head -c " + std::to_string(size) + " /dev/zero";
+  return to_stderr ? "sh -c \"" + command + " 1>&2\"" : command;
+}
+
+// Runs executor once per iteration and reports the heap allocations and
+// allocated bytes per run. Allocated bytes include every copy of the output
+// made while it grows.
+template <typename Check>
+void Run(benchmark::State& state, SubprocessExecutor& executor,
+         std::size_t size, Check check) {
+  const auto allocations_before = subtitler::NumAllocations();
+  const auto bytes_before = subtitler::BytesAllocated();
+  for (auto _ : state) {
+    executor.Start();
+    auto output = executor.WaitUntilFinished();
+    check(output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+  state.counters["allocs_per_run"] = benchmark::Counter(
+      static_cast<double>(subtitler::NumAllocations() - allocations_before),
+      benchmark::Counter::kAvgIterations);
+  state.counters["bytes_allocated_per_run"] = benchmark::Counter(
+      static_cast<double>(subtitler::BytesAllocated() - bytes_before),
+      benchmark::Counter::kAvgIterations);
+}
+
+// Captures all of stdout, reserving its size up front if state.range(1).
+void BM_CaptureStdout(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  SubprocessExecutor executor{MakeCommand(size), /* capture_output= */ true};
+  if (state.range(1)) {
+    executor.SetCaptureOptions({.reserve_stdout = size});
+  }
+  Run(state, executor, size, [&](const auto& output) {
+    if (output.subproc_stdout.size() != size) {
+      state.SkipWithError("Output is incomplete");
+    }
+  });
+}
+
+// Streams stdout to a callback without capturing it.
+void BM_DataCallback(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  SubprocessExecutor executor{MakeCommand(size), /* capture_output= */ false};
+  std::size_t received = 0;
+  auto callback = [&received](std::string_view data) {
+    received += data.size();
+  };
+  executor.SetDataCallback(callback);
+  Run(state, executor, size, [&](const auto&) {
+    if (received != size) {
+      state.SkipWithError("Output is incomplete");
+    }
+    received = 0;
+    // The callback is reset by WaitUntilFinished().
+    executor.SetDataCallback(callback);
+  });
+}
+
+// Captures only the last 64 KB of stderr.
+void BM_CaptureStderrTail(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  const std::size_t max_stderr = 64 * 1024;
+  SubprocessExecutor executor{MakeCommand(size, /* to_stderr= */ true),
+                              /* capture_output= */ true};
+  executor.SetCaptureOptions({.max_stderr = max_stderr});
+  Run(state, executor, size, [&](const auto& output) {
+    if (output.subproc_stderr.size() != max_stderr) {
+      state.SkipWithError("Output is incomplete");
+    }
+  });
+}
+
+// Stdout goes straight to a file, without passing through this process.
+void BM_RedirectToFile(benchmark::State& state) {
+  const auto size = static_cast<std::size_t>(state.range(0));
+  int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  SubprocessExecutor executor{MakeCommand(size), /* capture_output= */ true};
+  executor.RedirectOutput(fd);
+  Run(state, executor, size, [](const auto&) {});
+  close(fd);
+}
+
+// Latency from the exit of a process to WaitUntilFinished() returning, with
+// a timeout of state.range(0) ms if not 0. The process prints the time right
+// before it exits.
+void BM_WaitForExit(benchmark::State& state) {
+  SubprocessExecutor executor{"date +%s%N", /* capture_output= */ true};
+  std::optional<int> timeout_ms;
+  if (state.range(0)) {
+    timeout_ms = static_cast<int>(state.range(0));
+  }
+  double latency_us = 0;
+  for (auto _ : state) {
+    executor.Start();
+    auto output = executor.WaitUntilFinished(timeout_ms);
+    const auto woken_up = std::chrono::system_clock::now().time_since_epoch();
+    const std::chrono::nanoseconds exited{std::stoll(output.subproc_stdout)};
+    latency_us +=
+        std::chrono::duration<double, std::micro>(woken_up - exited).count();
+  }
+  state.counters["exit_to_wakeup_us"] =
+      benchmark::Counter(latency_us, benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace
+
+BENCHMARK(BM_CaptureStdout)
+    ->ArgsProduct({{1 << 20, 64 << 20}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DataCallback)
+    ->Arg(1 << 20)
+    ->Arg(64 << 20)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CaptureStderrTail)
+    ->Arg(1 << 20)
+    ->Arg(64 << 20)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RedirectToFile)
+    ->Arg(1 << 20)
+    ->Arg(64 << 20)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WaitForExit)->Arg(0)->Arg(2000)->Unit(benchmark::kMillisecond);
@@ -1,11 +1,53 @@
+#include <fcntl.h>
 #include <gmock/gmock.h>
+#include <signal.h>
 #include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "subtitler/subprocess/subprocess_executor.h"
 
 using subtitler::subprocess::SubprocessExecutor;
 using ::testing::IsEmpty;
 
+namespace {
+
+// Threads of this process, from /proc.
+int CountThreads() {
+  std::ifstream status{"/proc/self/status"};
+  std::string field;
+  while (status >> field) {
+    if (field == "Threads:") {
+      int threads = 0;
+      status >> threads;
+      return threads;
+    }
+  }
+  return -1;
+}
+
+// User and system CPU time used by this process so far, excluding children.
+std::chrono::microseconds CpuTime() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+         std::chrono::microseconds{usage.ru_utime.tv_usec +
+                                   usage.ru_stime.tv_usec};
+}
+
+}  // namespace
+
 TEST(SubprocessExecutorTest, SanityCheck) {
   SubprocessExecutor executor(
       /* command= */ "echo hello world",
@@ -58,6 +100,188 @@ TEST(SubprocessExecutorTest, DoNotCaptureStdout) {
   ASSERT_THAT(captured_output.subproc_stderr, IsEmpty());
 }
 
+TEST(SubprocessExecutorTest, OutputWithNullBytes) {
+  using namespace std::string_literals;
+  SubprocessExecutor executor{"printf 'a\\0b'", /* capture_output= */ true};
+  std::string received;
+  executor.SetDataCallback(
+      [&received](std::string_view data) { received.append(data); });
+
+  executor.Start();
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_EQ(received, "a\0b"s);
+  ASSERT_EQ(captured_output.subproc_stdout, "a\0b"s);
+}
+
+TEST(SubprocessExecutorTest, CaptureLastBytesOfStderr) {
+  SubprocessExecutor executor{"sh -c \"seq 1000 1>&2\"",
+                              /* capture_output= */ true};
+  executor.SetCaptureOptions({.reserve_stdout = 0, .max_stderr = 9});
+
+  executor.Start();
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_THAT(captured_output.subproc_stdout, IsEmpty());
+  ASSERT_EQ(captured_output.subproc_stderr, "999\n1000\n");
+}
+
+TEST(SubprocessExecutorTest, RedirectOutputToFile) {
+  const std::string path =
+      std::string{std::getenv("TEST_TMPDIR")} + "/redirected_output.txt";
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  ASSERT_GE(fd, 0);
+  SubprocessExecutor executor{"sh -c \"echo hello; echo error 1>&2\"",
+                              /* capture_output= */ true};
+  executor.RedirectOutput(fd);
+
+  executor.Start();
+  close(fd);
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_THAT(captured_output.subproc_stdout, IsEmpty());
+  ASSERT_EQ(captured_output.subproc_stderr, "error\n");
+  std::ifstream file{path};
+  std::string contents{std::istreambuf_iterator<char>{file}, {}};
+  ASSERT_EQ(contents, "hello\n");
+}
+
+TEST(SubprocessExecutorTest, WriteInput) {
+  SubprocessExecutor executor{"cat", /* capture_output= */ true};
+  executor.OpenInput();
+
+  executor.Start();
+  ASSERT_TRUE(executor.WriteInput("hello"));
+  ASSERT_TRUE(executor.WriteInput(" world"));
+  executor.CloseInput();
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_EQ(captured_output.subproc_stdout, "hello world");
+}
+
+TEST(SubprocessExecutorTest, WriteInputAfterProcessExited) {
+  SubprocessExecutor executor{"true", /* capture_output= */ true};
+  executor.OpenInput();
+
+  executor.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  // Fails rather than raising SIGPIPE.
+  ASSERT_FALSE(executor.WriteInput(std::string(1 << 20, 'a')));
+  executor.WaitUntilFinished();
+}
+
+TEST(SubprocessExecutorTest, InputCallback) {
+  SubprocessExecutor executor{"cat", /* capture_output= */ true};
+  executor.SetInputCallback(SubprocessExecutor::InputFrom("hello world"));
+
+  executor.Start();
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_EQ(captured_output.subproc_stdout, "hello world");
+}
+
+TEST(SubprocessExecutorTest, InputCallbackIsCalledOnlyAsInputIsRead) {
+  // Reads the first 1000 bytes, then closes stdin by exiting.
+  SubprocessExecutor executor{"head -c 1000", /* capture_output= */ true};
+  std::size_t produced = 0;
+  executor.SetInputCallback([&produced](char* buffer, std::size_t size) {
+    std::fill_n(buffer, size, 'a');
+    produced += size;
+    return size;
+  });
+
+  executor.Start();
+  auto captured_output = executor.WaitUntilFinished();
+
+  ASSERT_EQ(captured_output.subproc_stdout, std::string(1000, 'a'));
+  // Endless input stops once the pipe and the reads of head are full.
+  ASSERT_LT(produced, 4u << 20);
+}
+
+TEST(SubprocessExecutorTest, ExitCode) {
+  SubprocessExecutor executor{"sh -c \"exit 3\"", /* capture_output= */ true};
+
+  executor.Start();
+  auto output = executor.WaitUntilFinished(/* timeout_ms= */ 2000);
+
+  ASSERT_EQ(output.exit_code, 3);
+  ASSERT_EQ(output.term_signal, std::nullopt);
+}
+
+TEST(SubprocessExecutorTest, WaitReturnsAsSoonAsProcessExits) {
+  SubprocessExecutor executor{"sleep 0.1", /* capture_output= */ true};
+
+  executor.Start();
+  const auto start = std::chrono::steady_clock::now();
+  auto output = executor.WaitUntilFinished(/* timeout_ms= */ 10000);
+  const auto waited = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(output.exit_code, 0);
+  ASSERT_LT(waited, std::chrono::seconds{2});
+}
+
+TEST(SubprocessExecutorTest, TimeoutTerminatesProcess) {
+  SubprocessExecutor executor{"sleep 10", /* capture_output= */ true};
+
+  executor.Start();
+  const auto start = std::chrono::steady_clock::now();
+  auto output = executor.WaitUntilFinished(/* timeout_ms= */ 100);
+  const auto waited = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(output.exit_code, std::nullopt);
+  ASSERT_EQ(output.term_signal, SIGTERM);
+  ASSERT_GE(waited, std::chrono::milliseconds{100});
+  ASSERT_LT(waited, std::chrono::seconds{2});
+}
+
+TEST(SubprocessExecutorTest, TimeoutKillsProcessIgnoringSigterm) {
+  // Ignored signals stay ignored after exec.
+  SubprocessExecutor executor{"sh -c \"trap '' TERM; exec sleep 10\"",
+                              /* capture_output= */ true};
+
+  executor.Start();
+  const auto start = std::chrono::steady_clock::now();
+  auto output = executor.WaitUntilFinished(/* timeout_ms= */ 100);
+  const auto waited = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(output.term_signal, SIGKILL);
+  ASSERT_GE(waited, std::chrono::milliseconds{200});
+  ASSERT_LT(waited, std::chrono::seconds{2});
+}
+
+TEST(SubprocessExecutorTest, ResourceUsage) {
+  // Copies 256 MB through memory, using CPU time in the kernel.
+  SubprocessExecutor executor{
+      "dd if=/dev/zero of=/dev/null bs=1M count=256 status=none",
+      /* capture_output= */ true};
+
+  executor.Start();
+  auto output = executor.WaitUntilFinished();
+
+  ASSERT_EQ(output.exit_code, 0);
+  const auto& usage = output.usage;
+  ASSERT_GT(usage.user_cpu + usage.system_cpu, std::chrono::microseconds{0});
+  // Single threaded, so it can't use more CPU than time, give or take a
+  // scheduler tick of CPU time accounting.
+  ASSERT_GE(usage.wall_time + std::chrono::milliseconds{5},
+            usage.user_cpu + usage.system_cpu);
+  // At least the 1 MB block.
+  ASSERT_GE(usage.max_rss_kb, 1024);
+}
+
+TEST(SubprocessExecutorTest, ResourceUsageWallTime) {
+  SubprocessExecutor executor{"sleep 0.2", /* capture_output= */ true};
+
+  executor.Start();
+  auto output = executor.WaitUntilFinished();
+
+  ASSERT_GE(output.usage.wall_time, std::chrono::milliseconds{200});
+  ASSERT_LT(output.usage.wall_time, std::chrono::seconds{2});
+  // Sleeping takes hardly any CPU.
+  ASSERT_LT(output.usage.user_cpu + output.usage.system_cpu,
+            std::chrono::milliseconds{100});
+}
+
 TEST(SubprocessExecutor, StartTwiceWithoutWaitingThrowsError) {
   SubprocessExecutor executor;
   executor.SetCommand("echo hello world");
@@ -110,3 +334,44 @@ TEST(SubprocessExecutor, InvalidCommandThrowsError_CommandDoesNotExist) {
     ASSERT_STREQ(e.what(), "Unable to create process to run: DoesNotExist");
   }
 }
+
+TEST(SubprocessExecutor, ManyConcurrentProcessesShareOneReaderThread) {
+  const int num_processes = 500;
+  // Starts the reader thread, so it is counted in threads_before.
+  SubprocessExecutor{"echo", /* capture_output= */ true}.Start();
+  const int threads_before = CountThreads();
+  const auto cpu_before = CpuTime();
+  const auto wall_before = std::chrono::steady_clock::now();
+
+  std::vector<std::unique_ptr<SubprocessExecutor>> executors;
+  for (int i = 0; i < num_processes; ++i) {
+    executors.push_back(std::make_unique<SubprocessExecutor>(
+        "sh -c \"sleep 1; echo " + std::to_string(i) + "; echo error 1>&2\"",
+        /* capture_output= */ true));
+    executors.back()->Start();
+  }
+  // Every process is still sleeping.
+  const int threads_during = CountThreads();
+  for (int i = 0; i < num_processes; ++i) {
+    auto output = executors[i]->WaitUntilFinished();
+    ASSERT_EQ(output.subproc_stdout, std::to_string(i) + "\n");
+    ASSERT_EQ(output.subproc_stderr, "error\n");
+  }
+  const auto cpu_used = CpuTime() - cpu_before;
+  const auto wall_time = std::chrono::steady_clock::now() - wall_before;
+
+  std::cout << num_processes << " processes: " << threads_before
+            << " threads before, " << threads_during << " while running, "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(cpu_used)
+                   .count()
+            << " ms CPU used in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(wall_time)
+                   .count()
+            << " ms" << std::endl;
+  RecordProperty("threads_while_running", threads_during);
+  RecordProperty("cpu_used_ms",
+                 static_cast<int>(std::chrono::duration_cast<
+                                      std::chrono::milliseconds>(cpu_used)
+                                      .count()));
+  ASSERT_EQ(threads_during, threads_before);
+}
@@ -1,14 +1,20 @@
 #include "subtitler/subprocess/subprocess_executor.h"
 
 #pragma comment(lib, "User32.lib")
+#pragma comment(lib, "Psapi.lib")
 
+#include <io.h>
 #include <windows.h>
+// After windows.h
+#include <psapi.h>
 
 #include <algorithm>
+#include <chrono>
 #include <future>
-#include <sstream>
 #include <stdexcept>
+#include <vector>
 
+#include "subtitler/subprocess/output_buffer.h"
 #include "subtitler/util/unicode.h"
 
 namespace subtitler {
@@ -16,7 +22,7 @@ namespace subprocess {
 
 namespace {
 
-const int BUFFER_SIZE = 1024;
+const int BUFFER_SIZE = 64 * 1024;
 const int TIMEOUT_MS = 5000;
 
 void CleanupHandle(HANDLE& handle) {
@@ -43,17 +49,18 @@ BOOL CALLBACK SendWMCloseMsg(HWND hwnd, LPARAM lParam) {
 }
 
 std::string PollHandle(const HANDLE handle, bool return_output,
-                       const std::function<void(const char*)> callback) {
+                       OutputBuffer output,
+                       const std::function<void(std::string_view)> callback) {
   DWORD amount_read;
-  CHAR buffer[BUFFER_SIZE + 1];  // Ensure space for null-terminator.
+  // Ensure space for null-terminator.
+  std::vector<CHAR> buffer(BUFFER_SIZE + 1);
   BOOL success = FALSE;
-  std::ostringstream str;
 
   // Spin until we are unable to read the pipe from child process anymore.
   for (;;) {
     success = ReadFile(
         /* hFile= */ handle,
-        /* lpBuffer= */ buffer,
+        /* lpBuffer= */ buffer.data(),
         /* nNumberOfBytesToRead= */ BUFFER_SIZE,
         /* lpNumberOfBytesRead= */ &amount_read,
         /* lpOverlapped= */ NULL);
@@ -62,18 +69,81 @@ std::string PollHandle(const HANDLE handle, bool return_output,
       break;
     }
 
-    // ensure null termination.
+    // ensure null termination, for callbacks set by SetCallback().
     buffer[amount_read] = '\0';
+    const std::string_view data{buffer.data(), amount_read};
 
     if (callback) {
-      callback(buffer);
+      callback(data);
     }
     if (return_output) {
-      str << buffer;
+      output.Append(data);
     }
   }
 
-  return str.str();
+  return output.Release();
+}
+
+// Writes all of data to handle. Returns false if the reader closed the pipe.
+bool WriteHandle(const HANDLE handle, std::string_view data) {
+  while (!data.empty()) {
+    DWORD amount_written = 0;
+    if (!WriteFile(
+            /* hFile= */ handle,
+            /* lpBuffer= */ data.data(),
+            /* nNumberOfBytesToWrite= */ static_cast<DWORD>(data.size()),
+            /* lpNumberOfBytesWritten= */ &amount_written,
+            /* lpOverlapped= */ NULL)) {
+      return false;
+    }
+    data.remove_prefix(amount_written);
+  }
+  return true;
+}
+
+// Writes the input produced by callback to handle until it ends or the child
+// closes its end, then closes handle.
+void FeedHandle(HANDLE handle, SubprocessExecutor::InputCallback callback) {
+  std::vector<CHAR> buffer(BUFFER_SIZE);
+  for (;;) {
+    const auto size = callback(buffer.data(), buffer.size());
+    // WriteFile blocks while the pipe is full.
+    if (size == 0 || !WriteHandle(handle, {buffer.data(), size})) {
+      break;
+    }
+  }
+  CloseHandle(handle);
+}
+
+// FILETIME counts 100 nanosecond intervals.
+std::chrono::microseconds ToDuration(const FILETIME& time) {
+  ULARGE_INTEGER ticks;
+  ticks.LowPart = time.dwLowDateTime;
+  ticks.HighPart = time.dwHighDateTime;
+  return std::chrono::microseconds{ticks.QuadPart / 10};
+}
+
+// Resources used by the exited process. Windows doesn't count context
+// switches per process, so those are left 0.
+SubprocessExecutor::ResourceUsage GetUsage(HANDLE process) {
+  SubprocessExecutor::ResourceUsage usage;
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (GetProcessTimes(process, &creation_time, &exit_time, &kernel_time,
+                      &user_time)) {
+    usage.wall_time = ToDuration(exit_time) - ToDuration(creation_time);
+    usage.user_cpu = ToDuration(user_time);
+    usage.system_cpu = ToDuration(kernel_time);
+  }
+  PROCESS_MEMORY_COUNTERS memory;
+  if (GetProcessMemoryInfo(process, &memory, sizeof(memory))) {
+    usage.max_rss_kb = static_cast<long>(memory.PeakWorkingSetSize / 1024);
+  }
+  IO_COUNTERS io;
+  if (GetProcessIoCounters(process, &io)) {
+    usage.input_blocks = static_cast<long>(io.ReadOperationCount);
+    usage.output_blocks = static_cast<long>(io.WriteOperationCount);
+  }
+  return usage;
 }
 
 }  // namespace
@@ -83,10 +153,13 @@ struct SubprocessExecutor::PlatformDependentFields {
   HANDLE hStdOutPipeWrite = NULL;
   HANDLE hStdErrPipeRead = NULL;
   HANDLE hStdErrPipeWrite = NULL;
+  HANDLE hStdInPipeRead = NULL;
+  HANDLE hStdInPipeWrite = NULL;
   HANDLE hProcess = NULL;
   DWORD dwProcessId = 0;
   std::unique_ptr<std::future<std::string>> captured_output = nullptr;
   std::unique_ptr<std::future<std::string>> captured_error = nullptr;
+  std::unique_ptr<std::future<void>> input_written = nullptr;
 };
 
 SubprocessExecutor::SubprocessExecutor()
@@ -94,6 +167,8 @@ SubprocessExecutor::SubprocessExecutor()
       capture_output_{false},
       is_running_{false},
       callback_{},
+      redirect_fd_{-1},
+      open_input_{false},
       fields{std::make_unique<PlatformDependentFields>()} {}
 
 SubprocessExecutor::SubprocessExecutor(const std::string_view command,
@@ -101,6 +176,8 @@ SubprocessExecutor::SubprocessExecutor(const std::string_view command,
     : command_{command},
       capture_output_{capture_output},
       is_running_{false},
+      redirect_fd_{-1},
+      open_input_{false},
       fields{std::make_unique<PlatformDependentFields>()} {}
 
 SubprocessExecutor::~SubprocessExecutor() {
@@ -108,19 +185,23 @@ SubprocessExecutor::~SubprocessExecutor() {
     // Force kill other process.
     // No throw and no block so it's "safe" to call in dtor.
     TerminateProcess(fields->hProcess, /* uExitCode= */ 1);
-    // Dtor of future will block until both threads terminate.
+    CloseInput();
+    // Dtor of future will block until all threads terminate.
     // Since we have killed the other process, this should terminate
     // eventually.
     fields->captured_output.reset();
     fields->captured_error.reset();
+    fields->input_written.reset();
 
     CleanupHandle(fields->hStdOutPipeRead);
     CleanupHandle(fields->hStdOutPipeWrite);
     CleanupHandle(fields->hStdErrPipeRead);
     CleanupHandle(fields->hStdErrPipeWrite);
     CleanupHandle(fields->hProcess);
+    CleanupHandle(fields->hStdInPipeRead);
     fields->dwProcessId = 0;
     callback_ = {};
+    input_callback_ = {};
   }
 }
 
@@ -130,13 +211,47 @@ void SubprocessExecutor::SetCommand(const std::string_view command) {
 
 void SubprocessExecutor::SetCallback(
     std::function<void(const char*)> callback) {
-  callback_ = callback;
+  callback_ = {};
+  if (callback) {
+    callback_ = [callback = std::move(callback)](std::string_view data) {
+      callback(data.data());
+    };
+  }
+}
+
+void SubprocessExecutor::SetDataCallback(
+    std::function<void(std::string_view)> callback) {
+  callback_ = std::move(callback);
 }
 
 void SubprocessExecutor::CaptureOutput(bool capture) {
   capture_output_ = capture;
 }
 
+void SubprocessExecutor::SetCaptureOptions(const CaptureOptions& options) {
+  capture_options_ = options;
+}
+
+void SubprocessExecutor::RedirectOutput(int fd) { redirect_fd_ = fd; }
+
+void SubprocessExecutor::OpenInput() { open_input_ = true; }
+
+bool SubprocessExecutor::WriteInput(std::string_view data) {
+  if (!is_running_ || !fields->hStdInPipeWrite) {
+    throw std::runtime_error(
+        "You must call OpenInput() and Start() before writing input.");
+  }
+  return WriteHandle(fields->hStdInPipeWrite, data);
+}
+
+void SubprocessExecutor::CloseInput() {
+  CleanupHandle(fields->hStdInPipeWrite);
+}
+
+void SubprocessExecutor::SetInputCallback(InputCallback callback) {
+  input_callback_ = std::move(callback);
+}
+
 void SubprocessExecutor::Start() {
   if (is_running_) {
     throw std::runtime_error(
@@ -151,7 +266,23 @@ void SubprocessExecutor::Start() {
   security_attributes.bInheritHandle = TRUE;
   security_attributes.lpSecurityDescriptor = NULL;
 
-  if (capture_output_ || callback_) {
+  const bool redirect = redirect_fd_ >= 0;
+  const bool read_output = !redirect && (capture_output_ || callback_);
+  const bool read_error = capture_output_ || callback_;
+  const bool write_input = open_input_ || input_callback_;
+  if (redirect) {
+    // The child writes to an inheritable duplicate of the file's handle,
+    // which is closed with the pipe handles below.
+    const auto file = reinterpret_cast<HANDLE>(_get_osfhandle(redirect_fd_));
+    if (file == INVALID_HANDLE_VALUE ||
+        !DuplicateHandle(GetCurrentProcess(), file, GetCurrentProcess(),
+                         &fields->hStdOutPipeWrite, 0, TRUE,
+                         DUPLICATE_SAME_ACCESS)) {
+      throw std::runtime_error("Unable to redirect stdout while running: " +
+                               command_);
+    }
+  }
+  if (read_output) {
     if (!CreatePipe(&fields->hStdOutPipeRead, &fields->hStdOutPipeWrite,
                     &security_attributes, 0)) {
       throw std::runtime_error("Unable to create stdout pipe while running: " +
@@ -164,6 +295,8 @@ void SubprocessExecutor::Start() {
       throw std::runtime_error(
           "Unable to set stdout handle info while running: " + command_);
     }
+  }
+  if (read_error) {
     if (!CreatePipe(&fields->hStdErrPipeRead, &fields->hStdErrPipeWrite,
                     &security_attributes, 0)) {
       throw std::runtime_error("Unable to create err pipe while running: " +
@@ -175,6 +308,19 @@ void SubprocessExecutor::Start() {
                                command_);
     }
   }
+  if (write_input) {
+    if (!CreatePipe(&fields->hStdInPipeRead, &fields->hStdInPipeWrite,
+                    &security_attributes, 0)) {
+      throw std::runtime_error("Unable to create stdin pipe while running: " +
+                               command_);
+    }
+    // Do not let child process inherit the write handle.
+    if (!SetHandleInformation(fields->hStdInPipeWrite, HANDLE_FLAG_INHERIT,
+                              0)) {
+      throw std::runtime_error(
+          "Unable to set stdin handle info while running: " + command_);
+    }
+  }
 
   PROCESS_INFORMATION proc_info;
   ZeroMemory(&proc_info, sizeof(PROCESS_INFORMATION));
@@ -184,6 +330,7 @@ void SubprocessExecutor::Start() {
   start_info.cb = sizeof(STARTUPINFOW);
   start_info.hStdError = fields->hStdErrPipeWrite;
   start_info.hStdOutput = fields->hStdOutPipeWrite;
+  start_info.hStdInput = fields->hStdInPipeRead;
   start_info.dwFlags |= STARTF_USESTDHANDLES;
 
   std::wstring command = ConvertToWString(command_);
@@ -216,19 +363,31 @@ void SubprocessExecutor::Start() {
   // https://devblogs.microsoft.com/oldnewthing/20110707-00/?p=10223
   CleanupHandle(fields->hStdOutPipeWrite);
   CleanupHandle(fields->hStdErrPipeWrite);
+  CleanupHandle(fields->hStdInPipeRead);
 
-  if (capture_output_ || callback_) {
-    // Launch 2 theads to read from stdout and stderr respectively.
+  // Launch threads to read from stdout and stderr respectively.
+  if (read_output) {
     fields->captured_output = std::make_unique<std::future<std::string>>(
         std::async(std::launch::async, [this] {
           return PollHandle(fields->hStdOutPipeRead, capture_output_,
+                            OutputBuffer{capture_options_.reserve_stdout},
                             callback_);
         }));
+  }
+  if (read_error) {
     fields->captured_error = std::make_unique<std::future<std::string>>(
         std::async(std::launch::async, [this] {
-          return PollHandle(fields->hStdErrPipeRead, capture_output_, {});
+          return PollHandle(fields->hStdErrPipeRead, capture_output_,
+                            OutputBuffer{0, capture_options_.max_stderr}, {});
         }));
   }
+  if (input_callback_) {
+    // The thread closes the write handle at the end of the input.
+    HANDLE handle = fields->hStdInPipeWrite;
+    fields->hStdInPipeWrite = NULL;
+    fields->input_written = std::make_unique<std::future<void>>(std::async(
+        std::launch::async, FeedHandle, handle, input_callback_));
+  }
 }
 
 SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
@@ -238,6 +397,8 @@ SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
         "You must call Start() before you are able to wait.");
   }
 
+  // Or the process may wait for the end of its input forever.
+  CloseInput();
   // First wait to see if it finishes in time.
   if (timeout_ms &&
       WaitForSingleObject(fields->hProcess, *timeout_ms) == WAIT_TIMEOUT) {
@@ -259,6 +420,17 @@ SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
     // Block until stderr thread finishes.
     output.subproc_stderr = fields->captured_error->get();
   }
+  if (fields->input_written) {
+    // The process exited, so writing fails soon if not done yet.
+    fields->input_written->wait();
+  }
+  // Output may end before the process does.
+  WaitForSingleObject(fields->hProcess, INFINITE);
+  DWORD exit_code = 0;
+  if (GetExitCodeProcess(fields->hProcess, &exit_code)) {
+    output.exit_code = static_cast<int>(exit_code);
+  }
+  output.usage = GetUsage(fields->hProcess);
 
   is_running_ = false;
 
@@ -267,11 +439,16 @@ SubprocessExecutor::Output SubprocessExecutor::WaitUntilFinished(
   CleanupHandle(fields->hStdOutPipeWrite);
   CleanupHandle(fields->hStdErrPipeRead);
   CleanupHandle(fields->hStdErrPipeWrite);
+  CleanupHandle(fields->hStdInPipeRead);
+  CleanupHandle(fields->hStdInPipeWrite);
   CleanupHandle(fields->hProcess);
   fields->dwProcessId = 0;
   fields->captured_output.reset();
   fields->captured_error.reset();
+  fields->input_written.reset();
   callback_ = {};
+  input_callback_ = {};
+  open_input_ = false;
 
   return output;
 }
@@ -0,0 +1,65 @@
+#include "subtitler/util/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> num_allocations{0};
+std::atomic<std::size_t> bytes_allocated{0};
+
+void* Allocate(std::size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+}  // namespace
+
+namespace subtitler {
+
+std::size_t NumAllocations() { return num_allocations.load(); }
+
+std::size_t BytesAllocated() { return bytes_allocated.load(); }
+
+}  // namespace subtitler
+
+// Defined here rather than in the benchmarks, where GCC would inline the
+// free() below into code which it sees calling operator new, and report the
+// pair as mismatched. Every form of new ends in malloc() and every form of
+// delete in free(), including the array and nothrow ones.
+void* operator new(std::size_t size) {
+  if (void* memory = Allocate(size)) {
+    return memory;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete[](void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete[](void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
@@ -0,0 +1,27 @@
+#ifndef SUBTITLER_UTIL_ALLOCATION_COUNTER_H
+#define SUBTITLER_UTIL_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+namespace subtitler {
+
+/**
+ * Counts the heap allocations of a benchmark. Linking this library replaces
+ * the global operator new and operator delete of the program, so only link
+ * it into benchmarks.
+ *
+ * Sample Usage:
+ * auto before = NumAllocations();
+ * Query();
+ * auto allocations = NumAllocations() - before;
+ */
+
+// Calls to operator new since the program started, on every thread.
+std::size_t NumAllocations();
+
+// Total bytes requested from operator new since the program started.
+std::size_t BytesAllocated();
+
+}  // namespace subtitler
+
+#endif  // SUBTITLER_UTIL_ALLOCATION_COUNTER_H
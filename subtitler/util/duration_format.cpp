@@ -1,6 +1,7 @@
 #include "subtitler/util/duration_format.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <sstream>
 
 #include "date/date.h"
@@ -66,11 +67,49 @@ std::optional<std::chrono::milliseconds> FromSubRipDuration(
 }
 
 std::string ToSubRipDuration(const std::chrono::milliseconds& duration) {
-  // First convert to standard duration, then replace any decimals with comma.
-  // Ex: 00:00:12.340 => 00:00:12,340
-  auto result = FormatDuration(duration);
-  std::replace(result.begin(), result.end(), '.', ',');
+  std::string result;
+  AppendSubRipDuration(duration, result);
   return result;
 }
 
+void AppendSubRipDuration(std::chrono::milliseconds duration,
+                          std::string& output) {
+  // Ex: 12340ms => 00:00:12,340
+  // Hours are at least 2 digits, but may be more.
+  auto count = duration.count();
+  if (count < 0) {
+    output += '-';
+  }
+  // Unsigned so negating the minimum value is well defined.
+  auto remaining = static_cast<std::uint64_t>(count);
+  if (count < 0) {
+    remaining = ~remaining + 1;
+  }
+
+  // Filled from the back.
+  char buffer[32];
+  char* end = buffer + sizeof(buffer);
+  char* begin = end;
+  auto put_digits = [&begin](std::uint64_t value, int width) {
+    for (int i = 0; i < width; ++i) {
+      *--begin = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+  };
+  put_digits(remaining % 1000, 3);
+  *--begin = ',';
+  remaining /= 1000;
+  put_digits(remaining % 60, 2);
+  *--begin = ':';
+  remaining /= 60;
+  put_digits(remaining % 60, 2);
+  *--begin = ':';
+  remaining /= 60;
+  put_digits(remaining % 100, 2);
+  for (remaining /= 100; remaining > 0; remaining /= 10) {
+    *--begin = static_cast<char>('0' + remaining % 10);
+  }
+  output.append(begin, end);
+}
+
 }  // namespace subtitler
@@ -17,6 +17,11 @@ std::optional<std::chrono::milliseconds> FromSubRipDuration(
 
 std::string ToSubRipDuration(const std::chrono::milliseconds& duration);
 
+// Same format as ToSubRipDuration (HH:MM:SS,mmm), appended to output without
+// any intermediate allocation.
+void AppendSubRipDuration(std::chrono::milliseconds duration,
+                          std::string& output);
+
 }  // namespace subtitler
 
 #endif
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <string>
 
 using namespace std::chrono_literals;
 using namespace subtitler;
@@ -51,3 +52,22 @@ TEST(DurationFormatTest, RoundTrip_SubRipFormat) {
   EXPECT_EQ("01:12:34,000", ToSubRipDuration(parsed));
   EXPECT_EQ("01:12:34,567", ToSubRipDuration(parsed_with_decimal));
 }
+
+TEST(DurationFormatTest, AppendSubRipDuration) {
+  std::string output = "start ";
+  AppendSubRipDuration(0ms, output);
+  EXPECT_EQ("start 00:00:00,000", output);
+
+  output.clear();
+  AppendSubRipDuration(9h + 59min + 59s + 999ms, output);
+  EXPECT_EQ("09:59:59,999", output);
+
+  // Hours are not limited to 2 digits.
+  output.clear();
+  AppendSubRipDuration(123h + 4min + 5s + 6ms, output);
+  EXPECT_EQ("123:04:05,006", output);
+
+  output.clear();
+  AppendSubRipDuration(-1500ms, output);
+  EXPECT_EQ("-00:00:01,500", output);
+}
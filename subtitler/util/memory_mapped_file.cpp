@@ -0,0 +1,102 @@
+#include "subtitler/util/memory_mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace subtitler {
+
+#ifdef _MSC_VER
+MemoryMappedFile::MemoryMappedFile(const std::filesystem::path& path) {
+  HANDLE file = CreateFileW(path.wstring().c_str(),  // name of the file
+                            GENERIC_READ,            // open for reading
+                            FILE_SHARE_READ,         // allow other readers
+                            NULL,                    // default security
+                            OPEN_EXISTING,           // file must exist
+                            FILE_ATTRIBUTE_NORMAL,   // normal file
+                            NULL);                   // no attr. template
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error{"Could not open file " + path.string()};
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    throw std::runtime_error{"Could not get size of file " + path.string()};
+  }
+  file_handle_ = file;
+  size_ = static_cast<std::size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    // Zero length files cannot be mapped.
+    return;
+  }
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    CloseHandle(file);
+    throw std::runtime_error{"Could not map file " + path.string()};
+  }
+  mapping_handle_ = mapping;
+  data_ = static_cast<const char*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error{"Could not map view of file " + path.string()};
+  }
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_) {
+    CloseHandle(file_handle_);
+  }
+}
+
+#else
+MemoryMappedFile::MemoryMappedFile(const std::filesystem::path& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error{"Could not open file " + path.string()};
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0) {
+    close(fd);
+    throw std::runtime_error{"Could not get size of file " + path.string()};
+  }
+  size_ = static_cast<std::size_t>(file_stat.st_size);
+  if (size_ == 0) {
+    // Zero length files cannot be mapped.
+    close(fd);
+    return;
+  }
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (data == MAP_FAILED) {
+    size_ = 0;
+    throw std::runtime_error{"Could not map file " + path.string()};
+  }
+  // The file is scanned front to back exactly once.
+  madvise(data, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(data);
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (data_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+#endif
+
+}  // namespace subtitler
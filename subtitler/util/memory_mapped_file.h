@@ -0,0 +1,40 @@
+#ifndef SUBTITLER_UTIL_MEMORY_MAPPED_FILE_H
+#define SUBTITLER_UTIL_MEMORY_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace subtitler {
+
+/**
+ * Read-only view of an entire file, mapped into memory.
+ * The contents stay valid for the lifetime of this object. Avoids copying
+ * the file through a stream buffer when it only needs to be scanned once.
+ */
+class MemoryMappedFile {
+ public:
+  // Maps the file. Throws std::runtime_error if the file cannot be opened
+  // or mapped.
+  explicit MemoryMappedFile(const std::filesystem::path& path);
+
+  // Unmaps the file.
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(const MemoryMappedFile& other) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile& other) = delete;
+
+  std::string_view contents() const { return {data_, size_}; }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _MSC_VER
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+}  // namespace subtitler
+
+#endif  // SUBTITLER_UTIL_MEMORY_MAPPED_FILE_H
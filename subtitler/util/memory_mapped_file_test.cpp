@@ -0,0 +1,51 @@
+#include "subtitler/util/memory_mapped_file.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "subtitler/util/unicode.h"
+
+namespace subtitler {
+namespace {
+
+namespace fs = std::filesystem;
+
+TEST(MemoryMappedFileTest, MapsEntireContents) {
+  std::string data = "hello world!\nthis is a test :)\n";
+  auto path = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) / "mapped.txt";
+  {
+    std::ofstream stream{path, std::ios::binary};
+    stream << data;
+  }
+
+  {
+    MemoryMappedFile file{path};
+    ASSERT_EQ(file.contents(), data);
+  }
+  fs::remove(path);
+}
+
+TEST(MemoryMappedFileTest, EmptyFileHasEmptyContents) {
+  auto path = GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) / "empty.txt";
+  { std::ofstream stream{path}; }
+
+  {
+    MemoryMappedFile file{path};
+    ASSERT_TRUE(file.contents().empty());
+  }
+  fs::remove(path);
+}
+
+TEST(MemoryMappedFileTest, MissingFileThrows) {
+  auto path =
+      GetFileSystemUtf8Path(std::getenv("TEST_TMPDIR")) / "does_not_exist.txt";
+  ASSERT_THROW(MemoryMappedFile{path}, std::runtime_error);
+}
+
+}  // namespace
+}  // namespace subtitler
@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "date/date.h"
@@ -15,6 +16,9 @@ namespace player {
 
 namespace {
 
+// Input read by the subtitles filter for subtitles set by FFPlay::subtitles().
+constexpr std::string_view kStdin = "pipe:0";
+
 std::string FormatChrono(const std::chrono::milliseconds& chrono) {
   std::ostringstream stream;
   date::to_stream(stream, "%T", chrono);
@@ -41,6 +45,13 @@ FFPlay::~FFPlay() = default;
 
 FFPlay* FFPlay::subtitles_path(const std::string& path) {
   subtitles_path_ = util::FixPathForFilters(path);
+  subtitles_.clear();
+  return this;
+}
+
+FFPlay* FFPlay::subtitles(std::string srt) {
+  subtitles_ = std::move(srt);
+  subtitles_path_ = subtitles_.empty() ? "" : util::FixPathForFilters(kStdin);
   return this;
 }
 
@@ -128,6 +139,10 @@ void FFPlay::OpenPlayer(const std::string_view video_path) {
   }
   executor_->CaptureOutput(true);
   executor_->SetCommand(command.str());
+  if (!subtitles_.empty()) {
+    executor_->SetInputCallback(
+        subprocess::SubprocessExecutor::InputFrom(subtitles_));
+  }
   executor_->Start();
 
   is_playing_ = true;
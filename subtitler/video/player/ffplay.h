@@ -96,6 +96,11 @@ class FFPlay {
 
   FFPlay* subtitles_path(const std::string& path);
 
+  // Subtitles to display, in SubRip format. They are written to the stdin of
+  // ffplay rather than to a file it reads. Replaces subtitles_path() and
+  // vice versa, empty to display none.
+  FFPlay* subtitles(std::string srt);
+
  private:
   std::string ffplay_path_;
   std::unique_ptr<subprocess::SubprocessExecutor> executor_;
@@ -114,6 +119,7 @@ class FFPlay {
   std::optional<int> volume_;
   bool enable_timestamp_ = false;
   std::string subtitles_path_;
+  std::string subtitles_;
 
   std::vector<std::string> BuildArgs();
 };
@@ -4,16 +4,19 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <string>
 
 #include "subtitler/subprocess/mock_subprocess_executor.h"
 #include "subtitler/util/font_config.h"
 
 using subtitler::subprocess::MockSubprocessExecutor;
 using subtitler::video::player::FFPlay;
+using ::testing::_;
 using ::testing::InSequence;
 using ::testing::IsEmpty;
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::StrictMock;
 
 TEST(FFPlayTest, OpenPlayerWithDefaultArgs) {
@@ -122,6 +125,30 @@ TEST(FFPlayTest, OpenPlayerWithWindowsSubtitlePathEnabled) {
   ffplay.subtitles_path("C:\\foo\\subtitle.srt")->OpenPlayer("video.mp4");
 }
 
+TEST(FFPlayTest, OpenPlayerWithSubtitlesFromMemory) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  MockSubprocessExecutor::InputCallback input;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*mock_executor, SetCommand("ffplay \"video.mp4\" -sn "
+                                           "-vf \"subtitles='pipe\\:0'\" "
+                                           "-loglevel error"))
+        .Times(1);
+    EXPECT_CALL(*mock_executor, SetInputCallback(_))
+        .WillOnce(SaveArg<0>(&input));
+    EXPECT_CALL(*mock_executor, Start()).Times(1);
+  }
+
+  FFPlay ffplay("ffplay", std::move(mock_executor));
+  ffplay.subtitles("1\n00:00:00,000 --> 00:00:01,000\nhello\n\n")
+      ->OpenPlayer("video.mp4");
+
+  std::string written(64, '\0');
+  written.resize(input(written.data(), written.size()));
+  ASSERT_EQ(written, "1\n00:00:00,000 --> 00:00:01,000\nhello\n\n");
+  ASSERT_EQ(input(written.data(), written.size()), 0u);
+}
+
 TEST(FFPlayTest, OpenPlayerWithTimeStampsAndSubtitles) {
   auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
   EXPECT_CALL(*mock_executor,
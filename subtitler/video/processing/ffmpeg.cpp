@@ -4,9 +4,11 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/video/processing/progress_parser.h"
+#include "subtitler/video/processing/run_report.h"
 #include "subtitler/video/util/video_utils.h"
 
 namespace fs = std::filesystem;
@@ -15,6 +17,48 @@ namespace subtitler {
 namespace video {
 namespace processing {
 
+namespace {
+
+// Input read by ffmpeg for subtitles passed from memory.
+constexpr std::string_view kStdin = "pipe:0";
+
+std::string RemuxCommand(std::string_view ffmpeg_path, std::string_view video,
+                         std::string_view subtitles_input,
+                         std::string_view output) {
+  std::ostringstream stream;
+  stream << ffmpeg_path;
+  stream << " -y -i " << '"' << video << '"';
+  if (subtitles_input == kStdin) {
+    // Can't be told from the file extension.
+    stream << " -f srt";
+  }
+  stream << " -i " << '"' << subtitles_input << '"';
+  stream << " -map 0 -map 1:s -c copy";
+  stream << " " << '"' << output << '"';
+  stream << " -loglevel error -progress pipe:1 -stats_period 5";
+  return stream.str();
+}
+
+std::string BurnCommand(std::string_view ffmpeg_path, std::string_view video,
+                        std::string_view subtitles_input,
+                        std::string_view output) {
+  std::ostringstream stream;
+  stream << ffmpeg_path;
+  if (subtitles_input == kStdin) {
+    // Otherwise ffmpeg reads stdin for interactive commands as well.
+    stream << " -nostdin";
+  }
+  stream << " -y -i " << '"' << video << '"';
+  stream << " -vf"
+         << " \"subtitles='" << util::FixPathForFilters(subtitles_input) << "'"
+         << '"';
+  stream << " " << '"' << output << '"';
+  stream << " -loglevel error -progress pipe:1 -stats_period 5";
+  return stream.str();
+}
+
+}  // namespace
+
 FFMpeg::FFMpeg(const std::string_view ffmpeg_path,
                std::unique_ptr<subprocess::SubprocessExecutor> executor)
     : ffmpeg_path_{ffmpeg_path},
@@ -77,28 +121,8 @@ void FFMpeg::RemuxSubtitlesAsync(
     const std::string_view output,
     std::function<void(const Progress&)> progress_callback) {
   throwIfRunning();
-
-  std::ostringstream stream;
-  stream << ffmpeg_path_;
-  stream << " -y -i " << '"' << video << '"';
-  stream << " -i " << '"' << subtitles << '"';
-  stream << " -map 0 -map 1:s -c copy";
-  stream << " " << '"' << output << '"';
-  stream << " -loglevel error -progress pipe:1 -stats_period 5";
-
-  executor_->SetCommand(stream.str());
-  executor_->CaptureOutput(false);
-
-  progress_parser_ = std::make_unique<ProgressParser>();
-  executor_->SetCallback(
-      [this, pcb = std::move(progress_callback)](const char* buffer) {
-        const auto progress = progress_parser_->Receive(buffer);
-        if (progress) {
-          pcb(*progress);
-        }
-      });
-  executor_->Start();
-  is_running_ = true;
+  startAsync(RemuxCommand(ffmpeg_path_, video, subtitles, output),
+             std::move(progress_callback));
 }
 
 void FFMpeg::BurnSubtitlesAsync(
@@ -106,29 +130,30 @@ void FFMpeg::BurnSubtitlesAsync(
     const std::string_view output,
     std::function<void(const Progress&)> progress_callback) {
   throwIfRunning();
+  startAsync(BurnCommand(ffmpeg_path_, video, subtitles, output),
+             std::move(progress_callback));
+}
 
-  std::ostringstream stream;
-  stream << ffmpeg_path_;
-  stream << " -y -i " << '"' << video << '"';
-  stream << " -vf"
-         << " \"subtitles='" << util::FixPathForFilters(subtitles) << "'"
-         << '"';
-  stream << " " << '"' << output << '"';
-  stream << " -loglevel error -progress pipe:1 -stats_period 5";
-
-  executor_->SetCommand(stream.str());
-  executor_->CaptureOutput(false);
+void FFMpeg::RemuxSubtitlesFromMemoryAsync(
+    const std::string_view video, std::string subtitles,
+    const std::string_view output,
+    std::function<void(const Progress&)> progress_callback) {
+  throwIfRunning();
+  executor_->SetInputCallback(
+      subprocess::SubprocessExecutor::InputFrom(std::move(subtitles)));
+  startAsync(RemuxCommand(ffmpeg_path_, video, kStdin, output),
+             std::move(progress_callback));
+}
 
-  progress_parser_ = std::make_unique<ProgressParser>();
-  executor_->SetCallback(
-      [this, pcb = std::move(progress_callback)](const char* buffer) {
-        const auto progress = progress_parser_->Receive(buffer);
-        if (progress) {
-          pcb(*progress);
-        }
-      });
-  executor_->Start();
-  is_running_ = true;
+void FFMpeg::BurnSubtitlesFromMemoryAsync(
+    const std::string_view video, std::string subtitles,
+    const std::string_view output,
+    std::function<void(const Progress&)> progress_callback) {
+  throwIfRunning();
+  executor_->SetInputCallback(
+      subprocess::SubprocessExecutor::InputFrom(std::move(subtitles)));
+  startAsync(BurnCommand(ffmpeg_path_, video, kStdin, output),
+             std::move(progress_callback));
 }
 
 void FFMpeg::WaitForAsyncTask(std::optional<int> timeout_ms) {
@@ -138,13 +163,59 @@ void FFMpeg::WaitForAsyncTask(std::optional<int> timeout_ms) {
   }
 
   auto output = executor_->WaitUntilFinished(timeout_ms);
+  RunReport report;
+  report.command = std::move(async_command_);
+  report.exit_code = output.exit_code;
+  report.term_signal = output.term_signal;
+  report.error = output.subproc_stderr;
+  report.usage = output.usage;
+  report.progress = progress_parser_->history();
   progress_parser_.reset();
   is_running_ = false;
+
+  const auto report_path = std::move(run_report_path_);
+  run_report_path_.clear();
+  last_run_report_ = std::move(report);
+  if (!report_path.empty()) {
+    try {
+      WriteRunReport(*last_run_report_, report_path);
+    } catch (const std::exception&) {
+      // The report is only informational, the task succeeded or failed
+      // regardless. It is still available from GetLastRunReport().
+    }
+  }
   if (!output.subproc_stderr.empty()) {
     throw std::runtime_error{"Error running ffmpeg: " + output.subproc_stderr};
   }
 }
 
+void FFMpeg::SetRunReportPath(const std::string_view path) {
+  run_report_path_ = path;
+}
+
+const std::optional<RunReport>& FFMpeg::GetLastRunReport() const {
+  return last_run_report_;
+}
+
+void FFMpeg::startAsync(
+    const std::string& command,
+    std::function<void(const Progress&)> progress_callback) {
+  executor_->SetCommand(command);
+  executor_->CaptureOutput(false);
+  async_command_ = command;
+
+  progress_parser_ = std::make_unique<ProgressParser>();
+  executor_->SetCallback(
+      [this, pcb = std::move(progress_callback)](const char* buffer) {
+        const auto progress = progress_parser_->Receive(buffer);
+        if (progress) {
+          pcb(*progress);
+        }
+      });
+  executor_->Start();
+  is_running_ = true;
+}
+
 void FFMpeg::throwIfRunning() {
   if (is_running_) {
     throw std::runtime_error{
@@ -9,6 +9,7 @@
 
 #include "subtitler/subprocess/subprocess_executor.h"
 #include "subtitler/video/processing/progress_parser.h"
+#include "subtitler/video/processing/run_report.h"
 
 namespace subtitler {
 namespace video {
@@ -76,21 +77,65 @@ class FFMpeg {
       std::string_view output,
       std::function<void(const Progress&)> progress_callback);
 
+  /**
+   * Same as RemuxSubtitlesAsync(), with the subtitles in memory rather than
+   * in a file. They are written to the stdin of ffmpeg.
+   *
+   * @param subtitles The input subtitles, in SubRip format.
+   */
+  void RemuxSubtitlesFromMemoryAsync(
+      std::string_view video, std::string subtitles, std::string_view output,
+      std::function<void(const Progress&)> progress_callback);
+
+  /**
+   * Same as BurnSubtitlesAsync(), with the subtitles in memory rather than
+   * in a file. They are written to the stdin of ffmpeg.
+   *
+   * @param subtitles The input subtitles, in SubRip format.
+   */
+  void BurnSubtitlesFromMemoryAsync(
+      std::string_view video, std::string subtitles, std::string_view output,
+      std::function<void(const Progress&)> progress_callback);
+
   /**
    * Waits (blocks) for the last async task launched to be completed.
    * Throws runtime_error if no async task is running.
    *
+   * Writes the report of the task if SetRunReportPath() was called, also
+   * if the task failed. Failing to write the report doesn't fail the task.
+   *
    * @param timeout_ms the amount of time to wait before cancelling the task.
    */
   void WaitForAsyncTask(std::optional<int> timeout_ms = std::nullopt);
 
+  /**
+   * Sets where WaitForAsyncTask() writes the report of the task as JSON,
+   * see RunReport. Applies to the next async task only.
+   *
+   * @param path The path of the report file, replaced if it exists.
+   */
+  void SetRunReportPath(std::string_view path);
+
+  /**
+   * Returns the report of the last async task waited for, whether or not it
+   * was written to a file. Empty before any task completed.
+   */
+  const std::optional<RunReport>& GetLastRunReport() const;
+
  private:
   std::string ffmpeg_path_;
   std::unique_ptr<subprocess::SubprocessExecutor> executor_;
   bool is_running_;
   std::unique_ptr<ProgressParser> progress_parser_;
+  // Command of the running async task.
+  std::string async_command_;
+  std::string run_report_path_;
+  std::optional<RunReport> last_run_report_;
 
   void throwIfRunning();
+  // Starts command, reporting progress parsed from its stdout.
+  void startAsync(const std::string& command,
+                  std::function<void(const Progress&)> progress_callback);
 };
 
 }  // namespace processing
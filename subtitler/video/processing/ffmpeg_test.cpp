@@ -4,7 +4,13 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 #include "subtitler/subprocess/mock_subprocess_executor.h"
 #include "subtitler/video/processing/progress_parser.h"
@@ -12,7 +18,9 @@
 using subtitler::subprocess::MockSubprocessExecutor;
 using subtitler::video::processing::FFMpeg;
 using subtitler::video::processing::Progress;
+using subtitler::video::processing::ToJson;
 using ::testing::_;
+using ::testing::HasSubstr;
 using ::testing::InSequence;
 using ::testing::NiceMock;
 using ::testing::Return;
@@ -207,6 +215,70 @@ TEST(FFMpegTest, RemuxSubtitlesAsync_Success) {
   ASSERT_TRUE(callback_run);
 }
 
+TEST(FFMpegTest, BurnSubtitlesFromMemoryAsync_WritesSubtitlesToStdin) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  MockSubprocessExecutor::InputCallback intercepted_input;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*mock_executor, SetInputCallback)
+        .WillOnce(SaveArg<0>(&intercepted_input));
+    EXPECT_CALL(
+        *mock_executor,
+        SetCommand(
+            "ffmpeg -nostdin -y -i \"video.mp4\" -vf "
+            "\"subtitles='pipe\\:0'\" "
+            "\"output.mp4\" -loglevel error -progress pipe:1 -stats_period "
+            "5"))
+        .Times(1);
+    EXPECT_CALL(*mock_executor, Start()).Times(1);
+    EXPECT_CALL(*mock_executor, WaitUntilFinished(std::optional<int>()))
+        .Times(1)
+        .WillOnce(Return(MockSubprocessExecutor::Output{"", ""}));
+  }
+
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ffmpeg.BurnSubtitlesFromMemoryAsync("video.mp4", "subtitles", "output.mp4",
+                                      {});
+
+  std::string written(16, '\0');
+  written.resize(intercepted_input(written.data(), written.size()));
+  ASSERT_EQ(written, "subtitles");
+
+  ffmpeg.WaitForAsyncTask();
+}
+
+TEST(FFMpegTest, RemuxSubtitlesFromMemoryAsync_WritesSubtitlesToStdin) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  MockSubprocessExecutor::InputCallback intercepted_input;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*mock_executor, SetInputCallback)
+        .WillOnce(SaveArg<0>(&intercepted_input));
+    EXPECT_CALL(
+        *mock_executor,
+        SetCommand(
+            "ffmpeg -y -i \"video.mp4\" -f srt -i \"pipe:0\" "
+            "-map 0 -map 1:s -c copy "
+            "\"output.mkv\" -loglevel error -progress pipe:1 -stats_period "
+            "5"))
+        .Times(1);
+    EXPECT_CALL(*mock_executor, Start()).Times(1);
+    EXPECT_CALL(*mock_executor, WaitUntilFinished(std::optional<int>()))
+        .Times(1)
+        .WillOnce(Return(MockSubprocessExecutor::Output{"", ""}));
+  }
+
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ffmpeg.RemuxSubtitlesFromMemoryAsync("video.mp4", "subtitles", "output.mkv",
+                                       {});
+
+  std::string written(16, '\0');
+  written.resize(intercepted_input(written.data(), written.size()));
+  ASSERT_EQ(written, "subtitles");
+
+  ffmpeg.WaitForAsyncTask();
+}
+
 TEST(FFMpegTest, WaitForAsyncTask_ThrowsStdErr) {
   auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
   {
@@ -233,3 +305,96 @@ TEST(FFMpegTest, WaitForAsyncTask_ThrowsStdErr) {
     ASSERT_STREQ(e.what(), "Error running ffmpeg: some error");
   }
 }
+
+TEST(FFMpegTest, WaitForAsyncTask_WritesRunReport) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  std::function<void(const char*)> intercepted_callback;
+  MockSubprocessExecutor::Output output;
+  output.exit_code = 0;
+  output.usage.wall_time = 10s;
+  output.usage.user_cpu = 30s;
+  output.usage.max_rss_kb = 250000;
+  EXPECT_CALL(*mock_executor, SetCallback)
+      .WillOnce(SaveArg<0>(&intercepted_callback));
+  EXPECT_CALL(*mock_executor, WaitUntilFinished).WillOnce(Return(output));
+
+  const std::string path =
+      std::string{std::getenv("TEST_TMPDIR")} + "/ffmpeg_run_report.json";
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ASSERT_FALSE(ffmpeg.GetLastRunReport());
+  ffmpeg.SetRunReportPath(path);
+  ffmpeg.RemuxSubtitlesAsync("video.mp4", "subtitle.srt", "output.mkv",
+                             [](const Progress&) {});
+  intercepted_callback(PROGRESS_TEST_OUTPUT);
+  intercepted_callback(PROGRESS_TEST_OUTPUT);
+  ffmpeg.WaitForAsyncTask();
+
+  const auto& report = ffmpeg.GetLastRunReport();
+  ASSERT_TRUE(report);
+  ASSERT_THAT(report->command, HasSubstr("-i \"subtitle.srt\""));
+  ASSERT_EQ(report->exit_code, 0);
+  ASSERT_EQ(report->usage.wall_time, 10s);
+  ASSERT_EQ(report->usage.user_cpu, 30s);
+  ASSERT_EQ(report->usage.max_rss_kb, 250000);
+  ASSERT_EQ(report->progress.size(), 2u);
+  ASSERT_EQ(report->progress[0].progress.frame, 123456);
+
+  std::ifstream file{path};
+  std::stringstream contents;
+  contents << file.rdbuf();
+  ASSERT_EQ(contents.str(), ToJson(*report) + "\n");
+}
+
+TEST(FFMpegTest, WaitForAsyncTask_WritesRunReportOnError) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  EXPECT_CALL(*mock_executor, WaitUntilFinished)
+      .WillOnce(Return(MockSubprocessExecutor::Output{"", "some error"}));
+
+  const std::string path = std::string{std::getenv("TEST_TMPDIR")} +
+                           "/ffmpeg_failed_run_report.json";
+  std::remove(path.c_str());
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ffmpeg.SetRunReportPath(path);
+  ffmpeg.BurnSubtitlesAsync("video.mp4", "subtitle.srt", "output.mp4", {});
+  ASSERT_THROW(ffmpeg.WaitForAsyncTask(), std::runtime_error);
+
+  ASSERT_EQ(ffmpeg.GetLastRunReport()->error, "some error");
+  ASSERT_TRUE(std::ifstream{path}.good());
+}
+
+TEST(FFMpegTest, WaitForAsyncTask_SucceedsWhenRunReportCantBeWritten) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  EXPECT_CALL(*mock_executor, WaitUntilFinished)
+      .WillOnce(Return(MockSubprocessExecutor::Output{}));
+
+  const std::string path = std::string{std::getenv("TEST_TMPDIR")} +
+                           "/missing_directory/ffmpeg_run_report.json";
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ffmpeg.SetRunReportPath(path);
+  // Not valid UTF-8, which the report replaces.
+  ffmpeg.BurnSubtitlesAsync("caf\xe9.mp4", "subtitle.srt", "output.mp4", {});
+  ASSERT_NO_THROW(ffmpeg.WaitForAsyncTask());
+
+  ASSERT_THAT(ffmpeg.GetLastRunReport()->command, HasSubstr("caf\xe9.mp4"));
+}
+
+TEST(FFMpegTest, RunReportPathAppliesToNextTaskOnly) {
+  auto mock_executor = std::make_unique<NiceMock<MockSubprocessExecutor>>();
+  EXPECT_CALL(*mock_executor, WaitUntilFinished)
+      .Times(2)
+      .WillRepeatedly(Return(MockSubprocessExecutor::Output{}));
+
+  const std::string path =
+      std::string{std::getenv("TEST_TMPDIR")} + "/ffmpeg_once_run_report.json";
+  FFMpeg ffmpeg("ffmpeg", std::move(mock_executor));
+  ffmpeg.SetRunReportPath(path);
+  ffmpeg.BurnSubtitlesAsync("video.mp4", "subtitle.srt", "output.mp4", {});
+  ffmpeg.WaitForAsyncTask();
+  std::remove(path.c_str());
+  ffmpeg.BurnSubtitlesAsync("video.mp4", "subtitle.srt", "output.mp4", {});
+  ffmpeg.WaitForAsyncTask();
+
+  ASSERT_FALSE(std::ifstream{path}.good());
+  // Still kept in memory.
+  ASSERT_TRUE(ffmpeg.GetLastRunReport());
+}
@@ -125,6 +125,10 @@ std::optional<Progress> ProgressParser::Receive(const char* input) {
       if (line.rfind("progress=", 0) == 0) {
         result = ParseProgress(buffer_.str());
         buffer_ = std::ostringstream{};
+        history_.push_back(
+            {std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - created_),
+             *result});
         // Continue parsing. Possibly we've recieved a new
         // more up to date progress, in which case we want to
         // return that one instead.
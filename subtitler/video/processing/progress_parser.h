@@ -4,6 +4,7 @@
 #include <chrono>
 #include <optional>
 #include <sstream>
+#include <vector>
 
 namespace subtitler {
 namespace video {
@@ -25,6 +26,15 @@ struct Progress {
   std::string progress;
 };
 
+/**
+ * Progress update, with the time it was received since the parser was
+ * created, i.e. roughly since FFMPEG was started.
+ */
+struct ProgressSample {
+  std::chrono::milliseconds elapsed = std::chrono::milliseconds::zero();
+  Progress progress;
+};
+
 /**
  * Parses FFMPEG progress and returns as a Progress struct.
  * Data from FFMPEG can be received in chunks. If an incomplete progress
@@ -32,7 +42,8 @@ struct Progress {
  * a complete update can be returned.
  *
  * If multiple updates are received at once, then this returns the most
- * recent update.
+ * recent update. All of them are kept in history(), e.g. to report how
+ * the speed of a task varied over time.
  */
 class ProgressParser {
  public:
@@ -48,8 +59,14 @@ class ProgressParser {
    */
   std::optional<Progress> Receive(const char* input);
 
+  // Every update received so far, oldest first.
+  const std::vector<ProgressSample>& history() const { return history_; }
+
  private:
   std::ostringstream buffer_;
+  std::chrono::steady_clock::time_point created_ =
+      std::chrono::steady_clock::now();
+  std::vector<ProgressSample> history_;
 };
 
 }  // namespace processing
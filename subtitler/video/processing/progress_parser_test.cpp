@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <string>
 
 using subtitler::video::processing::Progress;
 using subtitler::video::processing::ProgressParser;
@@ -150,3 +151,23 @@ TEST(ProgressParserTest, ParseIncompleteUpdate_BreakInMiddle) {
   ASSERT_EQ(result.speed, "6.29x");
   ASSERT_EQ(result.progress, "continue");
 }
+
+TEST(ProgressParserTest, HistoryKeepsEveryUpdate) {
+  ProgressParser parser;
+  ASSERT_TRUE(parser.history().empty());
+
+  // Both updates at once, of which only the last one is returned.
+  std::string both = std::string{PROGRESS_TEST_OUTPUT_CONTINUE} +
+                     std::string{PROGRESS_TEST_OUTPUT_END};
+  auto res_opt = parser.Receive(both.c_str());
+  ASSERT_TRUE(res_opt);
+  ASSERT_EQ(res_opt->progress, "end");
+
+  const auto& history = parser.history();
+  ASSERT_EQ(history.size(), 2u);
+  ASSERT_EQ(history[0].progress.frame, 123456);
+  ASSERT_EQ(history[0].progress.speed, "6.29x");
+  ASSERT_EQ(history[1].progress.frame, 123457);
+  ASSERT_EQ(history[1].progress.speed, "7.29x");
+  ASSERT_LE(history[0].elapsed, history[1].elapsed);
+}
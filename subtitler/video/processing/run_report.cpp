@@ -0,0 +1,91 @@
+#include "subtitler/video/processing/run_report.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace subtitler {
+namespace video {
+namespace processing {
+
+namespace {
+
+// Number at the start of an FFMPEG stat such as "6.29x" or
+// "1416.3kbits/s", or null for "N/A".
+nlohmann::json LeadingNumber(const std::string& stat) {
+  const char* begin = stat.c_str();
+  char* end = nullptr;
+  const double number = std::strtod(begin, &end);
+  if (end == begin) {
+    return nullptr;
+  }
+  return number;
+}
+
+template <typename T>
+nlohmann::json OrNull(const std::optional<T>& value) {
+  if (!value) {
+    return nullptr;
+  }
+  return *value;
+}
+
+}  // namespace
+
+std::string ToJson(const RunReport& report) {
+  const auto& usage = report.usage;
+  nlohmann::json progress = nlohmann::json::array();
+  for (const auto& [elapsed, update] : report.progress) {
+    progress.push_back({
+        {"elapsed_ms", elapsed.count()},
+        {"frame", update.frame},
+        {"fps", update.fps},
+        {"bitrate_kbits_per_s", LeadingNumber(update.bitrate)},
+        {"total_size", update.total_size},
+        {"out_time_us", update.out_time_us.count()},
+        {"dup_frames", update.dup_frames},
+        {"drop_frames", update.drop_frames},
+        {"speed", LeadingNumber(update.speed)},
+        {"progress", update.progress},
+    });
+  }
+
+  nlohmann::json json = {
+      {"command", report.command},
+      {"exit_code", OrNull(report.exit_code)},
+      {"term_signal", OrNull(report.term_signal)},
+      {"error", report.error},
+      {"usage",
+       {
+           {"wall_time_us", usage.wall_time.count()},
+           {"user_cpu_us", usage.user_cpu.count()},
+           {"system_cpu_us", usage.system_cpu.count()},
+           {"max_rss_kb", usage.max_rss_kb},
+           {"voluntary_context_switches", usage.voluntary_context_switches},
+           {"involuntary_context_switches",
+            usage.involuntary_context_switches},
+           {"input_blocks", usage.input_blocks},
+           {"output_blocks", usage.output_blocks},
+       }},
+      {"progress", std::move(progress)},
+  };
+  // Paths and FFMPEG's stderr aren't necessarily UTF-8, replace invalid
+  // bytes rather than failing the whole report.
+  return json.dump(/* indent= */ 2, /* indent_char= */ ' ',
+                   /* ensure_ascii= */ false,
+                   nlohmann::json::error_handler_t::replace);
+}
+
+void WriteRunReport(const RunReport& report, const std::string& path) {
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  file << ToJson(report) << '\n';
+  file.close();
+  if (!file) {
+    throw std::runtime_error{"Could not write run report to " + path};
+  }
+}
+
+}  // namespace processing
+}  // namespace video
+}  // namespace subtitler
@@ -0,0 +1,56 @@
+#ifndef SUBTITLER_VIDEO_PROCESSING_RUN_REPORT_H
+#define SUBTITLER_VIDEO_PROCESSING_RUN_REPORT_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "subtitler/subprocess/subprocess_executor.h"
+#include "subtitler/video/processing/progress_parser.h"
+
+namespace subtitler {
+namespace video {
+namespace processing {
+
+/**
+ * What a finished FFMPEG task cost: how it ended, the resources used by the
+ * process and its progress over time. Written as JSON, to compare tasks and
+ * plan capacity for the machines running them.
+ *
+ * Sample Usage:
+ * RunReport report;
+ * report.command = command;
+ * report.usage = output.usage;
+ * report.progress = progress_parser.history();
+ * WriteRunReport(report, "export.json");
+ */
+struct RunReport {
+  std::string command;
+  std::optional<int> exit_code;
+  std::optional<int> term_signal;
+  // Stderr of FFMPEG, which is only logged on errors.
+  std::string error;
+  subprocess::SubprocessExecutor::ResourceUsage usage;
+  std::vector<ProgressSample> progress;
+};
+
+/**
+ * Returns the report as a JSON object. Durations are in microseconds,
+ * except for the elapsed time of progress updates which is in milliseconds.
+ * Bitrate (kbits/s) and speed (x realtime) are numbers, or null if FFMPEG
+ * didn't know them yet. Invalid UTF-8 in strings, e.g. a path in another
+ * encoding, is replaced with U+FFFD.
+ */
+std::string ToJson(const RunReport& report);
+
+/**
+ * Writes the report to path as JSON, replacing the file if it exists.
+ * Throws runtime_error if the file can't be written.
+ */
+void WriteRunReport(const RunReport& report, const std::string& path);
+
+}  // namespace processing
+}  // namespace video
+}  // namespace subtitler
+
+#endif
@@ -0,0 +1,134 @@
+#include "subtitler/video/processing/run_report.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using subtitler::video::processing::Progress;
+using subtitler::video::processing::ProgressSample;
+using subtitler::video::processing::RunReport;
+using subtitler::video::processing::ToJson;
+using subtitler::video::processing::WriteRunReport;
+
+using namespace std::chrono_literals;
+
+namespace {
+
+RunReport MakeReport() {
+  RunReport report;
+  report.command = "ffmpeg -y -i \"in.mp4\" \"out.mp4\"";
+  report.exit_code = 0;
+  report.usage.wall_time = 10s;
+  report.usage.user_cpu = 30s;
+  report.usage.system_cpu = 2s;
+  report.usage.max_rss_kb = 250000;
+  report.usage.voluntary_context_switches = 100;
+  report.usage.involuntary_context_switches = 20;
+  report.usage.input_blocks = 3;
+  report.usage.output_blocks = 4;
+
+  Progress first;
+  first.frame = 120;
+  first.fps = 24.5;
+  first.bitrate = "N/A";
+  first.total_size = 1000;
+  first.out_time_us = 5s;
+  first.speed = "N/A";
+  first.progress = "continue";
+  Progress last = first;
+  last.frame = 240;
+  last.bitrate = "1416.3kbits/s";
+  last.out_time_us = 10s;
+  last.speed = "6.29x";
+  last.progress = "end";
+  report.progress = {{5000ms, first}, {10000ms, last}};
+  return report;
+}
+
+}  // namespace
+
+TEST(RunReportTest, ToJson) {
+  auto json = nlohmann::json::parse(ToJson(MakeReport()));
+
+  ASSERT_EQ(json["command"], "ffmpeg -y -i \"in.mp4\" \"out.mp4\"");
+  ASSERT_EQ(json["exit_code"], 0);
+  ASSERT_TRUE(json["term_signal"].is_null());
+  ASSERT_EQ(json["error"], "");
+
+  const auto& usage = json["usage"];
+  ASSERT_EQ(usage["wall_time_us"], 10'000'000);
+  ASSERT_EQ(usage["user_cpu_us"], 30'000'000);
+  ASSERT_EQ(usage["system_cpu_us"], 2'000'000);
+  ASSERT_EQ(usage["max_rss_kb"], 250000);
+  ASSERT_EQ(usage["voluntary_context_switches"], 100);
+  ASSERT_EQ(usage["involuntary_context_switches"], 20);
+  ASSERT_EQ(usage["input_blocks"], 3);
+  ASSERT_EQ(usage["output_blocks"], 4);
+
+  const auto& progress = json["progress"];
+  ASSERT_EQ(progress.size(), 2u);
+  ASSERT_EQ(progress[0]["elapsed_ms"], 5000);
+  ASSERT_EQ(progress[0]["frame"], 120);
+  ASSERT_EQ(progress[0]["fps"], 24.5);
+  ASSERT_TRUE(progress[0]["bitrate_kbits_per_s"].is_null());
+  ASSERT_TRUE(progress[0]["speed"].is_null());
+  ASSERT_EQ(progress[0]["out_time_us"], 5'000'000);
+  ASSERT_EQ(progress[0]["progress"], "continue");
+  ASSERT_EQ(progress[1]["elapsed_ms"], 10000);
+  ASSERT_EQ(progress[1]["bitrate_kbits_per_s"], 1416.3);
+  ASSERT_EQ(progress[1]["speed"], 6.29);
+  ASSERT_EQ(progress[1]["progress"], "end");
+}
+
+TEST(RunReportTest, ToJsonOfTerminatedTask) {
+  RunReport report;
+  report.term_signal = 15;
+  report.error = "Conversion failed!";
+
+  auto json = nlohmann::json::parse(ToJson(report));
+
+  ASSERT_TRUE(json["exit_code"].is_null());
+  ASSERT_EQ(json["term_signal"], 15);
+  ASSERT_EQ(json["error"], "Conversion failed!");
+  ASSERT_TRUE(json["progress"].is_array());
+  ASSERT_TRUE(json["progress"].empty());
+}
+
+TEST(RunReportTest, ToJsonReplacesInvalidUtf8) {
+  RunReport report;
+  report.command = "ffmpeg -i \"caf\xe9.mp4\"";
+  report.error = "Could not open caf\xe9.mp4\nConversion failed!\xff";
+
+  auto json = nlohmann::json::parse(ToJson(report));
+
+  ASSERT_EQ(json["command"], "ffmpeg -i \"caf\uFFFD.mp4\"");
+  ASSERT_EQ(json["error"],
+            "Could not open caf\uFFFD.mp4\nConversion failed!\uFFFD");
+}
+
+TEST(RunReportTest, WriteRunReport) {
+  const std::string path =
+      std::string{std::getenv("TEST_TMPDIR")} + "/run_report.json";
+  const auto report = MakeReport();
+
+  WriteRunReport(report, path);
+
+  std::ifstream file{path};
+  std::stringstream contents;
+  contents << file.rdbuf();
+  ASSERT_EQ(contents.str(), ToJson(report) + "\n");
+}
+
+TEST(RunReportTest, WriteRunReportToMissingDirectoryThrowsError) {
+  const std::string path = std::string{std::getenv("TEST_TMPDIR")} +
+                           "/missing_directory/run_report.json";
+
+  ASSERT_THROW(WriteRunReport(MakeReport(), path), std::runtime_error);
+}